@@ -0,0 +1,638 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Parsed blame results, one file per commit and path in the user's cache
+ * directory. The blame of a path at a given commit never changes, the
+ * blob sha stored along only guards against stale or damaged entries.
+ * Hits touch their file, so once the cache grows beyond its limit the
+ * entries with the oldest modification time get evicted first.
+ *
+ * Entries get written by a worker thread, which also keeps count of the
+ * cache's size and evicts entries, so the UI never waits for that.
+ */
+
+#include "config.h"
+#include "giggle-blame-cache.h"
+#include "giggle-git.h"
+
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define SHA_LENGTH 40
+
+#define CACHE_MAGIC    "GGLBLME"
+#define CACHE_VERSION  1
+
+#define CACHE_MAX_SIZE (32 * 1024 * 1024)
+
+/* file header, the cache is machine local so host byte order is fine */
+typedef struct {
+	gchar   magic[8];
+	guint32 version;
+	guint32 n_chunks;
+	guint32 n_revisions;
+	guint32 text_length;
+	gchar   blob[SHA_LENGTH];
+} CacheHeader;
+
+/* followed by n_revisions author times, and the NUL terminated
+ * sha, author, committer and summary of each revision */
+typedef struct {
+	guint32 source_line;
+	guint32 result_line;
+	guint32 num_lines;
+	guint32 revision;
+} CacheChunk;
+
+typedef struct {
+	gchar  *filename;
+	time_t  mtime;
+	goffset size;
+} CacheEntry;
+
+typedef struct {
+	gchar   *directory;
+	gchar   *filename;
+	GString *contents;
+} StoreTask;
+
+typedef struct GiggleBlameCachePriv GiggleBlameCachePriv;
+
+struct GiggleBlameCachePriv {
+	gchar   *directory;
+};
+
+/* runs one StoreTask after the other */
+static GThreadPool *store_pool = NULL;
+
+/* total size of the cache files, -1 until counted. only the store
+ * thread uses it. */
+static goffset      cache_size = -1;
+
+static void blame_cache_finalize (GObject *object);
+
+G_DEFINE_TYPE (GiggleBlameCache, giggle_blame_cache, G_TYPE_OBJECT)
+
+#define GET_PRIV(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIGGLE_TYPE_BLAME_CACHE, GiggleBlameCachePriv))
+
+static void
+giggle_blame_cache_class_init (GiggleBlameCacheClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+	object_class->finalize = blame_cache_finalize;
+
+	g_type_class_add_private (object_class, sizeof (GiggleBlameCachePriv));
+}
+
+static void
+giggle_blame_cache_init (GiggleBlameCache *cache)
+{
+	GiggleBlameCachePriv *priv;
+
+	priv = GET_PRIV (cache);
+
+	priv->directory = g_build_filename (g_get_user_cache_dir (),
+					    PACKAGE, "blame", NULL);
+}
+
+static void
+blame_cache_finalize (GObject *object)
+{
+	GiggleBlameCachePriv *priv;
+
+	priv = GET_PRIV (object);
+
+	g_free (priv->directory);
+
+	G_OBJECT_CLASS (giggle_blame_cache_parent_class)->finalize (object);
+}
+
+static gchar *
+blame_cache_get_filename (GiggleBlameCachePriv *priv,
+			  GiggleRevision       *revision,
+			  const char           *file)
+{
+	gchar *key, *checksum, *filename;
+
+	key = g_strconcat (giggle_revision_get_sha (revision), ":", file, NULL);
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+	filename = g_build_filename (priv->directory, checksum, NULL);
+
+	g_free (checksum);
+	g_free (key);
+
+	return filename;
+}
+
+static const gchar *
+blame_cache_next_string (const gchar **text,
+			 const gchar  *end)
+{
+	const gchar *str = *text;
+	const gchar *nul;
+
+	if (str >= end || !(nul = memchr (str, '\0', end - str)))
+		return NULL;
+
+	*text = nul + 1;
+
+	return str;
+}
+
+static GiggleAuthor *
+blame_cache_new_author (const gchar *name)
+{
+	return *name ? giggle_author_new_from_name (name, NULL) : NULL;
+}
+
+static GPtrArray *
+blame_cache_parse_revisions (const CacheHeader *header,
+			     const gint64      *times,
+			     const gchar       *text)
+{
+	GiggleRevisionRegistry *registry;
+	GPtrArray              *revisions;
+	GiggleRevision         *revision;
+	GiggleAuthor           *author, *committer;
+	const gchar            *end, *sha, *author_name, *committer_name, *summary;
+	struct tm              *date;
+	time_t                  time;
+	guint32                 i;
+
+	registry = giggle_git_get_revision_registry (giggle_git_get ());
+	revisions = g_ptr_array_sized_new (header->n_revisions);
+	end = text + header->text_length;
+
+	for (i = 0; i < header->n_revisions; ++i) {
+		sha            = blame_cache_next_string (&text, end);
+		author_name    = blame_cache_next_string (&text, end);
+		committer_name = blame_cache_next_string (&text, end);
+		summary        = blame_cache_next_string (&text, end);
+
+		if (!summary || strlen (sha) != SHA_LENGTH)
+			break;
+
+		revision = giggle_revision_registry_resolve (registry, sha);
+		g_ptr_array_add (revisions, revision);
+
+		/* commits loaded by the history already have all details */
+		if (giggle_revision_get_author (revision))
+			continue;
+
+		author = blame_cache_new_author (author_name);
+		committer = blame_cache_new_author (committer_name);
+
+		if (author) {
+			giggle_revision_set_author (revision, author);
+			g_object_unref (author);
+		}
+
+		if (committer) {
+			giggle_revision_set_committer (revision, committer);
+			g_object_unref (committer);
+		}
+
+		if (times[i]) {
+			date = g_new (struct tm, 1); time = times[i];
+			giggle_revision_set_date (revision, gmtime_r (&time, date));
+		}
+
+		giggle_revision_set_short_log (revision, summary);
+	}
+
+	if (i < header->n_revisions) {
+		g_ptr_array_foreach (revisions, (GFunc) g_object_unref, NULL);
+		g_ptr_array_free (revisions, TRUE);
+		revisions = NULL;
+	}
+
+	return revisions;
+}
+
+/* Calls func for each chunk of the blame of file at revision,
+ * when the cache has it for the very blob given. */
+gboolean
+giggle_blame_cache_lookup (GiggleBlameCache     *cache,
+			   GiggleRevision       *revision,
+			   const char           *file,
+			   const char           *blob,
+			   GiggleBlameCacheFunc  func,
+			   gpointer              user_data)
+{
+	GiggleBlameCachePriv *priv;
+	GiggleGitBlameChunk   chunk;
+	CacheChunk           *chunks = NULL;
+	CacheHeader           header;
+	GPtrArray            *revisions = NULL;
+	gchar                *filename, *contents = NULL;
+	gint64               *times = NULL;
+	gboolean              success = FALSE;
+	gsize                 length;
+	guint32               i;
+
+	g_return_val_if_fail (GIGGLE_IS_BLAME_CACHE (cache), FALSE);
+	g_return_val_if_fail (NULL != file, FALSE);
+	g_return_val_if_fail (NULL != func, FALSE);
+
+	if (!revision || !blob)
+		return FALSE;
+
+	priv = GET_PRIV (cache);
+	filename = blame_cache_get_filename (priv, revision, file);
+
+	if (!g_file_get_contents (filename, &contents, &length, NULL))
+		goto out;
+
+	if (length < sizeof (header))
+		goto invalid;
+
+	memcpy (&header, contents, sizeof (header));
+
+	if (memcmp (header.magic, CACHE_MAGIC, sizeof (CACHE_MAGIC)) ||
+	    CACHE_VERSION != header.version ||
+	    strncmp (header.blob, blob, SHA_LENGTH))
+		goto invalid;
+
+	if (length != sizeof (header) +
+	    (gsize) header.n_chunks * sizeof (CacheChunk) +
+	    (gsize) header.n_revisions * sizeof (gint64) +
+	    header.text_length)
+		goto invalid;
+
+	/* copied, as the file contents are not aligned for them */
+	times = g_memdup (contents + sizeof (header) +
+			  header.n_chunks * sizeof (CacheChunk),
+			  header.n_revisions * sizeof (gint64));
+
+	revisions = blame_cache_parse_revisions
+		(&header, times, contents + length - header.text_length);
+
+	if (!revisions)
+		goto invalid;
+
+	chunks = g_memdup (contents + sizeof (header),
+			   header.n_chunks * sizeof (CacheChunk));
+
+	for (i = 0; i < header.n_chunks; ++i) {
+		if (chunks[i].revision >= revisions->len)
+			break;
+	}
+
+	if (i < header.n_chunks)
+		goto invalid;
+
+	for (i = 0; i < header.n_chunks; ++i) {
+		chunk.revision    = revisions->pdata[chunks[i].revision];
+		chunk.source_line = chunks[i].source_line;
+		chunk.result_line = chunks[i].result_line;
+		chunk.num_lines   = chunks[i].num_lines;
+
+		func (&chunk, user_data);
+	}
+
+	/* keeps recently used entries away from eviction */
+	g_utime (filename, NULL);
+	success = TRUE;
+
+	goto out;
+
+invalid:
+	g_unlink (filename);
+
+out:
+	if (revisions) {
+		g_ptr_array_foreach (revisions, (GFunc) g_object_unref, NULL);
+		g_ptr_array_free (revisions, TRUE);
+	}
+
+	g_free (filename);
+	g_free (contents);
+	g_free (chunks);
+	g_free (times);
+
+	return success;
+}
+
+/* only checks the header, for deciding whether to blame at all */
+gboolean
+giggle_blame_cache_contains (GiggleBlameCache *cache,
+			     GiggleRevision   *revision,
+			     const char       *file,
+			     const char       *blob)
+{
+	CacheHeader  header;
+	gboolean     success = FALSE;
+	gchar       *filename;
+	FILE        *stream;
+
+	g_return_val_if_fail (GIGGLE_IS_BLAME_CACHE (cache), FALSE);
+	g_return_val_if_fail (NULL != file, FALSE);
+
+	if (!revision || !blob)
+		return FALSE;
+
+	filename = blame_cache_get_filename (GET_PRIV (cache), revision, file);
+	stream = g_fopen (filename, "rb");
+
+	if (stream) {
+		success = (1 == fread (&header, sizeof (header), 1, stream) &&
+			   !memcmp (header.magic, CACHE_MAGIC, sizeof (CACHE_MAGIC)) &&
+			   CACHE_VERSION == header.version &&
+			   !strncmp (header.blob, blob, SHA_LENGTH));
+
+		fclose (stream);
+	}
+
+	g_free (filename);
+
+	return success;
+}
+
+static int
+blame_cache_entry_compare (gconstpointer a,
+			   gconstpointer b)
+{
+	const CacheEntry *entry_a = a;
+	const CacheEntry *entry_b = b;
+
+	if (entry_a->mtime != entry_b->mtime)
+		return entry_a->mtime < entry_b->mtime ? -1 : 1;
+
+	return 0;
+}
+
+/* counts the cache's size, and evicts the least recently used
+ * entries once that exceeds the limit */
+static void
+blame_cache_trim (const gchar *directory,
+		  gboolean     evict)
+{
+	GArray      *entries;
+	CacheEntry   entry;
+	const gchar *name;
+	gchar       *filename;
+	struct stat  st;
+	GDir        *dir;
+	guint        i;
+
+	dir = g_dir_open (directory, 0, NULL);
+
+	if (!dir)
+		return;
+
+	entries = g_array_new (FALSE, FALSE, sizeof (CacheEntry));
+	cache_size = 0;
+
+	while ((name = g_dir_read_name (dir))) {
+		filename = g_build_filename (directory, name, NULL);
+
+		if (g_stat (filename, &st) || !S_ISREG (st.st_mode)) {
+			g_free (filename);
+			continue;
+		}
+
+		entry.filename = filename;
+		entry.mtime = st.st_mtime;
+		entry.size = st.st_size;
+
+		g_array_append_val (entries, entry);
+		cache_size += entry.size;
+	}
+
+	g_dir_close (dir);
+
+	if (evict && cache_size > CACHE_MAX_SIZE) {
+		g_array_sort (entries, blame_cache_entry_compare);
+
+		/* leaves some room, so that not every store evicts */
+		for (i = 0; i < entries->len && cache_size > CACHE_MAX_SIZE / 4 * 3; ++i) {
+			entry = g_array_index (entries, CacheEntry, i);
+
+			if (!g_unlink (entry.filename))
+				cache_size -= entry.size;
+		}
+	}
+
+	for (i = 0; i < entries->len; ++i)
+		g_free (g_array_index (entries, CacheEntry, i).filename);
+
+	g_array_free (entries, TRUE);
+}
+
+static void
+store_task_free (StoreTask *task)
+{
+	g_free (task->directory);
+	g_free (task->filename);
+	g_string_free (task->contents, TRUE);
+	g_slice_free (StoreTask, task);
+}
+
+static void
+blame_cache_store_thread (gpointer data,
+			  gpointer user_data)
+{
+	StoreTask   *task = data;
+	GError      *error = NULL;
+	struct stat  st;
+	goffset      old_size = 0;
+
+	/* storing a commit's blame again replaces its entry */
+	if (!g_stat (task->filename, &st) && S_ISREG (st.st_mode))
+		old_size = st.st_size;
+
+	if (g_mkdir_with_parents (task->directory, 0700) ||
+	    !g_file_set_contents (task->filename, task->contents->str,
+				  task->contents->len, &error)) {
+		if (error)
+			g_warning ("Cannot save blame: %s", error->message);
+
+		g_clear_error (&error);
+	} else {
+		/* the directory only gets listed when the count says so */
+		if (cache_size < 0)
+			blame_cache_trim (task->directory, FALSE);
+		else
+			cache_size += (goffset) task->contents->len - old_size;
+
+		if (cache_size > CACHE_MAX_SIZE)
+			blame_cache_trim (task->directory, TRUE);
+	}
+
+	store_task_free (task);
+}
+
+static const gchar *
+blame_cache_get_author_name (GiggleAuthor *author)
+{
+	const gchar *name = NULL;
+
+	if (author)
+		name = giggle_author_get_name (author);
+
+	return name ? name : "";
+}
+
+/* Saves the result of a finished blame job, which must cover the entire
+ * file. blob is the sha of the file's contents at the blamed revision. */
+void
+giggle_blame_cache_store (GiggleBlameCache *cache,
+			  GiggleGitBlame   *blame,
+			  const char       *blob)
+{
+	GiggleBlameCachePriv      *priv;
+	const GiggleGitBlameChunk *chunk;
+	GiggleRevision            *revision;
+	CacheHeader                header;
+	CacheChunk                 cache_chunk;
+	StoreTask                 *task;
+	GHashTable                *ids;
+	GArray                    *chunks, *times;
+	GString                   *text, *contents;
+	const struct tm           *date;
+	struct tm                  tm;
+	GError                    *error = NULL;
+	gchar                     *file;
+	gint64                     time;
+	int                        i, first_line;
+
+	g_return_if_fail (GIGGLE_IS_BLAME_CACHE (cache));
+	g_return_if_fail (GIGGLE_IS_GIT_BLAME (blame));
+
+	g_object_get (blame, "revision", &revision, "file", &file,
+		      "first-line", &first_line, NULL);
+
+	if (!revision || !blob || first_line > 0)
+		goto out;
+
+	priv = GET_PRIV (cache);
+
+	ids = g_hash_table_new (g_str_hash, g_str_equal);
+	chunks = g_array_new (FALSE, FALSE, sizeof (CacheChunk));
+	times = g_array_new (FALSE, FALSE, sizeof (gint64));
+	text = g_string_new (NULL);
+
+	for (i = 0; (chunk = giggle_git_blame_get_chunk (blame, i)); ++i) {
+		const gchar *sha = giggle_revision_get_sha (chunk->revision);
+		gpointer     id;
+
+		if (!g_hash_table_lookup_extended (ids, sha, NULL, &id)) {
+			id = GUINT_TO_POINTER (times->len);
+			g_hash_table_insert (ids, (gpointer) sha, id);
+
+			date = giggle_revision_get_date (chunk->revision);
+			time = 0;
+
+			if (date) {
+				tm = *date;
+				time = timegm (&tm);
+			}
+
+			g_array_append_val (times, time);
+
+			g_string_append_len (text, sha, strlen (sha) + 1);
+			g_string_append (text, blame_cache_get_author_name
+					 (giggle_revision_get_author (chunk->revision)));
+			g_string_append_c (text, '\0');
+			g_string_append (text, blame_cache_get_author_name
+					 (giggle_revision_get_committer (chunk->revision)));
+			g_string_append_c (text, '\0');
+
+			if (giggle_revision_get_short_log (chunk->revision))
+				g_string_append (text, giggle_revision_get_short_log (chunk->revision));
+
+			g_string_append_c (text, '\0');
+		}
+
+		cache_chunk.source_line = chunk->source_line;
+		cache_chunk.result_line = chunk->result_line;
+		cache_chunk.num_lines = chunk->num_lines;
+		cache_chunk.revision = GPOINTER_TO_UINT (id);
+
+		g_array_append_val (chunks, cache_chunk);
+	}
+
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, CACHE_MAGIC, sizeof (CACHE_MAGIC));
+	header.version = CACHE_VERSION;
+	header.n_chunks = chunks->len;
+	header.n_revisions = times->len;
+	header.text_length = text->len;
+	strncpy (header.blob, blob, SHA_LENGTH);
+
+	contents = g_string_sized_new (sizeof (header) +
+				       chunks->len * sizeof (CacheChunk) +
+				       times->len * sizeof (gint64) + text->len);
+
+	g_string_append_len (contents, (const gchar *) &header, sizeof (header));
+	g_string_append_len (contents, chunks->data, chunks->len * sizeof (CacheChunk));
+	g_string_append_len (contents, times->data, times->len * sizeof (gint64));
+	g_string_append_len (contents, text->str, text->len);
+
+	task = g_slice_new (StoreTask);
+	task->directory = g_strdup (priv->directory);
+	task->filename = blame_cache_get_filename (priv, revision, file);
+	task->contents = contents;
+
+	if (!store_pool) {
+		store_pool = g_thread_pool_new (blame_cache_store_thread, NULL,
+						1, FALSE, &error);
+	}
+
+	if (store_pool) {
+		g_thread_pool_push (store_pool, task, NULL);
+	} else {
+		g_warning ("Cannot save blame: %s", error->message);
+		g_clear_error (&error);
+
+		/* not worth blocking for */
+		store_task_free (task);
+	}
+
+	g_string_free (text, TRUE);
+	g_array_free (times, TRUE);
+	g_array_free (chunks, TRUE);
+	g_hash_table_destroy (ids);
+
+out:
+	if (revision)
+		g_object_unref (revision);
+
+	g_free (file);
+}
+
+GiggleBlameCache *
+giggle_blame_cache_get (void)
+{
+	static GiggleBlameCache *cache = NULL;
+
+	if (!cache) {
+		cache = g_object_new (GIGGLE_TYPE_BLAME_CACHE, NULL);
+		g_object_add_weak_pointer (G_OBJECT (cache), (gpointer) &cache);
+	} else {
+		g_object_ref (cache);
+	}
+
+	return cache;
+}
@@ -0,0 +1,68 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GIGGLE_BLAME_CACHE_H__
+#define __GIGGLE_BLAME_CACHE_H__
+
+#include <libgiggle-git/giggle-git-blame.h>
+
+G_BEGIN_DECLS
+
+#define GIGGLE_TYPE_BLAME_CACHE            (giggle_blame_cache_get_type ())
+#define GIGGLE_BLAME_CACHE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIGGLE_TYPE_BLAME_CACHE, GiggleBlameCache))
+#define GIGGLE_BLAME_CACHE_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), GIGGLE_TYPE_BLAME_CACHE, GiggleBlameCacheClass))
+#define GIGGLE_IS_BLAME_CACHE(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GIGGLE_TYPE_BLAME_CACHE))
+#define GIGGLE_IS_BLAME_CACHE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GIGGLE_TYPE_BLAME_CACHE))
+#define GIGGLE_BLAME_CACHE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GIGGLE_TYPE_BLAME_CACHE, GiggleBlameCacheClass))
+
+typedef struct GiggleBlameCache      GiggleBlameCache;
+typedef struct GiggleBlameCacheClass GiggleBlameCacheClass;
+
+struct GiggleBlameCache {
+	GObject parent_instance;
+};
+
+struct GiggleBlameCacheClass {
+	GObjectClass parent_class;
+};
+
+typedef void (* GiggleBlameCacheFunc) (const GiggleGitBlameChunk *chunk,
+				       gpointer                   user_data);
+
+GType              giggle_blame_cache_get_type (void);
+GiggleBlameCache * giggle_blame_cache_get      (void);
+
+gboolean           giggle_blame_cache_lookup   (GiggleBlameCache     *cache,
+						GiggleRevision       *revision,
+						const char           *file,
+						const char           *blob,
+						GiggleBlameCacheFunc  func,
+						gpointer              user_data);
+gboolean           giggle_blame_cache_contains (GiggleBlameCache     *cache,
+						GiggleRevision       *revision,
+						const char           *file,
+						const char           *blob);
+void               giggle_blame_cache_store    (GiggleBlameCache     *cache,
+						GiggleGitBlame       *blame,
+						const char           *blob);
+
+G_END_DECLS
+
+#endif /* __GIGGLE_BLAME_CACHE_H__ */
@@ -20,6 +20,7 @@
 
 #include "config.h"
 #include "giggle-git-blame.h"
+#include "giggle-git.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -30,8 +31,18 @@ struct GiggleGitBlamePriv {
 	GiggleRevision *revision;
 
 	char           *file;
+	int             first_line;
+	int             last_line;
+
 	GPtrArray      *chunks;
-	GHashTable     *revision_cache;
+
+	/* the chunk whose header lines are being received,
+	 * and the incomplete line of the last output block */
+	GiggleGitBlameChunk *chunk;
+	GString             *pending;
+
+	/* whether the chunk's revision still lacks its details */
+	gboolean             fill_revision;
 };
 
 G_DEFINE_TYPE (GiggleGitBlame, giggle_git_blame, GIGGLE_TYPE_JOB)
@@ -42,8 +53,17 @@ enum {
 	PROP_0,
 	PROP_REVISION,
 	PROP_FILE,
+	PROP_FIRST_LINE,
+	PROP_LAST_LINE,
+};
+
+enum {
+	CHUNK_ADDED,
+	LAST_SIGNAL
 };
 
+static guint signals[LAST_SIGNAL] = { 0, };
+
 
 static void
 git_blame_finalize (GObject *object)
@@ -53,6 +73,7 @@ git_blame_finalize (GObject *object)
 	priv = GET_PRIV (object);
 
 	g_ptr_array_free (priv->chunks, TRUE);
+	g_string_free (priv->pending, TRUE);
 	g_free (priv->file);
 
 	G_OBJECT_CLASS (giggle_git_blame_parent_class)->finalize (object);
@@ -71,13 +92,9 @@ git_blame_dispose (GObject *object)
 		priv->revision = NULL;
 	}
 
-	if (priv->revision_cache) {
-		g_hash_table_destroy (priv->revision_cache);
-		priv->revision_cache = NULL;
-	}
-
 	while (priv->chunks->len > 0) {
 		i = priv->chunks->len - 1;
+		g_object_unref (((GiggleGitBlameChunk *) priv->chunks->pdata[i])->revision);
 		g_slice_free (GiggleGitBlameChunk, priv->chunks->pdata[i]);
 		g_ptr_array_remove_index_fast (priv->chunks, i);
 	}
@@ -104,6 +121,14 @@ git_blame_get_property (GObject    *object,
 		g_value_set_string (value, priv->file);
 		break;
 
+	case PROP_FIRST_LINE:
+		g_value_set_int (value, priv->first_line);
+		break;
+
+	case PROP_LAST_LINE:
+		g_value_set_int (value, priv->last_line);
+		break;
+
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
 		break;
@@ -131,6 +156,14 @@ git_blame_set_property (GObject      *object,
 		priv->file = g_value_dup_string (value);
 		break;
 
+	case PROP_FIRST_LINE:
+		priv->first_line = g_value_get_int (value);
+		break;
+
+	case PROP_LAST_LINE:
+		priv->last_line = g_value_get_int (value);
+		break;
+
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
 		break;
@@ -143,6 +176,7 @@ git_blame_get_command_line (GiggleJob *job, gchar **command_line)
 	GiggleGitBlamePriv *priv;
 	const char         *sha = "";
 	char		   *file;
+	GString            *str;
 
 	priv = GET_PRIV (job);
 
@@ -150,82 +184,138 @@ git_blame_get_command_line (GiggleJob *job, gchar **command_line)
 		sha = giggle_revision_get_sha (priv->revision);
 
 	file = g_shell_quote (priv->file);
+	str = g_string_new (GIT_COMMAND " blame --incremental");
+
+	if (priv->first_line > 0) {
+		g_string_append_printf (str, " -L %d,%d",
+					priv->first_line,
+					MAX (priv->first_line, priv->last_line));
+	}
 
-	*command_line = g_strconcat (GIT_COMMAND " blame --incremental ",
-				     sha, " ", file, NULL);
+	g_string_append_printf (str, " %s %s", sha, file);
+	*command_line = g_string_free (str, FALSE);
 
 	g_free (file);
 
 	return TRUE;
 }
 
+/* fills in the revision's details from a header line */
 static void
-git_blame_handle_output (GiggleJob   *job,
-			 const gchar *output_str,
-			 gsize        output_len)
+git_blame_parse_revision_line (GiggleRevision *revision,
+			       const char     *start,
+			       const char     *end)
+{
+	GiggleAuthor *author;
+	time_t        time;
+	int           i;
+
+	if (g_str_has_prefix (start, "author ")) {
+		char *name = g_strndup (start + 7, end - start - 7);
+		author = giggle_author_new_from_name (name, NULL);
+		giggle_revision_set_author (revision, author);
+		g_object_unref (author);
+		g_free (name);
+	} else if (g_str_has_prefix (start, "committer ")) {
+		char *name = g_strndup (start + 10, end - start - 10);
+		author = giggle_author_new_from_name (name, NULL);
+		giggle_revision_set_committer (revision, author);
+		g_object_unref (author);
+		g_free (name);
+	} else if (1 == sscanf (start, "author-time %d\n", &i)) {
+		struct tm *date = g_new (struct tm, 1); time = i;
+		giggle_revision_set_date (revision, gmtime_r (&time, date));
+	} else if (g_str_has_prefix (start, "summary ")) {
+		char *summary = g_strndup (start + 8, end - start - 8);
+		giggle_revision_set_short_log (revision, summary);
+		g_free (summary);
+	}
+}
+
+static void
+git_blame_parse_line (GiggleGitBlame *blame,
+		      const char     *start,
+		      const char     *end)
 {
 	GiggleGitBlamePriv  *priv;
-	const char          *start, *end;
-	GiggleGitBlameChunk *chunk = NULL;
-	GiggleAuthor        *author = NULL;
-	GiggleAuthor        *committer = NULL;
+	GiggleGitBlameChunk *chunk;
 	char                 sha[41];
-	time_t               time;
-	int                  i;
 
-	priv = GET_PRIV (job);
+	priv = GET_PRIV (blame);
+	chunk = priv->chunk;
+
+	if (!chunk) {
+		chunk = g_slice_new0 (GiggleGitBlameChunk);
+		g_ptr_array_add (priv->chunks, chunk);
+		priv->chunk = chunk;
+
+		g_warn_if_fail (4 == sscanf
+			(start, "%40s %d %d %d", sha,
+			 &chunk->source_line, &chunk->result_line,
+			 &chunk->num_lines));
+
+		/* commits loaded by the history already have all details */
+		chunk->revision = giggle_revision_registry_resolve
+			(giggle_git_get_revision_registry (giggle_git_get ()), sha);
+		priv->fill_revision = !giggle_revision_get_author (chunk->revision);
+	} else if (g_str_has_prefix (start, "filename ")) {
+		/* the filename line terminates each chunk */
+		priv->chunk = NULL;
+		g_signal_emit (blame, signals[CHUNK_ADDED], 0, chunk);
+	} else if (priv->fill_revision) {
+		git_blame_parse_revision_line (chunk->revision, start, end);
+	}
+}
+
+static void
+git_blame_parse (GiggleGitBlame *blame,
+		 const char     *output_str,
+		 gsize           output_len)
+{
+	GiggleGitBlamePriv *priv;
+	const char         *start, *end, *eol;
+
+	priv = GET_PRIV (blame);
+	end = output_str + output_len;
 
-	for (end = output_str; *end; ++end) {
-		start = end;
-		end = strchr (start, '\n');
+	for (start = output_str; start < end; start = eol + 1) {
+		eol = memchr (start, '\n', end - start);
 
-		if (NULL == end)
+		if (!eol) {
+			/* the rest of this line comes with the next block */
+			g_string_append_len (priv->pending, start, end - start);
 			break;
+		}
+
+		if (priv->pending->len > 0) {
+			g_string_append_len (priv->pending, start, eol - start);
+
+			git_blame_parse_line (blame, priv->pending->str,
+					      priv->pending->str + priv->pending->len);
 
-		if (!chunk) {
-			chunk = g_slice_new0 (GiggleGitBlameChunk);
-			g_ptr_array_add (priv->chunks, chunk);
-
-			g_warn_if_fail (4 == sscanf
-				(start, "%40s %d %d %d", sha,
-				 &chunk->source_line, &chunk->result_line,
-				 &chunk->num_lines));
-
-			chunk->revision = g_hash_table_lookup (priv->revision_cache, sha);
-
-			if (!chunk->revision) {
-				chunk->revision = giggle_revision_new (sha);
-
-				g_hash_table_insert (priv->revision_cache,
-						     g_strdup (sha), chunk->revision);
-			}
-		} else if (g_str_has_prefix (start, "author ")) {
-			char *name = g_strndup (start + 7, end - start - 7);
-			author = giggle_author_new_from_name (name, NULL);
-			giggle_revision_set_author (chunk->revision, author);
-			g_object_unref (author);
-			g_free (name);
-		} else if (g_str_has_prefix (start, "committer ")) {
-			char *name = g_strndup (start + 10, end - start - 10);
-			committer = giggle_author_new_from_name (name, NULL);
-			giggle_revision_set_committer (chunk->revision, author);
-			g_object_unref (committer);
-			g_free (name);
-		} else if (1 == sscanf (start, "author-time %d\n", &i)) {
-			struct tm *date = g_new (struct tm, 1); time = i;
-			giggle_revision_set_date (chunk->revision, gmtime_r (&time, date));
-		} else if (g_str_has_prefix (start, "summary ")) {
-			char *summary = g_strndup (start + 8, end - start - 8);
-			giggle_revision_set_short_log (chunk->revision, summary);
-			g_free (summary);
-		} else if (g_str_has_prefix (start, "filename ")) {
-			committer = NULL;
-			author = NULL;
-			chunk = NULL;
+			g_string_truncate (priv->pending, 0);
+		} else {
+			git_blame_parse_line (blame, start, eol);
 		}
 	}
 }
 
+static void
+git_blame_handle_partial_output (GiggleJob   *job,
+				 const gchar *output_str,
+				 gsize        output_len)
+{
+	git_blame_parse (GIGGLE_GIT_BLAME (job), output_str, output_len);
+}
+
+static void
+git_blame_handle_output (GiggleJob   *job,
+			 const gchar *output_str,
+			 gsize        output_len)
+{
+	git_blame_parse (GIGGLE_GIT_BLAME (job), output_str, output_len);
+}
+
 static void
 giggle_git_blame_class_init (GiggleGitBlameClass *class)
 {
@@ -239,6 +329,7 @@ giggle_git_blame_class_init (GiggleGitBlameClass *class)
 
 	job_class->get_command_line = git_blame_get_command_line;
 	job_class->handle_output    = git_blame_handle_output;
+	job_class->handle_partial_output = git_blame_handle_partial_output;
 
 	g_object_class_install_property (object_class,
 					 PROP_REVISION,
@@ -258,6 +349,33 @@ giggle_git_blame_class_init (GiggleGitBlameClass *class)
 							      G_PARAM_READWRITE |
 							      G_PARAM_CONSTRUCT_ONLY));
 
+	g_object_class_install_property (object_class,
+					 PROP_FIRST_LINE,
+					 g_param_spec_int ("first-line",
+							   "first line",
+							   "first line to annotate, 0 for the whole file",
+							   0, G_MAXINT, 0,
+							   G_PARAM_READWRITE |
+							   G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property (object_class,
+					 PROP_LAST_LINE,
+					 g_param_spec_int ("last-line",
+							   "last line",
+							   "last line to annotate",
+							   0, G_MAXINT, 0,
+							   G_PARAM_READWRITE |
+							   G_PARAM_CONSTRUCT_ONLY));
+
+	signals[CHUNK_ADDED] =
+		g_signal_new ("chunk-added",
+			      G_OBJECT_CLASS_TYPE (object_class),
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (GiggleGitBlameClass, chunk_added),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__POINTER,
+			      G_TYPE_NONE, 1, G_TYPE_POINTER);
+
 	g_type_class_add_private (object_class, sizeof (GiggleGitBlamePriv));
 }
 
@@ -269,9 +387,7 @@ giggle_git_blame_init (GiggleGitBlame *blame)
 	priv = GET_PRIV (blame);
 
 	priv->chunks = g_ptr_array_new ();
-
-	priv->revision_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
-						      g_free, g_object_unref);
+	priv->pending = g_string_new (NULL);
 }
 
 GiggleJob *
@@ -285,6 +401,23 @@ giggle_git_blame_new (GiggleRevision *revision,
 			     "file", file, NULL);
 }
 
+/* annotates the lines first_line to last_line only, counting from 1 */
+GiggleJob *
+giggle_git_blame_new_for_range (GiggleRevision *revision,
+				const char     *file,
+				int             first_line,
+				int             last_line)
+{
+	g_return_val_if_fail (NULL != file, NULL);
+	g_return_val_if_fail (first_line > 0, NULL);
+
+	return g_object_new (GIGGLE_TYPE_GIT_BLAME,
+			     "revision", revision,
+			     "file", file,
+			     "first-line", first_line,
+			     "last-line", last_line, NULL);
+}
+
 const GiggleGitBlameChunk *
 giggle_git_blame_get_chunk (GiggleGitBlame *blame,
 			    int             index)
@@ -37,24 +37,33 @@ typedef struct GiggleGitBlame       GiggleGitBlame;
 typedef struct GiggleGitBlameClass  GiggleGitBlameClass;
 typedef struct GiggleGitBlameChunk  GiggleGitBlameChunk;
 
+struct GiggleGitBlameChunk {
+	GiggleRevision *revision;
+	int             source_line;
+	int             result_line;
+	int             num_lines;
+};
+
 struct GiggleGitBlame {
 	GiggleJob parent;
 };
 
 struct GiggleGitBlameClass {
 	GiggleJobClass parent_class;
-};
 
-struct GiggleGitBlameChunk {
-	GiggleRevision *revision;
-	int             source_line;
-	int             result_line;
-	int             num_lines;
+	/* emitted while the command runs, for each chunk once parsed */
+	void (* chunk_added) (GiggleGitBlame            *blame,
+			      const GiggleGitBlameChunk *chunk);
 };
 
 GType                       giggle_git_blame_get_type  (void);
 GiggleJob *                 giggle_git_blame_new       (GiggleRevision *revision,
 					                const char     *file);
+GiggleJob *                 giggle_git_blame_new_for_range
+							(GiggleRevision *revision,
+							 const char     *file,
+							 int             first_line,
+							 int             last_line);
 
 const GiggleGitBlameChunk * giggle_git_blame_get_chunk (GiggleGitBlame *blame,
 					                int             index);
@@ -21,13 +21,20 @@
 #include "config.h"
 #include "giggle-git-cat-file.h"
 
+#include <stdio.h>
+#include <string.h>
+
 typedef struct GiggleGitCatFilePriv GiggleGitCatFilePriv;
 
 struct GiggleGitCatFilePriv {
-	char  *contents;
-	gsize  length;
-	char  *type;
-	char  *sha;
+	char           *contents;
+	gsize           length;
+	char           *type;
+	char           *sha;
+
+	/* set when looking up a path, type and sha get filled in then */
+	GiggleRevision *revision;
+	char           *path;
 };
 
 G_DEFINE_TYPE (GiggleGitCatFile, giggle_git_cat_file, GIGGLE_TYPE_JOB)
@@ -38,6 +45,8 @@ enum {
 	PROP_0,
 	PROP_TYPE,
 	PROP_SHA,
+	PROP_REVISION,
+	PROP_PATH,
 };
 
 
@@ -48,9 +57,13 @@ git_cat_file_finalize (GObject *object)
 
 	priv = GET_PRIV (object);
 
+	if (priv->revision)
+		g_object_unref (priv->revision);
+
 	g_free (priv->contents);
 	g_free (priv->type);
 	g_free (priv->sha);
+	g_free (priv->path);
 
 	G_OBJECT_CLASS (giggle_git_cat_file_parent_class)->finalize (object);
 }
@@ -74,6 +87,14 @@ git_cat_file_get_property (GObject    *object,
 		g_value_set_string (value, priv->sha);
 		break;
 
+	case PROP_REVISION:
+		g_value_set_object (value, priv->revision);
+		break;
+
+	case PROP_PATH:
+		g_value_set_string (value, priv->path);
+		break;
+
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
 		break;
@@ -101,6 +122,16 @@ git_cat_file_set_property (GObject      *object,
 		priv->sha = g_value_dup_string (value);
 		break;
 
+	case PROP_REVISION:
+		g_assert (NULL == priv->revision);
+		priv->revision = g_value_dup_object (value);
+		break;
+
+	case PROP_PATH:
+		g_assert (NULL == priv->path);
+		priv->path = g_value_dup_string (value);
+		break;
+
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
 		break;
@@ -114,23 +145,69 @@ git_cat_file_get_command_line (GiggleJob *job, gchar **command_line)
 
 	priv = GET_PRIV (job);
 
-	*command_line = g_strconcat (GIT_COMMAND " cat-file ",
-				     priv->type, " ", priv->sha, NULL);
+	if (priv->path) {
+		*command_line = g_strdup (GIT_COMMAND " cat-file --batch");
+	} else {
+		*command_line = g_strconcat (GIT_COMMAND " cat-file ",
+					     priv->type, " ", priv->sha, NULL);
+	}
 
 	return TRUE;
 }
 
+static gchar *
+git_cat_file_get_input (GiggleJob *job)
+{
+	GiggleGitCatFilePriv *priv;
+	const char           *revision = "HEAD";
+
+	priv = GET_PRIV (job);
+
+	if (!priv->path)
+		return NULL;
+
+	if (priv->revision)
+		revision = giggle_revision_get_sha (priv->revision);
+
+	return g_strconcat (revision, ":", priv->path, "\n", NULL);
+}
+
 static void
 git_cat_file_handle_output (GiggleJob   *job,
 			    const gchar *output_str,
 			    gsize        output_len)
 {
 	GiggleGitCatFilePriv *priv;
+	const char           *eol;
+	char                  sha[41], type[16];
+	unsigned long         size;
 
 	priv = GET_PRIV (job);
 
-	priv->contents = g_strdup (output_str);
+	if (priv->path) {
+		/* "<sha> <type> <size>\n<contents>\n", or "<name> missing\n" */
+		eol = memchr (output_str, '\n', output_len);
+
+		if (!eol || 3 != sscanf (output_str, "%40s %15s %lu", sha, type, &size))
+			return;
+
+		output_len -= eol + 1 - output_str;
+		output_str = eol + 1;
+
+		if (size > output_len)
+			return;
+
+		priv->sha = g_strdup (sha);
+		priv->type = g_strdup (type);
+		output_len = size;
+	}
+
+	/* blobs may contain NUL characters */
+	priv->contents = g_malloc (output_len + 1);
 	priv->length = output_len;
+
+	memcpy (priv->contents, output_str, output_len);
+	priv->contents[output_len] = '\0';
 }
 
 static void
@@ -145,6 +222,7 @@ giggle_git_cat_file_class_init (GiggleGitCatFileClass *class)
 
 	job_class->get_command_line = git_cat_file_get_command_line;
 	job_class->handle_output    = git_cat_file_handle_output;
+	job_class->get_input        = git_cat_file_get_input;
 
 	g_object_class_install_property (object_class,
 					 PROP_TYPE,
@@ -164,6 +242,24 @@ giggle_git_cat_file_class_init (GiggleGitCatFileClass *class)
 							      G_PARAM_READWRITE |
 							      G_PARAM_CONSTRUCT_ONLY));
 
+	g_object_class_install_property (object_class,
+					 PROP_REVISION,
+					 g_param_spec_object ("revision",
+							      "revision",
+							      "revision to look up the path in",
+							      GIGGLE_TYPE_REVISION,
+							      G_PARAM_READWRITE |
+							      G_PARAM_CONSTRUCT_ONLY));
+
+	g_object_class_install_property (object_class,
+					 PROP_PATH,
+					 g_param_spec_string ("path",
+							      "path",
+							      "path of the file to retrieve",
+							      NULL,
+							      G_PARAM_READWRITE |
+							      G_PARAM_CONSTRUCT_ONLY));
+
 	g_type_class_add_private (object_class, sizeof (GiggleGitCatFilePriv));
 }
 
@@ -183,6 +279,33 @@ giggle_git_cat_file_new (const char *type,
 			     "type", type, "sha", sha, NULL);
 }
 
+/* Resolves path at revision, or at HEAD when revision is NULL, and
+ * retrieves whatever object it names in the same request. */
+GiggleJob *
+giggle_git_cat_file_new_for_path (GiggleRevision *revision,
+				  const char     *path)
+{
+	g_return_val_if_fail (NULL != path, NULL);
+
+	return g_object_new (GIGGLE_TYPE_GIT_CAT_FILE,
+			     "revision", revision, "path", path, NULL);
+}
+
+/* type of the object retrieved, NULL if the path wasn't found */
+const char *
+giggle_git_cat_file_get_kind (GiggleGitCatFile *job)
+{
+	g_return_val_if_fail (GIGGLE_IS_GIT_CAT_FILE (job), NULL);
+	return GET_PRIV (job)->type;
+}
+
+const char *
+giggle_git_cat_file_get_sha (GiggleGitCatFile *job)
+{
+	g_return_val_if_fail (GIGGLE_IS_GIT_CAT_FILE (job), NULL);
+	return GET_PRIV (job)->sha;
+}
+
 const char *
 giggle_git_cat_file_get_contents (GiggleGitCatFile *job,
 				  gsize            *length)
@@ -22,6 +22,7 @@
 #define __GIGGLE_GIT_CAT_FILE_H__
 
 #include <libgiggle/giggle-job.h>
+#include <libgiggle/giggle-revision.h>
 
 G_BEGIN_DECLS
 
@@ -46,9 +47,13 @@ struct GiggleGitCatFileClass {
 GType        giggle_git_cat_file_get_type     (void);
 GiggleJob *  giggle_git_cat_file_new          (const char *type,
 					       const char *sha);
+GiggleJob *  giggle_git_cat_file_new_for_path (GiggleRevision *revision,
+					       const char     *path);
 
 const char * giggle_git_cat_file_get_contents (GiggleGitCatFile *job,
 					       gsize            *length);
+const char * giggle_git_cat_file_get_kind     (GiggleGitCatFile *job);
+const char * giggle_git_cat_file_get_sha      (GiggleGitCatFile *job);
 
 G_END_DECLS
 
@@ -57,6 +57,8 @@ static const struct {
 	{ "giggle.file-view-hpane-position", TRUE },
 	[GIGGLE_GIT_CONFIG_FIELD_FILE_VIEW_VPANE_POSITION] =
 	{ "giggle.file-view-vpane-position", TRUE },
+	[GIGGLE_GIT_CONFIG_FIELD_FILE_VIEW_LARGE_FILE_SIZE] =
+	{ "giggle.file-view-large-file-size", TRUE },
 
 	[GIGGLE_GIT_CONFIG_FIELD_HISTORY_VIEW_VPANE_POSITION] =
 	{ "giggle.history-view-vpane-position", TRUE },
@@ -59,6 +59,7 @@ typedef enum {
 	GIGGLE_GIT_CONFIG_FIELD_FILE_VIEW_PATH,
 	GIGGLE_GIT_CONFIG_FIELD_FILE_VIEW_HPANE_POSITION,
 	GIGGLE_GIT_CONFIG_FIELD_FILE_VIEW_VPANE_POSITION,
+	GIGGLE_GIT_CONFIG_FIELD_FILE_VIEW_LARGE_FILE_SIZE,
 	GIGGLE_GIT_CONFIG_FIELD_HISTORY_VIEW_VPANE_POSITION,
 } GiggleGitConfigField;
 
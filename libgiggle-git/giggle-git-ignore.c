@@ -25,18 +25,46 @@
 
 #include <fnmatch.h>
 #include <string.h>
+#include <sys/stat.h>
+
+/* Patterns get sorted into buckets that can be checked by hashing:
+ * plain file names, "*suffix" patterns and plain paths. Only real
+ * globs are left for fnmatch(). */
+typedef struct {
+	GHashTable *names;
+	GHashTable *suffixes;
+	GArray     *suffix_lengths; /* ascending, no duplicates */
+	GHashTable *paths;
+	GPtrArray  *name_globs;
+	GPtrArray  *path_globs;
+} IgnoreMatcher;
+
+/* One ignore file, parsed and compiled. These get cached for the whole
+ * session and are shared by everyone reading the same file, they only
+ * get read again when the file's modification time or size changes. */
+typedef struct {
+	gchar         *path;
+	gchar         *relative_path;
+	time_t         mtime;
+	off_t          size;
+
+	GPtrArray     *globs;
+	IgnoreMatcher  matcher;
+} IgnoreFile;
 
 typedef struct GiggleGitIgnorePriv GiggleGitIgnorePriv;
 
 struct GiggleGitIgnorePriv {
-	GiggleGit *git;
-	gchar     *directory_path;
-	gchar     *relative_path;
+	GiggleGit  *git;
+	gchar      *directory_path;
+	gchar      *relative_path;
 
-	GPtrArray *globs;
-	GPtrArray *global_globs; /* .git/info/exclude */
+	IgnoreFile *file;
+	IgnoreFile *exclude; /* .git/info/exclude */
 };
 
+static GHashTable *ignore_files = NULL;
+
 static void       git_ignore_finalize           (GObject               *object);
 static void       git_ignore_get_property       (GObject               *object,
 						 guint                  param_id,
@@ -102,15 +130,7 @@ git_ignore_finalize (GObject *object)
 	g_free (priv->directory_path);
 	g_free (priv->relative_path);
 
-	if (priv->globs) {
-		g_ptr_array_foreach (priv->globs, (GFunc) g_free, NULL);
-		g_ptr_array_free (priv->globs, TRUE);
-	}
-
-	if (priv->global_globs) {
-		g_ptr_array_foreach (priv->global_globs, (GFunc) g_free, NULL);
-		g_ptr_array_free (priv->global_globs, TRUE);
-	}
+	/* the ignore files stay cached */
 
 	G_OBJECT_CLASS (giggle_git_ignore_parent_class)->finalize (object);
 }
@@ -155,31 +175,245 @@ git_ignore_set_property (GObject      *object,
 	}
 }
 
-static GPtrArray *
-git_ignore_read_file (const gchar *path)
+static const gchar *
+git_ignore_get_basename (const gchar *path)
+{
+	const gchar *basename;
+
+	basename = strrchr (path, G_DIR_SEPARATOR);
+
+	if (!basename) {
+		basename = path;
+	} else {
+		/* avoid dir separator */
+		basename++;
+	}
+
+	return basename;
+}
+
+static gboolean
+git_ignore_is_literal (const gchar *glob)
+{
+	return !strpbrk (glob, "*?[\\");
+}
+
+static void
+ignore_matcher_init (IgnoreMatcher *matcher)
+{
+	matcher->names = g_hash_table_new (g_str_hash, g_str_equal);
+	matcher->suffixes = g_hash_table_new (g_str_hash, g_str_equal);
+	matcher->suffix_lengths = g_array_new (FALSE, FALSE, sizeof (guint));
+	matcher->paths = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	matcher->name_globs = g_ptr_array_new ();
+	matcher->path_globs = g_ptr_array_new ();
+}
+
+static void
+ignore_matcher_clear (IgnoreMatcher *matcher)
+{
+	/* names, suffixes and name_globs point into the glob list */
+	g_hash_table_destroy (matcher->names);
+	g_hash_table_destroy (matcher->suffixes);
+	g_array_free (matcher->suffix_lengths, TRUE);
+	g_hash_table_destroy (matcher->paths);
+	g_ptr_array_free (matcher->name_globs, TRUE);
+	g_ptr_array_foreach (matcher->path_globs, (GFunc) g_free, NULL);
+	g_ptr_array_free (matcher->path_globs, TRUE);
+}
+
+static void
+ignore_matcher_add_suffix (IgnoreMatcher *matcher,
+			   const gchar   *suffix)
+{
+	guint length, i;
+
+	g_hash_table_insert (matcher->suffixes, (gpointer) suffix, (gpointer) suffix);
+	length = strlen (suffix);
+
+	for (i = 0; i < matcher->suffix_lengths->len; ++i) {
+		if (g_array_index (matcher->suffix_lengths, guint, i) == length)
+			return;
+		if (g_array_index (matcher->suffix_lengths, guint, i) > length)
+			break;
+	}
+
+	g_array_insert_val (matcher->suffix_lengths, i, length);
+}
+
+/* must stay in sync with git_ignore_path_matches_glob() */
+static void
+ignore_matcher_compile (IgnoreMatcher *matcher,
+			GPtrArray     *globs,
+			const gchar   *relative_path)
 {
-	GPtrArray  *array;
-	gchar     **strarr;
-	gchar      *contents;
-	gint        i;
+	const gchar *glob;
+	gchar       *path;
+	guint        i;
+
+	for (i = 0; i < globs->len; ++i) {
+		glob = g_ptr_array_index (globs, i);
+
+		if (!strchr (glob, G_DIR_SEPARATOR)) {
+			if (git_ignore_is_literal (glob))
+				g_hash_table_insert (matcher->names, (gpointer) glob, (gpointer) glob);
+			else if ('*' == glob[0] && git_ignore_is_literal (glob + 1))
+				ignore_matcher_add_suffix (matcher, glob + 1);
+			else
+				g_ptr_array_add (matcher->name_globs, (gpointer) glob);
+
+			continue;
+		}
+
+		path = (relative_path ?
+			g_build_filename (relative_path, glob, NULL) :
+			g_strdup (glob));
+
+		if (path[0] == G_DIR_SEPARATOR)
+			memmove (path, path + 1, strlen (path));
+
+		if (git_ignore_is_literal (path))
+			g_hash_table_insert (matcher->paths, path, path);
+		else
+			g_ptr_array_add (matcher->path_globs, path);
+	}
+}
+
+static gboolean
+ignore_matcher_matches (IgnoreMatcher *matcher,
+			const gchar   *path)
+{
+	const gchar *basename;
+	guint        length, suffix_length, i;
+
+	basename = git_ignore_get_basename (path);
 
-	if (!g_file_get_contents (path, &contents, NULL, NULL)) {
-		return g_ptr_array_new ();
+	if (g_hash_table_lookup (matcher->names, basename) ||
+	    g_hash_table_lookup (matcher->paths, path))
+		return TRUE;
+
+	length = strlen (basename);
+
+	for (i = 0; i < matcher->suffix_lengths->len; ++i) {
+		suffix_length = g_array_index (matcher->suffix_lengths, guint, i);
+
+		if (suffix_length > length)
+			break;
+
+		if (g_hash_table_lookup (matcher->suffixes, basename + length - suffix_length))
+			return TRUE;
 	}
 
-	array = g_ptr_array_sized_new (10);
+	for (i = 0; i < matcher->name_globs->len; ++i) {
+		if (!fnmatch (g_ptr_array_index (matcher->name_globs, i), basename, FNM_PATHNAME))
+			return TRUE;
+	}
+
+	for (i = 0; i < matcher->path_globs->len; ++i) {
+		if (!fnmatch (g_ptr_array_index (matcher->path_globs, i), path, FNM_PATHNAME))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void
+ignore_file_parse (IgnoreFile  *file,
+		   const gchar *contents)
+{
+	gchar **strarr;
+	gint    i;
+
 	strarr = g_strsplit (contents, "\n", -1);
 
 	for (i = 0; strarr[i]; i++) {
 		if (*strarr[i] && !g_str_has_prefix (strarr[i], "#")) {
-			g_ptr_array_add (array, g_strdup (strarr[i]));
+			g_ptr_array_add (file->globs, strarr[i]);
+		} else {
+			g_free (strarr[i]);
 		}
 	}
 
-	g_free (contents);
-	g_strfreev (strarr);
+	/* the strings moved to the glob list */
+	g_free (strarr);
+}
 
-	return array;
+static void
+ignore_file_compile (IgnoreFile *file)
+{
+	ignore_matcher_clear (&file->matcher);
+	ignore_matcher_init (&file->matcher);
+	ignore_matcher_compile (&file->matcher, file->globs, file->relative_path);
+}
+
+static void
+ignore_file_stat (IgnoreFile *file)
+{
+	struct stat st;
+
+	if (stat (file->path, &st)) {
+		file->mtime = 0;
+		file->size = -1;
+	} else {
+		file->mtime = st.st_mtime;
+		file->size = st.st_size;
+	}
+}
+
+static void
+ignore_file_reload (IgnoreFile *file)
+{
+	gchar *contents;
+
+	g_ptr_array_foreach (file->globs, (GFunc) g_free, NULL);
+	g_ptr_array_set_size (file->globs, 0);
+
+	if (g_file_get_contents (file->path, &contents, NULL, NULL)) {
+		ignore_file_parse (file, contents);
+		g_free (contents);
+	}
+
+	ignore_file_compile (file);
+}
+
+/* returns the cached ignore file at path, reading it if needed */
+static IgnoreFile *
+ignore_file_lookup (const gchar *path,
+		    const gchar *relative_path)
+{
+	IgnoreFile *file;
+	time_t      mtime;
+	off_t       size;
+
+	if (!ignore_files)
+		ignore_files = g_hash_table_new (g_str_hash, g_str_equal);
+
+	file = g_hash_table_lookup (ignore_files, path);
+
+	if (!file) {
+		file = g_slice_new0 (IgnoreFile);
+		file->path = g_strdup (path);
+		file->relative_path = g_strdup (relative_path);
+		file->size = -1;
+		file->globs = g_ptr_array_new ();
+		ignore_matcher_init (&file->matcher);
+
+		g_hash_table_insert (ignore_files, file->path, file);
+	} else if (g_strcmp0 (file->relative_path, relative_path)) {
+		/* same directory, seen from another project */
+		g_free (file->relative_path);
+		file->relative_path = g_strdup (relative_path);
+		file->size = -1;
+	}
+
+	mtime = file->mtime;
+	size = file->size;
+	ignore_file_stat (file);
+
+	if (mtime != file->mtime || size != file->size)
+		ignore_file_reload (file);
+
+	return file;
 }
 
 static GObject*
@@ -197,15 +431,6 @@ git_ignore_constructor (GType                  type,
 										   construct_params);
 	priv = GET_PRIV (object);
 
-	path = g_build_filename (priv->directory_path, ".gitignore", NULL);
-	priv->globs = git_ignore_read_file (path);
-	g_free (path);
-
-	path = g_build_filename (giggle_git_get_git_dir (priv->git),
-				 "info", "exclude", NULL);
-	priv->global_globs = git_ignore_read_file (path);
-	g_free (path);
-
 	project_path = giggle_git_get_directory (priv->git);
 
 	if (strcmp (priv->directory_path, project_path) != 0) {
@@ -214,6 +439,15 @@ git_ignore_constructor (GType                  type,
 						+ 1 /* dir separator */);
 	}
 
+	path = g_build_filename (priv->directory_path, ".gitignore", NULL);
+	priv->file = ignore_file_lookup (path, priv->relative_path);
+	g_free (path);
+
+	path = g_build_filename (giggle_git_get_git_dir (priv->git),
+				 "info", "exclude", NULL);
+	priv->exclude = ignore_file_lookup (path, NULL);
+	g_free (path);
+
 	return object;
 }
 
@@ -221,20 +455,22 @@ static void
 git_ignore_save_file (GiggleGitIgnore *git_ignore)
 {
 	GiggleGitIgnorePriv *priv;
-	gchar               *path;
 	GString             *content;
 	gint                 i;
 
 	priv = GET_PRIV (git_ignore);
-	path = g_build_filename (priv->directory_path, ".gitignore", NULL);
 	content = g_string_new ("");
 
-	for (i = 0; i < priv->globs->len; i++) {
-		g_string_append_printf (content, "%s\n", (gchar *) g_ptr_array_index (priv->globs, i));
+	for (i = 0; i < priv->file->globs->len; i++) {
+		g_string_append_printf (content, "%s\n", (gchar *) g_ptr_array_index (priv->file->globs, i));
 	}
 
-	g_file_set_contents (path, content->str, -1, NULL);
+	g_file_set_contents (priv->file->path, content->str, -1, NULL);
 	g_string_free (content, TRUE);
+
+	/* our own change must not look like a stale cache entry */
+	ignore_file_compile (priv->file);
+	ignore_file_stat (priv->file);
 }
 
 GiggleGitIgnore *
@@ -247,23 +483,6 @@ giggle_git_ignore_new (const gchar *directory_path)
 			     NULL);
 }
 
-static const gchar *
-git_ignore_get_basename (const gchar *path)
-{
-	const gchar *basename;
-
-	basename = strrchr (path, G_DIR_SEPARATOR);
-
-	if (!basename) {
-		basename = path;
-	} else {
-		/* avoid dir separator */
-		basename++;
-	}
-
-	return basename;
-}
-
 static gboolean
 git_ignore_path_matches_glob (const gchar *path,
 			      const gchar *glob,
@@ -318,29 +537,6 @@ git_ignore_path_matches_glob (const gchar *path,
 	return match;
 }
 
-static gboolean
-git_ignore_path_matches (const gchar *path,
-			 GPtrArray   *array,
-			 const gchar *relative_path)
-{
-	gboolean     match = FALSE;
-	gint         n_glob = 0;
-	const gchar *glob;
-
-	if (!array) {
-		return FALSE;
-	}
-
-	while (!match && n_glob < array->len) {
-		glob = g_ptr_array_index (array, n_glob);
-		n_glob++;
-
-		match = git_ignore_path_matches_glob (path, glob, relative_path);
-	}
-
-	return match;
-}
-
 gboolean
 giggle_git_ignore_path_matches (GiggleGitIgnore *git_ignore,
 				const gchar     *path)
@@ -351,15 +547,8 @@ giggle_git_ignore_path_matches (GiggleGitIgnore *git_ignore,
 
 	priv = GET_PRIV (git_ignore);
 
-	if (git_ignore_path_matches (path, priv->globs, priv->relative_path)) {
-		return TRUE;
-	}
-
-	if (git_ignore_path_matches (path, priv->global_globs, NULL)) {
-		return TRUE;
-	}
-
-	return FALSE;
+	return (ignore_matcher_matches (&priv->file->matcher, path) ||
+		ignore_matcher_matches (&priv->exclude->matcher, path));
 }
 
 void
@@ -372,7 +561,7 @@ giggle_git_ignore_add_glob (GiggleGitIgnore *git_ignore,
 	g_return_if_fail (glob != NULL);
 
 	priv = GET_PRIV (git_ignore);
-	g_ptr_array_add (priv->globs, g_strdup (glob));
+	g_ptr_array_add (priv->file->globs, g_strdup (glob));
 
 	git_ignore_save_file (git_ignore);
 }
@@ -413,14 +602,14 @@ giggle_git_ignore_remove_glob_for_path (GiggleGitIgnore *git_ignore,
 
 	priv = GET_PRIV (git_ignore);
 
-	while (i < priv->globs->len) {
-		glob = g_ptr_array_index (priv->globs, i);
+	while (i < priv->file->globs->len) {
+		glob = g_ptr_array_index (priv->file->globs, i);
 		filename = git_ignore_get_basename (path);
 
 		if ((perfect_match && strcmp (glob, filename) == 0) ||
 		    (!perfect_match &&
 		     git_ignore_path_matches_glob (path, glob, priv->relative_path))) {
-			g_ptr_array_remove_index (priv->globs, i);
+			g_free (g_ptr_array_remove_index (priv->file->globs, i));
 			removed = TRUE;
 		} else {
 			/* no match, increment index */
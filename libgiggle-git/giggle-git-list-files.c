@@ -99,10 +99,8 @@ git_list_files_char_to_status (gchar status)
 		return GIGGLE_GIT_FILE_STATUS_CHANGED;
 	case 'K':
 		return GIGGLE_GIT_FILE_STATUS_KILLED;
-	case '?':
-		return GIGGLE_GIT_FILE_STATUS_OTHER;
 	default:
-		g_assert_not_reached ();
+		/* '?', and whatever newer versions of git report */
 		return GIGGLE_GIT_FILE_STATUS_OTHER;
 	}
 }
@@ -155,3 +153,16 @@ giggle_git_list_files_get_file_status (GiggleGitListFiles *list_files,
 	status = GPOINTER_TO_INT (g_hash_table_lookup (priv->files, file));
 	return status;
 }
+
+/* lets partial status queries update the result of a full listing */
+void
+giggle_git_list_files_set_file_status (GiggleGitListFiles       *list_files,
+				       const gchar              *file,
+				       GiggleGitListFilesStatus  status)
+{
+	g_return_if_fail (GIGGLE_IS_GIT_LIST_FILES (list_files));
+	g_return_if_fail (NULL != file);
+
+	g_hash_table_replace (GET_PRIV (list_files)->files,
+			      g_strdup (file), GINT_TO_POINTER (status));
+}
@@ -57,6 +57,9 @@ GiggleJob *              giggle_git_list_files_new        (void);
 
 GiggleGitListFilesStatus giggle_git_list_files_get_file_status (GiggleGitListFiles *list_files,
 								const gchar        *file);
+void                     giggle_git_list_files_set_file_status (GiggleGitListFiles       *list_files,
+								const gchar              *file,
+								GiggleGitListFilesStatus  status);
 
 
 G_END_DECLS
@@ -0,0 +1,438 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+#include "giggle-git-list-index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define GITLINK_MODE 0160000
+
+/* All paths of the index plus the untracked ones, stored back to back
+ * and sorted bytewise. The entries of any directory form one range of
+ * that list, so children get listed by binary searching, without ever
+ * building a tree. Untracked directories and submodules are listed
+ * with a trailing slash, their contents are not known to the index. */
+typedef struct GiggleGitListIndexPriv GiggleGitListIndexPriv;
+
+struct GiggleGitListIndexPriv {
+	GString *paths;
+	GArray  *offsets;
+	GString *pending;
+};
+
+static void     git_list_index_finalize              (GObject     *object);
+
+static gboolean git_list_index_get_command_line      (GiggleJob   *job,
+						      gchar      **command_line);
+static void     git_list_index_handle_output         (GiggleJob   *job,
+						      const gchar *output_str,
+						      gsize        output_len);
+static void     git_list_index_handle_partial_output (GiggleJob   *job,
+						      const gchar *output_str,
+						      gsize        output_len);
+
+G_DEFINE_TYPE (GiggleGitListIndex, giggle_git_list_index, GIGGLE_TYPE_JOB)
+
+#define GET_PRIV(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIGGLE_TYPE_GIT_LIST_INDEX, GiggleGitListIndexPriv))
+
+#define PATH_AT(priv,i) ((priv)->paths->str + g_array_index ((priv)->offsets, guint32, (i)))
+
+static void
+giggle_git_list_index_class_init (GiggleGitListIndexClass *class)
+{
+	GObjectClass   *object_class = G_OBJECT_CLASS (class);
+	GiggleJobClass *job_class    = GIGGLE_JOB_CLASS (class);
+
+	object_class->finalize = git_list_index_finalize;
+
+	job_class->get_command_line      = git_list_index_get_command_line;
+	job_class->handle_output         = git_list_index_handle_output;
+	job_class->handle_partial_output = git_list_index_handle_partial_output;
+
+	g_type_class_add_private (object_class, sizeof (GiggleGitListIndexPriv));
+}
+
+static void
+giggle_git_list_index_init (GiggleGitListIndex *list_index)
+{
+	GiggleGitListIndexPriv *priv;
+
+	priv = GET_PRIV (list_index);
+
+	priv->paths = g_string_new (NULL);
+	priv->offsets = g_array_new (FALSE, FALSE, sizeof (guint32));
+	priv->pending = g_string_new (NULL);
+}
+
+static void
+git_list_index_finalize (GObject *object)
+{
+	GiggleGitListIndexPriv *priv;
+
+	priv = GET_PRIV (object);
+
+	g_string_free (priv->paths, TRUE);
+	g_array_free (priv->offsets, TRUE);
+	g_string_free (priv->pending, TRUE);
+
+	G_OBJECT_CLASS (giggle_git_list_index_parent_class)->finalize (object);
+}
+
+static gboolean
+git_list_index_get_command_line (GiggleJob *job, gchar **command_line)
+{
+	/* untracked files are listed first and without stage information,
+	 * untracked directories get collapsed into a single entry */
+	*command_line = g_strdup (GIT_COMMAND " ls-files -z --stage --cached --others --directory");
+
+	return TRUE;
+}
+
+/* length of the "<mode> <sha> <stage>\t" prefix of index entries,
+ * 0 for untracked entries, whose names might contain tabs, too */
+static gsize
+git_list_index_get_prefix_length (const gchar *record,
+				  gsize        length)
+{
+	const gchar *p, *end;
+	gsize        n;
+
+	p = record;
+	end = record + length;
+
+	while (p < end && *p >= '0' && *p <= '7')
+		++p;
+
+	if (p == record || p >= end || ' ' != *p++)
+		return 0;
+
+	for (n = 0; p < end && g_ascii_isxdigit (*p); ++n)
+		++p;
+
+	/* SHA-1 or SHA-256 object names */
+	if ((40 != n && 64 != n) || p >= end || ' ' != *p++)
+		return 0;
+
+	if (p + 2 > end || *p < '0' || *p > '3' || '\t' != p[1])
+		return 0;
+
+	return p + 2 - record;
+}
+
+static void
+git_list_index_add_record (GiggleGitListIndexPriv *priv,
+			   const gchar            *record,
+			   gsize                   length)
+{
+	gsize    prefix;
+	guint32  offset;
+	gboolean gitlink = FALSE;
+
+	prefix = git_list_index_get_prefix_length (record, length);
+
+	if (prefix) {
+		gitlink = (GITLINK_MODE == strtoul (record, NULL, 8));
+		length -= prefix;
+		record += prefix;
+	}
+
+	if (!length)
+		return;
+
+	offset = priv->paths->len;
+	g_string_append_len (priv->paths, record, length);
+
+	if (gitlink)
+		g_string_append_c (priv->paths, '/');
+
+	g_string_append_c (priv->paths, '\0');
+	g_array_append_val (priv->offsets, offset);
+}
+
+static void
+git_list_index_parse (GiggleGitListIndexPriv *priv,
+		      const gchar            *output_str,
+		      gsize                   output_len)
+{
+	const gchar *end, *nul;
+
+	end = output_str + output_len;
+
+	while (output_str < end) {
+		nul = memchr (output_str, '\0', end - output_str);
+
+		if (!nul) {
+			/* the rest of this record comes with the next chunk */
+			g_string_append_len (priv->pending, output_str, end - output_str);
+			break;
+		}
+
+		if (priv->pending->len) {
+			g_string_append_len (priv->pending, output_str, nul - output_str);
+			git_list_index_add_record (priv, priv->pending->str, priv->pending->len);
+			g_string_truncate (priv->pending, 0);
+		} else {
+			git_list_index_add_record (priv, output_str, nul - output_str);
+		}
+
+		output_str = nul + 1;
+	}
+}
+
+static void
+git_list_index_handle_partial_output (GiggleJob   *job,
+				      const gchar *output_str,
+				      gsize        output_len)
+{
+	git_list_index_parse (GET_PRIV (job), output_str, output_len);
+}
+
+static gint
+git_list_index_compare (gconstpointer a,
+			gconstpointer b,
+			gpointer      user_data)
+{
+	GiggleGitListIndexPriv *priv = user_data;
+
+	return strcmp (priv->paths->str + *(const guint32 *) a,
+		       priv->paths->str + *(const guint32 *) b);
+}
+
+/* git lists both the untracked and the index entries sorted, so
+ * usually two runs have to be merged. anything else gets sorted. */
+static void
+git_list_index_sort (GiggleGitListIndexPriv *priv)
+{
+	GArray  *merged;
+	guint32 *offsets;
+	guint    n, i, j, split = 0;
+	int      cmp;
+
+	offsets = (guint32 *) priv->offsets->data;
+	n = priv->offsets->len;
+
+	for (i = 1; i < n; ++i) {
+		if (git_list_index_compare (&offsets[i - 1], &offsets[i], priv) <= 0)
+			continue;
+
+		if (split) {
+			g_qsort_with_data (offsets, n, sizeof (guint32),
+					   git_list_index_compare, priv);
+			return;
+		}
+
+		split = i;
+	}
+
+	if (!split)
+		return;
+
+	merged = g_array_sized_new (FALSE, FALSE, sizeof (guint32), n);
+
+	for (i = 0, j = split; i < split || j < n; ) {
+		if (i == split)
+			cmp = 1;
+		else if (j == n)
+			cmp = -1;
+		else
+			cmp = git_list_index_compare (&offsets[i], &offsets[j], priv);
+
+		if (cmp <= 0)
+			g_array_append_val (merged, offsets[i++]);
+		else
+			g_array_append_val (merged, offsets[j++]);
+	}
+
+	g_array_free (priv->offsets, TRUE);
+	priv->offsets = merged;
+}
+
+static void
+git_list_index_handle_output (GiggleJob   *job,
+			      const gchar *output_str,
+			      gsize        output_len)
+{
+	GiggleGitListIndexPriv *priv;
+	guint32                *offsets;
+	guint                   i, n;
+
+	priv = GET_PRIV (job);
+
+	git_list_index_parse (priv, output_str, output_len);
+
+	if (priv->pending->len) {
+		git_list_index_add_record (priv, priv->pending->str, priv->pending->len);
+		g_string_truncate (priv->pending, 0);
+	}
+
+	git_list_index_sort (priv);
+
+	/* unmerged paths have one index entry per stage */
+	offsets = (guint32 *) priv->offsets->data;
+
+	for (i = n = 0; i < priv->offsets->len; ++i) {
+		if (n && !strcmp (PATH_AT (priv, i), priv->paths->str + offsets[n - 1]))
+			continue;
+
+		offsets[n++] = offsets[i];
+	}
+
+	g_array_set_size (priv->offsets, n);
+}
+
+/* first entry not sorting before key */
+static guint
+git_list_index_lower_bound (GiggleGitListIndexPriv *priv,
+			    const gchar            *key)
+{
+	guint low, high, mid;
+
+	low = 0;
+	high = priv->offsets->len;
+
+	while (low < high) {
+		mid = (low + high) / 2;
+
+		if (strcmp (PATH_AT (priv, mid), key) < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+/* first entry after the range of entries starting with prefix */
+static guint
+git_list_index_prefix_end (GiggleGitListIndexPriv *priv,
+			   guint                   low,
+			   const gchar            *prefix,
+			   gsize                   length)
+{
+	guint high, mid;
+
+	high = priv->offsets->len;
+
+	while (low < high) {
+		mid = (low + high) / 2;
+
+		if (strncmp (PATH_AT (priv, mid), prefix, length) <= 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+static gboolean
+git_list_index_contains (GiggleGitListIndexPriv *priv,
+			 const gchar            *path)
+{
+	guint i;
+
+	i = git_list_index_lower_bound (priv, path);
+
+	return i < priv->offsets->len && !strcmp (PATH_AT (priv, i), path);
+}
+
+GiggleJob *
+giggle_git_list_index_new (void)
+{
+	return g_object_new (GIGGLE_TYPE_GIT_LIST_INDEX, NULL);
+}
+
+guint
+giggle_git_list_index_get_n_paths (GiggleGitListIndex *list_index)
+{
+	g_return_val_if_fail (GIGGLE_IS_GIT_LIST_INDEX (list_index), 0);
+	return GET_PRIV (list_index)->offsets->len;
+}
+
+/* Calls func for each file and directory in directory, which is relative
+ * to the project directory. Returns FALSE when the contents of directory
+ * are not known to the index, because it is untracked or a submodule. */
+gboolean
+giggle_git_list_index_foreach_child (GiggleGitListIndex     *list_index,
+				     const gchar            *directory,
+				     GiggleGitListIndexFunc  func,
+				     gpointer                user_data)
+{
+	GiggleGitListIndexPriv *priv;
+	GString                *prefix;
+	const gchar            *name, *slash;
+	gsize                   length;
+	guint                   i;
+
+	g_return_val_if_fail (GIGGLE_IS_GIT_LIST_INDEX (list_index), FALSE);
+	g_return_val_if_fail (NULL != directory, FALSE);
+	g_return_val_if_fail (NULL != func, FALSE);
+
+	priv = GET_PRIV (list_index);
+	prefix = g_string_new (NULL);
+
+	/* is this directory, or one of its parents, collapsed? */
+	for (name = directory; *name; name = slash + 1) {
+		slash = strchr (name, '/');
+
+		if (!slash)
+			slash = name + strlen (name);
+
+		g_string_append_len (prefix, name, slash - name);
+		g_string_append_c (prefix, '/');
+
+		if (git_list_index_contains (priv, prefix->str)) {
+			g_string_free (prefix, TRUE);
+			return FALSE;
+		}
+
+		if (!*slash)
+			break;
+	}
+
+	length = prefix->len;
+	i = git_list_index_lower_bound (priv, prefix->str);
+
+	while (i < priv->offsets->len && !strncmp (PATH_AT (priv, i), prefix->str, length)) {
+		name = PATH_AT (priv, i) + length;
+		slash = strchr (name, '/');
+
+		if (!slash) {
+			func (name, FALSE, user_data);
+			++i;
+			continue;
+		}
+
+		/* skip everything below this subdirectory */
+		g_string_truncate (prefix, length);
+		g_string_append_len (prefix, name, slash + 1 - name);
+		i = git_list_index_prefix_end (priv, i, prefix->str, prefix->len);
+
+		prefix->str[prefix->len - 1] = '\0';
+		func (prefix->str + length, TRUE, user_data);
+		prefix->str[prefix->len - 1] = '/';
+	}
+
+	g_string_free (prefix, TRUE);
+
+	return TRUE;
+}
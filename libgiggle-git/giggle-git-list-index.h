@@ -0,0 +1,61 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GIGGLE_GIT_LIST_INDEX_H__
+#define __GIGGLE_GIT_LIST_INDEX_H__
+
+#include <libgiggle/giggle-job.h>
+
+G_BEGIN_DECLS
+
+#define GIGGLE_TYPE_GIT_LIST_INDEX            (giggle_git_list_index_get_type ())
+#define GIGGLE_GIT_LIST_INDEX(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIGGLE_TYPE_GIT_LIST_INDEX, GiggleGitListIndex))
+#define GIGGLE_GIT_LIST_INDEX_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), GIGGLE_TYPE_GIT_LIST_INDEX, GiggleGitListIndexClass))
+#define GIGGLE_IS_GIT_LIST_INDEX(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GIGGLE_TYPE_GIT_LIST_INDEX))
+#define GIGGLE_IS_GIT_LIST_INDEX_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GIGGLE_TYPE_GIT_LIST_INDEX))
+#define GIGGLE_GIT_LIST_INDEX_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GIGGLE_TYPE_GIT_LIST_INDEX, GiggleGitListIndexClass))
+
+typedef struct GiggleGitListIndex      GiggleGitListIndex;
+typedef struct GiggleGitListIndexClass GiggleGitListIndexClass;
+
+struct GiggleGitListIndex {
+	GiggleJob parent;
+};
+
+struct GiggleGitListIndexClass {
+	GiggleJobClass parent_class;
+};
+
+typedef void (* GiggleGitListIndexFunc) (const gchar *name,
+					 gboolean     is_dir,
+					 gpointer     user_data);
+
+GType         giggle_git_list_index_get_type      (void);
+GiggleJob *   giggle_git_list_index_new           (void);
+
+guint         giggle_git_list_index_get_n_paths   (GiggleGitListIndex     *list_index);
+gboolean      giggle_git_list_index_foreach_child (GiggleGitListIndex     *list_index,
+						   const gchar            *directory,
+						   GiggleGitListIndexFunc  func,
+						   gpointer                user_data);
+
+G_END_DECLS
+
+#endif /* __GIGGLE_GIT_LIST_INDEX_H__ */
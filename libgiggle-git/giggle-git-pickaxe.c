@@ -0,0 +1,703 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Searches the changes of a list of commits with git's pickaxe. The
+ * list gets split into slices, and each slice is fed to its own
+ * "git log --no-walk=unsorted --stdin -G" process, so that several
+ * cores diff in parallel. Each process reports its matches in input
+ * order, which tells how far into its slice it got.
+ *
+ * This does not go through GiggleDispatcher, which only runs one
+ * process at a time.
+ */
+
+#include "config.h"
+#include "giggle-git-pickaxe.h"
+
+#include <libgiggle/giggle-sysdeps.h>
+
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define SHA_LENGTH 40
+
+/* slices get no smaller than this, to keep process overhead low */
+#define MIN_SLICE_SIZE 512
+#define MAX_SLICES     8
+
+#define IO_BUFFER_SIZE (32 * 1024)
+
+typedef struct GiggleGitPickaxePriv GiggleGitPickaxePriv;
+
+typedef struct {
+	GiggleGitPickaxe *pickaxe;
+
+	/* range of shas, end is exclusive */
+	guint             start, end;
+	/* next sha to write, and the first not searched yet */
+	guint             write_pos;
+	guint             read_pos;
+
+	GPid              pid;
+	GIOChannel       *input;
+	GIOChannel       *output;
+	guint             write_id;
+	guint             read_id;
+	guint             wait_id;
+
+	GString          *write_buffer;
+	GString          *pending;
+
+	gboolean          finished;
+} PickaxeSlice;
+
+struct GiggleGitPickaxePriv {
+	gchar        *directory;
+	gchar        *search_term;
+	gchar       **files;
+
+	/* SHA_LENGTH characters per entry, all NUL for entries without commit */
+	gchar        *shas;
+	guint         n_shas;
+
+	PickaxeSlice *slices;
+	guint         n_slices;
+	guint         n_running;
+
+	/* bumped when stopping frees the slices, which signal
+	 * handlers may do while a slice emits */
+	guint         generation;
+
+	/* the first slice which failed */
+	GError       *error;
+};
+
+enum {
+	MATCH_FOUND,
+	PROGRESS,
+	FINISHED,
+	LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0, };
+
+static void git_pickaxe_finalize (GObject *object);
+
+G_DEFINE_TYPE (GiggleGitPickaxe, giggle_git_pickaxe, G_TYPE_OBJECT)
+
+#define GET_PRIV(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIGGLE_TYPE_GIT_PICKAXE, GiggleGitPickaxePriv))
+
+static void
+giggle_git_pickaxe_class_init (GiggleGitPickaxeClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+	object_class->finalize = git_pickaxe_finalize;
+
+	signals[MATCH_FOUND] =
+		g_signal_new ("match-found",
+			      G_OBJECT_CLASS_TYPE (object_class),
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (GiggleGitPickaxeClass, match_found),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__UINT,
+			      G_TYPE_NONE, 1, G_TYPE_UINT);
+
+	signals[PROGRESS] =
+		g_signal_new ("progress",
+			      G_OBJECT_CLASS_TYPE (object_class),
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (GiggleGitPickaxeClass, progress),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
+
+	signals[FINISHED] =
+		g_signal_new ("finished",
+			      G_OBJECT_CLASS_TYPE (object_class),
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (GiggleGitPickaxeClass, finished),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
+
+	g_type_class_add_private (object_class, sizeof (GiggleGitPickaxePriv));
+}
+
+static void
+giggle_git_pickaxe_init (GiggleGitPickaxe *pickaxe)
+{
+}
+
+static void
+git_pickaxe_stop_slice (PickaxeSlice *slice)
+{
+	if (slice->write_id) {
+		g_source_remove (slice->write_id);
+		slice->write_id = 0;
+	}
+
+	if (slice->read_id) {
+		g_source_remove (slice->read_id);
+		slice->read_id = 0;
+	}
+
+	if (slice->input) {
+		g_io_channel_shutdown (slice->input, FALSE, NULL);
+		g_io_channel_unref (slice->input);
+		slice->input = NULL;
+	}
+
+	if (slice->output) {
+		g_io_channel_shutdown (slice->output, FALSE, NULL);
+		g_io_channel_unref (slice->output);
+		slice->output = NULL;
+	}
+
+	/* no wait source means the child already exited */
+	if (slice->wait_id) {
+		g_source_remove (slice->wait_id);
+		slice->wait_id = 0;
+
+		giggle_sysdeps_kill_pid (slice->pid);
+		g_spawn_close_pid (slice->pid);
+	}
+
+	if (slice->write_buffer) {
+		g_string_free (slice->write_buffer, TRUE);
+		slice->write_buffer = NULL;
+	}
+
+	if (slice->pending) {
+		g_string_free (slice->pending, TRUE);
+		slice->pending = NULL;
+	}
+}
+
+static void
+git_pickaxe_stop (GiggleGitPickaxePriv *priv)
+{
+	guint i;
+
+	for (i = 0; i < priv->n_slices; ++i)
+		git_pickaxe_stop_slice (&priv->slices[i]);
+
+	g_free (priv->slices);
+	priv->slices = NULL;
+	priv->n_slices = 0;
+	priv->n_running = 0;
+	priv->generation++;
+
+	g_free (priv->shas);
+	priv->shas = NULL;
+	priv->n_shas = 0;
+
+	g_clear_error (&priv->error);
+}
+
+static void
+git_pickaxe_finalize (GObject *object)
+{
+	GiggleGitPickaxePriv *priv;
+
+	priv = GET_PRIV (object);
+
+	git_pickaxe_stop (priv);
+
+	g_free (priv->directory);
+	g_free (priv->search_term);
+	g_strfreev (priv->files);
+
+	G_OBJECT_CLASS (giggle_git_pickaxe_parent_class)->finalize (object);
+}
+
+static gchar *
+git_pickaxe_escape_pattern (const gchar *search_term)
+{
+	GString *pattern;
+
+	/* git -G takes an extended regular expression */
+	pattern = g_string_new (NULL);
+
+	for (; *search_term; ++search_term) {
+		if (strchr (".[]()*+?{}|^$\\", *search_term))
+			g_string_append_c (pattern, '\\');
+
+		g_string_append_c (pattern, *search_term);
+	}
+
+	return g_string_free (pattern, FALSE);
+}
+
+static gchar *
+git_pickaxe_get_command_line (GiggleGitPickaxePriv *priv)
+{
+	GString *str;
+	gchar   *pattern, *quoted;
+	int      i;
+
+	str = g_string_new (GIT_COMMAND);
+	g_string_append (str, " log --no-walk=unsorted --stdin --no-color"
+			 " -z --format=format:%H --regexp-ignore-case");
+
+	pattern = git_pickaxe_escape_pattern (priv->search_term);
+	quoted = g_shell_quote (pattern);
+	g_string_append_printf (str, " -G%s", quoted);
+	g_free (quoted);
+	g_free (pattern);
+
+	if (priv->files) {
+		g_string_append (str, " --");
+
+		for (i = 0; priv->files[i]; ++i) {
+			quoted = g_shell_quote (priv->files[i]);
+			g_string_append_printf (str, " %s", quoted);
+			g_free (quoted);
+		}
+	}
+
+	return g_string_free (str, FALSE);
+}
+
+static inline const gchar *
+git_pickaxe_peek_sha (GiggleGitPickaxePriv *priv,
+		      guint                 index)
+{
+	return priv->shas + index * SHA_LENGTH;
+}
+
+static void
+git_pickaxe_finish_slice (PickaxeSlice *slice)
+{
+	GiggleGitPickaxe     *pickaxe;
+	GiggleGitPickaxePriv *priv;
+	guint                 generation;
+
+	pickaxe = g_object_ref (slice->pickaxe);
+	priv = GET_PRIV (pickaxe);
+
+	slice->finished = TRUE;
+	slice->read_pos = slice->end;
+
+	if (slice->read_id) {
+		g_source_remove (slice->read_id);
+		slice->read_id = 0;
+	}
+
+	priv->n_running--;
+
+	generation = priv->generation;
+	g_signal_emit (pickaxe, signals[PROGRESS], 0);
+
+	if (generation == priv->generation && !priv->n_running)
+		g_signal_emit (pickaxe, signals[FINISHED], 0);
+
+	g_object_unref (pickaxe);
+}
+
+/* returns FALSE if handlers stopped the search, which freed the slice,
+ * the caller must hold a reference on the pickaxe */
+static gboolean
+git_pickaxe_match_sha (PickaxeSlice *slice,
+		       const gchar  *sha,
+		       gsize         length)
+{
+	GiggleGitPickaxePriv *priv;
+	guint                 index, generation;
+
+	priv = GET_PRIV (slice->pickaxe);
+
+	if (SHA_LENGTH != length)
+		return TRUE;
+
+	/* matches come in input order, skip the ones without match */
+	for (index = slice->read_pos; index < slice->end; ++index) {
+		if (!memcmp (git_pickaxe_peek_sha (priv, index), sha, SHA_LENGTH)) {
+			slice->read_pos = index + 1;
+
+			generation = priv->generation;
+			g_signal_emit (slice->pickaxe, signals[MATCH_FOUND], 0, index);
+
+			return generation == priv->generation;
+		}
+	}
+
+	g_warning ("%s: Unexpected commit name: '%.*s'", G_STRFUNC, (int) length, sha);
+
+	return TRUE;
+}
+
+/* returns FALSE like git_pickaxe_match_sha() does */
+static gboolean
+git_pickaxe_parse (PickaxeSlice *slice,
+		   const gchar  *output_str,
+		   gsize         output_len)
+{
+	const gchar *end, *nul;
+
+	end = output_str + output_len;
+
+	while (output_str < end) {
+		nul = memchr (output_str, '\0', end - output_str);
+
+		if (!nul) {
+			g_string_append_len (slice->pending, output_str, end - output_str);
+			break;
+		}
+
+		g_string_append_len (slice->pending, output_str, nul - output_str);
+
+		if (!git_pickaxe_match_sha (slice, slice->pending->str, slice->pending->len))
+			return FALSE;
+
+		g_string_truncate (slice->pending, 0);
+
+		output_str = nul + 1;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+git_pickaxe_read_cb (GIOChannel   *source,
+		     GIOCondition  condition,
+		     PickaxeSlice *slice)
+{
+	GiggleGitPickaxe     *pickaxe;
+	GiggleGitPickaxePriv *priv;
+	gchar                 buffer[IO_BUFFER_SIZE];
+	GIOStatus             status;
+	gsize                 length = 0;
+	guint                 generation;
+	gboolean              running = FALSE;
+
+	status = g_io_channel_read_chars (source, buffer, sizeof (buffer), &length, NULL);
+
+	/* handlers may cancel or even drop the search */
+	pickaxe = g_object_ref (slice->pickaxe);
+	priv = GET_PRIV (pickaxe);
+	generation = priv->generation;
+
+	if (length > 0 && git_pickaxe_parse (slice, buffer, length))
+		g_signal_emit (pickaxe, signals[PROGRESS], 0);
+
+	/* the slice is gone if the search got stopped meanwhile */
+	if (generation != priv->generation)
+		goto finish;
+
+	if (G_IO_STATUS_NORMAL == status || G_IO_STATUS_AGAIN == status) {
+		running = TRUE;
+		goto finish;
+	}
+
+	/* records are separated, not terminated */
+	if (slice->pending->len > 0 &&
+	    !git_pickaxe_match_sha (slice, slice->pending->str, slice->pending->len))
+		goto finish;
+
+	g_string_truncate (slice->pending, 0);
+	slice->read_id = 0;
+
+	/* the exit status tells whether the slice really got searched */
+	if (!slice->wait_id)
+		git_pickaxe_finish_slice (slice);
+
+finish:
+	g_object_unref (pickaxe);
+
+	return running;
+}
+
+static gboolean
+git_pickaxe_write_cb (GIOChannel   *source,
+		      GIOCondition  condition,
+		      PickaxeSlice *slice)
+{
+	GiggleGitPickaxePriv *priv;
+	GIOStatus             status;
+	gsize                 written = 0;
+
+	priv = GET_PRIV (slice->pickaxe);
+
+	/* refill the buffer with the next batch of commits */
+	while (slice->write_buffer->len < IO_BUFFER_SIZE &&
+	       slice->write_pos < slice->end) {
+		if (*git_pickaxe_peek_sha (priv, slice->write_pos)) {
+			g_string_append_len (slice->write_buffer,
+					     git_pickaxe_peek_sha (priv, slice->write_pos),
+					     SHA_LENGTH);
+			g_string_append_c (slice->write_buffer, '\n');
+		}
+
+		slice->write_pos++;
+	}
+
+	if (slice->write_buffer->len > 0 && !(condition & (G_IO_HUP | G_IO_ERR))) {
+		status = g_io_channel_write_chars (source, slice->write_buffer->str,
+						   slice->write_buffer->len,
+						   &written, NULL);
+
+		g_string_erase (slice->write_buffer, 0, written);
+
+		if (G_IO_STATUS_NORMAL == status || G_IO_STATUS_AGAIN == status) {
+			if (slice->write_buffer->len > 0 || slice->write_pos < slice->end)
+				return TRUE;
+		}
+	}
+
+	/* git log only starts once its input got closed */
+	g_io_channel_shutdown (slice->input, FALSE, NULL);
+	g_io_channel_unref (slice->input);
+	slice->input = NULL;
+	slice->write_id = 0;
+
+	return FALSE;
+}
+
+static void
+git_pickaxe_exited_cb (GPid          pid,
+		       gint          status,
+		       PickaxeSlice *slice)
+{
+	GiggleGitPickaxePriv *priv;
+
+	priv = GET_PRIV (slice->pickaxe);
+
+	g_spawn_close_pid (pid);
+	slice->wait_id = 0;
+
+	if ((!WIFEXITED (status) || WEXITSTATUS (status)) && !priv->error) {
+		g_set_error (&priv->error, G_SPAWN_ERROR, G_SPAWN_ERROR_FAILED,
+			     "git log exited with status %d", status);
+	}
+
+	/* wait for the output which is still in the pipe */
+	if (!slice->read_id && !slice->finished)
+		git_pickaxe_finish_slice (slice);
+}
+
+static gboolean
+git_pickaxe_start_slice (PickaxeSlice  *slice,
+			 gchar        **argv,
+			 GError       **error)
+{
+	GiggleGitPickaxePriv *priv;
+	gint                  std_in, std_out;
+
+	priv = GET_PRIV (slice->pickaxe);
+
+	if (!g_spawn_async_with_pipes (priv->directory, argv, NULL,
+				       G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD |
+				       G_SPAWN_STDERR_TO_DEV_NULL,
+				       giggle_sysdeps_child_setup, NULL, &slice->pid,
+				       &std_in, &std_out, NULL, error))
+		return FALSE;
+
+	slice->write_buffer = g_string_sized_new (IO_BUFFER_SIZE + SHA_LENGTH + 1);
+	slice->pending = g_string_new (NULL);
+
+	slice->input = g_io_channel_unix_new (std_in);
+	g_io_channel_set_encoding (slice->input, NULL, NULL);
+	g_io_channel_set_buffered (slice->input, FALSE);
+	g_io_channel_set_flags (slice->input, G_IO_FLAG_NONBLOCK, NULL);
+	g_io_channel_set_close_on_unref (slice->input, TRUE);
+
+	slice->output = g_io_channel_unix_new (std_out);
+	g_io_channel_set_encoding (slice->output, NULL, NULL);
+	g_io_channel_set_buffered (slice->output, FALSE);
+	g_io_channel_set_close_on_unref (slice->output, TRUE);
+
+	slice->write_id = g_io_add_watch (slice->input, G_IO_OUT | G_IO_HUP | G_IO_ERR,
+					  (GIOFunc) git_pickaxe_write_cb, slice);
+	slice->read_id = g_io_add_watch_full (slice->output, G_PRIORITY_HIGH_IDLE,
+					      G_IO_IN | G_IO_HUP,
+					      (GIOFunc) git_pickaxe_read_cb,
+					      slice, NULL);
+	slice->wait_id = g_child_watch_add (slice->pid,
+					    (GChildWatchFunc) git_pickaxe_exited_cb,
+					    slice);
+
+	return TRUE;
+}
+
+static guint
+git_pickaxe_get_n_slices (guint n_shas)
+{
+	glong n_cpus;
+
+	n_cpus = sysconf (_SC_NPROCESSORS_ONLN);
+	n_cpus = CLAMP (n_cpus, 1, MAX_SLICES);
+
+	return CLAMP (n_shas / MIN_SLICE_SIZE, 1, (guint) n_cpus);
+}
+
+GiggleGitPickaxe *
+giggle_git_pickaxe_new (const gchar         *directory,
+			const gchar         *search_term,
+			const gchar * const *files)
+{
+	GiggleGitPickaxe     *pickaxe;
+	GiggleGitPickaxePriv *priv;
+
+	g_return_val_if_fail (NULL != directory, NULL);
+	g_return_val_if_fail (NULL != search_term, NULL);
+
+	pickaxe = g_object_new (GIGGLE_TYPE_GIT_PICKAXE, NULL);
+	priv = GET_PRIV (pickaxe);
+
+	priv->directory = g_strdup (directory);
+	priv->search_term = g_strdup (search_term);
+	priv->files = g_strdupv ((gchar **) files);
+
+	return pickaxe;
+}
+
+/* Searches the commits named by shas, which may contain NULL entries.
+ * Matches are reported by their index into shas. */
+gboolean
+giggle_git_pickaxe_start (GiggleGitPickaxe     *pickaxe,
+			  const gchar * const  *shas,
+			  guint                 n_shas,
+			  GError              **error)
+{
+	GiggleGitPickaxePriv  *priv;
+	PickaxeSlice          *slice;
+	gchar                 *command;
+	gchar                **argv;
+	guint                  i;
+
+	g_return_val_if_fail (GIGGLE_IS_GIT_PICKAXE (pickaxe), FALSE);
+	g_return_val_if_fail (NULL != shas || !n_shas, FALSE);
+
+	priv = GET_PRIV (pickaxe);
+
+	git_pickaxe_stop (priv);
+
+	/* slices which fail stop reading their input */
+	giggle_sysdeps_ignore_sigpipe ();
+
+	priv->n_shas = n_shas;
+	priv->shas = g_malloc0 (n_shas * SHA_LENGTH + 1);
+
+	for (i = 0; i < n_shas; ++i) {
+		if (shas[i])
+			memcpy (priv->shas + i * SHA_LENGTH, shas[i], SHA_LENGTH);
+	}
+
+	command = git_pickaxe_get_command_line (priv);
+
+	if (!g_shell_parse_argv (command, NULL, &argv, error)) {
+		g_free (command);
+		return FALSE;
+	}
+
+	g_free (command);
+
+	priv->n_slices = git_pickaxe_get_n_slices (n_shas);
+	priv->slices = g_new0 (PickaxeSlice, priv->n_slices);
+
+	for (i = 0; i < priv->n_slices; ++i) {
+		slice = &priv->slices[i];
+
+		slice->pickaxe = pickaxe;
+		slice->start = (guint64) n_shas * i / priv->n_slices;
+		slice->end = (guint64) n_shas * (i + 1) / priv->n_slices;
+		slice->write_pos = slice->start;
+		slice->read_pos = slice->start;
+
+		if (!git_pickaxe_start_slice (slice, argv, error)) {
+			git_pickaxe_stop (priv);
+			g_strfreev (argv);
+			return FALSE;
+		}
+
+		priv->n_running++;
+	}
+
+	g_strfreev (argv);
+
+	return TRUE;
+}
+
+void
+giggle_git_pickaxe_cancel (GiggleGitPickaxe *pickaxe)
+{
+	g_return_if_fail (GIGGLE_IS_GIT_PICKAXE (pickaxe));
+	git_pickaxe_stop (GET_PRIV (pickaxe));
+}
+
+gboolean
+giggle_git_pickaxe_is_running (GiggleGitPickaxe *pickaxe)
+{
+	g_return_val_if_fail (GIGGLE_IS_GIT_PICKAXE (pickaxe), FALSE);
+	return GET_PRIV (pickaxe)->n_running > 0;
+}
+
+/* whether all entries from first to last, inclusive, got searched */
+gboolean
+giggle_git_pickaxe_is_searched (GiggleGitPickaxe *pickaxe,
+				guint             first,
+				guint             last)
+{
+	GiggleGitPickaxePriv *priv;
+	PickaxeSlice         *slice;
+	guint                 i;
+
+	g_return_val_if_fail (GIGGLE_IS_GIT_PICKAXE (pickaxe), FALSE);
+
+	priv = GET_PRIV (pickaxe);
+
+	for (i = 0; i < priv->n_slices; ++i) {
+		slice = &priv->slices[i];
+
+		if (slice->end <= first || slice->start > last)
+			continue;
+
+		if (slice->read_pos <= MIN (last, slice->end - 1))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* why some slices could not be searched, or NULL */
+const GError *
+giggle_git_pickaxe_get_error (GiggleGitPickaxe *pickaxe)
+{
+	g_return_val_if_fail (GIGGLE_IS_GIT_PICKAXE (pickaxe), NULL);
+	return GET_PRIV (pickaxe)->error;
+}
+
+guint
+giggle_git_pickaxe_get_n_searched (GiggleGitPickaxe *pickaxe)
+{
+	GiggleGitPickaxePriv *priv;
+	guint                 i, n_searched = 0;
+
+	g_return_val_if_fail (GIGGLE_IS_GIT_PICKAXE (pickaxe), 0);
+
+	priv = GET_PRIV (pickaxe);
+
+	for (i = 0; i < priv->n_slices; ++i)
+		n_searched += priv->slices[i].read_pos - priv->slices[i].start;
+
+	return n_searched;
+}
@@ -0,0 +1,71 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GIGGLE_GIT_PICKAXE_H__
+#define __GIGGLE_GIT_PICKAXE_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GIGGLE_TYPE_GIT_PICKAXE            (giggle_git_pickaxe_get_type ())
+#define GIGGLE_GIT_PICKAXE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIGGLE_TYPE_GIT_PICKAXE, GiggleGitPickaxe))
+#define GIGGLE_GIT_PICKAXE_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), GIGGLE_TYPE_GIT_PICKAXE, GiggleGitPickaxeClass))
+#define GIGGLE_IS_GIT_PICKAXE(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GIGGLE_TYPE_GIT_PICKAXE))
+#define GIGGLE_IS_GIT_PICKAXE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GIGGLE_TYPE_GIT_PICKAXE))
+#define GIGGLE_GIT_PICKAXE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GIGGLE_TYPE_GIT_PICKAXE, GiggleGitPickaxeClass))
+
+typedef struct GiggleGitPickaxe      GiggleGitPickaxe;
+typedef struct GiggleGitPickaxeClass GiggleGitPickaxeClass;
+
+struct GiggleGitPickaxe {
+	GObject parent_instance;
+};
+
+struct GiggleGitPickaxeClass {
+	GObjectClass parent_class;
+
+	void (* match_found) (GiggleGitPickaxe *pickaxe,
+			      guint             index);
+	void (* progress)    (GiggleGitPickaxe *pickaxe);
+	void (* finished)    (GiggleGitPickaxe *pickaxe);
+};
+
+GType              giggle_git_pickaxe_get_type       (void);
+GiggleGitPickaxe * giggle_git_pickaxe_new            (const gchar         *directory,
+						      const gchar         *search_term,
+						      const gchar * const *files);
+
+gboolean           giggle_git_pickaxe_start          (GiggleGitPickaxe    *pickaxe,
+						      const gchar * const *shas,
+						      guint                n_shas,
+						      GError             **error);
+void               giggle_git_pickaxe_cancel         (GiggleGitPickaxe    *pickaxe);
+
+gboolean           giggle_git_pickaxe_is_running     (GiggleGitPickaxe    *pickaxe);
+gboolean           giggle_git_pickaxe_is_searched    (GiggleGitPickaxe    *pickaxe,
+						      guint                first,
+						      guint                last);
+guint              giggle_git_pickaxe_get_n_searched (GiggleGitPickaxe    *pickaxe);
+const GError *     giggle_git_pickaxe_get_error      (GiggleGitPickaxe    *pickaxe);
+
+G_END_DECLS
+
+#endif /* __GIGGLE_GIT_PICKAXE_H__ */
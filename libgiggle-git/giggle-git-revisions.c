@@ -20,6 +20,8 @@
 
 #include "config.h"
 #include "giggle-git-revisions.h"
+#include "giggle-git.h"
+
 #include <string.h>
 
 #define GET_PRIV(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIGGLE_TYPE_GIT_REVISIONS, GiggleGitRevisionsPriv))
@@ -263,6 +265,43 @@ git_revisions_parse_revision_info (GiggleGitRevisionsPriv  *priv,
 
 }
 
+/* whether revision was only resolved by jobs like blame,
+ * instead of being part of a previously loaded history */
+static gboolean
+git_revisions_is_detached (GiggleRevision *revision)
+{
+	return !giggle_revision_get_parents (revision) &&
+	       !giggle_revision_get_children (revision) &&
+	       !giggle_revision_get_branch_heads (revision) &&
+	       !giggle_revision_get_tags (revision) &&
+	       !giggle_revision_get_remotes (revision);
+}
+
+static GiggleRevision *
+git_revisions_new_revision (GiggleGitRevisionsPriv *priv,
+			    const gchar            *sha)
+{
+	GiggleRevisionRegistry *registry;
+	GiggleRevision         *revision;
+
+	/* git rewrites the parents of path limited histories,
+	 * so their graph can't be shared with anyone else */
+	if (priv->files)
+		return giggle_revision_new (sha);
+
+	registry = giggle_git_get_revision_registry (giggle_git_get ());
+	revision = giggle_revision_registry_lookup (registry, sha);
+
+	/* a reloaded history builds a new graph */
+	if (revision && git_revisions_is_detached (revision))
+		return g_object_ref (revision);
+
+	revision = giggle_revision_new (sha);
+	giggle_revision_registry_add (registry, revision);
+
+	return revision;
+}
+
 static GiggleRevision*
 git_revisions_get_revision (GiggleGitRevisionsPriv *priv,
 			    const gchar            *str,
@@ -277,14 +316,14 @@ git_revisions_get_revision (GiggleGitRevisionsPriv *priv,
 
 	if (!(revision = g_hash_table_lookup (revisions_hash, ids[0]))) {
 		/* revision hasn't been created in a previous step, create it */
-		revision = giggle_revision_new (ids[0]);
+		revision = git_revisions_new_revision (priv, ids[0]);
 		g_hash_table_insert (revisions_hash, g_strdup (ids[0]), revision);
 	}
 
 	/* add parents */
 	while (ids[i] != NULL) {
 		if (!(parent = g_hash_table_lookup (revisions_hash, ids[i]))) {
-			parent = giggle_revision_new (ids[i]);
+			parent = git_revisions_new_revision (priv, ids[i]);
 			g_hash_table_insert (revisions_hash, g_strdup (ids[i]), parent);
 		}
 
@@ -0,0 +1,485 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Searches the entire history with a single git process: commits get
+ * streamed as NUL separated (sha, author, message[, patch]) records,
+ * which are matched while the process is still running.
+ *
+ * Like the pickaxe this does not go through GiggleDispatcher, so that
+ * jobs started while browsing the matches don't wait for the search.
+ */
+
+#include "config.h"
+#include "giggle-git-search.h"
+
+#include <libgiggle/giggle-sysdeps.h>
+
+#include <string.h>
+#include <sys/wait.h>
+
+#define SHA_LENGTH 40
+
+#define IO_BUFFER_SIZE (32 * 1024)
+
+typedef enum {
+	FIELD_SHA,
+	FIELD_AUTHOR,
+	FIELD_MESSAGE,
+	N_FIELDS
+} SearchField;
+
+typedef struct GiggleGitSearchPriv GiggleGitSearchPriv;
+
+struct GiggleGitSearchPriv {
+	gchar       *directory;
+	gchar       *term;
+	gboolean     full_search;
+	gchar      **files;
+
+	GPid         pid;
+	GIOChannel  *output;
+	guint        read_id;
+	guint        wait_id;
+	gboolean     running;
+	GError      *error;
+
+	/* the field currently being received */
+	SearchField  field;
+	GString     *pending;
+
+	gchar        sha[SHA_LENGTH + 1];
+	gchar        last_sha[SHA_LENGTH + 1];
+	gboolean     matched;
+	guint        n_searched;
+};
+
+enum {
+	MATCH_FOUND,
+	PROGRESS,
+	FINISHED,
+	LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0, };
+
+static void git_search_finalize (GObject *object);
+
+G_DEFINE_TYPE (GiggleGitSearch, giggle_git_search, G_TYPE_OBJECT)
+
+#define GET_PRIV(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIGGLE_TYPE_GIT_SEARCH, GiggleGitSearchPriv))
+
+static void
+giggle_git_search_class_init (GiggleGitSearchClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+	object_class->finalize = git_search_finalize;
+
+	signals[MATCH_FOUND] =
+		g_signal_new ("match-found",
+			      G_OBJECT_CLASS_TYPE (object_class),
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (GiggleGitSearchClass, match_found),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__STRING,
+			      G_TYPE_NONE, 1, G_TYPE_STRING);
+
+	signals[PROGRESS] =
+		g_signal_new ("progress",
+			      G_OBJECT_CLASS_TYPE (object_class),
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (GiggleGitSearchClass, progress),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
+
+	signals[FINISHED] =
+		g_signal_new ("finished",
+			      G_OBJECT_CLASS_TYPE (object_class),
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (GiggleGitSearchClass, finished),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
+
+	g_type_class_add_private (object_class, sizeof (GiggleGitSearchPriv));
+}
+
+static void
+giggle_git_search_init (GiggleGitSearch *search)
+{
+	GiggleGitSearchPriv *priv;
+
+	priv = GET_PRIV (search);
+
+	priv->pending = g_string_new (NULL);
+}
+
+static void
+git_search_stop (GiggleGitSearchPriv *priv)
+{
+	if (priv->read_id) {
+		g_source_remove (priv->read_id);
+		priv->read_id = 0;
+	}
+
+	if (priv->output) {
+		g_io_channel_shutdown (priv->output, FALSE, NULL);
+		g_io_channel_unref (priv->output);
+		priv->output = NULL;
+	}
+
+	/* no wait source means the child already exited */
+	if (priv->wait_id) {
+		g_source_remove (priv->wait_id);
+		priv->wait_id = 0;
+
+		giggle_sysdeps_kill_pid (priv->pid);
+		g_spawn_close_pid (priv->pid);
+	}
+
+	priv->running = FALSE;
+}
+
+static void
+git_search_finalize (GObject *object)
+{
+	GiggleGitSearchPriv *priv;
+
+	priv = GET_PRIV (object);
+
+	git_search_stop (priv);
+
+	g_string_free (priv->pending, TRUE);
+	g_free (priv->directory);
+	g_free (priv->term);
+	g_strfreev (priv->files);
+	g_clear_error (&priv->error);
+
+	G_OBJECT_CLASS (giggle_git_search_parent_class)->finalize (object);
+}
+
+static gchar *
+git_search_get_command_line (GiggleGitSearchPriv *priv)
+{
+	GString *str;
+	gchar   *quoted;
+	int      i;
+
+	str = g_string_new (GIT_COMMAND);
+	g_string_append (str, " log --all --topo-order --no-color -z"
+			 " '--format=format:%H%x00%an <%ae>%x00%B'");
+
+	if (priv->full_search)
+		g_string_append (str, " -p");
+
+	if (priv->files) {
+		g_string_append (str, " --");
+
+		for (i = 0; priv->files[i]; ++i) {
+			quoted = g_shell_quote (priv->files[i]);
+			g_string_append_printf (str, " %s", quoted);
+			g_free (quoted);
+		}
+	}
+
+	return g_string_free (str, FALSE);
+}
+
+static gboolean
+git_search_field_matches (GiggleGitSearchPriv *priv,
+			  const gchar         *field,
+			  gsize                length)
+{
+	gchar    *casefold;
+	gboolean  match;
+
+	/* the search term already got casefolded by GiggleSearchable */
+	if (g_utf8_validate (field, length, NULL))
+		casefold = g_utf8_casefold (field, length);
+	else
+		casefold = g_ascii_strdown (field, length);
+
+	match = (strstr (casefold, priv->term) != NULL);
+	g_free (casefold);
+
+	return match;
+}
+
+static void
+git_search_finish_field (GiggleGitSearch *search)
+{
+	GiggleGitSearchPriv *priv;
+
+	priv = GET_PRIV (search);
+
+	if (FIELD_SHA == priv->field) {
+		g_strlcpy (priv->sha, priv->pending->str, sizeof (priv->sha));
+		priv->matched = FALSE;
+	}
+
+	if (!priv->matched) {
+		priv->matched = git_search_field_matches (priv, priv->pending->str,
+							  priv->pending->len);
+	}
+
+	g_string_truncate (priv->pending, 0);
+
+	if (++priv->field < N_FIELDS)
+		return;
+
+	priv->field = FIELD_SHA;
+	priv->n_searched++;
+	memcpy (priv->last_sha, priv->sha, sizeof (priv->last_sha));
+
+	if (priv->matched)
+		g_signal_emit (search, signals[MATCH_FOUND], 0, priv->sha);
+}
+
+static void
+git_search_parse (GiggleGitSearch *search,
+		  const gchar     *output_str,
+		  gsize            output_len)
+{
+	GiggleGitSearchPriv *priv;
+	const gchar         *end, *nul;
+
+	priv = GET_PRIV (search);
+	end = output_str + output_len;
+
+	while (output_str < end) {
+		nul = memchr (output_str, '\0', end - output_str);
+
+		if (!nul) {
+			/* the rest of this field comes with the next chunk */
+			g_string_append_len (priv->pending, output_str, end - output_str);
+			break;
+		}
+
+		g_string_append_len (priv->pending, output_str, nul - output_str);
+		git_search_finish_field (search);
+
+		output_str = nul + 1;
+	}
+}
+
+/* once git exited and all of its output got read */
+static void
+git_search_finish (GiggleGitSearch *search)
+{
+	GiggleGitSearchPriv *priv;
+
+	priv = GET_PRIV (search);
+
+	priv->running = FALSE;
+
+	g_signal_emit (search, signals[PROGRESS], 0);
+	g_signal_emit (search, signals[FINISHED], 0);
+}
+
+static gboolean
+git_search_read_cb (GIOChannel      *source,
+		    GIOCondition     condition,
+		    GiggleGitSearch *search)
+{
+	GiggleGitSearchPriv *priv;
+	gchar                buffer[IO_BUFFER_SIZE];
+	GIOStatus            status;
+	gsize                length = 0;
+	gboolean             running;
+
+	priv = GET_PRIV (search);
+
+	status = g_io_channel_read_chars (source, buffer, sizeof (buffer), &length, NULL);
+
+	/* handlers may cancel or even drop the search */
+	g_object_ref (search);
+
+	if (length > 0) {
+		git_search_parse (search, buffer, length);
+		g_signal_emit (search, signals[PROGRESS], 0);
+	}
+
+	running = (0 != priv->read_id);
+
+	if (running && G_IO_STATUS_NORMAL != status && G_IO_STATUS_AGAIN != status) {
+		/* records are separated, not terminated */
+		if (priv->pending->len > 0 || FIELD_SHA != priv->field)
+			git_search_finish_field (search);
+
+		priv->read_id = 0;
+		running = FALSE;
+
+		if (!priv->wait_id)
+			git_search_finish (search);
+	}
+
+	g_object_unref (search);
+
+	return running;
+}
+
+static void
+git_search_exited_cb (GPid             pid,
+		      gint             status,
+		      GiggleGitSearch *search)
+{
+	GiggleGitSearchPriv *priv;
+
+	priv = GET_PRIV (search);
+
+	g_spawn_close_pid (pid);
+	priv->wait_id = 0;
+
+	if (!WIFEXITED (status) || WEXITSTATUS (status)) {
+		g_set_error (&priv->error, G_SPAWN_ERROR, G_SPAWN_ERROR_FAILED,
+			     "git log exited with status %d", status);
+	}
+
+	/* wait for the output which is still in the pipe */
+	if (!priv->read_id)
+		git_search_finish (search);
+}
+
+GiggleGitSearch *
+giggle_git_search_new (const gchar         *directory,
+		       const gchar         *search_term,
+		       gboolean             full_search,
+		       const gchar * const *files)
+{
+	GiggleGitSearch     *search;
+	GiggleGitSearchPriv *priv;
+
+	g_return_val_if_fail (NULL != directory, NULL);
+	g_return_val_if_fail (NULL != search_term, NULL);
+
+	search = g_object_new (GIGGLE_TYPE_GIT_SEARCH, NULL);
+	priv = GET_PRIV (search);
+
+	priv->directory = g_strdup (directory);
+	priv->term = g_strdup (search_term);
+	priv->full_search = full_search;
+	priv->files = g_strdupv ((gchar **) files);
+
+	return search;
+}
+
+gboolean
+giggle_git_search_start (GiggleGitSearch  *search,
+			 GError          **error)
+{
+	GiggleGitSearchPriv  *priv;
+	gchar                *command;
+	gchar               **argv;
+	gint                  std_out;
+	gboolean              success;
+
+	g_return_val_if_fail (GIGGLE_IS_GIT_SEARCH (search), FALSE);
+
+	priv = GET_PRIV (search);
+	git_search_stop (priv);
+	g_clear_error (&priv->error);
+
+	command = git_search_get_command_line (priv);
+	success = g_shell_parse_argv (command, NULL, &argv, error);
+	g_free (command);
+
+	if (!success)
+		return FALSE;
+
+	success = g_spawn_async_with_pipes (priv->directory, argv, NULL,
+					    G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD |
+					    G_SPAWN_STDERR_TO_DEV_NULL,
+					    giggle_sysdeps_child_setup, NULL, &priv->pid,
+					    NULL, &std_out, NULL, error);
+	g_strfreev (argv);
+
+	if (!success)
+		return FALSE;
+
+	priv->output = g_io_channel_unix_new (std_out);
+	g_io_channel_set_encoding (priv->output, NULL, NULL);
+	g_io_channel_set_buffered (priv->output, FALSE);
+	g_io_channel_set_close_on_unref (priv->output, TRUE);
+
+	/* below redraws, so that matches don't hold up scrolling */
+	priv->read_id = g_io_add_watch_full (priv->output, G_PRIORITY_DEFAULT_IDLE,
+					     G_IO_IN | G_IO_HUP,
+					     (GIOFunc) git_search_read_cb,
+					     search, NULL);
+	priv->wait_id = g_child_watch_add (priv->pid,
+					   (GChildWatchFunc) git_search_exited_cb,
+					   search);
+	priv->running = TRUE;
+
+	return TRUE;
+}
+
+void
+giggle_git_search_cancel (GiggleGitSearch *search)
+{
+	g_return_if_fail (GIGGLE_IS_GIT_SEARCH (search));
+	git_search_stop (GET_PRIV (search));
+}
+
+gboolean
+giggle_git_search_is_running (GiggleGitSearch *search)
+{
+	g_return_val_if_fail (GIGGLE_IS_GIT_SEARCH (search), FALSE);
+	return GET_PRIV (search)->running;
+}
+
+/* why the search failed, or NULL */
+const GError *
+giggle_git_search_get_error (GiggleGitSearch *search)
+{
+	g_return_val_if_fail (GIGGLE_IS_GIT_SEARCH (search), NULL);
+	return GET_PRIV (search)->error;
+}
+
+const gchar *
+giggle_git_search_get_term (GiggleGitSearch *search)
+{
+	g_return_val_if_fail (GIGGLE_IS_GIT_SEARCH (search), NULL);
+	return GET_PRIV (search)->term;
+}
+
+gboolean
+giggle_git_search_get_full_search (GiggleGitSearch *search)
+{
+	g_return_val_if_fail (GIGGLE_IS_GIT_SEARCH (search), FALSE);
+	return GET_PRIV (search)->full_search;
+}
+
+guint
+giggle_git_search_get_n_searched (GiggleGitSearch *search)
+{
+	g_return_val_if_fail (GIGGLE_IS_GIT_SEARCH (search), 0);
+	return GET_PRIV (search)->n_searched;
+}
+
+/* sha of the last commit which was searched completely,
+ * or an empty string before the first one */
+const gchar *
+giggle_git_search_get_last_sha (GiggleGitSearch *search)
+{
+	g_return_val_if_fail (GIGGLE_IS_GIT_SEARCH (search), NULL);
+	return GET_PRIV (search)->last_sha;
+}
@@ -0,0 +1,70 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GIGGLE_GIT_SEARCH_H__
+#define __GIGGLE_GIT_SEARCH_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GIGGLE_TYPE_GIT_SEARCH            (giggle_git_search_get_type ())
+#define GIGGLE_GIT_SEARCH(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIGGLE_TYPE_GIT_SEARCH, GiggleGitSearch))
+#define GIGGLE_GIT_SEARCH_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), GIGGLE_TYPE_GIT_SEARCH, GiggleGitSearchClass))
+#define GIGGLE_IS_GIT_SEARCH(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GIGGLE_TYPE_GIT_SEARCH))
+#define GIGGLE_IS_GIT_SEARCH_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GIGGLE_TYPE_GIT_SEARCH))
+#define GIGGLE_GIT_SEARCH_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GIGGLE_TYPE_GIT_SEARCH, GiggleGitSearchClass))
+
+typedef struct GiggleGitSearch      GiggleGitSearch;
+typedef struct GiggleGitSearchClass GiggleGitSearchClass;
+
+struct GiggleGitSearch {
+	GObject parent_instance;
+};
+
+struct GiggleGitSearchClass {
+	GObjectClass parent_class;
+
+	void (* match_found) (GiggleGitSearch *search,
+			      const gchar     *sha);
+	void (* progress)    (GiggleGitSearch *search);
+	void (* finished)    (GiggleGitSearch *search);
+};
+
+GType             giggle_git_search_get_type        (void);
+GiggleGitSearch * giggle_git_search_new             (const gchar         *directory,
+						     const gchar         *search_term,
+						     gboolean             full_search,
+						     const gchar * const *files);
+
+gboolean          giggle_git_search_start           (GiggleGitSearch     *search,
+						     GError             **error);
+void              giggle_git_search_cancel          (GiggleGitSearch     *search);
+gboolean          giggle_git_search_is_running      (GiggleGitSearch     *search);
+const GError *    giggle_git_search_get_error       (GiggleGitSearch     *search);
+
+const gchar *     giggle_git_search_get_term        (GiggleGitSearch     *search);
+gboolean          giggle_git_search_get_full_search (GiggleGitSearch     *search);
+guint             giggle_git_search_get_n_searched  (GiggleGitSearch     *search);
+const gchar *     giggle_git_search_get_last_sha    (GiggleGitSearch     *search);
+
+G_END_DECLS
+
+#endif /* __GIGGLE_GIT_SEARCH_H__ */
@@ -0,0 +1,626 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+#include "giggle-git-status.h"
+
+#include <string.h>
+
+#define NO_PATH G_MAXUINT32
+
+/* Status of the working tree, or of a given set of paths, as reported
+ * by porcelain v2. Clean paths are not listed at all. Listed paths are
+ * copied back to back into one arena, the entries refer to them by
+ * offset and get sorted for binary searching once git is done. */
+typedef struct {
+	guint32 path;
+	guint32 orig_path;
+	gchar   kind; /* '1', '2', 'u', '?', '!', or 'r' for the source of a rename */
+	gchar   x;
+	gchar   y;
+} StatusEntry;
+
+typedef struct GiggleGitStatusPriv GiggleGitStatusPriv;
+
+struct GiggleGitStatusPriv {
+	gchar      **paths;
+
+	GString     *arena;
+	GArray      *entries;
+	GString     *pending;
+
+	/* entry index + 1 of a rename, its record is followed by the
+	 * original path. G_MAXUINT skips the next record. */
+	guint        orig_entry;
+
+	/* changes learned after the job finished */
+	GHashTable  *overrides;
+};
+
+static void     git_status_finalize              (GObject     *object);
+
+static gboolean git_status_get_command_line      (GiggleJob   *job,
+						  gchar      **command_line);
+static void     git_status_handle_output         (GiggleJob   *job,
+						  const gchar *output_str,
+						  gsize        output_len);
+static void     git_status_handle_partial_output (GiggleJob   *job,
+						  const gchar *output_str,
+						  gsize        output_len);
+static void     git_status_add_rename_sources    (GiggleGitStatusPriv *priv);
+
+G_DEFINE_TYPE (GiggleGitStatus, giggle_git_status, GIGGLE_TYPE_JOB)
+
+#define GET_PRIV(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIGGLE_TYPE_GIT_STATUS, GiggleGitStatusPriv))
+
+#define ENTRY(priv,i)  (&g_array_index ((priv)->entries, StatusEntry, (i)))
+#define STRING(priv,o) ((priv)->arena->str + (o))
+
+static void
+giggle_git_status_class_init (GiggleGitStatusClass *class)
+{
+	GObjectClass   *object_class = G_OBJECT_CLASS (class);
+	GiggleJobClass *job_class    = GIGGLE_JOB_CLASS (class);
+
+	object_class->finalize = git_status_finalize;
+
+	job_class->get_command_line      = git_status_get_command_line;
+	job_class->handle_output         = git_status_handle_output;
+	job_class->handle_partial_output = git_status_handle_partial_output;
+
+	g_type_class_add_private (object_class, sizeof (GiggleGitStatusPriv));
+}
+
+static void
+giggle_git_status_init (GiggleGitStatus *status)
+{
+	GiggleGitStatusPriv *priv;
+
+	priv = GET_PRIV (status);
+
+	priv->arena = g_string_new (NULL);
+	priv->entries = g_array_new (FALSE, FALSE, sizeof (StatusEntry));
+	priv->pending = g_string_new (NULL);
+}
+
+static void
+git_status_finalize (GObject *object)
+{
+	GiggleGitStatusPriv *priv;
+
+	priv = GET_PRIV (object);
+
+	g_strfreev (priv->paths);
+	g_string_free (priv->arena, TRUE);
+	g_array_free (priv->entries, TRUE);
+	g_string_free (priv->pending, TRUE);
+
+	if (priv->overrides)
+		g_hash_table_destroy (priv->overrides);
+
+	G_OBJECT_CLASS (giggle_git_status_parent_class)->finalize (object);
+}
+
+static gboolean
+git_status_get_command_line (GiggleJob *job, gchar **command_line)
+{
+	GiggleGitStatusPriv *priv;
+	GString             *str;
+	gchar               *quoted;
+	gint                 i;
+
+	priv = GET_PRIV (job);
+
+	/* status refreshes the index when it can take the lock, which
+	 * would look like a change of the index to the watcher. ignored
+	 * paths are listed to tell them from clean tracked files, whole
+	 * ignored directories get listed just once. */
+	str = g_string_new (GIT_COMMAND " --no-optional-locks --literal-pathspecs "
+			    "status --porcelain=v2 -z --untracked-files=all --ignored=matching");
+
+	if (priv->paths) {
+		g_string_append (str, " --");
+
+		for (i = 0; priv->paths[i]; ++i) {
+			quoted = g_shell_quote (priv->paths[i]);
+			g_string_append_c (str, ' ');
+			g_string_append (str, quoted);
+			g_free (quoted);
+		}
+	}
+
+	*command_line = g_string_free (str, FALSE);
+
+	return TRUE;
+}
+
+static guint32
+git_status_add_string (GiggleGitStatusPriv *priv,
+		       const gchar         *str,
+		       gsize                length)
+{
+	guint32 offset;
+
+	offset = priv->arena->len;
+	g_string_append_len (priv->arena, str, length);
+	g_string_append_c (priv->arena, '\0');
+
+	return offset;
+}
+
+/* skips n space separated fields */
+static const gchar *
+git_status_skip_fields (const gchar *record,
+			const gchar *end,
+			gint         n)
+{
+	while (n-- > 0) {
+		record = memchr (record, ' ', end - record);
+
+		if (!record)
+			return NULL;
+
+		++record;
+	}
+
+	return record;
+}
+
+static void
+git_status_add_record (GiggleGitStatusPriv *priv,
+		       const gchar         *record,
+		       gsize                length)
+{
+	StatusEntry  entry;
+	const gchar *end, *path;
+
+	if (priv->orig_entry) {
+		if (G_MAXUINT != priv->orig_entry)
+			ENTRY (priv, priv->orig_entry - 1)->orig_path =
+				git_status_add_string (priv, record, length);
+
+		priv->orig_entry = 0;
+		return;
+	}
+
+	if (length < 3 || ' ' != record[1])
+		return;
+
+	end = record + length;
+
+	switch (record[0]) {
+	case '1':
+		/* 1 XY sub mH mI mW hH hI path */
+		path = git_status_skip_fields (record, end, 8);
+		break;
+
+	case '2':
+		/* 2 XY sub mH mI mW hH hI Xscore path, then the original path */
+		path = git_status_skip_fields (record, end, 9);
+		priv->orig_entry = (path ? priv->entries->len + 1 : G_MAXUINT);
+		break;
+
+	case 'u':
+		/* u XY sub m1 m2 m3 mW h1 h2 h3 path */
+		path = git_status_skip_fields (record, end, 10);
+		break;
+
+	case '?':
+	case '!':
+		path = record + 2;
+		break;
+
+	default:
+		/* headers, and whatever newer versions add */
+		return;
+	}
+
+	if (!path || path >= end)
+		return;
+
+	entry.kind = record[0];
+	entry.x = (path - record > 4 ? record[2] : '.');
+	entry.y = (path - record > 4 ? record[3] : '.');
+	entry.path = git_status_add_string (priv, path, end - path);
+	entry.orig_path = NO_PATH;
+
+	g_array_append_val (priv->entries, entry);
+}
+
+static void
+git_status_parse (GiggleGitStatusPriv *priv,
+		  const gchar         *output_str,
+		  gsize                output_len)
+{
+	const gchar *end, *nul;
+
+	end = output_str + output_len;
+
+	while (output_str < end) {
+		nul = memchr (output_str, '\0', end - output_str);
+
+		if (!nul) {
+			/* the rest of this record comes with the next chunk */
+			g_string_append_len (priv->pending, output_str, end - output_str);
+			break;
+		}
+
+		if (priv->pending->len) {
+			g_string_append_len (priv->pending, output_str, nul - output_str);
+			git_status_add_record (priv, priv->pending->str, priv->pending->len);
+			g_string_truncate (priv->pending, 0);
+		} else {
+			git_status_add_record (priv, output_str, nul - output_str);
+		}
+
+		output_str = nul + 1;
+	}
+}
+
+static void
+git_status_handle_partial_output (GiggleJob   *job,
+				  const gchar *output_str,
+				  gsize        output_len)
+{
+	git_status_parse (GET_PRIV (job), output_str, output_len);
+}
+
+/* which entry describes a path listed more than once, like the
+ * "1 D." and "?" entries of a path removed by git rm --cached */
+static gint
+git_status_get_kind_rank (gchar kind)
+{
+	switch (kind) {
+	case 'u':
+		return 0;
+	case '2':
+		return 1;
+	case '1':
+		return 2;
+	case '?':
+		return 3;
+	case '!':
+		return 4;
+	default:
+		return 5;
+	}
+}
+
+static gint
+git_status_compare_entries (gconstpointer a,
+			    gconstpointer b,
+			    gpointer      user_data)
+{
+	GiggleGitStatusPriv *priv = user_data;
+	const StatusEntry   *entry_a = a, *entry_b = b;
+	gint                 cmp;
+
+	cmp = strcmp (STRING (priv, entry_a->path), STRING (priv, entry_b->path));
+
+	if (!cmp) {
+		cmp = (git_status_get_kind_rank (entry_a->kind) -
+		       git_status_get_kind_rank (entry_b->kind));
+	}
+
+	return cmp;
+}
+
+/* sorts the entries for binary searching, keeping one per path */
+static void
+git_status_sort_entries (GiggleGitStatusPriv *priv)
+{
+	StatusEntry *entry;
+	guint        i, j;
+
+	g_qsort_with_data (priv->entries->data, priv->entries->len,
+			   sizeof (StatusEntry), git_status_compare_entries, priv);
+
+	for (i = j = 0; i < priv->entries->len; ++i) {
+		entry = ENTRY (priv, i);
+
+		if (j > 0 && !strcmp (STRING (priv, entry->path),
+				      STRING (priv, ENTRY (priv, j - 1)->path)))
+			continue;
+
+		if (i != j)
+			*ENTRY (priv, j) = *entry;
+
+		++j;
+	}
+
+	g_array_set_size (priv->entries, j);
+}
+
+static void
+git_status_handle_output (GiggleJob   *job,
+			  const gchar *output_str,
+			  gsize        output_len)
+{
+	GiggleGitStatusPriv *priv;
+
+	priv = GET_PRIV (job);
+
+	git_status_parse (priv, output_str, output_len);
+
+	if (priv->pending->len) {
+		git_status_add_record (priv, priv->pending->str, priv->pending->len);
+		g_string_truncate (priv->pending, 0);
+	}
+
+	/* changes, untracked and ignored paths come as separate runs */
+	git_status_sort_entries (priv);
+
+	git_status_add_rename_sources (priv);
+}
+
+/* the entry for the first length bytes of key */
+static StatusEntry *
+git_status_find (GiggleGitStatusPriv *priv,
+		 const gchar         *key,
+		 gsize                length)
+{
+	const gchar *path;
+	guint        low, high, mid;
+	int          cmp;
+
+	low = 0;
+	high = priv->entries->len;
+
+	while (low < high) {
+		mid = (low + high) / 2;
+		path = STRING (priv, ENTRY (priv, mid)->path);
+		cmp = strncmp (path, key, length);
+
+		if (!cmp && path[length])
+			cmp = 1;
+
+		if (!cmp)
+			return ENTRY (priv, mid);
+
+		if (cmp < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return NULL;
+}
+
+/* the source of a rename is gone from the index, but git only lists
+ * it along with the destination. entries get added for sources which
+ * are not listed on their own, so that looking them up and walking
+ * the entries both tell they got deleted. */
+static void
+git_status_add_rename_sources (GiggleGitStatusPriv *priv)
+{
+	StatusEntry *entry, source;
+	const gchar *orig_path;
+	GArray      *sources;
+	guint        i;
+
+	sources = g_array_new (FALSE, FALSE, sizeof (StatusEntry));
+
+	for (i = 0; i < priv->entries->len; ++i) {
+		entry = ENTRY (priv, i);
+
+		if (NO_PATH == entry->orig_path || ('R' != entry->x && 'R' != entry->y))
+			continue;
+
+		orig_path = STRING (priv, entry->orig_path);
+
+		if (git_status_find (priv, orig_path, strlen (orig_path)))
+			continue;
+
+		source.kind = 'r';
+		source.x = 'D';
+		source.y = '.';
+		source.path = entry->orig_path;
+		source.orig_path = NO_PATH;
+
+		g_array_append_val (sources, source);
+	}
+
+	if (sources->len > 0) {
+		g_array_append_vals (priv->entries, sources->data, sources->len);
+		git_status_sort_entries (priv);
+	}
+
+	g_array_free (sources, TRUE);
+}
+
+/* maps entries to what ls-files -t would have said */
+static GiggleGitListFilesStatus
+git_status_entry_to_status (StatusEntry *entry)
+{
+	switch (entry->kind) {
+	case 'u':
+		return GIGGLE_GIT_FILE_STATUS_UNMERGED;
+	case '?':
+	case '!':
+		return GIGGLE_GIT_FILE_STATUS_OTHER;
+	case 'r':
+		return GIGGLE_GIT_FILE_STATUS_DELETED;
+	default:
+		break;
+	}
+
+	switch (entry->y) {
+	case 'M':
+	case 'T':
+		return GIGGLE_GIT_FILE_STATUS_CHANGED;
+	case 'D':
+		return GIGGLE_GIT_FILE_STATUS_DELETED;
+	default:
+		break;
+	}
+
+	/* removed from the index, the file is untracked now */
+	if ('D' == entry->x)
+		return GIGGLE_GIT_FILE_STATUS_OTHER;
+
+	return GIGGLE_GIT_FILE_STATUS_CACHED;
+}
+
+/* paths are relative to the project directory, NULL queries all of it */
+GiggleJob *
+giggle_git_status_new (const gchar * const *paths)
+{
+	GiggleGitStatus *status;
+
+	status = g_object_new (GIGGLE_TYPE_GIT_STATUS, NULL);
+	GET_PRIV (status)->paths = g_strdupv ((gchar **) paths);
+
+	return GIGGLE_JOB (status);
+}
+
+const gchar * const *
+giggle_git_status_get_paths (GiggleGitStatus *status)
+{
+	g_return_val_if_fail (GIGGLE_IS_GIT_STATUS (status), NULL);
+	return (const gchar * const *) GET_PRIV (status)->paths;
+}
+
+/* calls func for every path git listed and for the sources of
+ * renames, ignored directories get listed with a trailing slash */
+void
+giggle_git_status_foreach (GiggleGitStatus     *status,
+			   GiggleGitStatusFunc  func,
+			   gpointer             user_data)
+{
+	GiggleGitStatusPriv *priv;
+	StatusEntry         *entry;
+	guint                i;
+
+	g_return_if_fail (GIGGLE_IS_GIT_STATUS (status));
+	g_return_if_fail (NULL != func);
+
+	priv = GET_PRIV (status);
+
+	for (i = 0; i < priv->entries->len; ++i) {
+		entry = ENTRY (priv, i);
+		func (STRING (priv, entry->path), git_status_entry_to_status (entry), user_data);
+	}
+}
+
+/* unlisted paths are clean, unless they are below an untracked or
+ * ignored directory */
+GiggleGitListFilesStatus
+giggle_git_status_get_file_status (GiggleGitStatus *status,
+				   const gchar     *path)
+{
+	GiggleGitStatusPriv *priv;
+	StatusEntry         *entry;
+	const gchar         *slash;
+	gpointer             value;
+
+	g_return_val_if_fail (GIGGLE_IS_GIT_STATUS (status), GIGGLE_GIT_FILE_STATUS_OTHER);
+	g_return_val_if_fail (NULL != path, GIGGLE_GIT_FILE_STATUS_OTHER);
+
+	priv = GET_PRIV (status);
+
+	if (priv->overrides && g_hash_table_lookup_extended (priv->overrides, path, NULL, &value))
+		return GPOINTER_TO_INT (value);
+
+	entry = git_status_find (priv, path, strlen (path));
+
+	if (entry)
+		return git_status_entry_to_status (entry);
+
+	for (slash = strchr (path, '/'); slash; slash = strchr (slash + 1, '/')) {
+		entry = git_status_find (priv, path, slash + 1 - path);
+
+		if (entry && ('?' == entry->kind || '!' == entry->kind))
+			return GIGGLE_GIT_FILE_STATUS_OTHER;
+	}
+
+	return GIGGLE_GIT_FILE_STATUS_CACHED;
+}
+
+/* lets partial queries update the result of a full one */
+void
+giggle_git_status_set_file_status (GiggleGitStatus          *status,
+				   const gchar              *path,
+				   GiggleGitListFilesStatus  file_status)
+{
+	GiggleGitStatusPriv *priv;
+
+	g_return_if_fail (GIGGLE_IS_GIT_STATUS (status));
+	g_return_if_fail (NULL != path);
+
+	priv = GET_PRIV (status);
+
+	if (!priv->overrides)
+		priv->overrides = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	g_hash_table_replace (priv->overrides, g_strdup (path), GINT_TO_POINTER (file_status));
+}
+
+/* the source of a rename or copy */
+const gchar *
+giggle_git_status_get_orig_path (GiggleGitStatus *status,
+				 const gchar     *path)
+{
+	GiggleGitStatusPriv *priv;
+	StatusEntry         *entry;
+
+	g_return_val_if_fail (GIGGLE_IS_GIT_STATUS (status), NULL);
+	g_return_val_if_fail (NULL != path, NULL);
+
+	priv = GET_PRIV (status);
+	entry = git_status_find (priv, path, strlen (path));
+
+	if (!entry || NO_PATH == entry->orig_path)
+		return NULL;
+
+	return STRING (priv, entry->orig_path);
+}
+
+GiggleGitStatusConflict
+giggle_git_status_get_conflict (GiggleGitStatus *status,
+				const gchar     *path)
+{
+	StatusEntry *entry;
+
+	g_return_val_if_fail (GIGGLE_IS_GIT_STATUS (status), GIGGLE_GIT_CONFLICT_NONE);
+	g_return_val_if_fail (NULL != path, GIGGLE_GIT_CONFLICT_NONE);
+
+	entry = git_status_find (GET_PRIV (status), path, strlen (path));
+
+	if (!entry || 'u' != entry->kind)
+		return GIGGLE_GIT_CONFLICT_NONE;
+
+	switch (entry->x) {
+	case 'D':
+		return ('D' == entry->y ? GIGGLE_GIT_CONFLICT_BOTH_DELETED :
+					  GIGGLE_GIT_CONFLICT_DELETED_BY_US);
+	case 'A':
+		return ('U' == entry->y ? GIGGLE_GIT_CONFLICT_ADDED_BY_US :
+					  GIGGLE_GIT_CONFLICT_BOTH_ADDED);
+	case 'U':
+		if ('D' == entry->y)
+			return GIGGLE_GIT_CONFLICT_DELETED_BY_THEM;
+		if ('A' == entry->y)
+			return GIGGLE_GIT_CONFLICT_ADDED_BY_THEM;
+
+		return GIGGLE_GIT_CONFLICT_BOTH_MODIFIED;
+	default:
+		return GIGGLE_GIT_CONFLICT_BOTH_MODIFIED;
+	}
+}
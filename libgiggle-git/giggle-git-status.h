@@ -0,0 +1,82 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GIGGLE_GIT_STATUS_H__
+#define __GIGGLE_GIT_STATUS_H__
+
+#include <libgiggle-git/giggle-git-list-files.h>
+
+G_BEGIN_DECLS
+
+#define GIGGLE_TYPE_GIT_STATUS            (giggle_git_status_get_type ())
+#define GIGGLE_GIT_STATUS(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIGGLE_TYPE_GIT_STATUS, GiggleGitStatus))
+#define GIGGLE_GIT_STATUS_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), GIGGLE_TYPE_GIT_STATUS, GiggleGitStatusClass))
+#define GIGGLE_IS_GIT_STATUS(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GIGGLE_TYPE_GIT_STATUS))
+#define GIGGLE_IS_GIT_STATUS_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GIGGLE_TYPE_GIT_STATUS))
+#define GIGGLE_GIT_STATUS_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GIGGLE_TYPE_GIT_STATUS, GiggleGitStatusClass))
+
+typedef struct GiggleGitStatus      GiggleGitStatus;
+typedef struct GiggleGitStatusClass GiggleGitStatusClass;
+
+struct GiggleGitStatus {
+	GiggleJob parent;
+};
+
+struct GiggleGitStatusClass {
+	GiggleJobClass parent_class;
+};
+
+/* which sides of a merge added or deleted an unmerged path */
+typedef enum {
+	GIGGLE_GIT_CONFLICT_NONE = 0,
+	GIGGLE_GIT_CONFLICT_BOTH_DELETED,
+	GIGGLE_GIT_CONFLICT_ADDED_BY_US,
+	GIGGLE_GIT_CONFLICT_DELETED_BY_THEM,
+	GIGGLE_GIT_CONFLICT_ADDED_BY_THEM,
+	GIGGLE_GIT_CONFLICT_DELETED_BY_US,
+	GIGGLE_GIT_CONFLICT_BOTH_ADDED,
+	GIGGLE_GIT_CONFLICT_BOTH_MODIFIED
+} GiggleGitStatusConflict;
+
+typedef void (* GiggleGitStatusFunc) (const gchar              *path,
+				      GiggleGitListFilesStatus  status,
+				      gpointer                  user_data);
+
+GType                    giggle_git_status_get_type        (void);
+GiggleJob *              giggle_git_status_new             (const gchar * const *paths);
+
+const gchar * const *    giggle_git_status_get_paths       (GiggleGitStatus          *status);
+void                     giggle_git_status_foreach         (GiggleGitStatus          *status,
+							    GiggleGitStatusFunc       func,
+							    gpointer                  user_data);
+
+GiggleGitListFilesStatus giggle_git_status_get_file_status (GiggleGitStatus          *status,
+							    const gchar              *path);
+void                     giggle_git_status_set_file_status (GiggleGitStatus          *status,
+							    const gchar              *path,
+							    GiggleGitListFilesStatus  file_status);
+const gchar *            giggle_git_status_get_orig_path   (GiggleGitStatus          *status,
+							    const gchar              *path);
+GiggleGitStatusConflict  giggle_git_status_get_conflict    (GiggleGitStatus          *status,
+							    const gchar              *path);
+
+G_END_DECLS
+
+#endif /* __GIGGLE_GIT_STATUS_H__ */
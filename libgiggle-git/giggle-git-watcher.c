@@ -0,0 +1,530 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+#include "giggle-git-watcher.h"
+
+#include <string.h>
+
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
+/* changes arriving within this window get reported together */
+#define FLUSH_DELAY 200
+
+/* directories to add watches for per idle iteration */
+#define SCAN_BATCH  64
+
+typedef enum {
+	WATCH_GIT_DIR,
+	WATCH_REFS,
+	WATCH_WORKTREE
+} WatchKind;
+
+typedef struct {
+	WatchKind  kind;
+	gchar     *rel_path; /* relative to git_dir or project_dir */
+} WatchedDir;
+
+typedef struct GiggleGitWatcherPriv GiggleGitWatcherPriv;
+
+struct GiggleGitWatcherPriv {
+	gchar                   *git_dir;
+	gchar                   *project_dir;
+
+	GiggleGitWatcherFunc     func;
+	gpointer                 user_data;
+
+	int                      fd;
+	GIOChannel              *channel;
+	guint                    io_watch;
+
+	GHashTable              *watches; /* wd -> WatchedDir */
+	GQueue                  *pending; /* WatchedDir without a wd yet */
+	guint                    scan_idle;
+	gboolean                 exhausted;
+
+	GiggleGitWatcherChanges  changes;
+	GHashTable              *paths;
+	guint                    flush_timeout;
+};
+
+G_DEFINE_TYPE (GiggleGitWatcher, giggle_git_watcher, G_TYPE_OBJECT)
+
+#define GET_PRIV(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIGGLE_TYPE_GIT_WATCHER, GiggleGitWatcherPriv))
+
+static WatchedDir *
+watched_dir_new (WatchKind    kind,
+		 const gchar *rel_path)
+{
+	WatchedDir *dir;
+
+	dir = g_slice_new (WatchedDir);
+	dir->kind = kind;
+	dir->rel_path = g_strdup (rel_path);
+
+	return dir;
+}
+
+static void
+watched_dir_free (WatchedDir *dir)
+{
+	g_free (dir->rel_path);
+	g_slice_free (WatchedDir, dir);
+}
+
+static void
+git_watcher_dispose (GObject *object)
+{
+	GiggleGitWatcherPriv *priv;
+
+	priv = GET_PRIV (object);
+
+	if (priv->io_watch) {
+		g_source_remove (priv->io_watch);
+		priv->io_watch = 0;
+	}
+
+	if (priv->scan_idle) {
+		g_source_remove (priv->scan_idle);
+		priv->scan_idle = 0;
+	}
+
+	if (priv->flush_timeout) {
+		g_source_remove (priv->flush_timeout);
+		priv->flush_timeout = 0;
+	}
+
+	if (priv->channel) {
+		/* closes the inotify descriptor */
+		g_io_channel_unref (priv->channel);
+		priv->channel = NULL;
+		priv->fd = -1;
+	}
+
+	G_OBJECT_CLASS (giggle_git_watcher_parent_class)->dispose (object);
+}
+
+static void
+git_watcher_finalize (GObject *object)
+{
+	GiggleGitWatcherPriv *priv;
+
+	priv = GET_PRIV (object);
+
+	g_queue_foreach (priv->pending, (GFunc) watched_dir_free, NULL);
+	g_queue_free (priv->pending);
+	g_hash_table_destroy (priv->watches);
+	g_hash_table_destroy (priv->paths);
+
+	g_free (priv->git_dir);
+	g_free (priv->project_dir);
+
+	G_OBJECT_CLASS (giggle_git_watcher_parent_class)->finalize (object);
+}
+
+static void
+giggle_git_watcher_class_init (GiggleGitWatcherClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+	object_class->dispose  = git_watcher_dispose;
+	object_class->finalize = git_watcher_finalize;
+
+	g_type_class_add_private (object_class, sizeof (GiggleGitWatcherPriv));
+}
+
+static void
+giggle_git_watcher_init (GiggleGitWatcher *watcher)
+{
+	GiggleGitWatcherPriv *priv;
+
+	priv = GET_PRIV (watcher);
+
+	priv->fd = -1;
+	priv->watches = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+					       NULL, (GDestroyNotify) watched_dir_free);
+	priv->pending = g_queue_new ();
+	priv->paths = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+#define WORKTREE_MASK (IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_ATTRIB | \
+		       IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR)
+#define GIT_DIR_MASK  (IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | \
+		       IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR)
+
+static int
+git_watcher_compare_paths (gconstpointer a,
+			   gconstpointer b)
+{
+	return strcmp (*(const gchar **) a, *(const gchar **) b);
+}
+
+static gboolean
+git_watcher_flush (gpointer data)
+{
+	GiggleGitWatcher        *watcher = data;
+	GiggleGitWatcherPriv    *priv;
+	GiggleGitWatcherChanges  changes;
+	GPtrArray               *paths;
+	GHashTableIter           iter;
+	gpointer                 path;
+
+	priv = GET_PRIV (watcher);
+
+	priv->flush_timeout = 0;
+
+	changes = priv->changes;
+	priv->changes = 0;
+
+	paths = g_ptr_array_sized_new (g_hash_table_size (priv->paths) + 1);
+	g_hash_table_iter_init (&iter, priv->paths);
+
+	while (g_hash_table_iter_next (&iter, &path, NULL)) {
+		g_ptr_array_add (paths, path);
+		g_hash_table_iter_steal (&iter);
+	}
+
+	qsort (paths->pdata, paths->len, sizeof (gpointer), git_watcher_compare_paths);
+	g_ptr_array_add (paths, NULL);
+
+	g_object_ref (watcher);
+	priv->func (watcher, changes, (const gchar * const *) paths->pdata, priv->user_data);
+	g_object_unref (watcher);
+
+	g_strfreev ((gchar **) g_ptr_array_free (paths, FALSE));
+
+	return FALSE;
+}
+
+static void
+git_watcher_queue_flush (GiggleGitWatcher        *watcher,
+			 GiggleGitWatcherChanges  changes)
+{
+	GiggleGitWatcherPriv *priv;
+
+	priv = GET_PRIV (watcher);
+
+	priv->changes |= changes;
+
+	/* not restarted by later events, a busy tree still gets reported */
+	if (!priv->flush_timeout)
+		priv->flush_timeout = g_timeout_add (FLUSH_DELAY, git_watcher_flush, watcher);
+}
+
+static gboolean
+git_watcher_is_dir (const gchar   *path,
+		    struct dirent *entry)
+{
+	struct stat st;
+
+#ifdef _DIRENT_HAVE_D_TYPE
+	if (entry->d_type != DT_UNKNOWN)
+		return entry->d_type == DT_DIR;
+#endif
+
+	/* don't follow symlinks, they could lead out of the tree */
+	return !lstat (path, &st) && S_ISDIR (st.st_mode);
+}
+
+static void
+git_watcher_add_watch (GiggleGitWatcher *watcher,
+		       WatchedDir       *dir)
+{
+	GiggleGitWatcherPriv *priv;
+	struct dirent        *entry;
+	const gchar          *base;
+	gchar                *path;
+	gchar                *child_path;
+	gchar                *rel_path;
+	DIR                  *dirp;
+	int                   wd;
+
+	priv = GET_PRIV (watcher);
+
+	base = (WATCH_WORKTREE == dir->kind ? priv->project_dir : priv->git_dir);
+	path = g_build_filename (base, dir->rel_path, NULL);
+
+	wd = inotify_add_watch (priv->fd, path,
+				WATCH_WORKTREE == dir->kind ? WORKTREE_MASK : GIT_DIR_MASK);
+
+	if (wd < 0) {
+		if (ENOSPC == errno && !priv->exhausted) {
+			g_warning ("Ran out of inotify watches at %s, "
+				   "changes below other directories will be missed. "
+				   "Consider raising fs.inotify.max_user_watches.", path);
+			priv->exhausted = TRUE;
+		}
+
+		watched_dir_free (dir);
+		g_free (path);
+		return;
+	}
+
+	g_hash_table_replace (priv->watches, GINT_TO_POINTER (wd), dir);
+
+	if (WATCH_GIT_DIR == dir->kind || !(dirp = opendir (path))) {
+		g_free (path);
+		return;
+	}
+
+	while (NULL != (entry = readdir (dirp))) {
+		if (!strcmp (entry->d_name, ".") ||
+		    !strcmp (entry->d_name, "..") ||
+		    !strcmp (entry->d_name, ".git"))
+			continue;
+
+		child_path = g_build_filename (path, entry->d_name, NULL);
+
+		if (git_watcher_is_dir (child_path, entry)) {
+			rel_path = (*dir->rel_path ?
+				    g_build_filename (dir->rel_path, entry->d_name, NULL) :
+				    g_strdup (entry->d_name));
+			g_queue_push_tail (priv->pending, watched_dir_new (dir->kind, rel_path));
+			g_free (rel_path);
+		}
+
+		g_free (child_path);
+	}
+
+	closedir (dirp);
+	g_free (path);
+}
+
+static gboolean
+git_watcher_scan_idle (gpointer data)
+{
+	GiggleGitWatcher     *watcher = data;
+	GiggleGitWatcherPriv *priv;
+	int                   i;
+
+	priv = GET_PRIV (watcher);
+
+	for (i = 0; i < SCAN_BATCH && !g_queue_is_empty (priv->pending); ++i) {
+		if (priv->exhausted) {
+			watched_dir_free (g_queue_pop_head (priv->pending));
+			continue;
+		}
+
+		git_watcher_add_watch (watcher, g_queue_pop_head (priv->pending));
+	}
+
+	if (g_queue_is_empty (priv->pending)) {
+		priv->scan_idle = 0;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+git_watcher_queue_dir (GiggleGitWatcher *watcher,
+		       WatchKind         kind,
+		       const gchar      *rel_path)
+{
+	GiggleGitWatcherPriv *priv;
+
+	priv = GET_PRIV (watcher);
+
+	g_queue_push_tail (priv->pending, watched_dir_new (kind, rel_path));
+
+	if (!priv->scan_idle)
+		priv->scan_idle = g_idle_add_full (G_PRIORITY_LOW, git_watcher_scan_idle, watcher, NULL);
+}
+
+static void
+git_watcher_handle_event (GiggleGitWatcher     *watcher,
+			  struct inotify_event *event)
+{
+	GiggleGitWatcherPriv *priv;
+	WatchedDir           *dir;
+	const gchar          *name;
+	gchar                *rel_path;
+
+	priv = GET_PRIV (watcher);
+
+	if (event->mask & IN_Q_OVERFLOW) {
+		/* events got lost, an empty path stands for the whole tree */
+		g_hash_table_replace (priv->paths, g_strdup (""), NULL);
+		git_watcher_queue_flush (watcher,
+					 GIGGLE_GIT_WATCHER_REFS |
+					 GIGGLE_GIT_WATCHER_INDEX |
+					 (priv->project_dir ? GIGGLE_GIT_WATCHER_WORKTREE : 0));
+		return;
+	}
+
+	if (event->mask & IN_IGNORED) {
+		g_hash_table_remove (priv->watches, GINT_TO_POINTER (event->wd));
+		return;
+	}
+
+	dir = g_hash_table_lookup (priv->watches, GINT_TO_POINTER (event->wd));
+	name = (event->len ? event->name : NULL);
+
+	/* git writes through lock files and renames them into place */
+	if (!dir || !name || g_str_has_suffix (name, ".lock"))
+		return;
+
+	switch (dir->kind) {
+	case WATCH_GIT_DIR:
+		if (!strcmp (name, "HEAD") || !strcmp (name, "packed-refs"))
+			git_watcher_queue_flush (watcher, GIGGLE_GIT_WATCHER_REFS);
+		else if (!strcmp (name, "index"))
+			git_watcher_queue_flush (watcher, GIGGLE_GIT_WATCHER_INDEX);
+		else if (!strcmp (name, "description"))
+			git_watcher_queue_flush (watcher, GIGGLE_GIT_WATCHER_DESCRIPTION);
+		else if (!strcmp (name, "config"))
+			git_watcher_queue_flush (watcher, GIGGLE_GIT_WATCHER_CONFIG);
+
+		return;
+
+	case WATCH_REFS:
+		rel_path = g_build_filename (dir->rel_path, name, NULL);
+		git_watcher_queue_flush (watcher, GIGGLE_GIT_WATCHER_REFS);
+		break;
+
+	case WATCH_WORKTREE:
+		if (!*dir->rel_path && !strcmp (name, ".git"))
+			return;
+
+		rel_path = (*dir->rel_path ?
+			    g_build_filename (dir->rel_path, name, NULL) :
+			    g_strdup (name));
+		g_hash_table_replace (priv->paths, g_strdup (rel_path), NULL);
+		git_watcher_queue_flush (watcher, GIGGLE_GIT_WATCHER_WORKTREE);
+		break;
+
+	default:
+		g_return_if_reached ();
+	}
+
+	if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+		git_watcher_queue_dir (watcher, dir->kind, rel_path);
+
+	g_free (rel_path);
+}
+
+static gboolean
+git_watcher_io_cb (GIOChannel   *source,
+		   GIOCondition  condition,
+		   gpointer      data)
+{
+	GiggleGitWatcher     *watcher = data;
+	GiggleGitWatcherPriv *priv;
+	struct inotify_event *event;
+	gssize                len, offset;
+
+	union {
+		struct inotify_event event;
+		gchar                data[4096];
+	} buffer;
+
+	priv = GET_PRIV (watcher);
+
+	while ((len = read (priv->fd, &buffer, sizeof (buffer))) > 0) {
+		for (offset = 0; offset < len;
+		     offset += sizeof (struct inotify_event) + event->len) {
+			event = (struct inotify_event *) (buffer.data + offset);
+			git_watcher_handle_event (watcher, event);
+		}
+	}
+
+	if (len < 0 && EAGAIN != errno && EINTR != errno) {
+		g_warning ("Couldn't read inotify events: %s", g_strerror (errno));
+		priv->io_watch = 0;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+git_watcher_start (GiggleGitWatcher *watcher)
+{
+	GiggleGitWatcherPriv *priv;
+
+	priv = GET_PRIV (watcher);
+
+	priv->fd = inotify_init ();
+
+	if (priv->fd < 0) {
+		g_warning ("Couldn't initialize inotify: %s", g_strerror (errno));
+		return;
+	}
+
+	fcntl (priv->fd, F_SETFL, O_NONBLOCK | fcntl (priv->fd, F_GETFL));
+	fcntl (priv->fd, F_SETFD, FD_CLOEXEC);
+
+	priv->channel = g_io_channel_unix_new (priv->fd);
+	g_io_channel_set_close_on_unref (priv->channel, TRUE);
+	priv->io_watch = g_io_add_watch (priv->channel, G_IO_IN, git_watcher_io_cb, watcher);
+
+	/* metadata first, the working tree can take a while */
+	git_watcher_add_watch (watcher, watched_dir_new (WATCH_GIT_DIR, ""));
+	git_watcher_queue_dir (watcher, WATCH_REFS, "refs");
+
+	if (priv->project_dir)
+		git_watcher_queue_dir (watcher, WATCH_WORKTREE, "");
+}
+
+#else /* HAVE_SYS_INOTIFY_H */
+
+static void
+git_watcher_start (GiggleGitWatcher *watcher)
+{
+	/* no change notifications, callers fall back to explicit refreshes */
+}
+
+#endif /* HAVE_SYS_INOTIFY_H */
+
+GiggleGitWatcher *
+giggle_git_watcher_new (const gchar          *git_dir,
+			const gchar          *project_dir,
+			GiggleGitWatcherFunc  func,
+			gpointer              user_data)
+{
+	GiggleGitWatcher     *watcher;
+	GiggleGitWatcherPriv *priv;
+
+	g_return_val_if_fail (NULL != git_dir, NULL);
+	g_return_val_if_fail (NULL != func, NULL);
+
+	watcher = g_object_new (GIGGLE_TYPE_GIT_WATCHER, NULL);
+	priv = GET_PRIV (watcher);
+
+	priv->git_dir = g_strdup (git_dir);
+	priv->project_dir = g_strdup (project_dir);
+	priv->func = func;
+	priv->user_data = user_data;
+
+	git_watcher_start (watcher);
+
+	return watcher;
+}
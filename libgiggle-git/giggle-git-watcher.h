@@ -0,0 +1,68 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GIGGLE_GIT_WATCHER_H__
+#define __GIGGLE_GIT_WATCHER_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GIGGLE_TYPE_GIT_WATCHER            (giggle_git_watcher_get_type ())
+#define GIGGLE_GIT_WATCHER(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIGGLE_TYPE_GIT_WATCHER, GiggleGitWatcher))
+#define GIGGLE_GIT_WATCHER_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), GIGGLE_TYPE_GIT_WATCHER, GiggleGitWatcherClass))
+#define GIGGLE_IS_GIT_WATCHER(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GIGGLE_TYPE_GIT_WATCHER))
+#define GIGGLE_IS_GIT_WATCHER_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GIGGLE_TYPE_GIT_WATCHER))
+#define GIGGLE_GIT_WATCHER_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GIGGLE_TYPE_GIT_WATCHER, GiggleGitWatcherClass))
+
+typedef struct GiggleGitWatcher      GiggleGitWatcher;
+typedef struct GiggleGitWatcherClass GiggleGitWatcherClass;
+
+typedef enum {
+	GIGGLE_GIT_WATCHER_REFS        = 1 << 0,
+	GIGGLE_GIT_WATCHER_INDEX       = 1 << 1,
+	GIGGLE_GIT_WATCHER_WORKTREE    = 1 << 2,
+	GIGGLE_GIT_WATCHER_DESCRIPTION = 1 << 3,
+	GIGGLE_GIT_WATCHER_CONFIG      = 1 << 4
+} GiggleGitWatcherChanges;
+
+struct GiggleGitWatcher {
+	GObject parent;
+};
+
+struct GiggleGitWatcherClass {
+	GObjectClass parent_class;
+};
+
+/* paths are relative to the project directory, sorted and NULL terminated */
+typedef void (* GiggleGitWatcherFunc) (GiggleGitWatcher        *watcher,
+				       GiggleGitWatcherChanges  changes,
+				       const gchar * const     *paths,
+				       gpointer                 user_data);
+
+GType              giggle_git_watcher_get_type (void);
+GiggleGitWatcher * giggle_git_watcher_new      (const gchar          *git_dir,
+						const gchar          *project_dir,
+						GiggleGitWatcherFunc  func,
+						gpointer              user_data);
+
+G_END_DECLS
+
+#endif /* __GIGGLE_GIT_WATCHER_H__ */
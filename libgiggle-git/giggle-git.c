@@ -23,6 +23,7 @@
 
 #include "giggle-git-config-read.h"
 #include "giggle-git-remote-list.h"
+#include "giggle-git-watcher.h"
 
 #include <libgiggle/giggle-dispatcher.h>
 #include <libgiggle/giggle-remote.h>
@@ -43,7 +44,12 @@ struct GiggleGitPriv {
 
 	GList            *remotes;
 
+	/* the revisions of this repository jobs resolve shas to */
+	GiggleRevisionRegistry *revisions;
+
 	GHashTable       *jobs;
+
+	GiggleGitWatcher *watcher;
 };
 
 typedef struct {
@@ -73,6 +79,13 @@ static void     git_execute_callback    (GiggleDispatcher  *dispatcher,
 					 const gchar       *output_str,
 					 gsize              output_len,
 					 GiggleGit         *git);
+static void     git_execute_partial_callback
+					(GiggleDispatcher  *dispatcher,
+					 guint              id,
+					 GError            *error,
+					 const gchar       *output_str,
+					 gsize              output_len,
+					 GiggleGit         *git);
 static GQuark   giggle_git_error_quark  (void);
 
 G_DEFINE_TYPE (GiggleGit, giggle_git, G_TYPE_OBJECT)
@@ -89,6 +102,9 @@ enum {
 
 enum {
 	CHANGED,
+	REFS_CHANGED,
+	INDEX_CHANGED,
+	WORKTREE_PATHS_CHANGED,
 	LAST_SIGNAL
 };
 
@@ -156,6 +172,35 @@ giggle_git_class_init (GiggleGitClass *class)
 			      g_cclosure_marshal_VOID__VOID,
 			      G_TYPE_NONE, 0);
 
+	signals[REFS_CHANGED] =
+		g_signal_new ("refs-changed",
+			      G_OBJECT_CLASS_TYPE (object_class),
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (GiggleGitClass, refs_changed),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
+
+	signals[INDEX_CHANGED] =
+		g_signal_new ("index-changed",
+			      G_OBJECT_CLASS_TYPE (object_class),
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (GiggleGitClass, index_changed),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
+
+	/* paths are relative to the project dir, an empty path stands for
+	 * the whole working tree */
+	signals[WORKTREE_PATHS_CHANGED] =
+		g_signal_new ("worktree-paths-changed",
+			      G_OBJECT_CLASS_TYPE (object_class),
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (GiggleGitClass, worktree_paths_changed),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__BOXED,
+			      G_TYPE_NONE, 1, G_TYPE_STRV);
+
 	g_type_class_add_private (object_class, sizeof (GiggleGitPriv));
 }
 
@@ -168,6 +213,7 @@ giggle_git_init (GiggleGit *git)
 
 	priv->directory = NULL;
 	priv->dispatcher = giggle_dispatcher_new ();
+	priv->revisions = giggle_revision_registry_new ();
 
 	priv->jobs = g_hash_table_new_full (g_direct_hash, g_direct_equal,
 					    NULL, 
@@ -201,6 +247,10 @@ git_finalize (GObject *object)
 	g_free (priv->project_dir);
 	g_free (priv->project_name);
 
+	if (priv->watcher)
+		g_object_unref (priv->watcher);
+
+	g_object_unref (priv->revisions);
 	g_object_unref (priv->dispatcher);
 
 	G_OBJECT_CLASS (giggle_git_parent_class)->finalize (object);
@@ -373,6 +423,25 @@ git_execute_callback (GiggleDispatcher *dispatcher,
 	g_hash_table_remove (priv->jobs, GINT_TO_POINTER (id));
 }
 
+static void
+git_execute_partial_callback (GiggleDispatcher *dispatcher,
+			      guint             id,
+			      GError           *error,
+			      const gchar      *output_str,
+			      gsize             output_len,
+			      GiggleGit        *git)
+{
+	GiggleGitPriv *priv;
+	GitJobData    *data;
+
+	priv = GET_PRIV (git);
+
+	data = g_hash_table_lookup (priv->jobs, GINT_TO_POINTER (id));
+	g_assert (data != NULL);
+
+	giggle_job_handle_partial_output (data->job, output_str, output_len);
+}
+
 GiggleGit *
 giggle_git_get (void)
 {
@@ -398,7 +467,6 @@ giggle_git_get_description_file (const GiggleGit *git)
 static void
 giggle_git_update_description (GiggleGit *git)
 {
-	/* FIXME: read .git/description into description; install a file watch */
 	GiggleGitPriv *priv;
 	GError        *error;
 	gchar* description;
@@ -573,7 +641,7 @@ giggle_git_write_description (GiggleGit    *git,
 	}
 	g_free (filename);
 
-	/* notify will become unnecessary once we have file monitoring */
+	/* the watcher reports our own write, but only after a delay */
 	g_object_notify (G_OBJECT (git), "description");
 }
 
@@ -589,6 +657,30 @@ giggle_git_get_directory (GiggleGit *git)
 	return priv->directory;
 }
 
+static void
+git_watcher_cb (GiggleGitWatcher        *watcher,
+		GiggleGitWatcherChanges  changes,
+		const gchar * const     *paths,
+		gpointer                 user_data)
+{
+	GiggleGit *git = GIGGLE_GIT (user_data);
+
+	if (changes & GIGGLE_GIT_WATCHER_DESCRIPTION)
+		giggle_git_update_description (git);
+
+	if (changes & GIGGLE_GIT_WATCHER_CONFIG)
+		giggle_git_update_remotes (git);
+
+	if (changes & GIGGLE_GIT_WATCHER_REFS)
+		g_signal_emit (git, signals[REFS_CHANGED], 0);
+
+	if (changes & GIGGLE_GIT_WATCHER_INDEX)
+		g_signal_emit (git, signals[INDEX_CHANGED], 0);
+
+	if (changes & GIGGLE_GIT_WATCHER_WORKTREE)
+		g_signal_emit (git, signals[WORKTREE_PATHS_CHANGED], 0, paths);
+}
+
 gboolean
 giggle_git_set_directory (GiggleGit    *git, 
 			  const gchar  *directory,
@@ -608,6 +700,12 @@ giggle_git_set_directory (GiggleGit    *git,
 		return FALSE;
 	}
 
+	/* revisions of another repository can't be shared */
+	if (g_strcmp0 (priv->git_dir, tmp_dir)) {
+		g_object_unref (priv->revisions);
+		priv->revisions = giggle_revision_registry_new ();
+	}
+
 	/* update working directory */
 	dir = g_strdup (directory);
 	g_free (priv->directory);
@@ -665,6 +763,12 @@ giggle_git_set_directory (GiggleGit    *git,
 	giggle_git_update_description (git);
 	giggle_git_update_remotes (git);
 
+	if (priv->watcher)
+		g_object_unref (priv->watcher);
+
+	priv->watcher = giggle_git_watcher_new (priv->git_dir, priv->project_dir,
+						git_watcher_cb, git);
+
 	return TRUE;
 }
 
@@ -712,6 +816,14 @@ giggle_git_get_remotes (GiggleGit *git)
 	return GET_PRIV (git)->remotes;
 }
 
+GiggleRevisionRegistry *
+giggle_git_get_revision_registry (GiggleGit *git)
+{
+	g_return_val_if_fail (GIGGLE_IS_GIT (git), NULL);
+
+	return GET_PRIV (git)->revisions;
+}
+
 void
 giggle_git_save_remote (GiggleGit   *git,
 			GiggleRemote*remote)
@@ -737,6 +849,7 @@ giggle_git_run_job_full (GiggleGit             *git,
 {
 	GiggleGitPriv *priv;
 	gchar         *command;
+	gchar         *input;
 
 	g_return_if_fail (GIGGLE_IS_GIT (git));
 	g_return_if_fail (GIGGLE_IS_JOB (job));
@@ -744,14 +857,22 @@ giggle_git_run_job_full (GiggleGit             *git,
 	priv = GET_PRIV (git);
 
 	if (giggle_job_get_command_line (job, &command)) {
-		GitJobData    *data;
+		GiggleExecuteCallback  partial_callback = NULL;
+		GitJobData            *data;
+
+		if (giggle_job_is_streaming (job))
+			partial_callback = (GiggleExecuteCallback) git_execute_partial_callback;
+
+		input = giggle_job_get_input (job);
 
 		data = g_slice_new0 (GitJobData);
-		data->id = giggle_dispatcher_execute (priv->dispatcher,
-						      priv->project_dir,
-						      command,
-						      (GiggleExecuteCallback) git_execute_callback,
-						      git);
+		data->id = giggle_dispatcher_execute_full (priv->dispatcher,
+							   priv->project_dir,
+							   command,
+							   input,
+							   partial_callback,
+							   (GiggleExecuteCallback) git_execute_callback,
+							   git);
 
 		data->job = g_object_ref (job);
 		data->callback = callback;
@@ -762,6 +883,8 @@ giggle_git_run_job_full (GiggleGit             *git,
 
 		g_hash_table_insert (priv->jobs, 
 				     GINT_TO_POINTER (data->id), data);
+
+		g_free (input);
 	} else {
 		g_warning ("Couldn't get command line for job");
 	}
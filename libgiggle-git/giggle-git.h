@@ -23,6 +23,7 @@
 
 #include <libgiggle/giggle-job.h>
 #include <libgiggle/giggle-remote.h>
+#include <libgiggle/giggle-revision-registry.h>
 
 G_BEGIN_DECLS
 
@@ -43,7 +44,11 @@ struct GiggleGit {
 struct GiggleGitClass {
 	GObjectClass parent_class;
 
-	void (* changed) (GiggleGit *git);
+	void (* changed)                (GiggleGit          *git);
+	void (* refs_changed)           (GiggleGit          *git);
+	void (* index_changed)          (GiggleGit          *git);
+	void (* worktree_paths_changed) (GiggleGit          *git,
+					 const gchar * const *paths);
 };
 
 typedef void (*GiggleJobDoneCallback)   (GiggleGit *git,
@@ -64,6 +69,9 @@ const gchar *    giggle_git_get_git_dir      (GiggleGit    *git);
 const gchar *    giggle_git_get_project_dir  (GiggleGit    *git);
 const gchar *    giggle_git_get_project_name (GiggleGit    *git);
 GList *          giggle_git_get_remotes      (GiggleGit    *git);
+GiggleRevisionRegistry *
+                 giggle_git_get_revision_registry
+                                             (GiggleGit    *git);
 void             giggle_git_save_remote      (GiggleGit    *git,
 					      GiggleRemote *remote);
 
@@ -0,0 +1,559 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Trigram index over the casefolded sha, author and message of each
+ * commit. Every commit is a document, stored as NUL terminated
+ * "sha\nauthor\nmessage" string. Lookups take the shortest posting
+ * list among the search term's trigrams and verify each candidate with
+ * strstr(), which is plenty fast for commit messages.
+ */
+
+#include "config.h"
+#include "giggle-search-index.h"
+
+#include <libgiggle/giggle-sysdeps.h>
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define SHA_LENGTH 40
+
+#define INDEX_MAGIC   "GGLSIDX"
+#define INDEX_VERSION 1
+
+#define READ_BUFFER_SIZE (64 * 1024)
+
+#define TRIGRAM(s) ((((guchar) (s)[0]) << 16) | (((guchar) (s)[1]) << 8) | ((guchar) (s)[2]))
+
+typedef enum {
+	FIELD_SHA,
+	FIELD_AUTHOR,
+	FIELD_MESSAGE,
+	N_FIELDS
+} IndexField;
+
+/* file header, the cache is machine local so host byte order is fine */
+typedef struct {
+	gchar   magic[8];
+	guint32 version;
+	guint32 stamp;
+	guint32 n_documents;
+	guint32 text_length;
+} IndexHeader;
+
+typedef struct GiggleSearchIndexPriv GiggleSearchIndexPriv;
+
+struct GiggleSearchIndexPriv {
+	/* SHA_LENGTH characters per document, not terminated */
+	GString    *shas;
+	/* start of each document within text */
+	GArray     *offsets;
+	GString    *text;
+
+	/* trigram -> GArray of ascending document numbers */
+	GHashTable *trigrams;
+};
+
+static void search_index_finalize (GObject *object);
+
+G_DEFINE_TYPE (GiggleSearchIndex, giggle_search_index, G_TYPE_OBJECT)
+
+#define GET_PRIV(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIGGLE_TYPE_SEARCH_INDEX, GiggleSearchIndexPriv))
+
+static void
+giggle_search_index_class_init (GiggleSearchIndexClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+	object_class->finalize = search_index_finalize;
+
+	g_type_class_add_private (object_class, sizeof (GiggleSearchIndexPriv));
+}
+
+static void
+posting_list_free (gpointer data)
+{
+	g_array_free (data, TRUE);
+}
+
+static void
+giggle_search_index_init (GiggleSearchIndex *index)
+{
+	GiggleSearchIndexPriv *priv;
+
+	priv = GET_PRIV (index);
+
+	priv->shas = g_string_new (NULL);
+	priv->offsets = g_array_new (FALSE, FALSE, sizeof (guint32));
+	priv->text = g_string_new (NULL);
+	priv->trigrams = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+						NULL, posting_list_free);
+}
+
+static void
+search_index_finalize (GObject *object)
+{
+	GiggleSearchIndexPriv *priv;
+
+	priv = GET_PRIV (object);
+
+	g_hash_table_destroy (priv->trigrams);
+	g_string_free (priv->text, TRUE);
+	g_array_free (priv->offsets, TRUE);
+	g_string_free (priv->shas, TRUE);
+
+	G_OBJECT_CLASS (giggle_search_index_parent_class)->finalize (object);
+}
+
+static void
+search_index_clear (GiggleSearchIndexPriv *priv)
+{
+	g_string_truncate (priv->shas, 0);
+	g_array_set_size (priv->offsets, 0);
+	g_string_truncate (priv->text, 0);
+	g_hash_table_remove_all (priv->trigrams);
+}
+
+static void
+search_index_add_trigrams (GiggleSearchIndexPriv *priv,
+			   guint32                document)
+{
+	const gchar *text, *end;
+	GArray      *postings;
+	gpointer     key;
+
+	text = priv->text->str + g_array_index (priv->offsets, guint32, document);
+	end = text + strlen (text);
+
+	for (; text + 3 <= end; ++text) {
+		key = GUINT_TO_POINTER (TRIGRAM (text));
+		postings = g_hash_table_lookup (priv->trigrams, key);
+
+		if (!postings) {
+			postings = g_array_new (FALSE, FALSE, sizeof (guint32));
+			g_hash_table_insert (priv->trigrams, key, postings);
+		}
+
+		/* documents get added in order, so checking
+		 * the last entry is enough to avoid duplicates */
+		if (postings->len > 0 &&
+		    document == g_array_index (postings, guint32, postings->len - 1))
+			continue;
+
+		g_array_append_val (postings, document);
+	}
+}
+
+static void
+search_index_append_casefold (GString     *text,
+			      const gchar *field,
+			      gsize        length)
+{
+	gchar *casefold;
+
+	if (g_utf8_validate (field, length, NULL))
+		casefold = g_utf8_casefold (field, length);
+	else
+		casefold = g_ascii_strdown (field, length);
+
+	g_string_append (text, casefold);
+	g_free (casefold);
+}
+
+typedef struct {
+	GiggleSearchIndexPriv *priv;
+	IndexField             field;
+	GString               *pending;
+} IndexParser;
+
+static void
+search_index_finish_field (IndexParser *parser)
+{
+	GiggleSearchIndexPriv *priv = parser->priv;
+	guint32                offset;
+
+	switch (parser->field) {
+	case FIELD_SHA:
+		if (parser->pending->len != SHA_LENGTH) {
+			g_warning ("%s: Unexpected commit name: '%s'",
+				   G_STRFUNC, parser->pending->str);
+
+			while (parser->pending->len < SHA_LENGTH)
+				g_string_append_c (parser->pending, '0');
+		}
+
+		offset = priv->text->len;
+		g_array_append_val (priv->offsets, offset);
+		g_string_append_len (priv->shas, parser->pending->str, SHA_LENGTH);
+		g_string_append_len (priv->text, parser->pending->str, SHA_LENGTH);
+		g_string_append_c (priv->text, '\n');
+		break;
+
+	case FIELD_AUTHOR:
+		search_index_append_casefold (priv->text, parser->pending->str,
+					      parser->pending->len);
+		g_string_append_c (priv->text, '\n');
+		break;
+
+	case FIELD_MESSAGE:
+		search_index_append_casefold (priv->text, parser->pending->str,
+					      parser->pending->len);
+
+		/* keep the terminating NUL as part of the text */
+		g_string_append_c (priv->text, '\0');
+		search_index_add_trigrams (priv, priv->offsets->len - 1);
+		break;
+
+	case N_FIELDS:
+		g_assert_not_reached ();
+	}
+
+	g_string_truncate (parser->pending, 0);
+	parser->field = (parser->field + 1) % N_FIELDS;
+}
+
+static void
+search_index_parse (IndexParser *parser,
+		    const gchar *output_str,
+		    gsize        output_len)
+{
+	const gchar *end, *nul;
+
+	end = output_str + output_len;
+
+	while (output_str < end) {
+		nul = memchr (output_str, '\0', end - output_str);
+
+		if (!nul) {
+			g_string_append_len (parser->pending, output_str, end - output_str);
+			break;
+		}
+
+		g_string_append_len (parser->pending, output_str, nul - output_str);
+		search_index_finish_field (parser);
+
+		output_str = nul + 1;
+	}
+}
+
+GiggleSearchIndex *
+giggle_search_index_new (void)
+{
+	return g_object_new (GIGGLE_TYPE_SEARCH_INDEX, NULL);
+}
+
+/* Runs git log and indexes its output. This blocks, and is meant to be
+ * called from a worker thread: nobody else may use the index meanwhile.
+ */
+gboolean
+giggle_search_index_build (GiggleSearchIndex  *index,
+			   const gchar        *directory,
+			   GCancellable       *cancellable,
+			   GError            **error)
+{
+	GiggleSearchIndexPriv  *priv;
+	IndexParser             parser;
+	gchar                 **argv = NULL;
+	gchar                  *buffer;
+	GPid                    pid;
+	gint                    fd, status = -1;
+	gssize                  len;
+	gboolean                success = FALSE;
+
+	g_return_val_if_fail (GIGGLE_IS_SEARCH_INDEX (index), FALSE);
+	g_return_val_if_fail (NULL != directory, FALSE);
+
+	priv = GET_PRIV (index);
+	search_index_clear (priv);
+
+	if (!g_shell_parse_argv (GIT_COMMAND " log --all --topo-order --no-color -z"
+				 " '--format=format:%H%x00%an <%ae>%x00%B'",
+				 NULL, &argv, error))
+		return FALSE;
+
+	if (!g_spawn_async_with_pipes (directory, argv, NULL,
+				       G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD |
+				       G_SPAWN_STDERR_TO_DEV_NULL,
+				       giggle_sysdeps_child_setup, NULL,
+				       &pid, NULL, &fd, NULL, error)) {
+		g_strfreev (argv);
+		return FALSE;
+	}
+
+	g_strfreev (argv);
+
+	parser.priv = priv;
+	parser.field = FIELD_SHA;
+	parser.pending = g_string_new (NULL);
+
+	buffer = g_malloc (READ_BUFFER_SIZE);
+
+	while (!g_cancellable_is_cancelled (cancellable)) {
+		len = read (fd, buffer, READ_BUFFER_SIZE);
+
+		if (len < 0 && EINTR == errno)
+			continue;
+
+		if (len <= 0)
+			break;
+
+		search_index_parse (&parser, buffer, len);
+	}
+
+	if (g_cancellable_is_cancelled (cancellable))
+		kill (pid, SIGTERM);
+
+	close (fd);
+	g_free (buffer);
+
+	while (waitpid (pid, &status, 0) < 0 && EINTR == errno);
+	g_spawn_close_pid (pid);
+
+	if (g_cancellable_is_cancelled (cancellable)) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+			     "Operation was cancelled");
+	} else if (!WIFEXITED (status) || WEXITSTATUS (status)) {
+		g_set_error (error, G_SPAWN_ERROR, G_SPAWN_ERROR_FAILED,
+			     "git log exited with status %d", status);
+	} else {
+		/* records are separated, not terminated */
+		while (FIELD_SHA != parser.field || parser.pending->len > 0)
+			search_index_finish_field (&parser);
+
+		success = TRUE;
+	}
+
+	g_string_free (parser.pending, TRUE);
+
+	if (!success)
+		search_index_clear (priv);
+
+	return success;
+}
+
+gboolean
+giggle_search_index_load (GiggleSearchIndex  *index,
+			  const gchar        *filename,
+			  guint32             stamp,
+			  GError            **error)
+{
+	GiggleSearchIndexPriv *priv;
+	IndexHeader            header;
+	gchar                 *contents;
+	const gchar           *p;
+	gsize                  length;
+	guint32                i, offset;
+
+	g_return_val_if_fail (GIGGLE_IS_SEARCH_INDEX (index), FALSE);
+	g_return_val_if_fail (NULL != filename, FALSE);
+
+	priv = GET_PRIV (index);
+	search_index_clear (priv);
+
+	if (!g_file_get_contents (filename, &contents, &length, error))
+		return FALSE;
+
+	if (length < sizeof (header))
+		goto invalid;
+
+	memcpy (&header, contents, sizeof (header));
+
+	if (memcmp (header.magic, INDEX_MAGIC, sizeof (INDEX_MAGIC)) ||
+	    INDEX_VERSION != header.version)
+		goto invalid;
+
+	if (stamp != header.stamp) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+			     "%s: Search index is outdated", filename);
+		g_free (contents);
+		return FALSE;
+	}
+
+	if (length != sizeof (header) +
+	    (gsize) header.n_documents * (SHA_LENGTH + sizeof (guint32)) +
+	    header.text_length)
+		goto invalid;
+
+	p = contents + sizeof (header);
+	g_string_append_len (priv->shas, p, header.n_documents * SHA_LENGTH);
+	p += header.n_documents * SHA_LENGTH;
+
+	g_array_set_size (priv->offsets, header.n_documents);
+	memcpy (priv->offsets->data, p, header.n_documents * sizeof (guint32));
+	p += header.n_documents * sizeof (guint32);
+
+	g_string_append_len (priv->text, p, header.text_length);
+
+	/* rebuilding the trigrams is cheap compared to running git log,
+	 * and it keeps the file small and easy to validate */
+	for (i = 0; i < header.n_documents; ++i) {
+		offset = g_array_index (priv->offsets, guint32, i);
+
+		if (offset >= priv->text->len ||
+		    (i > 0 && offset <= g_array_index (priv->offsets, guint32, i - 1)))
+			goto invalid;
+
+		search_index_add_trigrams (priv, i);
+	}
+
+	g_free (contents);
+	return TRUE;
+
+invalid:
+	g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+		     "%s: Not a valid search index", filename);
+
+	search_index_clear (priv);
+	g_free (contents);
+
+	return FALSE;
+}
+
+gboolean
+giggle_search_index_save (GiggleSearchIndex  *index,
+			  const gchar        *filename,
+			  guint32             stamp,
+			  GError            **error)
+{
+	GiggleSearchIndexPriv *priv;
+	IndexHeader            header;
+	GString               *contents;
+	gboolean               success;
+
+	g_return_val_if_fail (GIGGLE_IS_SEARCH_INDEX (index), FALSE);
+	g_return_val_if_fail (NULL != filename, FALSE);
+
+	priv = GET_PRIV (index);
+
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, INDEX_MAGIC, sizeof (INDEX_MAGIC));
+	header.version = INDEX_VERSION;
+	header.stamp = stamp;
+	header.n_documents = priv->offsets->len;
+	header.text_length = priv->text->len;
+
+	contents = g_string_sized_new (sizeof (header) + priv->shas->len +
+				       priv->offsets->len * sizeof (guint32) +
+				       priv->text->len);
+
+	g_string_append_len (contents, (const gchar *) &header, sizeof (header));
+	g_string_append_len (contents, priv->shas->str, priv->shas->len);
+	g_string_append_len (contents, priv->offsets->data,
+			     priv->offsets->len * sizeof (guint32));
+	g_string_append_len (contents, priv->text->str, priv->text->len);
+
+	success = g_file_set_contents (filename, contents->str, contents->len, error);
+	g_string_free (contents, TRUE);
+
+	return success;
+}
+
+guint
+giggle_search_index_get_n_documents (GiggleSearchIndex *index)
+{
+	g_return_val_if_fail (GIGGLE_IS_SEARCH_INDEX (index), 0);
+	return GET_PRIV (index)->offsets->len;
+}
+
+/* copies the sha of the document into buffer,
+ * which must hold at least 41 characters */
+const gchar *
+giggle_search_index_get_sha (GiggleSearchIndex *index,
+			     guint              document,
+			     gchar             *buffer)
+{
+	GiggleSearchIndexPriv *priv;
+
+	g_return_val_if_fail (GIGGLE_IS_SEARCH_INDEX (index), NULL);
+	g_return_val_if_fail (NULL != buffer, NULL);
+
+	priv = GET_PRIV (index);
+
+	g_return_val_if_fail (document < priv->offsets->len, NULL);
+
+	memcpy (buffer, priv->shas->str + document * SHA_LENGTH, SHA_LENGTH);
+	buffer[SHA_LENGTH] = '\0';
+
+	return buffer;
+}
+
+static inline const gchar *
+search_index_get_text (GiggleSearchIndexPriv *priv,
+		       guint32                document)
+{
+	return priv->text->str + g_array_index (priv->offsets, guint32, document);
+}
+
+/* Returns the ascending numbers of all documents containing the
+ * already casefolded search term. Free the result with g_array_free().
+ */
+GArray *
+giggle_search_index_lookup (GiggleSearchIndex *index,
+			    const gchar       *search_term)
+{
+	GiggleSearchIndexPriv *priv;
+	GArray                *result, *postings, *candidates;
+	const gchar           *p;
+	guint32                document;
+	guint                  i;
+
+	g_return_val_if_fail (GIGGLE_IS_SEARCH_INDEX (index), NULL);
+	g_return_val_if_fail (NULL != search_term, NULL);
+
+	priv = GET_PRIV (index);
+	result = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+	if (strlen (search_term) < 3) {
+		/* too short for trigrams, scan all documents */
+		for (document = 0; document < priv->offsets->len; ++document) {
+			if (strstr (search_index_get_text (priv, document), search_term))
+				g_array_append_val (result, document);
+		}
+
+		return result;
+	}
+
+	candidates = NULL;
+
+	for (p = search_term; p[1] && p[2]; ++p) {
+		postings = g_hash_table_lookup (priv->trigrams,
+						GUINT_TO_POINTER (TRIGRAM (p)));
+
+		/* some trigram never occurs, so the term can't either */
+		if (!postings)
+			return result;
+
+		if (!candidates || postings->len < candidates->len)
+			candidates = postings;
+	}
+
+	for (i = 0; i < candidates->len; ++i) {
+		document = g_array_index (candidates, guint32, i);
+
+		if (strstr (search_index_get_text (priv, document), search_term))
+			g_array_append_val (result, document);
+	}
+
+	return result;
+}
@@ -0,0 +1,71 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GIGGLE_SEARCH_INDEX_H__
+#define __GIGGLE_SEARCH_INDEX_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define GIGGLE_TYPE_SEARCH_INDEX            (giggle_search_index_get_type ())
+#define GIGGLE_SEARCH_INDEX(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIGGLE_TYPE_SEARCH_INDEX, GiggleSearchIndex))
+#define GIGGLE_SEARCH_INDEX_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), GIGGLE_TYPE_SEARCH_INDEX, GiggleSearchIndexClass))
+#define GIGGLE_IS_SEARCH_INDEX(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GIGGLE_TYPE_SEARCH_INDEX))
+#define GIGGLE_IS_SEARCH_INDEX_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GIGGLE_TYPE_SEARCH_INDEX))
+#define GIGGLE_SEARCH_INDEX_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GIGGLE_TYPE_SEARCH_INDEX, GiggleSearchIndexClass))
+
+typedef struct GiggleSearchIndex      GiggleSearchIndex;
+typedef struct GiggleSearchIndexClass GiggleSearchIndexClass;
+
+struct GiggleSearchIndex {
+	GObject parent_instance;
+};
+
+struct GiggleSearchIndexClass {
+	GObjectClass parent_class;
+};
+
+GType               giggle_search_index_get_type        (void);
+GiggleSearchIndex * giggle_search_index_new             (void);
+
+gboolean            giggle_search_index_build           (GiggleSearchIndex  *index,
+							 const gchar        *directory,
+							 GCancellable       *cancellable,
+							 GError            **error);
+gboolean            giggle_search_index_load            (GiggleSearchIndex  *index,
+							 const gchar        *filename,
+							 guint32             stamp,
+							 GError            **error);
+gboolean            giggle_search_index_save            (GiggleSearchIndex  *index,
+							 const gchar        *filename,
+							 guint32             stamp,
+							 GError            **error);
+
+guint               giggle_search_index_get_n_documents (GiggleSearchIndex  *index);
+const gchar *       giggle_search_index_get_sha         (GiggleSearchIndex  *index,
+							 guint               document,
+							 gchar              *buffer);
+GArray *            giggle_search_index_lookup          (GiggleSearchIndex  *index,
+							 const gchar        *search_term);
+
+G_END_DECLS
+
+#endif /* __GIGGLE_SEARCH_INDEX_H__ */
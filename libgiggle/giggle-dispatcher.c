@@ -19,6 +19,7 @@
  */
 
 #include <config.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "giggle-error.h"
@@ -27,14 +28,20 @@
 
 #define d(x)
 
+/* bytes handed to streaming jobs per main loop iteration */
+#define READ_BUFFER_SIZE 32768
+
 #define GET_PRIV(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIGGLE_TYPE_DISPATCHER, GiggleDispatcherPriv))
 
 typedef struct GiggleDispatcherPriv GiggleDispatcherPriv;
 
 typedef struct {
 	gchar                 *command;
+	gchar                 *input;
+	gsize                  input_written;
 	gchar                 *wd;
 	GiggleExecuteCallback  callback;
+	GiggleExecuteCallback  partial_callback;
 	guint                  id;
 	GPid                   pid;
 	gint                   std_out;
@@ -51,6 +58,10 @@ struct GiggleDispatcherPriv {
 	guint          current_job_read_id;
 	GIOChannel    *channel;
 	GString       *output;
+
+	/* standard input of the current job, while it gets written */
+	guint          current_job_write_id;
+	GIOChannel    *input_channel;
 };
 
 static void     giggle_dispatcher_finalize (GObject *object);
@@ -78,6 +89,9 @@ static void      dispatcher_job_finished_cb  (GPid              pid,
 static gboolean  dispatcher_job_read_cb      (GIOChannel       *source,
 					      GIOCondition      condition,
 					      GiggleDispatcher *dispatcher);
+static gboolean  dispatcher_job_write_cb     (GIOChannel       *source,
+					      GIOCondition      condition,
+					      GiggleDispatcher *dispatcher);
 
 
 G_DEFINE_TYPE (GiggleDispatcher, giggle_dispatcher, G_TYPE_OBJECT)
@@ -89,6 +103,9 @@ giggle_dispatcher_class_init (GiggleDispatcherClass *class)
 
 	object_class->finalize = giggle_dispatcher_finalize;
 
+	/* jobs may exit before reading all of their input */
+	giggle_sysdeps_ignore_sigpipe ();
+
 	g_type_class_add_private (object_class, sizeof (GiggleDispatcherPriv));
 }
 
@@ -111,7 +128,7 @@ giggle_dispatcher_finalize (GObject *object)
 	GiggleDispatcherPriv *priv = GET_PRIV (object);
 	DispatcherJob        *job;
 
-	if (priv->current_job_wait_id) {
+	if (priv->current_job) {
 		dispatcher_stop_current_job (dispatcher);
 	}
 
@@ -156,12 +173,50 @@ dispatcher_unqueue_job (GiggleDispatcher *dispatcher, guint id)
 	}
 }
 
+static void
+dispatcher_close_input (GiggleDispatcherPriv *priv)
+{
+	if (priv->current_job_write_id) {
+		g_source_remove (priv->current_job_write_id);
+		priv->current_job_write_id = 0;
+	}
+
+	if (priv->input_channel) {
+		g_io_channel_shutdown (priv->input_channel, FALSE, NULL);
+		g_io_channel_unref (priv->input_channel);
+		priv->input_channel = NULL;
+	}
+}
+
+/* the input is written as the pipe takes it, so that a job replying
+ * while it reads can't get stuck with us */
+static void
+dispatcher_write_input (GiggleDispatcher *dispatcher,
+			gint              fd)
+{
+	GiggleDispatcherPriv *priv;
+
+	priv = GET_PRIV (dispatcher);
+
+	priv->input_channel = g_io_channel_unix_new (fd);
+	g_io_channel_set_encoding (priv->input_channel, NULL, NULL);
+	g_io_channel_set_buffered (priv->input_channel, FALSE);
+	g_io_channel_set_flags (priv->input_channel, G_IO_FLAG_NONBLOCK, NULL);
+	g_io_channel_set_close_on_unref (priv->input_channel, TRUE);
+
+	priv->current_job_write_id = g_io_add_watch (priv->input_channel,
+						     G_IO_OUT | G_IO_HUP | G_IO_ERR,
+						     (GIOFunc) dispatcher_job_write_cb,
+						     dispatcher);
+}
+
 static gboolean
 dispatcher_start_job (GiggleDispatcher *dispatcher, DispatcherJob *job)
 {
 	GiggleDispatcherPriv  *priv;
 	gint                   argc;
 	gchar                **argv;
+	gint                   std_in;
 	GError                *error = NULL;
 
 	priv = GET_PRIV (dispatcher);
@@ -175,9 +230,10 @@ dispatcher_start_job (GiggleDispatcher *dispatcher, DispatcherJob *job)
 	if (!g_spawn_async_with_pipes (job->wd, argv, 
 				       NULL, /* envp */
 				       G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD,
-				       NULL, NULL,
+				       giggle_sysdeps_child_setup, NULL,
 				       &job->pid,
-				       NULL, &job->std_out, &job->std_err,
+				       job->input ? &std_in : NULL,
+				       &job->std_out, &job->std_err,
 				       &error)) {
 		goto failed;
 	}
@@ -186,6 +242,12 @@ dispatcher_start_job (GiggleDispatcher *dispatcher, DispatcherJob *job)
 
 	priv->channel = g_io_channel_unix_new (job->std_out);
 	g_io_channel_set_encoding (priv->channel, NULL, NULL);
+
+	/* streaming jobs take whatever the pipe has to offer, without
+	 * waiting for line ends or for the buffer to fill up */
+	if (job->partial_callback)
+		g_io_channel_set_buffered (priv->channel, FALSE);
+
 	priv->output = g_string_new ("");
 
 	priv->current_job = job;
@@ -197,6 +259,10 @@ dispatcher_start_job (GiggleDispatcher *dispatcher, DispatcherJob *job)
 	priv->current_job_wait_id = g_child_watch_add (job->pid,
 						       (GChildWatchFunc) dispatcher_job_finished_cb,
 						       dispatcher);
+
+	if (job->input)
+		dispatcher_write_input (dispatcher, std_in);
+
 	g_strfreev (argv);
 
 	return TRUE;
@@ -219,12 +285,23 @@ dispatcher_stop_current_job (GiggleDispatcher *dispatcher)
 
 	priv = GET_PRIV (dispatcher);
 
-	g_assert (priv->current_job_wait_id != 0);
-	g_source_remove (priv->current_job_wait_id);
-	priv->current_job_wait_id = 0;
+	g_assert (priv->current_job != NULL);
 
-	g_source_remove (priv->current_job_read_id);
-	priv->current_job_read_id = 0;
+	/* no wait source means the child already exited,
+	 * and streaming jobs get cancelled while flushing */
+	if (priv->current_job_wait_id) {
+		g_source_remove (priv->current_job_wait_id);
+		priv->current_job_wait_id = 0;
+
+		giggle_sysdeps_kill_pid (priv->current_job->pid);
+	}
+
+	if (priv->current_job_read_id) {
+		g_source_remove (priv->current_job_read_id);
+		priv->current_job_read_id = 0;
+	}
+
+	dispatcher_close_input (priv);
 
 	g_io_channel_unref (priv->channel);
 	priv->channel = NULL;
@@ -232,9 +309,6 @@ dispatcher_stop_current_job (GiggleDispatcher *dispatcher)
 	g_string_free (priv->output, TRUE);
 	priv->output = NULL;
 
-	g_assert (priv->current_job != NULL);
-	giggle_sysdeps_kill_pid (priv->current_job->pid);
-
 	dispatcher_job_free (priv->current_job);
 	priv->current_job = NULL;
 }
@@ -266,6 +340,7 @@ static void
 dispatcher_job_free (DispatcherJob *job)
 {
 	g_free (job->command);
+	g_free (job->input);
 	g_free (job->wd);
 
 	if (job->pid) {
@@ -311,6 +386,43 @@ dispatcher_is_current_job (GiggleDispatcher *dispatcher, guint id)
 	return FALSE;
 }
 
+/* Hands the available output of a streaming job to its partial callback.
+ * Returns FALSE when the callback cancelled the job. */
+static gboolean
+dispatcher_job_read_partial (GiggleDispatcher *dispatcher,
+			     GIOStatus        *status)
+{
+	GiggleDispatcherPriv *priv;
+	DispatcherJob        *job;
+	gchar                 buffer[READ_BUFFER_SIZE];
+	gsize                 length = 0;
+	guint                 id;
+	GError               *error = NULL;
+
+	priv = GET_PRIV (dispatcher);
+	job = priv->current_job;
+	id = job->id;
+
+	*status = g_io_channel_read_chars (priv->channel, buffer,
+					   sizeof (buffer), &length, &error);
+
+	if (*status == G_IO_STATUS_ERROR) {
+		dispatcher_signal_job_failed (dispatcher, job, error);
+		dispatcher_stop_current_job (dispatcher);
+		dispatcher_start_next_job (dispatcher);
+		g_error_free (error);
+
+		return FALSE;
+	}
+
+	if (length > 0) {
+		job->partial_callback (dispatcher, id, NULL,
+				       buffer, length, job->user_data);
+	}
+
+	return dispatcher_is_current_job (dispatcher, id);
+}
+
 static void
 dispatcher_job_finished_cb (GPid              pid,
 			    gint              status,
@@ -329,11 +441,26 @@ dispatcher_job_finished_cb (GPid              pid,
 	g_source_remove (priv->current_job_read_id);
 	priv->current_job_read_id = 0;
 
-	g_io_channel_read_to_end (priv->channel, &str, &len, NULL);
+	/* the child watch source goes away after this callback */
+	priv->current_job_wait_id = 0;
+
+	/* input the job didn't care to read */
+	dispatcher_close_input (priv);
+
+	if (job->partial_callback) {
+		GIOStatus status;
 
-	if (str) {
-		g_string_append_len (priv->output, str, len);
-		g_free (str);
+		do {
+			if (!dispatcher_job_read_partial (dispatcher, &status))
+				return;
+		} while (status == G_IO_STATUS_NORMAL);
+	} else {
+		g_io_channel_read_to_end (priv->channel, &str, &len, NULL);
+
+		if (str) {
+			g_string_append_len (priv->output, str, len);
+			g_free (str);
+		}
 	}
 
 	job->callback (dispatcher, job->id, NULL,
@@ -363,6 +490,12 @@ dispatcher_job_read_cb (GIOChannel       *source,
 	priv = GET_PRIV (dispatcher);
 	status = G_IO_STATUS_NORMAL;
 
+	if (priv->current_job->partial_callback) {
+		/* stays installed until the child exits */
+		dispatcher_job_read_partial (dispatcher, &status);
+		return TRUE;
+	}
+
 	while (count < 10 && status == G_IO_STATUS_NORMAL) {
 		status = g_io_channel_read_line (source, &str, &length, NULL, &error);
 		count++;
@@ -384,6 +517,53 @@ dispatcher_job_read_cb (GIOChannel       *source,
 	return TRUE;
 }
 
+static gboolean
+dispatcher_job_write_cb (GIOChannel       *source,
+			 GIOCondition      condition,
+			 GiggleDispatcher *dispatcher)
+{
+	GiggleDispatcherPriv *priv;
+	DispatcherJob        *job;
+	GIOStatus             status;
+	GError               *error = NULL;
+	gsize                 length, written = 0;
+
+	priv = GET_PRIV (dispatcher);
+	job = priv->current_job;
+	length = strlen (job->input) - job->input_written;
+
+	if (condition & (G_IO_HUP | G_IO_ERR)) {
+		/* the job exited or closed its input early */
+		g_set_error (&error, G_IO_CHANNEL_ERROR, G_IO_CHANNEL_ERROR_PIPE,
+			     "Command stopped reading its input");
+		status = G_IO_STATUS_ERROR;
+	} else {
+		status = g_io_channel_write_chars (source, job->input + job->input_written,
+						   length, &written, &error);
+		job->input_written += written;
+	}
+
+	if (G_IO_STATUS_ERROR == status) {
+		priv->current_job_write_id = 0;
+
+		dispatcher_signal_job_failed (dispatcher, job, error);
+		dispatcher_stop_current_job (dispatcher);
+		dispatcher_start_next_job (dispatcher);
+		g_error_free (error);
+
+		return FALSE;
+	}
+
+	if (written < length)
+		return TRUE;
+
+	/* all written, the job sees the end of its input now */
+	priv->current_job_write_id = 0;
+	dispatcher_close_input (priv);
+
+	return FALSE;
+}
+
 GiggleDispatcher *
 giggle_dispatcher_new (void)
 {
@@ -396,6 +576,23 @@ giggle_dispatcher_execute (GiggleDispatcher      *dispatcher,
 			   const gchar           *command,
 			   GiggleExecuteCallback  callback,
 			   gpointer               user_data)
+{
+	return giggle_dispatcher_execute_full (dispatcher, wd, command, NULL,
+					       NULL, callback, user_data);
+}
+
+/* Like giggle_dispatcher_execute(), but writes input to the command's
+ * standard input unless it's NULL, and passes the output to
+ * partial_callback as soon as it arrives. callback gets no output
+ * then, it only reports the end of the job. */
+guint
+giggle_dispatcher_execute_full (GiggleDispatcher      *dispatcher,
+				const gchar           *wd,
+				const gchar           *command,
+				const gchar           *input,
+				GiggleExecuteCallback  partial_callback,
+				GiggleExecuteCallback  callback,
+				gpointer               user_data)
 {
 	DispatcherJob *job;
 	static guint   id = 0;
@@ -407,7 +604,9 @@ giggle_dispatcher_execute (GiggleDispatcher      *dispatcher,
 	job = g_slice_new0 (DispatcherJob);
 
 	job->command = g_strdup (command);
+	job->input = g_strdup (input);
 	job->callback = callback;
+	job->partial_callback = partial_callback;
 	job->user_data = user_data;
 
 	job->id = ++id;
@@ -59,6 +59,14 @@ guint             giggle_dispatcher_execute (GiggleDispatcher      *dispatcher,
 					     GiggleExecuteCallback  callback,
 					     gpointer               user_data);
 
+guint             giggle_dispatcher_execute_full (GiggleDispatcher      *dispatcher,
+						  const gchar           *wd,
+						  const gchar           *command,
+						  const gchar           *input,
+						  GiggleExecuteCallback  partial_callback,
+						  GiggleExecuteCallback  callback,
+						  gpointer               user_data);
+
 void              giggle_dispatcher_cancel  (GiggleDispatcher      *dispatcher,
 					     guint                  id);
 
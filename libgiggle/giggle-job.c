@@ -158,3 +158,40 @@ giggle_job_handle_output (GiggleJob   *job,
 	}
 }
 
+gboolean
+giggle_job_is_streaming (GiggleJob *job)
+{
+	g_return_val_if_fail (GIGGLE_IS_JOB (job), FALSE);
+
+	return GIGGLE_JOB_GET_CLASS (job)->handle_partial_output != NULL;
+}
+
+void
+giggle_job_handle_partial_output (GiggleJob   *job,
+				  const gchar *output_str,
+				  gsize        output_len)
+{
+	GiggleJobClass *klass;
+
+	g_return_if_fail (GIGGLE_IS_JOB (job));
+
+	klass = GIGGLE_JOB_GET_CLASS (job);
+	if (klass->handle_partial_output) {
+		klass->handle_partial_output (job, output_str, output_len);
+	}
+}
+
+gchar *
+giggle_job_get_input (GiggleJob *job)
+{
+	GiggleJobClass *klass;
+
+	g_return_val_if_fail (GIGGLE_IS_JOB (job), NULL);
+
+	klass = GIGGLE_JOB_GET_CLASS (job);
+	if (klass->get_input) {
+		return klass->get_input (job);
+	}
+
+	return NULL;
+}
@@ -48,6 +48,15 @@ struct GiggleJobClass {
 	void       (* handle_output)     (GiggleJob    *job,
 					  const gchar  *output_str,
 					  gsize         output_len);
+
+	/* streaming jobs get their output in chunks while the command
+	 * runs, and an empty handle_output() call once it finished */
+	void       (* handle_partial_output) (GiggleJob    *job,
+					      const gchar  *output_str,
+					      gsize         output_len);
+
+	/* text for the command's standard input, NULL for none */
+	gchar *    (* get_input)         (GiggleJob    *job);
 };
 
 GType        giggle_job_get_type         (void);
@@ -57,6 +66,12 @@ gboolean     giggle_job_get_command_line (GiggleJob    *job,
 void         giggle_job_handle_output    (GiggleJob    *job,
 					  const gchar  *output_str,
 					  gsize         output_len);
+gboolean     giggle_job_is_streaming     (GiggleJob    *job);
+void         giggle_job_handle_partial_output
+					 (GiggleJob    *job,
+					  const gchar  *output_str,
+					  gsize         output_len);
+gchar *      giggle_job_get_input        (GiggleJob    *job);
 
 G_END_DECLS
 
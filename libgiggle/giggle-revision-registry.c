@@ -0,0 +1,205 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Maps object ids to the GiggleRevision which represents that commit
+ * within one repository, so that jobs share revisions instead of each
+ * creating their own copies. Revisions are held weakly: an entry goes
+ * away once nothing else references its revision.
+ */
+
+#include "config.h"
+#include "giggle-revision-registry.h"
+
+#define GET_PRIV(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIGGLE_TYPE_REVISION_REGISTRY, GiggleRevisionRegistryPriv))
+
+typedef struct {
+	GHashTable *revisions;
+} GiggleRevisionRegistryPriv;
+
+/* attached to each registered revision */
+typedef struct {
+	GiggleRevisionRegistry *registry;
+	GiggleRevision         *revision;
+	gchar                  *sha;
+} RegistryEntry;
+
+static GQuark entry_quark;
+
+G_DEFINE_TYPE (GiggleRevisionRegistry, giggle_revision_registry, G_TYPE_OBJECT)
+
+static void
+registry_entry_free (RegistryEntry *entry)
+{
+	g_free (entry->sha);
+	g_slice_free (RegistryEntry, entry);
+}
+
+static void
+registry_entry_unlink (RegistryEntry *entry)
+{
+	GiggleRevisionRegistryPriv *priv;
+
+	priv = GET_PRIV (entry->registry);
+
+	if (g_hash_table_lookup (priv->revisions, entry->sha) == entry->revision)
+		g_hash_table_remove (priv->revisions, entry->sha);
+}
+
+/* runs when the revision gets finalized, so it must not be touched */
+static void
+registry_entry_destroy (RegistryEntry *entry)
+{
+	registry_entry_unlink (entry);
+	registry_entry_free (entry);
+}
+
+/* makes revision forget about its registry */
+static void
+registry_detach (GiggleRevision *revision,
+		 gboolean        unlink)
+{
+	RegistryEntry *entry;
+
+	entry = g_object_steal_qdata (G_OBJECT (revision), entry_quark);
+
+	if (entry) {
+		if (unlink)
+			registry_entry_unlink (entry);
+
+		registry_entry_free (entry);
+	}
+}
+
+static void
+registry_finalize (GObject *object)
+{
+	GiggleRevisionRegistryPriv *priv;
+	GHashTableIter              iter;
+	gpointer                    revision;
+
+	priv = GET_PRIV (object);
+
+	g_hash_table_iter_init (&iter, priv->revisions);
+
+	while (g_hash_table_iter_next (&iter, NULL, &revision))
+		registry_detach (revision, FALSE);
+
+	g_hash_table_destroy (priv->revisions);
+
+	G_OBJECT_CLASS (giggle_revision_registry_parent_class)->finalize (object);
+}
+
+static void
+giggle_revision_registry_class_init (GiggleRevisionRegistryClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+	object_class->finalize = registry_finalize;
+
+	entry_quark = g_quark_from_static_string ("giggle-revision-registry-entry");
+
+	g_type_class_add_private (class, sizeof (GiggleRevisionRegistryPriv));
+}
+
+static void
+giggle_revision_registry_init (GiggleRevisionRegistry *registry)
+{
+	GiggleRevisionRegistryPriv *priv;
+
+	priv = GET_PRIV (registry);
+
+	/* keys are owned by the entries attached to the revisions */
+	priv->revisions = g_hash_table_new (g_str_hash, g_str_equal);
+}
+
+GiggleRevisionRegistry *
+giggle_revision_registry_new (void)
+{
+	return g_object_new (GIGGLE_TYPE_REVISION_REGISTRY, NULL);
+}
+
+/* returns the registered revision without adding a reference, or NULL */
+GiggleRevision *
+giggle_revision_registry_lookup (GiggleRevisionRegistry *registry,
+				 const gchar            *sha)
+{
+	g_return_val_if_fail (GIGGLE_IS_REVISION_REGISTRY (registry), NULL);
+	g_return_val_if_fail (NULL != sha, NULL);
+
+	return g_hash_table_lookup (GET_PRIV (registry)->revisions, sha);
+}
+
+/* returns a new reference to the revision for sha, registering a
+ * new revision without any details if there is none yet */
+GiggleRevision *
+giggle_revision_registry_resolve (GiggleRevisionRegistry *registry,
+				  const gchar            *sha)
+{
+	GiggleRevision *revision;
+
+	g_return_val_if_fail (GIGGLE_IS_REVISION_REGISTRY (registry), NULL);
+	g_return_val_if_fail (NULL != sha, NULL);
+
+	revision = giggle_revision_registry_lookup (registry, sha);
+
+	if (revision)
+		return g_object_ref (revision);
+
+	revision = giggle_revision_new (sha);
+	giggle_revision_registry_add (registry, revision);
+
+	return revision;
+}
+
+/* makes revision the one representing its sha, replacing any other */
+void
+giggle_revision_registry_add (GiggleRevisionRegistry *registry,
+			      GiggleRevision         *revision)
+{
+	GiggleRevisionRegistryPriv *priv;
+	GiggleRevision             *previous;
+	RegistryEntry              *entry;
+
+	g_return_if_fail (GIGGLE_IS_REVISION_REGISTRY (registry));
+	g_return_if_fail (GIGGLE_IS_REVISION (revision));
+
+	priv = GET_PRIV (registry);
+	previous = g_hash_table_lookup (priv->revisions,
+					giggle_revision_get_sha (revision));
+
+	if (previous == revision)
+		return;
+
+	if (previous)
+		registry_detach (previous, TRUE);
+
+	/* revisions belong to one repository only */
+	registry_detach (revision, TRUE);
+
+	entry = g_slice_new (RegistryEntry);
+	entry->registry = registry;
+	entry->revision = revision;
+	entry->sha = g_strdup (giggle_revision_get_sha (revision));
+
+	g_object_set_qdata_full (G_OBJECT (revision), entry_quark, entry,
+				 (GDestroyNotify) registry_entry_destroy);
+
+	g_hash_table_insert (priv->revisions, entry->sha, revision);
+}
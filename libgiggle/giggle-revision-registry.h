@@ -0,0 +1,58 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GIGGLE_REVISION_REGISTRY_H__
+#define __GIGGLE_REVISION_REGISTRY_H__
+
+#include "giggle-revision.h"
+
+G_BEGIN_DECLS
+
+#define GIGGLE_TYPE_REVISION_REGISTRY            (giggle_revision_registry_get_type ())
+#define GIGGLE_REVISION_REGISTRY(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIGGLE_TYPE_REVISION_REGISTRY, GiggleRevisionRegistry))
+#define GIGGLE_REVISION_REGISTRY_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), GIGGLE_TYPE_REVISION_REGISTRY, GiggleRevisionRegistryClass))
+#define GIGGLE_IS_REVISION_REGISTRY(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GIGGLE_TYPE_REVISION_REGISTRY))
+#define GIGGLE_IS_REVISION_REGISTRY_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GIGGLE_TYPE_REVISION_REGISTRY))
+#define GIGGLE_REVISION_REGISTRY_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GIGGLE_TYPE_REVISION_REGISTRY, GiggleRevisionRegistryClass))
+
+typedef struct GiggleRevisionRegistry      GiggleRevisionRegistry;
+typedef struct GiggleRevisionRegistryClass GiggleRevisionRegistryClass;
+
+struct GiggleRevisionRegistry {
+	GObject parent_instance;
+};
+
+struct GiggleRevisionRegistryClass {
+	GObjectClass parent_class;
+};
+
+GType                    giggle_revision_registry_get_type (void);
+GiggleRevisionRegistry * giggle_revision_registry_new      (void);
+
+GiggleRevision *         giggle_revision_registry_lookup   (GiggleRevisionRegistry *registry,
+							    const gchar            *sha);
+GiggleRevision *         giggle_revision_registry_resolve  (GiggleRevisionRegistry *registry,
+							    const gchar            *sha);
+void                     giggle_revision_registry_add      (GiggleRevisionRegistry *registry,
+							    GiggleRevision         *revision);
+
+G_END_DECLS
+
+#endif /* __GIGGLE_REVISION_REGISTRY_H__ */
@@ -19,6 +19,29 @@
  */
 
 #include "giggle-searchable.h"
+#include "giggle-marshal.h"
+
+static void
+giggle_searchable_base_init (gpointer iface)
+{
+	static gboolean initialized = FALSE;
+
+	if (initialized)
+		return;
+
+	/* emitted by searchables which search in the background,
+	 * the GError tells when some of it could not be searched */
+	g_signal_new ("search-progress",
+		      GIGGLE_TYPE_SEARCHABLE,
+		      G_SIGNAL_RUN_LAST,
+		      G_STRUCT_OFFSET (GiggleSearchableIface, search_progress),
+		      NULL, NULL,
+		      giggle_marshal_VOID__UINT_UINT_BOOLEAN_POINTER,
+		      G_TYPE_NONE, 4,
+		      G_TYPE_UINT, G_TYPE_UINT, G_TYPE_BOOLEAN, G_TYPE_POINTER);
+
+	initialized = TRUE;
+}
 
 GType
 giggle_searchable_get_type (void)
@@ -28,7 +51,7 @@ giggle_searchable_get_type (void)
   if (G_UNLIKELY (!searchable_type)) {
 	  const GTypeInfo giggle_searchable_info = {
 		  sizeof (GiggleSearchableIface), /* class_size */
-		  NULL,         /* base_init */
+		  giggle_searchable_base_init,
 		  NULL,		/* base_finalize */
 		  NULL,
 		  NULL,		/* class_finalize */
@@ -89,3 +112,32 @@ giggle_searchable_cancel (GiggleSearchable *searchable)
 		(* iface->cancel) (searchable);
 	}
 }
+
+/* searchables which can, show only what matches the search */
+void
+giggle_searchable_set_filter (GiggleSearchable *searchable,
+			      gboolean          filter)
+{
+	GiggleSearchableIface *iface;
+
+	g_return_if_fail (GIGGLE_IS_SEARCHABLE (searchable));
+
+	iface = GIGGLE_SEARCHABLE_GET_IFACE (searchable);
+
+	if (iface->set_filter) {
+		(* iface->set_filter) (searchable, filter);
+	}
+}
+
+void
+giggle_searchable_emit_progress (GiggleSearchable *searchable,
+				 guint             n_searched,
+				 guint             n_matches,
+				 gboolean          finished,
+				 const GError     *error)
+{
+	g_return_if_fail (GIGGLE_IS_SEARCHABLE (searchable));
+
+	g_signal_emit_by_name (searchable, "search-progress",
+			       n_searched, n_matches, finished, error);
+}
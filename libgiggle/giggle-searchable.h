@@ -46,6 +46,15 @@ struct GiggleSearchableIface {
 			     GiggleSearchDirection  direction,
 			     gboolean               full_search);
 	void     (* cancel) (GiggleSearchable      *searchable);
+	void     (* set_filter) (GiggleSearchable  *searchable,
+				 gboolean           filter);
+
+	/* signals */
+	void     (* search_progress) (GiggleSearchable *searchable,
+				      guint             n_searched,
+				      guint             n_matches,
+				      gboolean          finished,
+				      const GError     *error);
 };
 
 GType      giggle_searchable_get_type (void);
@@ -55,6 +64,14 @@ gboolean   giggle_searchable_search   (GiggleSearchable      *searchable,
 				       gboolean               full_search);
 
 void       giggle_searchable_cancel   (GiggleSearchable      *searchable);
+void       giggle_searchable_set_filter (GiggleSearchable    *searchable,
+					 gboolean             filter);
+
+void       giggle_searchable_emit_progress (GiggleSearchable *searchable,
+					    guint             n_searched,
+					    guint             n_matches,
+					    gboolean          finished,
+					    const GError     *error);
 
 
 G_END_DECLS
@@ -62,3 +62,27 @@ giggle_sysdeps_kill_pid (GPid pid)
 #endif
 }
 
+/* writing to a pipe whose reader went away must fail with EPIPE
+ * instead of killing us */
+void
+giggle_sysdeps_ignore_sigpipe (void)
+{
+#ifndef G_OS_WIN32
+	static gboolean ignored = FALSE;
+
+	if (!ignored) {
+		signal (SIGPIPE, SIG_IGN);
+		ignored = TRUE;
+	}
+#endif
+}
+
+/* GSpawnChildSetupFunc giving children the default SIGPIPE handling,
+ * ignored signals would be inherited otherwise */
+void
+giggle_sysdeps_child_setup (gpointer user_data)
+{
+#ifndef G_OS_WIN32
+	signal (SIGPIPE, SIG_DFL);
+#endif
+}
@@ -23,6 +23,8 @@
 
 #include <glib.h>
 
-void   giggle_sysdeps_kill_pid (GPid pid);
+void   giggle_sysdeps_kill_pid        (GPid     pid);
+void   giggle_sysdeps_ignore_sigpipe  (void);
+void   giggle_sysdeps_child_setup     (gpointer user_data);
 
 #endif /* __GIGGLE_SYSDEPS_H__ */
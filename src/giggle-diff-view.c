@@ -21,6 +21,8 @@
 #include "config.h"
 #include "giggle-diff-view.h"
 
+#include "giggle-text-search.h"
+
 #include <libgiggle/giggle-job.h>
 #include <libgiggle/giggle-revision.h>
 #include <libgiggle/giggle-searchable.h>
@@ -350,34 +352,23 @@ diff_view_do_search (GiggleDiffView *view,
 	GiggleDiffViewPriv *priv;
 	GtkTextBuffer      *buffer;
 	GtkTextIter         start_iter, end_iter;
-	gchar              *diff;
-	const gchar        *p;
-	glong               offset, len;
-	gboolean            match = FALSE;
 
 	priv = GET_PRIV (view);
 
 	buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (view));
-	gtk_text_buffer_get_bounds (buffer, &start_iter, &end_iter);
-	diff = gtk_text_buffer_get_text (buffer, &start_iter, &end_iter, FALSE);
-
-	if ((p = strstr (diff, search_term)) != NULL) {
-		match = TRUE;
-		offset = g_utf8_pointer_to_offset (diff, p);
-		len = g_utf8_strlen (search_term, -1);
 
-		gtk_text_buffer_get_iter_at_offset (buffer, &start_iter, (gint) offset);
-		gtk_text_buffer_get_iter_at_offset (buffer, &end_iter, (gint) offset + len);
+	if (!giggle_text_buffer_search (buffer, search_term, NULL,
+					GIGGLE_SEARCH_DIRECTION_NEXT,
+					&start_iter, &end_iter))
+		return FALSE;
 
-		gtk_text_buffer_select_range (buffer, &start_iter, &end_iter);
+	gtk_text_buffer_select_range (buffer, &start_iter, &end_iter);
 
-		gtk_text_buffer_move_mark (buffer, priv->search_mark, &start_iter);
-		gtk_text_view_scroll_to_mark (GTK_TEXT_VIEW (view), priv->search_mark,
-					      0.0, FALSE, 0.5, 0.5);
-	}
+	gtk_text_buffer_move_mark (buffer, priv->search_mark, &start_iter);
+	gtk_text_view_scroll_to_mark (GTK_TEXT_VIEW (view), priv->search_mark,
+				      0.0, FALSE, 0.5, 0.5);
 
-	g_free (diff);
-	return match;
+	return TRUE;
 }
 
 static gboolean
@@ -33,12 +33,20 @@
 #include <libgiggle-git/giggle-git-diff.h>
 #include <libgiggle-git/giggle-git-enums.h>
 #include <libgiggle-git/giggle-git-ignore.h>
-#include <libgiggle-git/giggle-git-list-files.h>
+#include <libgiggle-git/giggle-git-list-index.h>
+#include <libgiggle-git/giggle-git-status.h>
 
+#include <dirent.h>
+#include <fcntl.h>
 #include <glib/gi18n.h>
 #include <string.h>
+#include <sys/stat.h>
+
+/* more dirty paths than this get a full status refresh */
+#define MAX_DIRTY_PATHS 256
 
 typedef struct GiggleFileListPriv GiggleFileListPriv;
+typedef struct PathTrie           PathTrie;
 
 struct GiggleFileListPriv {
 	GiggleGit      *git;
@@ -47,14 +55,31 @@ struct GiggleFileListPriv {
 	GtkTreeStore   *store;
 	GtkTreeModel   *filter_model;
 
+	/* relative path -> GtkTreeIter of every created row,
+	 * tree store iters stay valid until their row is removed */
+	GHashTable     *rows;
+
 	GtkWidget      *popup;
 	GtkUIManager   *ui_manager;
 
 	GiggleJob      *job;
 
-	GtkWidget      *diff_window;
+	/* the full status listing, and whether another one is due */
+	GiggleJob      *files_job;
+	gboolean        files_refresh_pending;
+
+	/* rows get created when their parent is expanded, these
+	 * provide the paths and states of the missing rows */
+	GiggleJob      *index_job;
+	GiggleJob      *index;
+	GiggleJob      *file_status;
+	PathTrie       *highlight;
 
-	GHashTable     *idle_jobs;
+	/* paths reported by the watcher, queried while status_job runs */
+	GiggleJob      *status_job;
+	GHashTable     *dirty_paths;
+
+	GtkWidget      *diff_window;
 
 	GiggleRevision *revision_from;
 	GiggleRevision *revision_to;
@@ -64,21 +89,27 @@ struct GiggleFileListPriv {
 	char           *selected_path;
 };
 
-typedef struct IdleLoaderData IdleLoaderData;
-
-struct IdleLoaderData {
-	GiggleFileList *list;
-	gchar          *directory;
-	gchar          *rel_path;
-	GtkTreeIter     parent_iter;
+/* files changed between the highlighted revisions,
+ * with one node per path component */
+struct PathTrie {
+	GHashTable *children;
 };
 
+/* children of an unexpanded directory, the placeholder row keeps the
+ * expander visible until the directory's rows get created */
+typedef struct {
+	GPtrArray *dirs;
+	GPtrArray *files;
+} FileListChildren;
 
-static void file_list_add_element		(GiggleFileList *list,
-						 const gchar    *directory,
-						 const gchar    *rel_path,
-						 const gchar    *name,
-						 GtkTreeIter    *parent_iter);
+
+static void file_list_materialize_dir		(GiggleFileList *list,
+						 GtkTreeIter    *parent);
+static void file_list_materialize_path		(GiggleFileList *list,
+						 const gchar    *path);
+static void file_list_cancel_index		(GiggleFileList *list);
+static void file_list_run_status_job		(GiggleFileList *list);
+static void file_list_files_status_changed	(GiggleFileList *list);
 
 static void giggle_file_list_clipboard_init	(GiggleClipboardIface *iface);
 
@@ -113,6 +144,79 @@ enum {
 static guint signals[LAST_SIGNAL] = { 0, };
 
 
+static void
+path_trie_free (PathTrie *trie)
+{
+	if (trie->children)
+		g_hash_table_destroy (trie->children);
+
+	g_slice_free (PathTrie, trie);
+}
+
+static void
+path_trie_insert (PathTrie    *trie,
+		  const gchar *path)
+{
+	PathTrie    *child;
+	const gchar *slash;
+	gchar       *name;
+
+	while (*path) {
+		slash = strchr (path, G_DIR_SEPARATOR);
+		name = slash ? g_strndup (path, slash - path) : g_strdup (path);
+
+		if (!trie->children) {
+			trie->children = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+								(GDestroyNotify) path_trie_free);
+		}
+
+		child = g_hash_table_lookup (trie->children, name);
+
+		if (!child) {
+			child = g_slice_new0 (PathTrie);
+			g_hash_table_insert (trie->children, name, child);
+		} else {
+			g_free (name);
+		}
+
+		trie = child;
+
+		if (!slash)
+			break;
+
+		path = slash + 1;
+	}
+}
+
+static PathTrie *
+path_trie_lookup (PathTrie    *trie,
+		  const gchar *name)
+{
+	if (!trie || !trie->children)
+		return NULL;
+
+	return g_hash_table_lookup (trie->children, name);
+}
+
+static PathTrie *
+path_trie_lookup_path (PathTrie    *trie,
+		       const gchar *path)
+{
+	gchar **names;
+	int     i;
+
+	names = g_strsplit (path, G_DIR_SEPARATOR_S, -1);
+
+	for (i = 0; trie && names[i]; ++i) {
+		if (*names[i])
+			trie = path_trie_lookup (trie, names[i]);
+	}
+
+	g_strfreev (names);
+
+	return trie;
+}
+
 static void
 file_list_finalize (GObject *object)
 {
@@ -126,6 +230,30 @@ file_list_finalize (GObject *object)
 		priv->job = NULL;
 	}
 
+	if (priv->files_job) {
+		giggle_git_cancel_job (priv->git, priv->files_job);
+		g_object_unref (priv->files_job);
+		priv->files_job = NULL;
+	}
+
+	if (priv->status_job) {
+		giggle_git_cancel_job (priv->git, priv->status_job);
+		g_object_unref (priv->status_job);
+		priv->status_job = NULL;
+	}
+
+	file_list_cancel_index (GIGGLE_FILE_LIST (object));
+
+	if (priv->file_status) {
+		g_object_unref (priv->file_status);
+	}
+
+	g_hash_table_destroy (priv->dirty_paths);
+
+	if (priv->highlight) {
+		path_trie_free (priv->highlight);
+	}
+
 	g_object_unref (priv->git);
 
 	if (priv->store) {
@@ -135,9 +263,11 @@ file_list_finalize (GObject *object)
 		g_object_unref (priv->filter_model);
 	}
 
-	g_object_unref (priv->ui_manager);
+	if (priv->rows) {
+		g_hash_table_destroy (priv->rows);
+	}
 
-	g_hash_table_destroy (priv->idle_jobs);
+	g_object_unref (priv->ui_manager);
 
 	if (priv->revision_from) {
 		g_object_unref (priv->revision_from);
@@ -327,9 +457,9 @@ file_list_button_press (GtkWidget      *widget,
 }
 
 static void
-file_list_update_files_status (GiggleFileList     *file_list,
-			       GtkTreeIter        *parent,
-			       GiggleGitListFiles *list_files)
+file_list_update_files_status (GiggleFileList  *file_list,
+			       GtkTreeIter     *parent,
+			       GiggleGitStatus *file_status)
 {
 	GiggleFileListPriv        *priv;
 	GtkTreeIter               iter;
@@ -352,14 +482,14 @@ file_list_update_files_status (GiggleFileList     *file_list,
 				    -1);
 
 		if (rel_path) {
-			status = giggle_git_list_files_get_file_status (list_files, rel_path);
+			status = giggle_git_status_get_file_status (file_status, rel_path);
 		} else {
 			status = GIGGLE_GIT_FILE_STATUS_CACHED;
 		}
 
 		if (gtk_tree_model_iter_has_child (GTK_TREE_MODEL (priv->store), &iter)) {
 			/* it's a directory */
-			file_list_update_files_status (file_list, &iter, list_files);
+			file_list_update_files_status (file_list, &iter, file_status);
 			status = GIGGLE_GIT_FILE_STATUS_CACHED;
 		}
 
@@ -397,12 +527,27 @@ file_list_files_callback (GiggleGit *git,
 		gtk_dialog_run (GTK_DIALOG (dialog));
 		gtk_widget_destroy (dialog);
 	} else {
-		file_list_update_files_status (list, NULL, GIGGLE_GIT_LIST_FILES (priv->job));
+		if (priv->file_status) {
+			g_object_unref (priv->file_status);
+		}
+
+		priv->file_status = g_object_ref (priv->files_job);
+
+		file_list_update_files_status (list, NULL, GIGGLE_GIT_STATUS (priv->files_job));
 		g_signal_emit (list, signals[STATUS_CHANGED], 0);
 	}
 
-	g_object_unref (priv->job);
-	priv->job = NULL;
+	g_object_unref (priv->files_job);
+	priv->files_job = NULL;
+
+	if (priv->files_refresh_pending) {
+		priv->files_refresh_pending = FALSE;
+		file_list_files_status_changed (list);
+	} else if (priv->file_status && !priv->status_job &&
+		   g_hash_table_size (priv->dirty_paths)) {
+		/* git may have scanned these before they changed */
+		file_list_run_status_job (list);
+	}
 }
 
 static void
@@ -412,20 +557,242 @@ file_list_files_status_changed (GiggleFileList *list)
 
 	priv = GET_PRIV (list);
 
-	if (priv->job) {
-		giggle_git_cancel_job (priv->git, priv->job);
-		g_object_unref (priv->job);
-		priv->job = NULL;
+	/* restarting the listing for every change would never
+	 * let it finish while something keeps writing files */
+	if (priv->files_job) {
+		priv->files_refresh_pending = TRUE;
+		return;
 	}
 
-	priv->job = giggle_git_list_files_new ();
+	/* the listing covers whatever the watcher queued so far */
+	g_hash_table_remove_all (priv->dirty_paths);
+
+	priv->files_job = giggle_git_status_new (NULL);
 
 	giggle_git_run_job (priv->git,
-			    priv->job,
+			    priv->files_job,
 			    file_list_files_callback,
 			    list);
 }
 
+static void
+file_list_set_path_status (GiggleFileList           *list,
+			   const gchar              *path,
+			   GiggleGitListFilesStatus  status)
+{
+	GiggleFileListPriv       *priv;
+	GiggleGitListFilesStatus  old_status;
+	GtkTreeIter              *iter;
+
+	priv = GET_PRIV (list);
+
+	giggle_git_status_set_file_status (GIGGLE_GIT_STATUS (priv->file_status), path, status);
+
+	iter = g_hash_table_lookup (priv->rows, path);
+
+	/* directories always show as cached */
+	if (!iter || gtk_tree_model_iter_has_child (GTK_TREE_MODEL (priv->store), iter))
+		return;
+
+	gtk_tree_model_get (GTK_TREE_MODEL (priv->store), iter,
+			    COL_FILE_STATUS, &old_status,
+			    -1);
+
+	if (old_status != status) {
+		gtk_tree_store_set (priv->store, iter,
+				    COL_FILE_STATUS, status,
+				    -1);
+	}
+}
+
+static void
+file_list_status_foreach_cb (const gchar              *path,
+			     GiggleGitListFilesStatus  status,
+			     gpointer                  user_data)
+{
+	/* sources of renames get listed as deleted, too */
+	file_list_set_path_status (user_data, path, status);
+}
+
+static void
+file_list_status_callback (GiggleGit *git,
+			   GiggleJob *job,
+			   GError    *error,
+			   gpointer   user_data)
+{
+	GiggleFileList           *list;
+	GiggleFileListPriv       *priv;
+	GiggleGitListFilesStatus  status;
+	const gchar * const      *paths;
+	gint                      i;
+
+	list = GIGGLE_FILE_LIST (user_data);
+	priv = GET_PRIV (list);
+
+	if (error) {
+		g_warning ("Cannot update the file status: %s", error->message);
+	} else if (priv->file_status) {
+		paths = giggle_git_status_get_paths (GIGGLE_GIT_STATUS (job));
+
+		/* queried paths git doesn't mention are clean, if tracked */
+		for (i = 0; paths[i]; ++i) {
+			status = giggle_git_status_get_file_status
+				(GIGGLE_GIT_STATUS (priv->file_status), paths[i]);
+
+			if (GIGGLE_GIT_FILE_STATUS_OTHER != status)
+				file_list_set_path_status (list, paths[i], GIGGLE_GIT_FILE_STATUS_CACHED);
+		}
+
+		giggle_git_status_foreach (GIGGLE_GIT_STATUS (job),
+					   file_list_status_foreach_cb, list);
+
+		g_signal_emit (list, signals[STATUS_CHANGED], 0);
+	}
+
+	g_object_unref (priv->status_job);
+	priv->status_job = NULL;
+
+	/* changes that came in meanwhile, unless a full listing flushes them */
+	if (!priv->files_job && g_hash_table_size (priv->dirty_paths))
+		file_list_run_status_job (list);
+}
+
+static void
+file_list_run_status_job (GiggleFileList *list)
+{
+	GiggleFileListPriv *priv;
+	GHashTableIter      iter;
+	GPtrArray          *paths;
+	gpointer            path;
+
+	priv = GET_PRIV (list);
+
+	paths = g_ptr_array_sized_new (g_hash_table_size (priv->dirty_paths) + 1);
+	g_hash_table_iter_init (&iter, priv->dirty_paths);
+
+	while (g_hash_table_iter_next (&iter, &path, NULL))
+		g_ptr_array_add (paths, path);
+
+	g_ptr_array_add (paths, NULL);
+
+	priv->status_job = giggle_git_status_new ((const gchar * const *) paths->pdata);
+
+	g_ptr_array_free (paths, TRUE);
+	g_hash_table_remove_all (priv->dirty_paths);
+
+	giggle_git_run_job (priv->git,
+			    priv->status_job,
+			    file_list_status_callback,
+			    list);
+}
+
+/* whether the ignore files of dir or its parents match path */
+static gboolean
+file_list_dir_ignores_path (GtkTreeModel *model,
+			    GtkTreeIter  *dir,
+			    const gchar  *path)
+{
+	GiggleGitIgnore *git_ignore;
+	GtkTreeIter      iter, parent;
+	gboolean         matches = FALSE;
+
+	iter = *dir;
+
+	do {
+		gtk_tree_model_get (model, &iter,
+				    COL_GIT_IGNORE, &git_ignore,
+				    -1);
+
+		if (git_ignore) {
+			matches = giggle_git_ignore_path_matches (git_ignore, path);
+			g_object_unref (git_ignore);
+		}
+
+		if (!gtk_tree_model_iter_parent (model, &parent, &iter))
+			break;
+
+		iter = parent;
+	} while (!matches);
+
+	return matches;
+}
+
+/* whether path or one of its parent directories is ignored, as far as
+ * the ignore files of the directories which got rows already tell */
+static gboolean
+file_list_path_is_ignored (GiggleFileList *list,
+			   const gchar    *path)
+{
+	GiggleFileListPriv *priv;
+	GtkTreeModel       *model;
+	GtkTreeIter         root, *dir;
+	gchar              *prefix, *end;
+	gboolean            ignored = FALSE;
+
+	priv = GET_PRIV (list);
+	model = GTK_TREE_MODEL (priv->store);
+
+	if (!gtk_tree_model_get_iter_first (model, &root))
+		return FALSE;
+
+	prefix = g_strdup (path);
+	dir = &root;
+	end = strchr (prefix, G_DIR_SEPARATOR);
+
+	while (TRUE) {
+		if (end)
+			*end = '\0';
+
+		if (file_list_dir_ignores_path (model, dir, prefix)) {
+			ignored = TRUE;
+			break;
+		}
+
+		/* rows below an unexpanded directory don't exist yet */
+		if (!end || !(dir = g_hash_table_lookup (priv->rows, prefix)))
+			break;
+
+		*end = G_DIR_SEPARATOR;
+		end = strchr (end + 1, G_DIR_SEPARATOR);
+	}
+
+	g_free (prefix);
+
+	return ignored;
+}
+
+/* queries the status of just the paths the watcher saw changing,
+ * instead of listing the whole tree again */
+static void
+file_list_worktree_paths_changed (GiggleFileList      *list,
+				  const gchar * const *paths)
+{
+	GiggleFileListPriv *priv;
+	gint                i;
+
+	priv = GET_PRIV (list);
+
+	for (i = 0; paths[i]; ++i) {
+		/* builds writing into ignored directories
+		 * mustn't overflow into full refreshes */
+		if (*paths[i] && file_list_path_is_ignored (list, paths[i]))
+			continue;
+
+		/* events got lost, or too many to list on a command line */
+		if (!*paths[i] || g_hash_table_size (priv->dirty_paths) >= MAX_DIRTY_PATHS) {
+			file_list_files_status_changed (list);
+			return;
+		}
+
+		g_hash_table_replace (priv->dirty_paths, g_strdup (paths[i]), NULL);
+	}
+
+	/* a running full listing flushes them once it's done */
+	if (priv->file_status && !priv->files_job && !priv->status_job &&
+	    g_hash_table_size (priv->dirty_paths))
+		file_list_run_status_job (list);
+}
+
 static void
 file_list_project_loaded (GiggleFileList *list)
 {
@@ -451,9 +818,28 @@ file_list_status_changed (GiggleFileList *list)
 	gtk_tree_view_expand_row (GTK_TREE_VIEW (list), path, FALSE);
 	gtk_tree_path_free (path);
 
-	if (priv->selected_path)
+	if (priv->selected_path) {
+		file_list_materialize_path (list, priv->selected_path);
 		giggle_tree_view_select_row_by_string (GTK_WIDGET (list),
 						       COL_REL_PATH, priv->selected_path);
+	}
+}
+
+static gboolean
+file_list_test_expand_row (GtkTreeView *tree_view,
+			   GtkTreeIter *iter,
+			   GtkTreePath *path)
+{
+	GiggleFileListPriv *priv;
+	GtkTreeIter         child_iter;
+
+	priv = GET_PRIV (tree_view);
+
+	gtk_tree_model_filter_convert_iter_to_child_iter (GTK_TREE_MODEL_FILTER (priv->filter_model),
+							  &child_iter, iter);
+	file_list_materialize_dir (GIGGLE_FILE_LIST (tree_view), &child_iter);
+
+	return FALSE;
 }
 
 static void
@@ -485,6 +871,7 @@ giggle_file_list_class_init (GiggleFileListClass *class)
 	widget_class->button_press_event = file_list_button_press;
 
 	tree_view_class->row_activated   = file_list_row_activated;
+	tree_view_class->test_expand_row = file_list_test_expand_row;
 
 	class->project_loaded            = file_list_project_loaded;
 	class->status_changed            = file_list_status_changed;
@@ -615,7 +1002,8 @@ file_list_filter_func (GtkTreeModel   *model,
 			    COL_REL_PATH, &path,
 			    -1);
 	if (!path) {
-		return FALSE;
+		/* placeholder of an unexpanded directory */
+		return TRUE;
 	}
 
 	/* we never want to show these files */
@@ -630,48 +1018,6 @@ file_list_filter_func (GtkTreeModel   *model,
 	return retval;
 }
 
-static gint
-file_list_compare_func (GtkTreeModel *model,
-			GtkTreeIter  *iter1,
-			GtkTreeIter  *iter2,
-			gpointer      user_data)
-{
-	GiggleGitIgnore *git_ignore1, *git_ignore2;
-	gchar           *name1, *name2;
-	gint             retval = 0;
-
-	gtk_tree_model_get (model, iter1,
-			    COL_GIT_IGNORE, &git_ignore1,
-			    COL_NAME, &name1,
-			    -1);
-	gtk_tree_model_get (model, iter2,
-			    COL_GIT_IGNORE, &git_ignore2,
-			    COL_NAME, &name2,
-			    -1);
-
-	if (git_ignore1 && !git_ignore2) {
-		retval = -1;
-	} else if (git_ignore2 && !git_ignore1) {
-		retval = 1;
-	} else {
-		retval = strcmp (name1, name2);
-	}
-
-	/* free stuff */
-	if (git_ignore1) {
-		g_object_unref (git_ignore1);
-	}
-
-	if (git_ignore2) {
-		g_object_unref (git_ignore2);
-	}
-
-	g_free (name1);
-	g_free (name2);
-
-	return retval;
-}
-
 static void
 file_list_create_store (GiggleFileList *list)
 {
@@ -689,20 +1035,18 @@ file_list_create_store (GiggleFileList *list)
 		g_object_unref (priv->filter_model);
 	}
 
+	if (priv->rows) {
+		g_hash_table_destroy (priv->rows);
+	}
+
+	priv->rows = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+					    (GDestroyNotify) gtk_tree_iter_free);
 	priv->store = gtk_tree_store_new (LAST_COL, G_TYPE_STRING, G_TYPE_STRING, GIGGLE_TYPE_GIT_LIST_FILES_STATUS,
 					  GIGGLE_TYPE_GIT_IGNORE, G_TYPE_BOOLEAN, G_TYPE_BOOLEAN);
 	priv->filter_model = gtk_tree_model_filter_new (GTK_TREE_MODEL (priv->store), NULL);
 
 	gtk_tree_model_filter_set_visible_func (GTK_TREE_MODEL_FILTER (priv->filter_model),
 						file_list_filter_func, list, NULL);
-
-	gtk_tree_sortable_set_sort_func (GTK_TREE_SORTABLE (priv->store),
-					 COL_NAME,
-					 file_list_compare_func,
-					 list, NULL);
-
-	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (priv->store),
-					      COL_NAME, GTK_SORT_ASCENDING);
 }
 
 static void
@@ -1067,123 +1411,276 @@ file_list_toggle_show_all (GtkAction      *action,
 }
 
 static void
-file_list_idle_data_free (IdleLoaderData *data)
+file_list_add_child (const gchar *name,
+		     gboolean     is_dir,
+		     gpointer     user_data)
 {
-	g_free (data->directory);
-	g_free (data->rel_path);
-	g_object_unref (data->list);
-	g_free (data);
+	FileListChildren *children = user_data;
+
+	g_ptr_array_add (is_dir ? children->dirs : children->files, g_strdup (name));
 }
 
+/* for directories the index knows nothing about */
 static void
-file_list_populate_dir (GiggleFileList *list,
-			const gchar    *directory,
-			const gchar    *rel_path,
-			GtkTreeIter    *parent_iter)
+file_list_read_dir (GiggleFileList   *list,
+		    const gchar      *rel_path,
+		    FileListChildren *children)
 {
 	GiggleFileListPriv *priv;
-	GDir               *dir;
-	const gchar        *name;
-	gchar              *full_path, *path;
+	DIR                *dir;
+	struct dirent      *dirent;
+	struct stat         st;
+	gchar              *full_path;
+	gboolean            is_dir;
 
 	priv = GET_PRIV (list);
-	full_path = g_build_filename (directory, rel_path, NULL);
-	dir = g_dir_open (full_path, 0, NULL);
 
-	g_return_if_fail (dir != NULL);
+	full_path = g_build_filename (giggle_git_get_project_dir (priv->git), rel_path, NULL);
+	dir = opendir (full_path);
+	g_free (full_path);
+
+	if (!dir)
+		return;
+
+	while ((dirent = readdir (dir))) {
+		if (!strcmp (dirent->d_name, ".") ||
+		    !strcmp (dirent->d_name, ".."))
+			continue;
 
-	while ((name = g_dir_read_name (dir))) {
-		path = g_build_filename (rel_path, name, NULL);
-		file_list_add_element (list, directory, path, name, parent_iter);
-		g_free (path);
+		/* most file systems tell the type without a stat,
+		 * symlinks get followed like g_file_test() does */
+		switch (dirent->d_type) {
+		case DT_DIR:
+			is_dir = TRUE;
+			break;
+
+		case DT_UNKNOWN:
+		case DT_LNK:
+			is_dir = (0 == fstatat (dirfd (dir), dirent->d_name, &st, 0) &&
+				  S_ISDIR (st.st_mode));
+			break;
+
+		default:
+			is_dir = FALSE;
+			break;
+		}
+
+		file_list_add_child (dirent->d_name, is_dir, children);
 	}
 
-	g_free (full_path);
-	g_dir_close (dir);
+	closedir (dir);
 }
 
-static gboolean
-file_list_populate_dir_idle (gpointer user_data)
+static gint
+file_list_compare_names (gconstpointer a,
+			 gconstpointer b)
+{
+	return strcmp (*(const gchar **) a, *(const gchar **) b);
+}
+
+static void
+file_list_insert_children (GiggleFileList *list,
+			   GtkTreeIter    *parent,
+			   GtkTreeIter    *sibling,
+			   const gchar    *rel_path,
+			   GPtrArray      *names,
+			   gboolean        is_dir)
+{
+	GiggleFileListPriv       *priv;
+	GiggleGitListFilesStatus  status;
+	GtkTreeIter               iter, placeholder;
+	PathTrie                 *trie = NULL;
+	gboolean                  highlight;
+	gchar                    *path;
+	guint                     i;
+
+	priv = GET_PRIV (list);
+
+	if (priv->highlight)
+		trie = path_trie_lookup_path (priv->highlight, rel_path);
+
+	g_ptr_array_sort (names, file_list_compare_names);
+
+	for (i = 0; i < names->len; ++i) {
+		path = g_build_filename (rel_path, names->pdata[i], NULL);
+
+		if (is_dir)
+			status = GIGGLE_GIT_FILE_STATUS_CACHED;
+		else if (priv->file_status)
+			status = giggle_git_status_get_file_status (GIGGLE_GIT_STATUS (priv->file_status), path);
+		else
+			status = GIGGLE_GIT_FILE_STATUS_OTHER;
+
+		highlight = (path_trie_lookup (trie, names->pdata[i]) != NULL);
+
+		gtk_tree_store_insert_after (priv->store, &iter, parent, sibling);
+		gtk_tree_store_set (priv->store, &iter,
+				    COL_NAME, names->pdata[i],
+				    COL_REL_PATH, path,
+				    COL_FILE_STATUS, status,
+				    COL_HIGHLIGHT, highlight,
+				    -1);
+
+		if (is_dir)
+			gtk_tree_store_append (priv->store, &placeholder, &iter);
+
+		/* the table takes ownership of path */
+		g_hash_table_insert (priv->rows, path, gtk_tree_iter_copy (&iter));
+		*sibling = iter;
+	}
+}
+
+/* replaces the placeholder below parent by the directory's real rows */
+static void
+file_list_materialize_dir (GiggleFileList *list,
+			   GtkTreeIter    *parent)
 {
 	GiggleFileListPriv *priv;
-	GiggleFileList     *list;
-	IdleLoaderData     *data;
 	GiggleGitIgnore    *git_ignore;
-	gchar              *full_path;
+	FileListChildren    children;
+	GtkTreeIter         placeholder, sibling;
+	gchar              *rel_path, *full_path;
 
-	data = (IdleLoaderData *) user_data;
-	list = g_object_ref (data->list);
 	priv = GET_PRIV (list);
 
-	full_path = g_build_filename (data->directory, data->rel_path, NULL);
+	if (!gtk_tree_model_iter_children (GTK_TREE_MODEL (priv->store), &placeholder, parent))
+		return;
+
+	gtk_tree_model_get (GTK_TREE_MODEL (priv->store), &placeholder,
+			    COL_REL_PATH, &rel_path,
+			    -1);
+
+	if (rel_path) {
+		/* already done */
+		g_free (rel_path);
+		return;
+	}
+
+	gtk_tree_model_get (GTK_TREE_MODEL (priv->store), parent,
+			    COL_REL_PATH, &rel_path,
+			    -1);
+
+	children.dirs = g_ptr_array_new ();
+	children.files = g_ptr_array_new ();
+
+	if (!priv->index ||
+	    !giggle_git_list_index_foreach_child (GIGGLE_GIT_LIST_INDEX (priv->index), rel_path,
+						  file_list_add_child, &children))
+		file_list_read_dir (list, rel_path, &children);
+
+	full_path = g_build_filename (giggle_git_get_project_dir (priv->git), rel_path, NULL);
 	git_ignore = giggle_git_ignore_new (full_path);
 
-	gtk_tree_store_set (priv->store, &data->parent_iter,
+	gtk_tree_store_set (priv->store, parent,
 			    COL_GIT_IGNORE, git_ignore,
 			    -1);
 
-	file_list_populate_dir (data->list, data->directory,
-				data->rel_path, &data->parent_iter);
-
-	/* remove this data from the table */
-	g_hash_table_remove (priv->idle_jobs, data);
+	/* directories first, just like the compare function sorted them */
+	sibling = placeholder;
+	file_list_insert_children (list, parent, &sibling, rel_path, children.dirs, TRUE);
+	file_list_insert_children (list, parent, &sibling, rel_path, children.files, FALSE);
+	gtk_tree_store_remove (priv->store, &placeholder);
 
-	if (g_hash_table_size (priv->idle_jobs) == 0) {
-		/* no remaining jobs */
-		g_signal_emit (list, signals[PROJECT_LOADED], 0);
-	}
+	g_ptr_array_foreach (children.dirs, (GFunc) g_free, NULL);
+	g_ptr_array_free (children.dirs, TRUE);
+	g_ptr_array_foreach (children.files, (GFunc) g_free, NULL);
+	g_ptr_array_free (children.files, TRUE);
 
 	g_object_unref (git_ignore);
-	g_object_unref (list);
 	g_free (full_path);
+	g_free (rel_path);
+}
 
-	return FALSE;
+/* creates the rows leading to path, so that it can be selected */
+static void
+file_list_materialize_path (GiggleFileList *list,
+			    const gchar    *path)
+{
+	GiggleFileListPriv  *priv;
+	GtkTreeIter          iter, child;
+	gchar              **names, *name;
+	gboolean             valid;
+	int                  i;
+
+	priv = GET_PRIV (list);
+
+	if (!gtk_tree_model_get_iter_first (GTK_TREE_MODEL (priv->store), &iter))
+		return;
+
+	names = g_strsplit (path, G_DIR_SEPARATOR_S, -1);
+
+	for (i = 0; names[i]; ++i) {
+		if (!*names[i])
+			continue;
+
+		file_list_materialize_dir (list, &iter);
+		valid = gtk_tree_model_iter_children (GTK_TREE_MODEL (priv->store), &child, &iter);
+
+		while (valid) {
+			gtk_tree_model_get (GTK_TREE_MODEL (priv->store), &child,
+					    COL_NAME, &name,
+					    -1);
+
+			if (!g_strcmp0 (name, names[i])) {
+				g_free (name);
+				break;
+			}
+
+			g_free (name);
+			valid = gtk_tree_model_iter_next (GTK_TREE_MODEL (priv->store), &child);
+		}
+
+		if (!valid)
+			break;
+
+		iter = child;
+	}
+
+	g_strfreev (names);
 }
 
 static void
-file_list_add_element (GiggleFileList *list,
-		       const gchar    *directory,
-		       const gchar    *rel_path,
-		       const gchar    *name,
-		       GtkTreeIter    *parent_iter)
+file_list_index_callback (GiggleGit *git,
+			  GiggleJob *job,
+			  GError    *error,
+			  gpointer   user_data)
 {
+	GiggleFileList     *list;
 	GiggleFileListPriv *priv;
-	GtkTreeIter         iter;
-	gboolean            is_dir;
-	gchar              *full_path;
 
+	list = GIGGLE_FILE_LIST (user_data);
 	priv = GET_PRIV (list);
 
-	full_path = g_build_filename (directory, rel_path, NULL);
-	is_dir = g_file_test (full_path, G_FILE_TEST_IS_DIR);
-
-	gtk_tree_store_append (priv->store,
-			       &iter,
-			       parent_iter);
+	/* without index directories get read from disk */
+	if (error) {
+		g_warning ("Cannot list the index: %s", error->message);
+	} else {
+		priv->index = g_object_ref (job);
+	}
 
-	gtk_tree_store_set (priv->store, &iter,
-			    COL_NAME, (name) ? name : full_path,
-			    COL_REL_PATH, rel_path,
-			    -1);
+	g_object_unref (priv->index_job);
+	priv->index_job = NULL;
 
-	if (is_dir) {
-		IdleLoaderData *data;
-		guint           idle_id;
+	g_signal_emit (list, signals[PROJECT_LOADED], 0);
+}
 
-		data = g_new0 (IdleLoaderData, 1);
-		data->list = g_object_ref (list);
-		data->directory = g_strdup (directory);
-		data->rel_path = g_strdup (rel_path);
-		data->parent_iter = iter;
+static void
+file_list_cancel_index (GiggleFileList *list)
+{
+	GiggleFileListPriv *priv;
 
-		idle_id = gdk_threads_add_idle_full (GDK_PRIORITY_REDRAW + 1,
-						     file_list_populate_dir_idle,
-						     data, NULL);
+	priv = GET_PRIV (list);
 
-		g_hash_table_insert (priv->idle_jobs, data, GUINT_TO_POINTER (idle_id));
+	if (priv->index_job) {
+		giggle_git_cancel_job (priv->git, priv->index_job);
+		g_object_unref (priv->index_job);
+		priv->index_job = NULL;
 	}
 
-	g_free (full_path);
+	if (priv->index) {
+		g_object_unref (priv->index);
+		priv->index = NULL;
+	}
 }
 
 static void
@@ -1191,13 +1688,27 @@ file_list_populate (GiggleFileList *list)
 {
 	GiggleFileListPriv *priv;
 	const gchar        *directory;
+	GtkTreeIter         iter, placeholder;
 
 	priv = GET_PRIV (list);
 	directory = giggle_git_get_project_dir (priv->git);
 
-	if (directory) {
-		file_list_add_element (list, directory, "", NULL, NULL);
-	}
+	if (!directory)
+		return;
+
+	gtk_tree_store_insert_with_values (priv->store, &iter, NULL, 0,
+					   COL_NAME, directory,
+					   COL_REL_PATH, "",
+					   -1);
+
+	gtk_tree_store_append (priv->store, &placeholder, &iter);
+
+	priv->index_job = giggle_git_list_index_new ();
+
+	giggle_git_run_job (priv->git,
+			    priv->index_job,
+			    file_list_index_callback,
+			    list);
 }
 
 static void
@@ -1211,8 +1722,33 @@ file_list_directory_changed (GObject    *object,
 	list = GIGGLE_FILE_LIST (user_data);
 	priv = GET_PRIV (list);
 
-	/* remove old directory idles */
-	g_hash_table_remove_all (priv->idle_jobs);
+	file_list_cancel_index (list);
+
+	if (priv->files_job) {
+		giggle_git_cancel_job (priv->git, priv->files_job);
+		g_object_unref (priv->files_job);
+		priv->files_job = NULL;
+	}
+
+	priv->files_refresh_pending = FALSE;
+
+	if (priv->status_job) {
+		giggle_git_cancel_job (priv->git, priv->status_job);
+		g_object_unref (priv->status_job);
+		priv->status_job = NULL;
+	}
+
+	g_hash_table_remove_all (priv->dirty_paths);
+
+	if (priv->file_status) {
+		g_object_unref (priv->file_status);
+		priv->file_status = NULL;
+	}
+
+	if (priv->highlight) {
+		path_trie_free (priv->highlight);
+		priv->highlight = NULL;
+	}
 
 	file_list_create_store (list);
 	file_list_populate (list);
@@ -1371,10 +1907,9 @@ file_list_cell_pixbuf_func (GtkCellLayout   *layout,
 			    COL_GIT_IGNORE, &git_ignore,
 			    -1);
 
-	if (git_ignore) {
+	if (git_ignore || gtk_tree_model_iter_has_child (tree_model, iter)) {
 		/* it's a folder */
 		icon_name = "folder";
-		g_object_unref (git_ignore);
 	} else {
 		switch (status) {
 		case GIGGLE_GIT_FILE_STATUS_OTHER:
@@ -1396,6 +1931,10 @@ file_list_cell_pixbuf_func (GtkCellLayout   *layout,
 		}
 	}
 
+	if (git_ignore) {
+		g_object_unref (git_ignore);
+	}
+
 	if (icon_name) {
 		pixbuf = gtk_icon_theme_load_icon (priv->icon_theme,
 						   icon_name, 16, 0, NULL);
@@ -1451,15 +1990,17 @@ giggle_file_list_init (GiggleFileList *list)
 
 	priv = GET_PRIV (list);
 
-	priv->idle_jobs = g_hash_table_new_full (g_direct_hash, g_direct_equal,
-						 (GDestroyNotify) file_list_idle_data_free,
-						 (GDestroyNotify) g_source_remove);
-
 	priv->git = giggle_git_get ();
+	priv->dirty_paths = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
 	g_signal_connect (priv->git, "notify::project-dir",
 			  G_CALLBACK (file_list_directory_changed), list);
 	g_signal_connect_swapped (priv->git, "changed",
 				  G_CALLBACK (file_list_files_status_changed), list);
+	g_signal_connect_swapped (priv->git, "index-changed",
+				  G_CALLBACK (file_list_files_status_changed), list);
+	g_signal_connect_swapped (priv->git, "worktree-paths-changed",
+				  G_CALLBACK (file_list_worktree_paths_changed), list);
 
 	priv->icon_theme = gtk_icon_theme_get_default ();
 
@@ -1595,63 +2136,94 @@ giggle_file_list_select (GiggleFileList *list,
 	g_free (priv->selected_path);
 	priv->selected_path = g_strdup (path);
 
-	if (gtk_tree_view_get_model (GTK_TREE_VIEW (list)))
+	if (gtk_tree_view_get_model (GTK_TREE_VIEW (list))) {
+		file_list_materialize_path (list, path);
 		giggle_tree_view_select_row_by_string (GTK_WIDGET (list),
 						       COL_REL_PATH, path);
+	}
 }
 
-static gint
-file_list_compare_prefix (gconstpointer a,
-			  gconstpointer b)
-{
-	return ! g_str_has_prefix (a, b);
-}
-
+/* walks the store along the trie, only subtrees which held or will hold
+ * highlighted rows can change. rows not created yet look at the trie. */
 static void
 file_list_update_highlight (GiggleFileList *file_list,
 			    GtkTreeIter    *parent,
-			    const gchar    *parent_path,
-			    GList          *files)
+			    PathTrie       *trie)
 {
 	GiggleFileListPriv *priv;
 	GtkTreeIter         iter;
 	gboolean            valid;
-	GiggleGitIgnore    *git_ignore;
-	gchar              *rel_path;
-	gboolean            highlight;
+	PathTrie           *child;
+	gchar              *name, *rel_path;
+	gboolean            highlight, old_highlight;
 
 	priv = GET_PRIV (file_list);
 
-	if (parent) {
-		valid = gtk_tree_model_iter_children (GTK_TREE_MODEL (priv->store),
-						      &iter, parent);
-	} else {
-		valid = gtk_tree_model_get_iter_first (GTK_TREE_MODEL (priv->store), &iter);
-	}
+	valid = gtk_tree_model_iter_children (GTK_TREE_MODEL (priv->store),
+					      &iter, parent);
 
 	while (valid) {
 		gtk_tree_model_get (GTK_TREE_MODEL (priv->store), &iter,
+				    COL_NAME, &name,
 				    COL_REL_PATH, &rel_path,
-				    COL_GIT_IGNORE, &git_ignore,
+				    COL_HIGHLIGHT, &old_highlight,
 				    -1);
 
-		highlight = (g_list_find_custom (files, rel_path, (GCompareFunc) file_list_compare_prefix) != NULL);
+		/* skip placeholders */
+		if (rel_path) {
+			child = path_trie_lookup (trie, name);
+			highlight = (child != NULL);
 
-		gtk_tree_store_set (priv->store, &iter,
-				    COL_HIGHLIGHT, highlight,
-				    -1);
+			if (highlight != old_highlight) {
+				gtk_tree_store_set (priv->store, &iter,
+						    COL_HIGHLIGHT, highlight,
+						    -1);
+			}
 
-		if (highlight && git_ignore) {
-			/* it's a directory */
-			file_list_update_highlight (file_list, &iter, rel_path, files);
-			g_object_unref (git_ignore);
+			if (highlight || old_highlight)
+				file_list_update_highlight (file_list, &iter, child);
 		}
 
+		g_free (name);
 		g_free (rel_path);
 		valid = gtk_tree_model_iter_next (GTK_TREE_MODEL (priv->store), &iter);
 	}
 }
 
+static void
+file_list_set_highlight (GiggleFileList *list,
+			 PathTrie       *trie)
+{
+	GiggleFileListPriv *priv;
+	GtkTreeIter         iter;
+	gboolean            highlight, old_highlight;
+
+	priv = GET_PRIV (list);
+
+	if (gtk_tree_model_get_iter_first (GTK_TREE_MODEL (priv->store), &iter)) {
+		gtk_tree_model_get (GTK_TREE_MODEL (priv->store), &iter,
+				    COL_HIGHLIGHT, &old_highlight,
+				    -1);
+
+		/* the project folder contains every changed file */
+		highlight = (trie && trie->children);
+
+		if (highlight != old_highlight) {
+			gtk_tree_store_set (priv->store, &iter,
+					    COL_HIGHLIGHT, highlight,
+					    -1);
+		}
+
+		if (highlight || old_highlight)
+			file_list_update_highlight (list, &iter, trie);
+	}
+
+	if (priv->highlight)
+		path_trie_free (priv->highlight);
+
+	priv->highlight = trie;
+}
+
 static void
 file_list_job_callback (GiggleGit *git,
 			GiggleJob *job,
@@ -1660,7 +2232,8 @@ file_list_job_callback (GiggleGit *git,
 {
 	GiggleFileList     *list;
 	GiggleFileListPriv *priv;
-	GList              *files;
+	PathTrie           *trie;
+	GList              *l;
 
 	list = GIGGLE_FILE_LIST (user_data);
 	priv = GET_PRIV (list);
@@ -1678,8 +2251,13 @@ file_list_job_callback (GiggleGit *git,
 		gtk_dialog_run (GTK_DIALOG (dialog));
 		gtk_widget_destroy (dialog);
 	} else {
-		files = giggle_git_diff_tree_get_files (GIGGLE_GIT_DIFF_TREE (priv->job));
-		file_list_update_highlight (list, NULL, NULL, files);
+		trie = g_slice_new0 (PathTrie);
+		l = giggle_git_diff_tree_get_files (GIGGLE_GIT_DIFF_TREE (priv->job));
+
+		for (; l; l = l->next)
+			path_trie_insert (trie, l->data);
+
+		file_list_set_highlight (list, trie);
 	}
 
 	g_object_unref (priv->job);
@@ -1710,7 +2288,7 @@ giggle_file_list_highlight_revisions (GiggleFileList *list,
 	}
 
 	/* clear highlights */
-	file_list_update_highlight (list, NULL, NULL, NULL);
+	file_list_set_highlight (list, NULL);
 
 	if (from && to) {
 		if (priv->job) {
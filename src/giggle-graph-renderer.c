@@ -20,6 +20,7 @@
 
 #include <config.h>
 #include <math.h>
+#include <string.h>
 #include <gtk/gtk.h>
 
 #include "giggle-graph-renderer.h"
@@ -33,11 +34,20 @@
 #define LINE_WIDTH(font_size) ((font_size / 6) << 1) /* we want the closest even number <= size/3 */
 #define NEXT_COLOR(n_color)   ((n_color % (G_N_ELEMENTS (colors) - 1)) + 1)
 #define INVALID_COLOR         0
+#define BUNDLE_COLOR          0xff
+#define BUNDLE_LANE           G_MAXUSHORT
+
+/* lanes beyond the budget stay visible this many rows around
+ * their commits, forks and merges, in one of the spill slots */
+#define ACTIVITY_ROWS         8
+#define MAX_SPILL_LANES       8
 
 typedef struct GiggleGraphRendererPrivate GiggleGraphRendererPrivate;
 
 struct GiggleGraphRendererPrivate {
 	gint            n_paths;
+	gint            lane_budget;
+	gint            n_spill;
 	GHashTable     *paths_info;
 	GiggleRevision *revision;
 };
@@ -48,11 +58,43 @@ struct GiggleGraphRendererPathState {
 	gushort upper_n_color : 8;
 	gushort lower_n_color : 8;
 	gushort n_path;
+
+	/* where the path is drawn, the lower half of the row
+	 * bends over to where the next row draws it */
+	gushort lane;
+	gushort lower_lane;
+
+	/* only meaningful for the bundle lane */
+	gushort n_bundled : 15;
+	gushort show_count : 1;
 };
 
+/* folding lags validation by ACTIVITY_ROWS rows,
+ * so that it knows about the activity below a row */
+typedef struct {
+	GiggleGraphRendererPrivate   *priv;
+
+	/* validated revisions, the oldest one first */
+	GQueue                        rows;
+	guint                         n_unfolded;
+
+	/* rows with activity of each path within the rows queued */
+	GArray                       *activity;
+
+	/* for counting each path folded into a row's bundle once */
+	GArray                       *stamps;
+	guint                         stamp;
+
+	/* paths drawn in the spill slots by the last folded row */
+	gushort                       spill_paths[MAX_SPILL_LANES];
+
+	GiggleGraphRendererPathState *prev_bundle;
+} GraphFoldState;
+
 enum {
 	PROP_0,
 	PROP_REVISION,
+	PROP_LANE_BUDGET,
 };
 
 static GdkColor colors[] = {
@@ -96,6 +138,9 @@ static GdkColor colors[] = {
 	{ 0x0, 0x2e00, 0x3400, 0x3600 }, /* no name grey */
 };
 
+static GdkColor bundle_color =
+	{ 0x0, 0xba00, 0xbd00, 0xb600 }; /* aluminium */
+
 static GQuark revision_paths_state_quark;
 
 static void giggle_graph_renderer_finalize     (GObject         *object);
@@ -146,6 +191,15 @@ giggle_graph_renderer_class_init (GiggleGraphRendererClass *class)
 				     GIGGLE_TYPE_REVISION,
 				     G_PARAM_READWRITE));
 
+	g_object_class_install_property (
+		object_class,
+		PROP_LANE_BUDGET,
+		g_param_spec_int ("lane-budget",
+				  "Lane budget",
+				  "Number of lanes shown before folding the remaining ones into a bundle, 0 for no limit",
+				  0, G_MAXSHORT, 0,
+				  G_PARAM_READWRITE));
+
 	g_type_class_add_private (object_class,
 				  sizeof (GiggleGraphRendererPrivate));
 
@@ -184,6 +238,9 @@ giggle_graph_renderer_get_property (GObject    *object,
 	case PROP_REVISION:
 		g_value_set_object (value, priv->revision);
 		break;
+	case PROP_LANE_BUDGET:
+		g_value_set_int (value, priv->lane_budget);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
 	}
@@ -204,6 +261,10 @@ giggle_graph_renderer_set_property (GObject      *object,
 		}
 		priv->revision = GIGGLE_REVISION (g_value_dup_object (value));
 		break;
+	case PROP_LANE_BUDGET:
+		/* takes effect on the next giggle_graph_renderer_validate_model() */
+		priv->lane_budget = g_value_get_int (value);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
 	}
@@ -219,7 +280,7 @@ giggle_graph_renderer_get_size (GtkCellRenderer *cell,
 				gint            *height)
 {
 	GiggleGraphRendererPrivate *priv;
-	gint size;
+	gint size, n_lanes;
 
 	priv = GIGGLE_GRAPH_RENDERER (cell)->_priv;
 	size = PANGO_PIXELS (pango_font_description_get_size (widget->style->font_desc));
@@ -229,8 +290,14 @@ giggle_graph_renderer_get_size (GtkCellRenderer *cell,
 	}
 
 	if (width) {
+		n_lanes = priv->n_paths;
+
+		/* the bundle lane needs room for its count */
+		if (priv->lane_budget && n_lanes > priv->lane_budget)
+			n_lanes = priv->lane_budget + priv->n_spill + 3;
+
 		/* the +1 is because we leave half at each side */
-		*width = PATH_SPACE (size) * (priv->n_paths + 1);
+		*width = PATH_SPACE (size) * (n_lanes + 1);
 	}
 
 	if (x_offset) {
@@ -250,12 +317,15 @@ set_source_color (cairo_t         *cr,
 	GdkColor  color;
 	GtkStyle *style;
 
+	if (BUNDLE_COLOR == color_index)
+		color = bundle_color;
+	else
+		color = colors[color_index];
 
-	if (GTK_WIDGET_IS_SENSITIVE (widget)) {
-		gdk_cairo_set_source_color (cr, &colors[color_index]);
+	if (!widget || GTK_WIDGET_IS_SENSITIVE (widget)) {
+		gdk_cairo_set_source_color (cr, &color);
 	} else {
 		style = gtk_widget_get_style (widget);
-		color = colors[color_index];
 
 		color.red   = (color.red   + 7 * style->text[GTK_STATE_INSENSITIVE].red)   / 8;
 		color.green = (color.green + 7 * style->text[GTK_STATE_INSENSITIVE].green) / 8;
@@ -265,43 +335,71 @@ set_source_color (cairo_t         *cr,
 	}
 }
 
+/* the position of a lane, the bundle lane comes after the spill slots */
+static gint
+get_lane_pos (GiggleGraphRendererPrivate *priv,
+	      gint                        lane)
+{
+	if (BUNDLE_LANE == lane)
+		return priv->lane_budget + priv->n_spill + 1;
+
+	return lane;
+}
+
 static void
-giggle_graph_renderer_render (GtkCellRenderer *cell,
-			      GdkWindow       *window,
-			      GtkWidget       *widget,
-			      GdkRectangle    *background_area,
-			      GdkRectangle    *cell_area,
-			      GdkRectangle    *expose_area,
-			      guint            flags)
+render_bundle_count (cairo_t                      *cr,
+		     GtkWidget                    *widget,
+		     GiggleGraphRendererPathState *bundle,
+		     gint                          x,
+		     gint                          y,
+		     gint                          h)
 {
-	GiggleGraphRendererPrivate   *priv;
-	GiggleGraphRendererPathState *path_state;
-	GiggleRevision               *revision;
-	GArray                       *paths_state;
-	GHashTable                   *table;
-	cairo_t                      *cr;
-	gint                          x, y, h;
-	gint                          cur_pos, pos;
-	GList                        *children;
-	gint                          size, i;
+	PangoLayout *layout;
+	gchar       *text;
+	gint         text_height;
 
-	priv = GIGGLE_GRAPH_RENDERER (cell)->_priv;
+	text = g_strdup_printf ("%d", bundle->n_bundled);
 
-	if (!priv->revision) {
-		return;
+	if (widget) {
+		layout = gtk_widget_create_pango_layout (widget, text);
+	} else {
+		layout = pango_cairo_create_layout (cr);
+		pango_layout_set_text (layout, text, -1);
 	}
 
-	cr = gdk_cairo_create (window);
-	x = cell_area->x;
-	y = background_area->y;
-	h = background_area->height;
-	revision = priv->revision;
-	size = PANGO_PIXELS (pango_font_description_get_size (widget->style->font_desc));
+	pango_layout_get_pixel_size (layout, NULL, &text_height);
+
+	set_source_color (cr, widget, BUNDLE_COLOR);
+	cairo_move_to (cr, x, y + (h - text_height) / 2);
+	pango_cairo_show_layout (cr, layout);
+
+	g_object_unref (layout);
+	g_free (text);
+}
+
+static void
+graph_renderer_draw (GiggleGraphRendererPrivate *priv,
+		     cairo_t                    *cr,
+		     GtkWidget                  *widget,
+		     GiggleRevision             *revision,
+		     gint                        size,
+		     gint                        x,
+		     gint                        y,
+		     gint                        h)
+{
+	GiggleGraphRendererPathState *path_state;
+	GiggleGraphRendererPathState *bundle = NULL;
+	GArray                       *paths_state;
+	GHashTable                   *table;
+	gint                          cur_path, cur_pos, pos, lower_pos;
+	GList                        *children;
+	gint                          i;
 
+	/* paths folded into the bundle go by path 0 */
 	table = g_hash_table_new (g_direct_hash, g_direct_equal);
 	paths_state = g_object_get_qdata (G_OBJECT (revision), revision_paths_state_quark);
 	children = giggle_revision_get_children (revision);
-	cur_pos = GPOINTER_TO_INT (g_hash_table_lookup (priv->paths_info, revision));
+	cur_path = GPOINTER_TO_INT (g_hash_table_lookup (priv->paths_info, revision));
 	cairo_set_line_width (cr, LINE_WIDTH (size));
 	cairo_set_line_join (cr, CAIRO_LINE_JOIN_ROUND);
 
@@ -309,13 +407,17 @@ giggle_graph_renderer_render (GtkCellRenderer *cell,
 	for (i = 0; i < paths_state->len; i++) {
 		path_state = & g_array_index (paths_state, GiggleGraphRendererPathState, i);
 		g_hash_table_insert (table, GINT_TO_POINTER ((gint) path_state->n_path), path_state);
-		pos = path_state->n_path;
+		pos = get_lane_pos (priv, path_state->lane);
+		lower_pos = get_lane_pos (priv, path_state->lower_lane);
+
+		if (path_state->n_bundled)
+			bundle = path_state;
 
 		if (path_state->lower_n_color != INVALID_COLOR &&
-		    (pos != cur_pos || giggle_revision_get_parents (revision))) {
+		    (path_state->n_path != cur_path || giggle_revision_get_parents (revision))) {
 			set_source_color (cr, widget, path_state->lower_n_color);
 			cairo_move_to (cr, x + (pos * PATH_SPACE (size)), y + (h / 2));
-			cairo_line_to (cr, x + (pos * PATH_SPACE (size)), y + h);
+			cairo_line_to (cr, x + (lower_pos * PATH_SPACE (size)), y + h);
 			cairo_stroke  (cr);
 		}
 
@@ -327,12 +429,20 @@ giggle_graph_renderer_render (GtkCellRenderer *cell,
 		}
 	}
 
+	path_state = g_hash_table_lookup (table, GINT_TO_POINTER (cur_path));
+	cur_pos = get_lane_pos (priv, path_state ? path_state->lane : BUNDLE_LANE);
+
 	/* paint connections between paths */
 	while (children) {
 		pos = GPOINTER_TO_INT (g_hash_table_lookup (priv->paths_info, children->data));
 		path_state = g_hash_table_lookup (table, GINT_TO_POINTER (pos));
 
-		if (path_state->upper_n_color != INVALID_COLOR) {
+		if (!path_state)
+			path_state = bundle;
+
+		pos = get_lane_pos (priv, path_state->lane);
+
+		if (pos != cur_pos && path_state->upper_n_color != INVALID_COLOR) {
 			set_source_color (cr, widget, path_state->upper_n_color);
 
 			cairo_move_to (cr,
@@ -362,7 +472,11 @@ giggle_graph_renderer_render (GtkCellRenderer *cell,
 	cairo_stroke (cr);
 
 	/* paint internal circle */
-	path_state = g_hash_table_lookup (table, GINT_TO_POINTER (cur_pos));
+	path_state = g_hash_table_lookup (table, GINT_TO_POINTER (cur_path));
+
+	if (!path_state)
+		path_state = bundle;
+
 	set_source_color (cr, widget, path_state->lower_n_color);
 
 	cairo_arc (cr,
@@ -372,16 +486,73 @@ giggle_graph_renderer_render (GtkCellRenderer *cell,
 	cairo_fill (cr);
 	cairo_stroke (cr);
 
-	cairo_destroy (cr);
+	if (bundle && bundle->show_count) {
+		render_bundle_count (cr, widget, bundle,
+				     x + (get_lane_pos (priv, BUNDLE_LANE) * PATH_SPACE (size)) +
+				     DOT_RADIUS (size) + 2,
+				     y, h);
+	}
+
 	g_hash_table_destroy (table);
 }
 
+static void
+giggle_graph_renderer_render (GtkCellRenderer *cell,
+			      GdkWindow       *window,
+			      GtkWidget       *widget,
+			      GdkRectangle    *background_area,
+			      GdkRectangle    *cell_area,
+			      GdkRectangle    *expose_area,
+			      guint            flags)
+{
+	GiggleGraphRendererPrivate *priv;
+	cairo_t                    *cr;
+	gint                        size;
+
+	priv = GIGGLE_GRAPH_RENDERER (cell)->_priv;
+
+	if (!priv->revision) {
+		return;
+	}
+
+	cr = gdk_cairo_create (window);
+	size = PANGO_PIXELS (pango_font_description_get_size (widget->style->font_desc));
+
+	graph_renderer_draw (priv, cr, widget, priv->revision, size,
+			     cell_area->x, background_area->y,
+			     background_area->height);
+
+	cairo_destroy (cr);
+}
+
 GtkCellRenderer *
 giggle_graph_renderer_new (void)
 {
 	return g_object_new (GIGGLE_TYPE_GRAPH_RENDERER, NULL);
 }
 
+void
+giggle_graph_renderer_render_revision (GiggleGraphRenderer *renderer,
+				       cairo_t             *cr,
+				       GiggleRevision      *revision,
+				       gint                 font_size,
+				       gint                 x,
+				       gint                 y,
+				       gint                 height)
+{
+	GiggleGraphRendererPrivate *priv;
+
+	g_return_if_fail (GIGGLE_IS_GRAPH_RENDERER (renderer));
+	g_return_if_fail (GIGGLE_IS_REVISION (revision));
+	g_return_if_fail (NULL != cr);
+
+	priv = renderer->_priv;
+
+	g_return_if_fail (NULL != priv->paths_info);
+
+	graph_renderer_draw (priv, cr, NULL, revision, font_size, x, y, height);
+}
+
 static void
 find_free_path (GHashTable *visible_paths,
 		gint       *n_paths,
@@ -416,8 +587,12 @@ get_initial_status_foreach (gpointer key,
 	n_path = GPOINTER_TO_INT (key);
 
 	path_state.n_path = n_path;
+	path_state.lane = n_path;
+	path_state.lower_lane = n_path;
 	path_state.lower_n_color = n_color;
 	path_state.upper_n_color = n_color;
+	path_state.n_bundled = 0;
+	path_state.show_count = FALSE;
 
 	g_array_append_val (array, path_state);
 }
@@ -436,6 +611,241 @@ get_initial_status (GHashTable *visible_paths)
 	return array;
 }
 
+static void
+fold_add_activity (GraphFoldState *fold,
+		   gint            n_path,
+		   gint            delta)
+{
+	if (n_path <= fold->priv->lane_budget)
+		return;
+
+	if (n_path >= fold->activity->len)
+		g_array_set_size (fold->activity, n_path + 1);
+
+	g_array_index (fold->activity, guint, n_path) += delta;
+}
+
+/* the revision's commit, and the forks and merges to its children */
+static void
+fold_update_activity (GraphFoldState *fold,
+		      GiggleRevision *revision,
+		      gint            delta)
+{
+	GList *children;
+	gint   n_path, child_path;
+
+	n_path = GPOINTER_TO_INT (g_hash_table_lookup (fold->priv->paths_info, revision));
+	fold_add_activity (fold, n_path, delta);
+
+	for (children = giggle_revision_get_children (revision); children; children = children->next) {
+		child_path = GPOINTER_TO_INT (g_hash_table_lookup (fold->priv->paths_info, children->data));
+
+		if (child_path != n_path)
+			fold_add_activity (fold, child_path, delta);
+	}
+}
+
+static gboolean
+fold_is_active (GraphFoldState *fold,
+		gint            n_path)
+{
+	return (n_path < fold->activity->len &&
+		g_array_index (fold->activity, guint, n_path) > 0);
+}
+
+static gint
+find_spill_lane (const gushort *spill_paths,
+		 gint           n_path)
+{
+	gint i;
+
+	for (i = 0; i < MAX_SPILL_LANES; i++) {
+		if (spill_paths[i] == n_path)
+			return i;
+	}
+
+	return -1;
+}
+
+static gushort
+get_spill_lane (GraphFoldState *fold,
+		const gushort  *spill_paths,
+		gint            n_path)
+{
+	gint i;
+
+	i = find_spill_lane (spill_paths, n_path);
+
+	if (i < 0)
+		return BUNDLE_LANE;
+
+	return fold->priv->lane_budget + 1 + i;
+}
+
+/* collapses the state of the idle paths beyond the lane budget into
+ * a single bundle entry, so that rendering a row deals with a bounded
+ * number of entries. Paths with activity nearby get a spill slot. */
+static void
+fold_paths_state (GraphFoldState *fold,
+		  GiggleRevision *revision)
+{
+	GiggleGraphRendererPathState *path_state;
+	GiggleGraphRendererPathState  bundle = { 0, };
+	GArray                       *paths_state;
+	gushort                       spill_paths[MAX_SPILL_LANES] = { 0, };
+	gint                          lane_budget, n_path, lane;
+	guint                         i, j;
+
+	paths_state = g_object_get_qdata (G_OBJECT (revision), revision_paths_state_quark);
+	lane_budget = fold->priv->lane_budget;
+
+	/* active paths keep their spill slot... */
+	for (i = 0; i < paths_state->len; i++) {
+		n_path = g_array_index (paths_state, GiggleGraphRendererPathState, i).n_path;
+		lane = find_spill_lane (fold->spill_paths, n_path);
+
+		if (lane >= 0 && fold_is_active (fold, n_path))
+			spill_paths[lane] = n_path;
+	}
+
+	/* ...or get one which the row below doesn't use */
+	for (i = 0; i < paths_state->len; i++) {
+		n_path = g_array_index (paths_state, GiggleGraphRendererPathState, i).n_path;
+
+		if (n_path <= lane_budget || !fold_is_active (fold, n_path) ||
+		    find_spill_lane (spill_paths, n_path) >= 0)
+			continue;
+
+		for (lane = 0; lane < MAX_SPILL_LANES; lane++) {
+			if (!spill_paths[lane] && !fold->spill_paths[lane]) {
+				spill_paths[lane] = n_path;
+				fold->priv->n_spill = MAX (fold->priv->n_spill, lane + 1);
+				break;
+			}
+		}
+	}
+
+	fold->stamp++;
+	bundle.lane = BUNDLE_LANE;
+	bundle.lower_lane = BUNDLE_LANE;
+
+	for (i = j = 0; i < paths_state->len; i++) {
+		path_state = &g_array_index (paths_state, GiggleGraphRendererPathState, i);
+		n_path = path_state->n_path;
+
+		if (n_path > lane_budget) {
+			path_state->lane = get_spill_lane (fold, spill_paths, n_path);
+			path_state->lower_lane = get_spill_lane (fold, fold->spill_paths, n_path);
+
+			if (BUNDLE_LANE == path_state->lane) {
+				if (n_path >= fold->stamps->len)
+					g_array_set_size (fold->stamps, n_path + 1);
+
+				/* paths forking or merging come twice */
+				if (g_array_index (fold->stamps, guint, n_path) != fold->stamp) {
+					g_array_index (fold->stamps, guint, n_path) = fold->stamp;
+					bundle.n_bundled++;
+				}
+
+				if (path_state->upper_n_color != INVALID_COLOR)
+					path_state->upper_n_color = BUNDLE_COLOR;
+			}
+
+			if (BUNDLE_LANE == path_state->lower_lane &&
+			    path_state->lower_n_color != INVALID_COLOR)
+				path_state->lower_n_color = BUNDLE_COLOR;
+
+			if (BUNDLE_LANE == path_state->lane &&
+			    BUNDLE_LANE == path_state->lower_lane) {
+				if (path_state->lower_n_color != INVALID_COLOR)
+					bundle.lower_n_color = BUNDLE_COLOR;
+				if (path_state->upper_n_color != INVALID_COLOR)
+					bundle.upper_n_color = BUNDLE_COLOR;
+
+				continue;
+			}
+		}
+
+		if (i != j) {
+			g_array_index (paths_state, GiggleGraphRendererPathState, j) = *path_state;
+		}
+
+		j++;
+	}
+
+	g_array_set_size (paths_state, j);
+	memcpy (fold->spill_paths, spill_paths, sizeof (spill_paths));
+
+	/* label the newest row of each run of equally sized bundles */
+	if (fold->prev_bundle && bundle.n_bundled != fold->prev_bundle->n_bundled)
+		fold->prev_bundle->show_count = TRUE;
+
+	fold->prev_bundle = NULL;
+
+	if (bundle.n_bundled) {
+		g_array_append_val (paths_state, bundle);
+		fold->prev_bundle = &g_array_index (paths_state, GiggleGraphRendererPathState, j);
+	}
+}
+
+static void
+fold_init (GraphFoldState             *fold,
+	   GiggleGraphRendererPrivate *priv)
+{
+	memset (fold, 0, sizeof (GraphFoldState));
+
+	fold->priv = priv;
+	fold->activity = g_array_new (FALSE, TRUE, sizeof (guint));
+	fold->stamps = g_array_new (FALSE, TRUE, sizeof (guint));
+	g_queue_init (&fold->rows);
+}
+
+static void
+fold_pop_row (GraphFoldState *fold)
+{
+	fold_update_activity (fold, g_queue_pop_head (&fold->rows), -1);
+}
+
+/* folds the rows which the activity of all rows
+ * within ACTIVITY_ROWS in either direction is known for */
+static void
+fold_push_row (GraphFoldState *fold,
+	       GiggleRevision *revision)
+{
+	g_queue_push_tail (&fold->rows, revision);
+	fold_update_activity (fold, revision, 1);
+	fold->n_unfolded++;
+
+	while (fold->rows.length > 2 * ACTIVITY_ROWS + 1)
+		fold_pop_row (fold);
+
+	if (fold->n_unfolded > ACTIVITY_ROWS) {
+		fold_paths_state (fold, g_queue_peek_nth (&fold->rows,
+							  fold->rows.length - fold->n_unfolded));
+		fold->n_unfolded--;
+	}
+}
+
+static void
+fold_finish (GraphFoldState *fold)
+{
+	while (fold->n_unfolded > 0) {
+		while (fold->rows.length - fold->n_unfolded > ACTIVITY_ROWS)
+			fold_pop_row (fold);
+
+		fold_paths_state (fold, g_queue_peek_nth (&fold->rows,
+							  fold->rows.length - fold->n_unfolded));
+		fold->n_unfolded--;
+	}
+
+	if (fold->prev_bundle)
+		fold->prev_bundle->show_count = TRUE;
+
+	g_queue_clear (&fold->rows);
+	g_array_free (fold->activity, TRUE);
+	g_array_free (fold->stamps, TRUE);
+}
+
 static void
 free_paths_state (GArray *array)
 {
@@ -448,7 +858,7 @@ giggle_graph_renderer_calculate_revision_state (GiggleGraphRenderer *renderer,
 						GHashTable          *visible_paths,
 						gint                *n_color)
 {
-	GiggleGraphRendererPathState  path_state;
+	GiggleGraphRendererPathState  path_state = { 0, };
 	GiggleGraphRendererPrivate   *priv;
 	GiggleRevision               *rev;
 	GArray                       *paths_state;
@@ -492,6 +902,8 @@ giggle_graph_renderer_calculate_revision_state (GiggleGraphRenderer *renderer,
 		}
 
 		path_state.n_path = n_path;
+		path_state.lane = n_path;
+		path_state.lower_lane = n_path;
 		g_hash_table_insert (visible_paths, GINT_TO_POINTER (n_path), GINT_TO_POINTER ((gint) path_state.upper_n_color));
 		g_array_append_val (paths_state, path_state);
 
@@ -523,7 +935,8 @@ giggle_graph_renderer_validate_model (GiggleGraphRenderer *renderer,
 				      GtkTreeModel        *model,
 				      gint                 column)
 {
-	GiggleGraphRendererPrivate *priv;
+	GiggleGraphRendererPrivate   *priv;
+	GraphFoldState               fold;
 	GtkTreeIter                 iter;
 	gint                        n_children;
 	gint                        n_color = 0;
@@ -545,10 +958,14 @@ giggle_graph_renderer_validate_model (GiggleGraphRenderer *renderer,
 	}
 
 	priv->n_paths = 0;
+	priv->n_spill = 0;
 	priv->paths_info = g_hash_table_new (g_direct_hash, g_direct_equal);
 	visible_paths = g_hash_table_new (g_direct_hash, g_direct_equal);
 	n_children = gtk_tree_model_iter_n_children (model, NULL);
 
+	if (priv->lane_budget)
+		fold_init (&fold, priv);
+
 	while (n_children) {
 		/* need to calculate state backwards for proper color asignment */
 		n_children--;
@@ -563,10 +980,18 @@ giggle_graph_renderer_validate_model (GiggleGraphRenderer *renderer,
 				g_hash_table_insert (visible_paths, GINT_TO_POINTER (n_path), GINT_TO_POINTER (n_color));
 			}
 
-			giggle_graph_renderer_calculate_revision_state (renderer, revision, visible_paths, &n_color);
+			giggle_graph_renderer_calculate_revision_state (renderer, revision, visible_paths,
+									&n_color);
+
+			if (priv->lane_budget)
+				fold_push_row (&fold, revision);
+
 			g_object_unref (revision);
 		}
 	}
 
+	if (priv->lane_budget)
+		fold_finish (&fold);
+
 	g_hash_table_destroy (visible_paths);
 }
@@ -24,6 +24,7 @@
 G_BEGIN_DECLS
 
 #include <gtk/gtk.h>
+#include "libgiggle/giggle-revision.h"
 
 #define GIGGLE_TYPE_GRAPH_RENDERER                 (giggle_graph_renderer_get_type ())
 #define GIGGLE_GRAPH_RENDERER(obj)                 (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIGGLE_TYPE_GRAPH_RENDERER, GiggleGraphRenderer))
@@ -53,6 +54,14 @@ void             giggle_graph_renderer_validate_model (GiggleGraphRenderer *rend
 						       GtkTreeModel        *model,
 						       gint                 column);
 
+void             giggle_graph_renderer_render_revision (GiggleGraphRenderer *renderer,
+							cairo_t             *cr,
+							GiggleRevision      *revision,
+							gint                 font_size,
+							gint                 x,
+							gint                 y,
+							gint                 height);
+
 G_END_DECLS
 
 #endif /* __GIGGLE_GRAPH_RENDERER_H__ */
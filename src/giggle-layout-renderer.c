@@ -0,0 +1,178 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+#include "giggle-layout-renderer.h"
+
+#define GET_PRIV(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIGGLE_TYPE_LAYOUT_RENDERER, GiggleLayoutRendererPriv))
+
+enum {
+	PROP_NONE,
+	PROP_LAYOUT
+};
+
+typedef struct {
+	PangoLayout *layout;
+} GiggleLayoutRendererPriv;
+
+G_DEFINE_TYPE (GiggleLayoutRenderer, giggle_layout_renderer, GTK_TYPE_CELL_RENDERER_TEXT);
+
+static void
+layout_renderer_finalize (GObject *object)
+{
+	GiggleLayoutRendererPriv *priv = GET_PRIV (object);
+
+	if (priv->layout)
+		g_object_unref (priv->layout);
+
+	G_OBJECT_CLASS (giggle_layout_renderer_parent_class)->finalize (object);
+}
+
+static void
+layout_renderer_get_property (GObject    *object,
+			      guint       param_id,
+			      GValue     *value,
+			      GParamSpec *pspec)
+{
+	GiggleLayoutRendererPriv *priv = GET_PRIV (object);
+
+	switch (param_id) {
+	case PROP_LAYOUT:
+		g_value_set_object (value, priv->layout);
+		break;
+
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
+		break;
+	}
+}
+
+static void
+layout_renderer_set_property (GObject      *object,
+			      guint         param_id,
+			      const GValue *value,
+			      GParamSpec   *pspec)
+{
+	GiggleLayoutRendererPriv *priv = GET_PRIV (object);
+
+	switch (param_id) {
+	case PROP_LAYOUT:
+		if (priv->layout)
+			g_object_unref (priv->layout);
+
+		priv->layout = g_value_dup_object (value);
+		break;
+
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
+		break;
+	}
+}
+
+static GtkStateType
+layout_renderer_get_state (GtkWidget            *widget,
+			   GtkCellRendererState  flags)
+{
+	if (flags & GTK_CELL_RENDERER_SELECTED)
+		return GTK_WIDGET_HAS_FOCUS (widget) ? GTK_STATE_SELECTED : GTK_STATE_ACTIVE;
+
+	if ((flags & GTK_CELL_RENDERER_PRELIT) &&
+	    GTK_WIDGET_STATE (widget) == GTK_STATE_PRELIGHT)
+		return GTK_STATE_PRELIGHT;
+
+	if (GTK_WIDGET_STATE (widget) == GTK_STATE_INSENSITIVE)
+		return GTK_STATE_INSENSITIVE;
+
+	return GTK_STATE_NORMAL;
+}
+
+static void
+layout_renderer_render (GtkCellRenderer      *cell,
+			GdkDrawable          *window,
+			GtkWidget            *widget,
+			GdkRectangle         *background_area,
+			GdkRectangle         *cell_area,
+			GdkRectangle         *expose_area,
+			GtkCellRendererState  flags)
+{
+	GiggleLayoutRendererPriv *priv = GET_PRIV (cell);
+	PangoRectangle            rect;
+	int                       width, y_offset;
+
+	if (!priv->layout) {
+		GTK_CELL_RENDERER_CLASS (giggle_layout_renderer_parent_class)->render
+			(cell, window, widget, background_area, cell_area, expose_area, flags);
+		return;
+	}
+
+	/* the layout is reused for the next expose, so it only gets
+	 * shaped again when the width of the cell really changed */
+	width = (cell_area->width - 2 * cell->xpad) * PANGO_SCALE;
+
+	if (PANGO_ELLIPSIZE_NONE != pango_layout_get_ellipsize (priv->layout) &&
+	    width != pango_layout_get_width (priv->layout))
+		pango_layout_set_width (priv->layout, width);
+
+	pango_layout_get_pixel_extents (priv->layout, NULL, &rect);
+	y_offset = MAX (0, (cell_area->height - 2 * cell->ypad - rect.height) / 2);
+
+	gtk_paint_layout (widget->style, window,
+			  layout_renderer_get_state (widget, flags),
+			  TRUE, expose_area, widget, "cellrenderertext",
+			  cell_area->x + cell->xpad,
+			  cell_area->y + cell->ypad + y_offset,
+			  priv->layout);
+}
+
+static void
+giggle_layout_renderer_class_init (GiggleLayoutRendererClass *class)
+{
+	GObjectClass         *object_class;
+	GtkCellRendererClass *renderer_class;
+
+	object_class   = G_OBJECT_CLASS (class);
+	renderer_class = GTK_CELL_RENDERER_CLASS (class);
+
+	object_class->finalize     = layout_renderer_finalize;
+	object_class->set_property = layout_renderer_set_property;
+	object_class->get_property = layout_renderer_get_property;
+
+	renderer_class->render = layout_renderer_render;
+
+	g_object_class_install_property
+		(object_class, PROP_LAYOUT,
+		 g_param_spec_object ("layout", "Layout",
+				      "Shaped layout to draw instead of the text property",
+				      PANGO_TYPE_LAYOUT,
+				      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+	g_type_class_add_private (class, sizeof (GiggleLayoutRendererPriv));
+}
+
+static void
+giggle_layout_renderer_init (GiggleLayoutRenderer *renderer)
+{
+}
+
+GtkCellRenderer *
+giggle_layout_renderer_new (void)
+{
+	return g_object_new (GIGGLE_TYPE_LAYOUT_RENDERER, NULL);
+}
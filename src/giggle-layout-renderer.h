@@ -0,0 +1,51 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GIGGLE_LAYOUT_RENDERER_H__
+#define __GIGGLE_LAYOUT_RENDERER_H__
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define GIGGLE_TYPE_LAYOUT_RENDERER            (giggle_layout_renderer_get_type ())
+#define GIGGLE_LAYOUT_RENDERER(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIGGLE_TYPE_LAYOUT_RENDERER, GiggleLayoutRenderer))
+#define GIGGLE_LAYOUT_RENDERER_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), GIGGLE_TYPE_LAYOUT_RENDERER, GiggleLayoutRendererClass))
+#define GIGGLE_IS_LAYOUT_RENDERER(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GIGGLE_TYPE_LAYOUT_RENDERER))
+#define GIGGLE_IS_LAYOUT_RENDERER_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GIGGLE_TYPE_LAYOUT_RENDERER))
+#define GIGGLE_LAYOUT_RENDERER_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GIGGLE_TYPE_LAYOUT_RENDERER, GiggleLayoutRendererClass))
+
+typedef struct GiggleLayoutRenderer      GiggleLayoutRenderer;
+typedef struct GiggleLayoutRendererClass GiggleLayoutRendererClass;
+
+struct GiggleLayoutRenderer {
+	GtkCellRendererText parent_instance;
+};
+
+struct GiggleLayoutRendererClass {
+	GtkCellRendererTextClass parent_class;
+};
+
+GType             giggle_layout_renderer_get_type (void) G_GNUC_CONST;
+GtkCellRenderer * giggle_layout_renderer_new      (void);
+
+G_END_DECLS
+
+#endif /* __GIGGLE_LAYOUT_RENDERER_H__ */
@@ -24,6 +24,8 @@
 #include "giggle-diff-window.h"
 #include "giggle-graph-renderer.h"
 #include "giggle-input-dialog.h"
+#include "giggle-layout-renderer.h"
+#include "giggle-revision-model.h"
 
 #include <libgiggle/giggle-branch.h>
 #include <libgiggle/giggle-clipboard.h>
@@ -36,8 +38,10 @@
 #include <libgiggle-git/giggle-git-add-ref.h>
 #include <libgiggle-git/giggle-git-delete-ref.h>
 #include <libgiggle-git/giggle-git-diff.h>
-#include <libgiggle-git/giggle-git-log.h>
+#include <libgiggle-git/giggle-git-pickaxe.h>
+#include <libgiggle-git/giggle-git-search.h>
 #include <libgiggle-git/giggle-git.h>
+#include <libgiggle-git/giggle-search-index.h>
 
 #include <glib/gi18n.h>
 #include <string.h>
@@ -49,46 +53,134 @@
 #define CREATE_TAG_UI_PATH    "/ui/PopupMenu/CreateTag"
 #define CREATE_PATCH_UI_PATH  "/ui/PopupMenu/CreatePatch"
 
+/* lanes shown in the graph before the remaining ones get bundled */
+#define GRAPH_LANE_BUDGET     24
+
+/* shaped layouts kept per text column before the oldest get evicted */
+#define LAYOUT_CACHE_SIZE     4096
+
+/* the search index gets persisted next to the repository's other caches */
+#define SEARCH_INDEX_FILENAME "giggle-search.index"
+
+/* more new matches than this refilter the whole list at once */
+#define REFILTER_THRESHOLD    256
+
 typedef struct GiggleRevListViewPriv GiggleRevListViewPriv;
 
+enum {
+	DECORATION_BRANCH   = 1 << 0,
+	DECORATION_REMOTE   = 1 << 1,
+	DECORATION_TAG      = 1 << 2,
+	N_DECORATION_BADGES = 1 << 3
+};
+
+/* everything needed to show the refs of a revision, built once
+ * when the refs get known instead of on each render or hover */
+typedef struct {
+	guint  kinds : 3;
+	char  *markup;
+} RevisionDecoration;
+
+/* shaped layouts by key, evicting the least recently used ones.
+ * entries from an older generation get shaped again on lookup. */
+typedef struct {
+	GHashTable *entries;
+	GQueue      lru;
+	guint       generation;
+} LayoutCache;
+
+typedef struct {
+	LayoutCache *cache;
+	char        *key;
+	PangoLayout *layout;
+	guint        generation;
+	GList       *link;
+} LayoutCacheEntry;
+
+/* loads or builds the search index of a repository in a worker
+ * thread. tasks are shared by all lists showing the same history,
+ * and a finished one is kept for lists coming later. */
+typedef struct {
+	GiggleSearchIndex *index;
+	GCancellable      *cancellable;
+	gchar             *directory;
+	gchar             *filename;
+	guint32            stamp;
+	gboolean           success;
+	gboolean           done;
+	GList             *lists;
+} IndexTask;
+
 struct GiggleRevListViewPriv {
 	GiggleGit         *git;
 	GiggleJob         *job;
 
+	/* the revisions, and the filter showing only search
+	 * matches which gets shown instead in filter mode */
+	GtkTreeModel      *model;
+	GtkTreeModel      *filter;
+	GArray            *filter_rows;
+	guint              refilter_id;
+
 	GtkTreeViewColumn *emblem_column;
+	GtkCellRenderer   *emblem_renderer;
 	int                emblem_size;
 
 	GdkPixbuf         *emblem_branch;
 	GdkPixbuf         *emblem_remote;
 	GdkPixbuf         *emblem_tag;
 
+	/* ref decorations of revisions, and the badge image for
+	 * each combination of decoration kinds */
+	GHashTable        *decorations;
+	GdkPixbuf         *badges[N_DECORATION_BADGES];
+
 	GtkTreeViewColumn *graph_column;
 	GtkCellRenderer   *graph_renderer;
 
+	/* background of rows matching the search */
+	GdkColor           match_color;
+
+	/* shaped layouts of the visible text, keyed by revision sha
+	 * and author name. they depend on the widget style and, when
+	 * ellipsized, on the column width. */
+	LayoutCache       *log_layouts;
+	LayoutCache       *author_layouts;
+
 	GtkUIManager      *ui_manager;
 	GtkWidget         *popup;
 
 	GtkActionGroup    *refs_action_group;
 	guint              refs_merge_id;
 
-	/* used for search inside diffs */
-	GMainLoop         *main_loop;
+	/* history search: the index or a single streaming process for
+	 * messages, the pickaxe for changes, matches as bitset over the
+	 * rows, and the row of a jump waiting for more matches. files
+	 * is the path limit of the shown history, if any. */
+	gchar                **files;
+	GiggleSearchIndex     *search_index;
+	IndexTask             *index_task;
+	gchar                 *search_term;
+	GiggleGitSearch       *search;
+	GiggleGitPickaxe      *pickaxe;
+	GError                *search_error;
+	GHashTable            *sha_index;
+	guint32               *search_matches;
+	guint                  n_search_rows;
+	guint                  n_search_matches;
+	int                    search_origin;
+	GiggleSearchDirection  search_direction;
 
 	/* revision caching */
 	GiggleRevision    *first_revision;
 	GiggleRevision    *last_revision;
 
 	guint              show_graph : 1;
-	guint              cancelled : 1;
-};
-
-typedef struct RevisionSearchData RevisionSearchData;
-
-struct RevisionSearchData {
-	GMainLoop          *main_loop;
-	const gchar        *search_term;
-	gboolean            match;
-	GiggleRevListView *list;
+	guint              graph_valid : 1;
+	guint              search_full : 1;
+	guint              search_pending : 1;
+	guint              search_redraw : 1;
+	guint              filter_mode : 1;
 };
 
 enum {
@@ -112,6 +204,9 @@ static guint signals [LAST_SIGNAL] = { 0 };
 static void giggle_rev_list_view_searchable_init  (GiggleSearchableIface *iface);
 static void giggle_rev_list_view_clipboard_init   (GiggleClipboardIface  *iface);
 
+static void rev_list_view_reset_search            (GiggleRevListView     *list);
+static void rev_list_view_cancel_index            (GiggleRevListView     *list);
+
 G_DEFINE_TYPE_WITH_CODE (GiggleRevListView, giggle_rev_list_view, GTK_TYPE_TREE_VIEW,
 			 G_IMPLEMENT_INTERFACE (GIGGLE_TYPE_SEARCHABLE,
 						giggle_rev_list_view_searchable_init)
@@ -121,6 +216,15 @@ G_DEFINE_TYPE_WITH_CODE (GiggleRevListView, giggle_rev_list_view, GTK_TYPE_TREE_
 static void
 rev_list_view_reset_emblems (GiggleRevListViewPriv *priv)
 {
+	int i;
+
+	for (i = 0; i < N_DECORATION_BADGES; ++i) {
+		if (priv->badges[i]) {
+			g_object_unref (priv->badges[i]);
+			priv->badges[i] = NULL;
+		}
+	}
+
 	if (priv->emblem_branch) {
 		g_object_unref (priv->emblem_branch);
 		priv->emblem_branch = NULL;
@@ -137,6 +241,194 @@ rev_list_view_reset_emblems (GiggleRevListViewPriv *priv)
 	}
 }
 
+/* Returns the revision of a row without taking a reference. The model
+ * keeps its rows alive while they are drawn, and the revision model
+ * even lets us skip the GValue round trip. */
+static GiggleRevision *
+rev_list_view_peek_revision (GtkTreeModel *model,
+			     GtkTreeIter  *iter)
+{
+	GiggleRevision *revision;
+	GtkTreeIter     child_iter;
+
+	if (GTK_IS_TREE_MODEL_FILTER (model)) {
+		gtk_tree_model_filter_convert_iter_to_child_iter
+			(GTK_TREE_MODEL_FILTER (model), &child_iter, iter);
+
+		model = gtk_tree_model_filter_get_model (GTK_TREE_MODEL_FILTER (model));
+		iter = &child_iter;
+	}
+
+	if (GIGGLE_IS_REVISION_MODEL (model))
+		return giggle_revision_model_peek (GIGGLE_REVISION_MODEL (model), iter);
+
+	gtk_tree_model_get (model, iter, COL_OBJECT, &revision, -1);
+
+	if (revision)
+		g_object_unref (revision);
+
+	return revision;
+}
+
+static void
+revision_decoration_free (RevisionDecoration *decoration)
+{
+	g_free (decoration->markup);
+	g_slice_free (RevisionDecoration, decoration);
+}
+
+static void
+layout_cache_entry_free (LayoutCacheEntry *entry)
+{
+	g_queue_delete_link (&entry->cache->lru, entry->link);
+	g_object_unref (entry->layout);
+	g_free (entry->key);
+	g_slice_free (LayoutCacheEntry, entry);
+}
+
+static LayoutCache *
+layout_cache_new (void)
+{
+	LayoutCache *cache;
+
+	cache = g_slice_new0 (LayoutCache);
+	cache->entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+						(GDestroyNotify) layout_cache_entry_free);
+
+	return cache;
+}
+
+static void
+layout_cache_free (LayoutCache *cache)
+{
+	g_hash_table_destroy (cache->entries);
+	g_slice_free (LayoutCache, cache);
+}
+
+static void
+layout_cache_invalidate (LayoutCache *cache)
+{
+	cache->generation += 1;
+}
+
+static void
+revision_tooltip_add_refs (GString  *str,
+			   gchar    *label,
+			   GList    *list)
+{
+	GiggleRef *ref;
+
+	if (str->len > 0 && list)
+		g_string_append (str, "\n");
+
+	while (list) {
+		ref = list->data;
+		list = list->next;
+
+		g_string_append_printf (str, "<b>%s</b>: %s", label,
+					giggle_ref_get_name (ref));
+
+		if (list)
+			g_string_append (str, "\n");
+	}
+}
+
+/* decorations get built when their row is drawn first, as only
+ * a few revisions have refs, and looking at every one of them
+ * would make attaching a model take time linear in its rows */
+static RevisionDecoration *
+rev_list_view_get_decoration (GiggleRevListViewPriv *priv,
+			      GiggleRevision        *revision)
+{
+	RevisionDecoration *decoration;
+	GList              *branches, *remotes, *tags;
+	GString            *markup;
+
+	decoration = g_hash_table_lookup (priv->decorations, revision);
+
+	if (decoration)
+		return decoration;
+
+	branches = giggle_revision_get_branch_heads (revision);
+	remotes  = giggle_revision_get_remotes (revision);
+	tags     = giggle_revision_get_tags (revision);
+
+	if (!branches && !remotes && !tags)
+		return NULL;
+
+	decoration = g_slice_new0 (RevisionDecoration);
+
+	if (branches)
+		decoration->kinds |= DECORATION_BRANCH;
+	if (remotes)
+		decoration->kinds |= DECORATION_REMOTE;
+	if (tags)
+		decoration->kinds |= DECORATION_TAG;
+
+	markup = g_string_new (NULL);
+	revision_tooltip_add_refs (markup, _("Branch"), branches);
+	revision_tooltip_add_refs (markup, _("Tag"), tags);
+	revision_tooltip_add_refs (markup, _("Remote"), remotes);
+	decoration->markup = g_string_free (markup, FALSE);
+
+	g_hash_table_insert (priv->decorations, revision, decoration);
+
+	return decoration;
+}
+
+static void
+rev_list_view_row_changed_cb (GtkTreeModel *model,
+			      GtkTreePath  *path,
+			      GtkTreeIter  *iter,
+			      gpointer      data)
+{
+	GiggleRevision *revision;
+
+	/* rows get changed when refs got attached to their revision,
+	 * the decoration gets built again when the row is drawn */
+	revision = rev_list_view_peek_revision (model, iter);
+
+	if (revision)
+		g_hash_table_remove (GET_PRIV (data)->decorations, revision);
+}
+
+static GdkPixbuf *
+rev_list_view_get_badge (GiggleRevListViewPriv *priv,
+			 guint                  kinds)
+{
+	GdkPixbuf *emblems[3];
+	GdkPixbuf *badge;
+	int        n_emblems = 0, i;
+
+	if (priv->badges[kinds])
+		return priv->badges[kinds];
+
+	if (kinds & DECORATION_BRANCH)
+		emblems[n_emblems++] = priv->emblem_branch;
+	if (kinds & DECORATION_REMOTE)
+		emblems[n_emblems++] = priv->emblem_remote;
+	if (kinds & DECORATION_TAG)
+		emblems[n_emblems++] = priv->emblem_tag;
+
+	badge = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8,
+				priv->emblem_size * n_emblems,
+				priv->emblem_size);
+	gdk_pixbuf_fill (badge, 0x00000000);
+
+	for (i = 0; i < n_emblems; ++i) {
+		if (!emblems[i])
+			continue;
+
+		gdk_pixbuf_copy_area (emblems[i], 0, 0,
+				      priv->emblem_size, priv->emblem_size,
+				      badge, i * priv->emblem_size, 0);
+	}
+
+	priv->badges[kinds] = badge;
+
+	return badge;
+}
+
 static void
 rev_list_view_dispose (GObject *object)
 {
@@ -146,24 +438,52 @@ rev_list_view_dispose (GObject *object)
 
 	rev_list_view_reset_emblems (priv);
 
+	if (priv->decorations) {
+		g_hash_table_destroy (priv->decorations);
+		priv->decorations = NULL;
+	}
+
+	if (priv->log_layouts) {
+		layout_cache_free (priv->log_layouts);
+		priv->log_layouts = NULL;
+	}
+
+	if (priv->author_layouts) {
+		layout_cache_free (priv->author_layouts);
+		priv->author_layouts = NULL;
+	}
+
 	if (priv->job) {
 		giggle_git_cancel_job (priv->git, priv->job);
 		g_object_unref (priv->job);
 		priv->job = NULL;
 	}
 
+	rev_list_view_cancel_index (GIGGLE_REV_LIST_VIEW (object));
+
+	if (priv->refilter_id) {
+		g_source_remove (priv->refilter_id);
+		priv->refilter_id = 0;
+	}
+
+	if (priv->filter) {
+		g_object_unref (priv->filter);
+		priv->filter = NULL;
+	}
+
+	if (priv->model) {
+		g_object_unref (priv->model);
+		priv->model = NULL;
+	}
+
 	if (priv->git) {
+		rev_list_view_reset_search (GIGGLE_REV_LIST_VIEW (object));
 		g_object_unref (priv->git);
 		priv->git = NULL;
 	}
 
-	if (priv->main_loop) {
-		if (g_main_loop_is_running (priv->main_loop))
-			g_main_loop_quit (priv->main_loop);
-
-		g_main_loop_unref (priv->main_loop);
-		priv->main_loop = NULL;
-	}
+	g_strfreev (priv->files);
+	priv->files = NULL;
 
 	G_OBJECT_CLASS (giggle_rev_list_view_parent_class)->dispose (object);
 }
@@ -458,28 +778,6 @@ rev_list_view_button_press (GtkWidget      *widget,
 	return TRUE;
 }
 
-static void
-revision_tooltip_add_refs (GString  *str,
-			   gchar    *label,
-			   GList    *list)
-{
-	GiggleRef *ref;
-
-	if (str->len > 0 && list)
-		g_string_append (str, "\n");
-
-	while (list) {
-		ref = list->data;
-		list = list->next;
-
-		g_string_append_printf (str, "<b>%s</b>: %s", label,
-					giggle_ref_get_name (ref));
-
-		if (list)
-			g_string_append (str, "\n");
-	}
-}
-
 static gboolean
 rev_list_view_query_tooltip (GtkWidget  *widget,
                              gint        x,
@@ -489,14 +787,13 @@ rev_list_view_query_tooltip (GtkWidget  *widget,
 {
 	GiggleRevListViewPriv *priv = GET_PRIV (widget);
 	int                    bin_x, bin_y;
+	RevisionDecoration    *decoration = NULL;
 	GiggleRevision        *revision = NULL;
 	GtkTreePath           *path = NULL;
 	GtkTreeViewColumn     *column;
 	GtkTreeIter            iter;
 	GtkTreeModel          *model;
 	GdkRectangle           cell_area;
-	GString               *markup;
-	GList                 *revs;
 
 	gtk_tree_view_convert_widget_to_bin_window_coords
 		(GTK_TREE_VIEW (widget), x, y, &bin_x, &bin_y);
@@ -512,50 +809,66 @@ rev_list_view_query_tooltip (GtkWidget  *widget,
 	model = gtk_tree_view_get_model (GTK_TREE_VIEW (widget));
 
 	if (gtk_tree_model_get_iter (model, &iter, path))
-		gtk_tree_model_get (model, &iter, COL_OBJECT, &revision, -1);
+		revision = rev_list_view_peek_revision (model, &iter);
+	if (revision)
+		decoration = rev_list_view_get_decoration (priv, revision);
 
-	if (!revision)
+	if (!decoration)
 		goto finish;
 
-	markup = g_string_new (NULL);
-
-	revs = giggle_revision_get_branch_heads (revision);
-	revision_tooltip_add_refs (markup, _("Branch"), revs);
-
-	revs = giggle_revision_get_tags (revision);
-	revision_tooltip_add_refs (markup, _("Tag"), revs);
+	gtk_tree_view_get_cell_area (GTK_TREE_VIEW (widget), path, column, &cell_area);
 
-	revs = giggle_revision_get_remotes (revision);
-	revision_tooltip_add_refs (markup, _("Remote"), revs);
+	gtk_tree_view_convert_bin_window_to_widget_coords
+		(GTK_TREE_VIEW (widget), cell_area.x, cell_area.y,
+		 &cell_area.x, &cell_area.y);
 
-	if (markup->len > 0) {
-		gtk_tree_view_get_cell_area (GTK_TREE_VIEW (widget), path, column, &cell_area);
-
-		gtk_tree_view_convert_bin_window_to_widget_coords
-			(GTK_TREE_VIEW (widget), cell_area.x, cell_area.y,
-			 &cell_area.x, &cell_area.y);
-
-		gtk_tooltip_set_tip_area (tooltip, &cell_area);
-		gtk_tooltip_set_markup (tooltip, markup->str);
-	} else {
-		g_object_unref (revision);
-		revision = NULL;
-	}
-
-	g_string_free (markup, TRUE);
+	gtk_tooltip_set_tip_area (tooltip, &cell_area);
+	gtk_tooltip_set_markup (tooltip, decoration->markup);
 
 finish:
 	gtk_tree_path_free (path);
 
-	if (revision) {
-		g_object_unref (revision);
+	if (decoration)
 		return TRUE;
-	}
 
 	return GTK_WIDGET_CLASS (giggle_rev_list_view_parent_class)->
 		query_tooltip (widget, x, y, keyboard_mode, tooltip);
 }
 
+/* All rows have the same height, which only depends on the font and
+ * the emblem size. Give every non-text cell that height, so that fixed
+ * height mode gets it from the first row without measuring anything. */
+static void
+rev_list_view_update_row_height (GtkWidget *widget)
+{
+	GiggleRevListViewPriv *priv = GET_PRIV (widget);
+	PangoFontMetrics      *metrics;
+	int                    height;
+
+	metrics = pango_context_get_metrics (gtk_widget_get_pango_context (widget),
+					     widget->style->font_desc,
+					     pango_context_get_language (gtk_widget_get_pango_context (widget)));
+
+	height = PANGO_PIXELS (pango_font_metrics_get_ascent (metrics) +
+			       pango_font_metrics_get_descent (metrics));
+	height = MAX (height, priv->emblem_size);
+	height += 2 * priv->emblem_renderer->ypad;
+
+	pango_font_metrics_unref (metrics);
+
+	gtk_cell_renderer_set_fixed_size (priv->emblem_renderer, -1, height);
+	gtk_cell_renderer_set_fixed_size (priv->graph_renderer, -1, height);
+}
+
+static void
+rev_list_view_flush_layouts (GiggleRevListViewPriv *priv)
+{
+	if (priv->log_layouts)
+		layout_cache_invalidate (priv->log_layouts);
+	if (priv->author_layouts)
+		layout_cache_invalidate (priv->author_layouts);
+}
+
 static void
 rev_list_view_style_set (GtkWidget *widget,
 			 GtkStyle  *prev_style)
@@ -591,6 +904,18 @@ rev_list_view_style_set (GtkWidget *widget,
 					    priv->emblem_size * 3 +
 					    2 * widget->style->xthickness);
 
+	rev_list_view_update_row_height (widget);
+	rev_list_view_flush_layouts (priv);
+
+	/* halfway to the selection, so that matches stand out on any
+	 * theme without looking selected */
+	priv->match_color.red   = (widget->style->base[GTK_STATE_NORMAL].red +
+				   widget->style->base[GTK_STATE_SELECTED].red) / 2;
+	priv->match_color.green = (widget->style->base[GTK_STATE_NORMAL].green +
+				   widget->style->base[GTK_STATE_SELECTED].green) / 2;
+	priv->match_color.blue  = (widget->style->base[GTK_STATE_NORMAL].blue +
+				   widget->style->base[GTK_STATE_SELECTED].blue) / 2;
+
 	GTK_WIDGET_CLASS (giggle_rev_list_view_parent_class)->style_set (widget, prev_style);
 }
 
@@ -670,302 +995,894 @@ giggle_rev_list_view_class_init (GiggleRevListViewClass *class)
 			      G_TYPE_NONE,
 			      1, GIGGLE_TYPE_REVISION);
 
-	g_type_class_add_private (object_class, sizeof (GiggleRevListViewPriv));
+	g_type_class_add_private (object_class, sizeof (GiggleRevListViewPriv));
+}
+
+#define MATCH_WORD(row)   ((row) / 32)
+#define MATCH_BIT(row)    (1u << ((row) % 32))
+
+/* checking a row is O(1) for the revision model, which matters for
+ * the filter calling this for each row */
+static gboolean
+rev_list_view_row_matches (GiggleRevListViewPriv *priv,
+			   GtkTreeModel          *model,
+			   GtkTreeIter           *iter)
+{
+	GtkTreeIter  child_iter;
+	GtkTreePath *path;
+	int          row;
+
+	if (!priv->n_search_matches)
+		return FALSE;
+
+	if (GTK_IS_TREE_MODEL_FILTER (model)) {
+		gtk_tree_model_filter_convert_iter_to_child_iter
+			(GTK_TREE_MODEL_FILTER (model), &child_iter, iter);
+
+		model = gtk_tree_model_filter_get_model (GTK_TREE_MODEL_FILTER (model));
+		iter = &child_iter;
+	}
+
+	if (GIGGLE_IS_REVISION_MODEL (model)) {
+		row = giggle_revision_model_get_index (GIGGLE_REVISION_MODEL (model), iter);
+	} else {
+		path = gtk_tree_model_get_path (model, iter);
+		row = gtk_tree_path_get_indices (path)[0];
+		gtk_tree_path_free (path);
+	}
+
+	return row < (int) priv->n_search_rows &&
+	       (priv->search_matches[MATCH_WORD (row)] & MATCH_BIT (row));
+}
+
+static gboolean
+rev_list_view_filter_visible_func (GtkTreeModel *model,
+				   GtkTreeIter  *iter,
+				   gpointer      data)
+{
+	GiggleRevListViewPriv *priv = GET_PRIV (data);
+
+	/* everything is shown until a search starts */
+	if (!priv->search_matches)
+		return TRUE;
+
+	return rev_list_view_row_matches (priv, model, iter);
+}
+
+static void
+rev_list_view_refilter (GiggleRevListViewPriv *priv)
+{
+	if (priv->refilter_id) {
+		g_source_remove (priv->refilter_id);
+		priv->refilter_id = 0;
+	}
+
+	if (priv->filter) {
+		g_array_set_size (priv->filter_rows, 0);
+		gtk_tree_model_filter_refilter (GTK_TREE_MODEL_FILTER (priv->filter));
+	}
+}
+
+static gboolean
+rev_list_view_refilter_idle_cb (gpointer data)
+{
+	GiggleRevListViewPriv *priv = GET_PRIV (data);
+
+	priv->refilter_id = 0;
+	rev_list_view_refilter (priv);
+
+	return FALSE;
+}
+
+/* the search gets reset from within model signals, which is no good
+ * time for the filter to look at the model again */
+static void
+rev_list_view_queue_refilter (GiggleRevListView *list)
+{
+	GiggleRevListViewPriv *priv = GET_PRIV (list);
+
+	if (priv->filter && !priv->refilter_id)
+		priv->refilter_id = g_idle_add (rev_list_view_refilter_idle_cb, list);
+}
+
+/* new matches become visible by their rows changing, unless
+ * there are so many that a refilter is cheaper */
+static void
+rev_list_view_flush_filter (GiggleRevListViewPriv *priv)
+{
+	GtkTreePath *path;
+	GtkTreeIter  iter;
+	guint        i;
+	int          row;
+
+	if (!priv->filter || !priv->filter_rows->len)
+		return;
+
+	if (priv->filter_rows->len > REFILTER_THRESHOLD) {
+		rev_list_view_refilter (priv);
+		return;
+	}
+
+	for (i = 0; i < priv->filter_rows->len; ++i) {
+		row = g_array_index (priv->filter_rows, int, i);
+
+		if (!gtk_tree_model_iter_nth_child (priv->model, &iter, NULL, row))
+			continue;
+
+		path = gtk_tree_path_new_from_indices (row, -1);
+		gtk_tree_model_row_changed (priv->model, path, &iter);
+		gtk_tree_path_free (path);
+	}
+
+	g_array_set_size (priv->filter_rows, 0);
+}
+
+static void
+rev_list_view_reset_search (GiggleRevListView *list)
+{
+	GiggleRevListViewPriv *priv;
+
+	priv = GET_PRIV (list);
+
+	if (priv->search) {
+		g_signal_handlers_disconnect_matched (priv->search,
+						      G_SIGNAL_MATCH_DATA,
+						      0, 0, NULL, NULL, list);
+
+		giggle_git_search_cancel (priv->search);
+		g_object_unref (priv->search);
+		priv->search = NULL;
+	}
+
+	if (priv->pickaxe) {
+		g_signal_handlers_disconnect_matched (priv->pickaxe,
+						      G_SIGNAL_MATCH_DATA,
+						      0, 0, NULL, NULL, list);
+
+		giggle_git_pickaxe_cancel (priv->pickaxe);
+		g_object_unref (priv->pickaxe);
+		priv->pickaxe = NULL;
+	}
+
+	if (priv->sha_index) {
+		g_hash_table_destroy (priv->sha_index);
+		priv->sha_index = NULL;
+	}
+
+	/* drop the highlights, and show all rows again */
+	if (priv->n_search_matches)
+		gtk_widget_queue_draw (GTK_WIDGET (list));
+
+	if (priv->filter_rows)
+		g_array_set_size (priv->filter_rows, 0);
+
+	if (priv->search_matches)
+		rev_list_view_queue_refilter (list);
+
+	g_free (priv->search_matches);
+	priv->search_matches = NULL;
+	priv->n_search_rows = 0;
+	priv->n_search_matches = 0;
+
+	g_free (priv->search_term);
+	priv->search_term = NULL;
+
+	g_clear_error (&priv->search_error);
+
+	priv->search_full = FALSE;
+	priv->search_pending = FALSE;
+	priv->search_redraw = FALSE;
+}
+
+static gboolean
+rev_list_view_search_is_running (GiggleRevListViewPriv *priv)
+{
+	return (priv->search && giggle_git_search_is_running (priv->search)) ||
+	       (priv->pickaxe && giggle_git_pickaxe_is_running (priv->pickaxe));
+}
+
+static void
+rev_list_view_emit_search_progress (GiggleRevListView *list)
+{
+	GiggleRevListViewPriv *priv;
+	const GError          *error;
+	guint                  n_searched;
+
+	priv = GET_PRIV (list);
+
+	/* failed slices count as searched, but the user should know */
+	error = priv->search_error;
+
+	if (!error && priv->search)
+		error = giggle_git_search_get_error (priv->search);
+	if (!error && priv->pickaxe)
+		error = giggle_git_pickaxe_get_error (priv->pickaxe);
+
+	if (priv->search)
+		n_searched = giggle_git_search_get_n_searched (priv->search);
+	else if (priv->search_index)
+		n_searched = giggle_search_index_get_n_documents (priv->search_index);
+	else
+		n_searched = priv->n_search_rows;
+
+	if (priv->pickaxe)
+		n_searched = MIN (n_searched, giggle_git_pickaxe_get_n_searched (priv->pickaxe));
+
+	giggle_searchable_emit_progress
+		(GIGGLE_SEARCHABLE (list), n_searched, priv->n_search_matches,
+		 !rev_list_view_search_is_running (priv), error);
+}
+
+/* returns the row of the sha plus one, so that unknown shas give 0 */
+static int
+rev_list_view_lookup_row (GiggleRevListViewPriv *priv,
+			  const gchar           *sha)
+{
+	return GPOINTER_TO_INT (g_hash_table_lookup (priv->sha_index, sha));
+}
+
+static int
+rev_list_view_find_match (GiggleRevListViewPriv *priv,
+			  int                    origin,
+			  GiggleSearchDirection  direction)
+{
+	int row;
+
+	if (GIGGLE_SEARCH_DIRECTION_NEXT == direction) {
+		for (row = origin + 1; row < (int) priv->n_search_rows; ++row) {
+			if (!priv->search_matches[MATCH_WORD (row)]) {
+				row |= 31;
+				continue;
+			}
+
+			if (priv->search_matches[MATCH_WORD (row)] & MATCH_BIT (row))
+				return row;
+		}
+	} else {
+		for (row = MIN (origin, (int) priv->n_search_rows) - 1; row >= 0; --row) {
+			if (!priv->search_matches[MATCH_WORD (row)]) {
+				row &= ~31;
+				continue;
+			}
+
+			if (priv->search_matches[MATCH_WORD (row)] & MATCH_BIT (row))
+				return row;
+		}
+	}
+
+	return -1;
+}
+
+/* whether all rows from first to last, inclusive, got searched. the
+ * search job goes through the list in order, while the pickaxe has
+ * its slices searched in parallel. */
+static gboolean
+rev_list_view_rows_searched (GiggleRevListViewPriv *priv,
+			     int                    first,
+			     int                    last)
+{
+	const gchar *sha;
+
+	if (first > last)
+		return TRUE;
+
+	if (priv->search && giggle_git_search_is_running (priv->search)) {
+		sha = giggle_git_search_get_last_sha (priv->search);
+
+		if (rev_list_view_lookup_row (priv, sha) <= last)
+			return FALSE;
+	}
+
+	if (priv->pickaxe && giggle_git_pickaxe_is_running (priv->pickaxe))
+		return giggle_git_pickaxe_is_searched (priv->pickaxe, first, last);
+
+	return TRUE;
+}
+
+/* a match found from origin is the one to jump to, or no match is
+ * final, once nothing in between can match anymore */
+static gboolean
+rev_list_view_match_is_final (GiggleRevListViewPriv *priv,
+			      int                    origin,
+			      GiggleSearchDirection  direction,
+			      int                    row)
+{
+	if (GIGGLE_SEARCH_DIRECTION_NEXT == direction) {
+		return rev_list_view_rows_searched
+			(priv, origin + 1, row >= 0 ? row - 1 : (int) priv->n_search_rows - 1);
+	}
+
+	return rev_list_view_rows_searched (priv, row + 1, MIN (origin, (int) priv->n_search_rows) - 1);
+}
+
+static void
+rev_list_view_select_row (GiggleRevListView *list,
+			  int                row)
+{
+	GiggleRevListViewPriv *priv;
+	GtkTreeSelection      *selection;
+	GtkTreePath           *path, *child_path;
+
+	priv = GET_PRIV (list);
+	path = gtk_tree_path_new_from_indices (row, -1);
+
+	/* search results are rows of the unfiltered model */
+	if (priv->filter) {
+		child_path = path;
+		path = gtk_tree_model_filter_convert_child_path_to_path
+			(GTK_TREE_MODEL_FILTER (priv->filter), child_path);
+		gtk_tree_path_free (child_path);
+
+		if (!path)
+			return;
+	}
+
+	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (list));
+	gtk_tree_selection_unselect_all (selection);
+	gtk_tree_selection_select_path (selection, path);
+
+	gtk_tree_view_scroll_to_cell (GTK_TREE_VIEW (list),
+				      path, NULL, FALSE, 0., 0.);
+	gtk_tree_path_free (path);
+}
+
+static void
+rev_list_view_resolve_pending_search (GiggleRevListView *list)
+{
+	GiggleRevListViewPriv *priv;
+	int                    row;
+
+	priv = GET_PRIV (list);
+
+	if (!priv->search_pending)
+		return;
+
+	row = rev_list_view_find_match (priv, priv->search_origin,
+					priv->search_direction);
+
+	if (!rev_list_view_match_is_final (priv, priv->search_origin,
+					   priv->search_direction, row))
+		return;
+
+	priv->search_pending = FALSE;
+
+	if (row >= 0)
+		rev_list_view_select_row (list, row);
+}
+
+/* rows can match both by message and by changes */
+static void
+rev_list_view_add_match (GiggleRevListViewPriv *priv,
+			 int                    row)
+{
+	if (priv->search_matches[MATCH_WORD (row)] & MATCH_BIT (row))
+		return;
+
+	priv->search_matches[MATCH_WORD (row)] |= MATCH_BIT (row);
+	priv->n_search_matches++;
+	priv->search_redraw = TRUE;
+
+	if (priv->filter)
+		g_array_append_val (priv->filter_rows, row);
+}
+
+static void
+rev_list_view_search_match_found_cb (GiggleGitSearch   *search,
+				     const gchar       *sha,
+				     GiggleRevListView *list)
+{
+	GiggleRevListViewPriv *priv;
+	int                    row;
+
+	priv = GET_PRIV (list);
+	row = rev_list_view_lookup_row (priv, sha) - 1;
+
+	/* commits which are not part of this list */
+	if (row >= 0)
+		rev_list_view_add_match (priv, row);
+}
+
+static void
+rev_list_view_pickaxe_match_found_cb (GiggleGitPickaxe  *pickaxe,
+				      guint              row,
+				      GiggleRevListView *list)
+{
+	rev_list_view_add_match (GET_PRIV (list), row);
+}
+
+static void
+rev_list_view_search_progress_cb (GObject           *search,
+				  GiggleRevListView *list)
+{
+	GiggleRevListViewPriv *priv;
+
+	priv = GET_PRIV (list);
+
+	/* highlight the new matches, or show them when filtering */
+	if (priv->search_redraw) {
+		rev_list_view_flush_filter (priv);
+		gtk_widget_queue_draw (GTK_WIDGET (list));
+		priv->search_redraw = FALSE;
+	}
+
+	rev_list_view_resolve_pending_search (list);
+	rev_list_view_emit_search_progress (list);
 }
 
-static gboolean
-revision_property_matches (GiggleRevision *revision,
-			   const gchar    *property,
-			   const gchar    *search_term)
+static void
+rev_list_view_search_index (GiggleRevListView *list)
 {
-	gboolean  match;
-	gchar    *str, *casefold_str;
+	GiggleRevListViewPriv *priv;
+	GArray                *documents;
+	gchar                  sha[41];
+	guint                  i;
+	int                    row;
+
+	priv = GET_PRIV (list);
+
+	documents = giggle_search_index_lookup (priv->search_index,
+						priv->search_term);
+
+	for (i = 0; i < documents->len; ++i) {
+		giggle_search_index_get_sha (priv->search_index,
+					     g_array_index (documents, guint32, i),
+					     sha);
+
+		row = rev_list_view_lookup_row (priv, sha) - 1;
+
+		if (row >= 0)
+			rev_list_view_add_match (priv, row);
+	}
+
+	g_array_free (documents, TRUE);
+}
 
-	g_object_get (revision, property, &str, NULL);
-	casefold_str = g_utf8_casefold (str, -1);
-	match = strstr (casefold_str, search_term) != NULL;
+static void
+rev_list_view_start_pickaxe (GiggleRevListView *list,
+			     GPtrArray         *shas)
+{
+	GiggleRevListViewPriv *priv;
 
-	g_free (casefold_str);
-	g_free (str);
+	priv = GET_PRIV (list);
 
-	return match;
+	priv->pickaxe = giggle_git_pickaxe_new (giggle_git_get_directory (priv->git),
+						priv->search_term,
+						(const gchar * const *) priv->files);
+
+	g_signal_connect (priv->pickaxe, "match-found",
+			  G_CALLBACK (rev_list_view_pickaxe_match_found_cb), list);
+	g_signal_connect (priv->pickaxe, "progress",
+			  G_CALLBACK (rev_list_view_search_progress_cb), list);
+
+	/* rows are passed as they are, so that indices are rows */
+	if (!giggle_git_pickaxe_start (priv->pickaxe,
+				       (const gchar * const *) shas->pdata,
+				       shas->len, &priv->search_error)) {
+		g_object_unref (priv->pickaxe);
+		priv->pickaxe = NULL;
+	}
 }
 
 static void
-log_matches_cb (GiggleGit *git,
-		 GiggleJob *job,
-		 GError    *error,
-		 gpointer   user_data)
+rev_list_view_start_search (GiggleRevListView *list,
+			    GtkTreeModel      *model,
+			    const gchar       *search_term,
+			    gboolean           full_search)
 {
-	RevisionSearchData     *data;
 	GiggleRevListViewPriv *priv;
-	const gchar            *log;
-	gchar                  *casefold_log;
+	GiggleRevision        *revision;
+	GtkTreeIter            iter;
+	GPtrArray             *shas;
+	const gchar           *sha;
+	gboolean               valid;
+	int                    row = 0;
 
-	data = (RevisionSearchData *) user_data;
-	priv = GET_PRIV (data->list);
+	priv = GET_PRIV (list);
 
-	if (error) {
-		data->match = FALSE;
-	} else {
-		log = giggle_git_log_get_log (GIGGLE_GIT_LOG (job));
-		casefold_log = g_utf8_casefold (log, -1);
-		data->match = (strstr (casefold_log, data->search_term) != NULL);
+	rev_list_view_reset_search (list);
+
+	/* the search job reports shas, map them to rows */
+	priv->sha_index = g_hash_table_new (g_str_hash, g_str_equal);
+	shas = g_ptr_array_new ();
+	valid = gtk_tree_model_get_iter_first (model, &iter);
+
+	while (valid) {
+		revision = rev_list_view_peek_revision (model, &iter);
+		sha = revision ? giggle_revision_get_sha (revision) : NULL;
+
+		if (sha) {
+			g_hash_table_insert (priv->sha_index, (gpointer) sha,
+					     GINT_TO_POINTER (row + 1));
+		}
+
+		g_ptr_array_add (shas, (gpointer) sha);
 
-		g_free (casefold_log);
+		valid = gtk_tree_model_iter_next (model, &iter);
+		++row;
 	}
 
-	g_object_unref (priv->job);
-	priv->job = NULL;
+	priv->n_search_rows = row;
+	priv->search_matches = g_new0 (guint32, MATCH_WORD (row) + 1);
+
+	/* when filtering, rows show up as they match */
+	rev_list_view_refilter (priv);
+
+	priv->search_term = g_strdup (search_term);
+	priv->search_full = full_search;
+
+	/* changes are searched by the pickaxe, messages by the
+	 * index or, while it is not ready yet, by git log */
+	if (full_search && g_hash_table_size (priv->sha_index) > 0)
+		rev_list_view_start_pickaxe (list, shas);
+
+	g_ptr_array_free (shas, TRUE);
 
-	g_main_loop_quit (data->main_loop);
+	if (priv->search_index) {
+		rev_list_view_search_index (list);
+		rev_list_view_search_progress_cb (NULL, list);
+		return;
+	}
+
+	priv->search = giggle_git_search_new (giggle_git_get_directory (priv->git),
+					      search_term, FALSE,
+					      (const gchar * const *) priv->files);
+
+	g_signal_connect (priv->search, "match-found",
+			  G_CALLBACK (rev_list_view_search_match_found_cb), list);
+	g_signal_connect (priv->search, "progress",
+			  G_CALLBACK (rev_list_view_search_progress_cb), list);
+	g_signal_connect (priv->search, "finished",
+			  G_CALLBACK (rev_list_view_search_progress_cb), list);
+
+	if (!giggle_git_search_start (priv->search,
+				      priv->search_error ? NULL : &priv->search_error)) {
+		g_object_unref (priv->search);
+		priv->search = NULL;
+
+		rev_list_view_search_progress_cb (NULL, list);
+	}
 }
 
 static gboolean
-revision_log_matches (GiggleRevListView *list,
-		      GiggleRevision     *revision,
-		      const gchar        *search_term)
+rev_list_view_search (GiggleSearchable      *searchable,
+		      const gchar           *search_term,
+		      GiggleSearchDirection  direction,
+		      gboolean               full_search)
 {
+	GiggleRevListView     *list;
 	GiggleRevListViewPriv *priv;
-	RevisionSearchData     *data;
-	gboolean                match;
+	GtkTreeSelection      *selection;
+	GtkTreePath           *path;
+	GList                 *rows;
+	int                    origin, row;
 
+	list = GIGGLE_REV_LIST_VIEW (searchable);
 	priv = GET_PRIV (list);
 
-	if (priv->job) {
-		giggle_git_cancel_job (priv->git, priv->job);
-		g_object_unref (priv->job);
-		priv->job = NULL;
+	if (!priv->model)
+		return FALSE;
+
+	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (list));
+	rows = gtk_tree_selection_get_selected_rows (selection, NULL);
+
+	/* search around the current selection */
+	if (!rows) {
+		origin = (GIGGLE_SEARCH_DIRECTION_NEXT == direction) ?
+			-1 : gtk_tree_model_iter_n_children (priv->model, NULL);
+	} else {
+		path = (GIGGLE_SEARCH_DIRECTION_NEXT == direction) ?
+			rows->data : g_list_last (rows)->data;
+
+		if (priv->filter) {
+			path = gtk_tree_model_filter_convert_path_to_child_path
+				(GTK_TREE_MODEL_FILTER (priv->filter), path);
+			origin = gtk_tree_path_get_indices (path)[0];
+			gtk_tree_path_free (path);
+		} else {
+			origin = gtk_tree_path_get_indices (path)[0];
+		}
 	}
 
-	priv->job = giggle_git_log_new (revision);
+	g_list_foreach (rows, (GFunc) gtk_tree_path_free, NULL);
+	g_list_free (rows);
 
-	data = g_slice_new0 (RevisionSearchData);
-	data->main_loop = g_main_loop_ref (priv->main_loop);
-	data->search_term = search_term;
-	data->list = list;
+	/* matches of the previous search are still good for next/previous */
+	if (!priv->search_term || full_search != priv->search_full ||
+	    strcmp (search_term, priv->search_term)) {
+		rev_list_view_start_search (list, priv->model, search_term, full_search);
+	}
 
-	giggle_git_run_job (priv->git,
-			    priv->job,
-			    log_matches_cb,
-			    data);
+	priv->search_pending = FALSE;
+	row = rev_list_view_find_match (priv, origin, direction);
 
-	/* wait here */
-	gdk_threads_leave ();
-	g_main_loop_run (data->main_loop);
-	gdk_threads_enter ();
+	if (rev_list_view_match_is_final (priv, origin, direction, row)) {
+		if (row < 0)
+			return FALSE;
 
-	/* At this point the match job has already returned */
-	g_main_loop_unref (data->main_loop);
-	match = data->match;
-	g_slice_free (RevisionSearchData, data);
+		rev_list_view_select_row (list, row);
+		return TRUE;
+	}
+
+	/* jump once everything up to the next match got searched */
+	if (rev_list_view_search_is_running (priv)) {
+		priv->search_origin = origin;
+		priv->search_direction = direction;
+		priv->search_pending = TRUE;
+	}
 
-	return match;
+	return FALSE;
 }
 
 static void
-diff_matches_cb (GiggleGit *git,
-		 GiggleJob *job,
-		 GError    *error,
-		 gpointer   user_data)
+rev_list_view_cancel_search (GiggleSearchable *searchable)
 {
-	RevisionSearchData     *data;
 	GiggleRevListViewPriv *priv;
-	const gchar            *diff_str;
 
-	data = (RevisionSearchData *) user_data;
-	priv = GET_PRIV (data->list);
+	priv = GET_PRIV (searchable);
 
-	if (error) {
-		data->match = FALSE;
-	} else {
-		diff_str = giggle_git_diff_get_result (GIGGLE_GIT_DIFF (job));
-		data->match = (strstr (diff_str, data->search_term) != NULL);
+	if (rev_list_view_search_is_running (priv)) {
+		rev_list_view_reset_search (GIGGLE_REV_LIST_VIEW (searchable));
+		giggle_searchable_emit_progress (searchable, 0, 0, TRUE, NULL);
 	}
+}
 
-	g_object_unref (priv->job);
-	priv->job = NULL;
+/* index file name to the latest task for it */
+static GHashTable *index_tasks = NULL;
+
+static void
+index_task_free (IndexTask *task)
+{
+	g_object_unref (task->index);
+	g_object_unref (task->cancellable);
+	g_free (task->directory);
+	g_free (task->filename);
+	g_list_free (task->lists);
+	g_slice_free (IndexTask, task);
+}
 
-	g_main_loop_quit (data->main_loop);
+static gboolean
+index_task_is_current (IndexTask *task)
+{
+	return index_tasks &&
+	       g_hash_table_lookup (index_tasks, task->filename) == task;
 }
 
 static gboolean
-revision_diff_matches (GiggleRevListView *list,
-		       GiggleRevision     *revision,
-		       const gchar        *search_term)
+rev_list_view_index_done_cb (gpointer data)
 {
+	IndexTask             *task = data;
 	GiggleRevListViewPriv *priv;
-	GiggleRevision         *parent;
-	GList                  *parents;
-	RevisionSearchData     *data;
-	gboolean                match;
+	GList                 *l;
 
-	priv = GET_PRIV (list);
-	parents = giggle_revision_get_parents (revision);
+	task->done = TRUE;
 
-	if (!parents) {
-		return FALSE;
-	}
+	for (l = task->lists; l; l = l->next) {
+		priv = GET_PRIV (l->data);
+		priv->index_task = NULL;
 
-	if (priv->job) {
-		giggle_git_cancel_job (priv->git, priv->job);
-		g_object_unref (priv->job);
-		priv->job = NULL;
+		if (task->success)
+			priv->search_index = g_object_ref (task->index);
 	}
 
-	parent = parents->data;
-	priv->job = giggle_git_diff_new ();
-	giggle_git_diff_set_revisions (GIGGLE_GIT_DIFF (priv->job),
-				       parent, revision);
+	g_list_free (task->lists);
+	task->lists = NULL;
 
-	data = g_slice_new0 (RevisionSearchData);
-	data->main_loop = g_main_loop_ref (priv->main_loop);
-	data->search_term = search_term;
-	data->list = list;
+	/* only a good index is worth keeping for lists coming later */
+	if (!index_task_is_current (task)) {
+		index_task_free (task);
+	} else if (!task->success) {
+		g_hash_table_remove (index_tasks, task->filename);
+		index_task_free (task);
+	}
 
-	giggle_git_run_job (priv->git,
-			    priv->job,
-			    diff_matches_cb,
-			    data);
+	return FALSE;
+}
+
+static gpointer
+rev_list_view_index_thread (gpointer data)
+{
+	IndexTask *task = data;
+	GError    *error = NULL;
+
+	task->success = giggle_search_index_load (task->index, task->filename,
+						  task->stamp, NULL);
+
+	if (!task->success) {
+		task->success = giggle_search_index_build (task->index, task->directory,
+							   task->cancellable, &error);
+
+		if (task->success &&
+		    !giggle_search_index_save (task->index, task->filename,
+					       task->stamp, &error)) {
+			g_warning ("Cannot save search index: %s", error->message);
+		} else if (error && !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_warning ("Cannot build search index: %s", error->message);
+		}
 
-	/* wait here */
-	gdk_threads_leave ();
-	g_main_loop_run (data->main_loop);
-	gdk_threads_enter ();
+		g_clear_error (&error);
+	}
 
-	/* At this point the match job has already returned */
-	g_main_loop_unref (data->main_loop);
-	match = data->match;
-	g_slice_free (RevisionSearchData, data);
+	gdk_threads_add_idle (rev_list_view_index_done_cb, task);
 
-	return match;
+	return NULL;
 }
 
-static gboolean
-revision_matches (GiggleRevListView *list,
-		  GiggleRevision     *revision,
-		  const gchar        *search_term,
-		  gboolean            full_search)
+static void
+rev_list_view_cancel_index (GiggleRevListView *list)
 {
-	gboolean match = FALSE;
+	GiggleRevListViewPriv *priv;
+	IndexTask             *task;
 
-	match = (revision_property_matches (revision, "author", search_term) ||
-		 revision_property_matches (revision, "sha", search_term) ||
-		 revision_log_matches (list, revision, search_term));
+	priv = GET_PRIV (list);
+	task = priv->index_task;
+
+	if (task) {
+		task->lists = g_list_remove (task->lists, list);
+		priv->index_task = NULL;
 
-	if (!match && full_search) {
-		match = revision_diff_matches (list, revision, search_term);
+		/* nobody waits for the index anymore */
+		if (!task->lists) {
+			g_cancellable_cancel (task->cancellable);
+
+			if (index_task_is_current (task))
+				g_hash_table_remove (index_tasks, task->filename);
+		}
 	}
 
-	return match;
+	if (priv->search_index) {
+		g_object_unref (priv->search_index);
+		priv->search_index = NULL;
+	}
 }
 
-static gboolean
-rev_list_view_search (GiggleSearchable      *searchable,
-		      const gchar           *search_term,
-		      GiggleSearchDirection  direction,
-		      gboolean               full_search)
+static void
+rev_list_view_start_index (GiggleRevListView *list,
+			   GtkTreeModel      *model)
 {
 	GiggleRevListViewPriv *priv;
-	GtkTreeModel           *model;
-	GtkTreeSelection       *selection;
-	GList                  *list;
-	GtkTreeIter             iter;
-	gboolean                valid, found;
-	GiggleRevision         *revision;
-	GtkTreePath            *path;
+	GiggleRevision        *revision;
+	IndexTask             *task;
+	GtkTreeIter            iter;
+	GError                *error = NULL;
+	gchar                 *filename;
+	gboolean               valid;
+	guint32                stamp = 0;
 
-	priv = GET_PRIV (searchable);
+	priv = GET_PRIV (list);
 
-	found = FALSE;
-	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (searchable));
-	list = gtk_tree_selection_get_selected_rows (selection, &model);
-	priv->cancelled = FALSE;
-
-	/* Find the first/current element */
-	if (list) {
-		if (direction == GIGGLE_SEARCH_DIRECTION_NEXT) {
-			path = gtk_tree_path_copy (list->data);
-			gtk_tree_path_next (path);
-			valid = TRUE;
+	if (!giggle_git_get_directory (priv->git) ||
+	    !giggle_git_get_git_dir (priv->git))
+		return;
+
+	/* a saved index is only good for the very same history */
+	valid = gtk_tree_model_get_iter_first (model, &iter);
+
+	while (valid) {
+		revision = rev_list_view_peek_revision (model, &iter);
+
+		if (revision)
+			stamp = stamp * 31 + g_str_hash (giggle_revision_get_sha (revision));
+
+		valid = gtk_tree_model_iter_next (model, &iter);
+	}
+
+	if (!index_tasks)
+		index_tasks = g_hash_table_new (g_str_hash, g_str_equal);
+
+	filename = g_build_filename (giggle_git_get_git_dir (priv->git),
+				     SEARCH_INDEX_FILENAME, NULL);
+
+	/* another list of the same history got it loaded or going */
+	task = g_hash_table_lookup (index_tasks, filename);
+
+	if (task && task->stamp == stamp) {
+		g_free (filename);
+
+		if (task->done) {
+			priv->search_index = g_object_ref (task->index);
 		} else {
-			path = gtk_tree_path_copy ((g_list_last (list))->data);
-			valid = gtk_tree_path_prev (path);
+			task->lists = g_list_prepend (task->lists, list);
+			priv->index_task = task;
 		}
-	} else {
-		path = gtk_tree_path_new_first ();
-		valid = TRUE;
+
+		return;
 	}
 
-	while (valid && !found && !priv->cancelled) {
-		valid = gtk_tree_model_get_iter (model, &iter, path);
+	/* the history changed, tasks still running for the old one
+	 * get freed once they finish */
+	if (task) {
+		g_hash_table_remove (index_tasks, filename);
 
-		if (!valid) {
-			break;
-		}
+		if (task->done)
+			index_task_free (task);
+		else if (!task->lists)
+			g_cancellable_cancel (task->cancellable);
+	}
 
-		gtk_tree_model_get (model, &iter, 0, &revision, -1);
+	task = g_slice_new0 (IndexTask);
+	task->index = giggle_search_index_new ();
+	task->cancellable = g_cancellable_new ();
+	task->directory = g_strdup (giggle_git_get_directory (priv->git));
+	task->filename = filename;
+	task->stamp = stamp;
+	task->lists = g_list_prepend (NULL, list);
+
+	if (!g_thread_create (rev_list_view_index_thread, task, FALSE, &error)) {
+		g_warning ("Cannot build search index: %s", error->message);
+		g_error_free (error);
+		index_task_free (task);
+		return;
+	}
 
-		if (revision) {
-			found = revision_matches (GIGGLE_REV_LIST_VIEW (searchable),
-					  revision, search_term, full_search);
+	g_hash_table_insert (index_tasks, task->filename, task);
+	priv->index_task = task;
+}
 
-			g_object_unref (revision);
-		}
+static void
+rev_list_view_update_filter (GiggleRevListView *list)
+{
+	GiggleRevListViewPriv *priv;
 
-		if (!found && !priv->cancelled) {
-			if (direction == GIGGLE_SEARCH_DIRECTION_NEXT) {
-				gtk_tree_path_next (path);
-			} else {
-				valid = gtk_tree_path_prev (path);
-			}
-		}
+	priv = GET_PRIV (list);
+
+	if (priv->refilter_id) {
+		g_source_remove (priv->refilter_id);
+		priv->refilter_id = 0;
 	}
 
-	if (found && !priv->cancelled) {
-		gtk_tree_selection_unselect_all (selection);
-		gtk_tree_selection_select_iter (selection, &iter);
+	if (priv->filter) {
+		g_object_unref (priv->filter);
+		g_array_free (priv->filter_rows, TRUE);
+		priv->filter_rows = NULL;
+		priv->filter = NULL;
+	}
+
+	if (priv->model && priv->filter_mode) {
+		priv->filter = gtk_tree_model_filter_new (priv->model, NULL);
+		priv->filter_rows = g_array_new (FALSE, FALSE, sizeof (int));
 
-		/* scroll to row */
-		gtk_tree_view_scroll_to_cell (GTK_TREE_VIEW (searchable),
-					      path, NULL, FALSE, 0., 0.);
+		gtk_tree_model_filter_set_visible_func (GTK_TREE_MODEL_FILTER (priv->filter),
+							rev_list_view_filter_visible_func,
+							list, NULL);
 	}
 
-	gtk_tree_path_free (path);
-	g_list_foreach (list, (GFunc) gtk_tree_path_free, NULL);
-	g_list_free (list);
+	/* lanes of the graph make no sense for a filtered list */
+	gtk_tree_view_column_set_visible (priv->graph_column,
+					  priv->show_graph && !priv->filter);
 
-	return (found && !priv->cancelled);
+	gtk_tree_view_set_model (GTK_TREE_VIEW (list),
+				 priv->filter ? priv->filter : priv->model);
 }
 
 static void
-rev_list_view_cancel_search (GiggleSearchable *searchable)
+rev_list_view_set_search_filter (GiggleSearchable *searchable,
+				 gboolean          filter)
 {
 	GiggleRevListViewPriv *priv;
+	GList                 *selection;
 
 	priv = GET_PRIV (searchable);
 
-	if (!priv->cancelled) {
-		priv->cancelled = TRUE;
+	if (priv->filter_mode == (filter == TRUE))
+		return;
 
-		if (priv->job) {
-			/* cancel the current search inside diffs job */
-			giggle_git_cancel_job (priv->git, priv->job);
-			g_object_unref (priv->job);
-			priv->job = NULL;
-		}
+	priv->filter_mode = (filter == TRUE);
 
-		if (g_main_loop_is_running (priv->main_loop)) {
-			g_main_loop_quit (priv->main_loop);
-		}
-	}
+	/* keep the selected revisions across the model change */
+	selection = giggle_rev_list_view_get_selection (GIGGLE_REV_LIST_VIEW (searchable));
+	rev_list_view_update_filter (GIGGLE_REV_LIST_VIEW (searchable));
+	giggle_rev_list_view_set_selection (GIGGLE_REV_LIST_VIEW (searchable), selection);
+
+	g_list_foreach (selection, (GFunc) g_object_unref, NULL);
+	g_list_free (selection);
 }
 
 static void
 giggle_rev_list_view_searchable_init (GiggleSearchableIface *iface)
 {
-	iface->search = rev_list_view_search;
-	iface->cancel = rev_list_view_cancel_search;
+	iface->search     = rev_list_view_search;
+	iface->cancel     = rev_list_view_cancel_search;
+	iface->set_filter = rev_list_view_set_search_filter;
 }
 
 static gboolean
@@ -1356,69 +2273,74 @@ rev_list_view_cell_data_emblem_func (GtkCellLayout     *layout,
 				     gpointer           data)
 {
 	GiggleRevListViewPriv *priv;
-	GiggleRevListView     *list;
 	GiggleRevision        *revision;
-	GdkPixbuf             *pixbuf = NULL;
-	int                    columns = 0, x = 0;
-	GList                 *branch_list = NULL;
-	GList                 *remote_list = NULL;
-	GList                 *tag_list = NULL;
+	RevisionDecoration    *decoration = NULL;
 
-	list = GIGGLE_REV_LIST_VIEW (data);
-	priv = GET_PRIV (list);
+	priv = GET_PRIV (data);
+	revision = rev_list_view_peek_revision (model, iter);
 
-	gtk_tree_model_get (model, iter,
-			    COL_OBJECT, &revision,
-			    -1);
+	if (revision)
+		decoration = rev_list_view_get_decoration (priv, revision);
 
-	if (revision) {
-		branch_list = giggle_revision_get_branch_heads (revision);
-		remote_list = giggle_revision_get_remotes (revision);
-		tag_list    = giggle_revision_get_tags (revision);
-	}
-
-	if (branch_list)
-		++columns;
-	if (remote_list)
-		++columns;
-	if (tag_list)
-		++columns;
-
-	if (columns > 0) {
-		pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8,
-					 priv->emblem_size * columns,
-					 priv->emblem_size);
-		gdk_pixbuf_fill (pixbuf, 0x00000000);
-
-		if (branch_list) {
-			gdk_pixbuf_copy_area (priv->emblem_branch, 0, 0,
-					      priv->emblem_size, priv->emblem_size,
-					      pixbuf, x, 0);
-			x += priv->emblem_size;
-		}
+	g_object_set (cell, "pixbuf",
+		      decoration ? rev_list_view_get_badge (priv, decoration->kinds) : NULL,
+		      NULL);
+}
 
-		if (remote_list) {
-			gdk_pixbuf_copy_area (priv->emblem_remote, 0, 0,
-					      priv->emblem_size, priv->emblem_size,
-					      pixbuf, x, 0);
-			x += priv->emblem_size;
-		}
+static PangoLayout *
+rev_list_view_lookup_layout (GiggleRevListView  *list,
+			     LayoutCache        *cache,
+			     const char         *key,
+			     const char         *text,
+			     PangoEllipsizeMode  ellipsize)
+{
+	LayoutCacheEntry *entry;
 
-		if (tag_list) {
-			gdk_pixbuf_copy_area (priv->emblem_tag, 0, 0,
-					      priv->emblem_size, priv->emblem_size,
-					      pixbuf, x, 0);
-			x += priv->emblem_size;
-		}
+	entry = g_hash_table_lookup (cache->entries, key);
+
+	if (entry && entry->generation != cache->generation) {
+		/* shaped for an old style or width */
+		g_hash_table_remove (cache->entries, key);
+		entry = NULL;
+	}
+
+	if (entry) {
+		g_queue_unlink (&cache->lru, entry->link);
+		g_queue_push_head_link (&cache->lru, entry->link);
+		return entry->layout;
 	}
 
-	g_object_set (cell, "pixbuf", pixbuf, NULL);
+	while (g_queue_get_length (&cache->lru) >= LAYOUT_CACHE_SIZE) {
+		entry = g_queue_peek_tail (&cache->lru);
+		g_hash_table_remove (cache->entries, entry->key);
+	}
 
-	if (pixbuf)
-		g_object_unref (pixbuf);
+	entry = g_slice_new0 (LayoutCacheEntry);
+	entry->cache = cache;
+	entry->key = g_strdup (key);
+	entry->generation = cache->generation;
 
-	if (revision)
-		g_object_unref (revision);
+	entry->layout = gtk_widget_create_pango_layout (GTK_WIDGET (list), text);
+	pango_layout_set_single_paragraph_mode (entry->layout, TRUE);
+	pango_layout_set_ellipsize (entry->layout, ellipsize);
+
+	g_queue_push_head (&cache->lru, entry);
+	entry->link = g_queue_peek_head_link (&cache->lru);
+	g_hash_table_insert (cache->entries, entry->key, entry);
+
+	return entry->layout;
+}
+
+static void
+rev_list_view_log_column_width_cb (GObject    *column,
+				   GParamSpec *pspec,
+				   gpointer    data)
+{
+	GiggleRevListViewPriv *priv = GET_PRIV (data);
+
+	/* ellipsized layouts must be shaped again for the new width */
+	if (priv->log_layouts)
+		layout_cache_invalidate (priv->log_layouts);
 }
 
 static void
@@ -1428,25 +2350,35 @@ rev_list_view_cell_data_log_func (GtkCellLayout   *layout,
 				  GtkTreeIter     *iter,
 				  gpointer         data)
 {
-	GiggleRevListViewPriv *priv;
+	GiggleRevListViewPriv  *priv;
 	GiggleRevision         *revision;
+	PangoLayout            *text_layout;
+	GdkColor               *color = NULL;
 	gchar                  *markup;
 
 	priv = GET_PRIV (data);
-
-	gtk_tree_model_get (model, iter,
-			    COL_OBJECT, &revision,
-			    -1);
+	revision = rev_list_view_peek_revision (model, iter);
 
 	if (revision) {
+		text_layout = rev_list_view_lookup_layout (data, priv->log_layouts,
+							   giggle_revision_get_sha (revision),
+							   giggle_revision_get_short_log (revision),
+							   PANGO_ELLIPSIZE_END);
+
+		/* highlight search matches as they come in */
+		if (rev_list_view_row_matches (priv, model, iter))
+			color = &priv->match_color;
+
 		g_object_set (cell,
-			      "text", giggle_revision_get_short_log (revision),
+			      "layout", text_layout,
+			      "cell-background-gdk", color,
 			      NULL);
-		g_object_unref (revision);
 	} else {
 		markup = g_strdup_printf ("<b>%s</b>", _("Uncommitted changes"));
 		g_object_set (cell,
+			      "layout", NULL,
 			      "markup", markup,
+			      "cell-background-gdk", NULL,
 			      NULL);
 		g_free (markup);
 	}
@@ -1462,18 +2394,21 @@ rev_list_view_cell_data_author_func (GtkCellLayout   *layout,
 	GiggleAuthor   *author = NULL;
 	const char     *name = NULL;
 	GiggleRevision *revision;
+	PangoLayout    *text_layout = NULL;
 
-	gtk_tree_model_get (model, iter, COL_OBJECT, &revision, -1);
+	revision = rev_list_view_peek_revision (model, iter);
 
 	if (revision)
 		author = giggle_revision_get_author (revision);
 	if (author)
 		name = giggle_author_get_name (author);
 
-	g_object_set (cell, "text", name, NULL);
+	if (name) {
+		text_layout = rev_list_view_lookup_layout (data, GET_PRIV (data)->author_layouts,
+							   name, name, PANGO_ELLIPSIZE_NONE);
+	}
 
-	if (revision)
-		g_object_unref (revision);
+	g_object_set (cell, "layout", text_layout, "text", NULL, NULL);
 }
 
 static gchar *
@@ -1538,32 +2473,25 @@ rev_list_view_cell_data_date_func (GtkCellLayout   *layout,
 				   GtkTreeIter     *iter,
 				   gpointer         data)
 {
-	GiggleRevListViewPriv *priv;
 	GiggleRevision         *revision;
 	gchar                  *format;
 	gchar                   buf[256];
-	const struct tm        *tm;
-
-	priv = GET_PRIV (data);
+	const struct tm        *tm = NULL;
 
-	gtk_tree_model_get (model, iter,
-			    COL_OBJECT, &revision,
-			    -1);
+	revision = rev_list_view_peek_revision (model, iter);
 
-	if (revision) {
+	if (revision)
 		tm = giggle_revision_get_date (revision);
 
-		if (tm) {
-			format = rev_list_view_get_formatted_time (tm);
-			strftime (buf, sizeof (buf), format, tm);
+	if (tm) {
+		format = rev_list_view_get_formatted_time (tm);
+		strftime (buf, sizeof (buf), format, tm);
 
-			g_object_set (cell,
-				      "text", buf,
-				      NULL);
+		g_object_set (cell,
+			      "text", buf,
+			      NULL);
 
-			g_free (format);
-			g_object_unref (revision);
-		}
+		g_free (format);
 	} else {
 		g_object_set (cell, "text", NULL, NULL);
 	}
@@ -1689,7 +2617,12 @@ giggle_rev_list_view_init (GiggleRevListView *rev_list_view)
 	priv->last_revision = (GiggleRevision *) 0x1;
 
 	priv->git = giggle_git_get ();
-	priv->main_loop = g_main_loop_new (NULL, FALSE);
+
+	priv->decorations = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+						   (GDestroyNotify) revision_decoration_free);
+
+	priv->log_layouts = layout_cache_new ();
+	priv->author_layouts = layout_cache_new ();
 
 	gtk_tree_view_set_fixed_height_mode (GTK_TREE_VIEW (rev_list_view), TRUE);
 	gtk_tree_view_set_rules_hint (GTK_TREE_VIEW (rev_list_view), TRUE);
@@ -1699,6 +2632,7 @@ giggle_rev_list_view_init (GiggleRevListView *rev_list_view)
 	gtk_tree_view_column_set_sizing (priv->emblem_column, GTK_TREE_VIEW_COLUMN_FIXED);
 
 	cell = gtk_cell_renderer_pixbuf_new ();
+	priv->emblem_renderer = cell;
 
 	gtk_cell_layout_pack_start (GTK_CELL_LAYOUT (priv->emblem_column), cell, TRUE);
 
@@ -1716,6 +2650,7 @@ giggle_rev_list_view_init (GiggleRevListView *rev_list_view)
 	gtk_tree_view_column_set_min_width (priv->graph_column, font_size * 10);
 
 	priv->graph_renderer = giggle_graph_renderer_new ();
+	g_object_set (priv->graph_renderer, "lane-budget", GRAPH_LANE_BUDGET, NULL);
 
 	gtk_tree_view_column_set_title (priv->graph_column, _("Graph"));
 	gtk_cell_layout_pack_start (GTK_CELL_LAYOUT (priv->graph_column),
@@ -1730,7 +2665,7 @@ giggle_rev_list_view_init (GiggleRevListView *rev_list_view)
 				     priv->graph_column, -1);
 
 	/* log cell renderer */
-	cell = gtk_cell_renderer_text_new ();
+	cell = giggle_layout_renderer_new ();
 	gtk_cell_renderer_text_set_fixed_height_from_font (GTK_CELL_RENDERER_TEXT (cell), 1);
 	g_object_set (cell, "ellipsize", PANGO_ELLIPSIZE_END, NULL);
 
@@ -1747,10 +2682,14 @@ giggle_rev_list_view_init (GiggleRevListView *rev_list_view)
 					    rev_list_view_cell_data_log_func,
 					    rev_list_view, NULL);
 
+	g_signal_connect (column, "notify::width",
+			  G_CALLBACK (rev_list_view_log_column_width_cb),
+			  rev_list_view);
+
 	gtk_tree_view_insert_column (GTK_TREE_VIEW (rev_list_view), column, -1);
 
 	/* Author cell renderer */
-	cell = gtk_cell_renderer_text_new ();
+	cell = giggle_layout_renderer_new ();
 	gtk_cell_renderer_text_set_fixed_height_from_font (GTK_CELL_RENDERER_TEXT (cell), 1);
 
 	column = gtk_tree_view_column_new ();
@@ -1826,6 +2765,7 @@ giggle_rev_list_view_set_model (GiggleRevListView *list,
 				GtkTreeModel      *model)
 {
 	GiggleRevListViewPriv *priv;
+	GtkTreeModel          *old_model;
 	GType                   type;
 
 	g_return_if_fail (GIGGLE_IS_REV_LIST_VIEW (list));
@@ -1839,13 +2779,90 @@ giggle_rev_list_view_set_model (GiggleRevListView *list,
 
 	priv = GET_PRIV (list);
 
+	old_model = priv->model;
+
+	if (old_model) {
+		g_signal_handlers_disconnect_by_func (old_model,
+						      rev_list_view_row_changed_cb,
+						      list);
+		g_signal_handlers_disconnect_by_func (old_model,
+						      rev_list_view_reset_search,
+						      list);
+	}
+
+	g_hash_table_remove_all (priv->decorations);
+	rev_list_view_reset_search (list);
+	rev_list_view_cancel_index (list);
+
+	if (model)
+		g_object_ref (model);
+	if (old_model)
+		g_object_unref (old_model);
+
+	priv->model = model;
+
 	if (model) {
+		g_signal_connect_object (model, "row-changed",
+					 G_CALLBACK (rev_list_view_row_changed_cb),
+					 list, 0);
+
+		/* search results are indexed by row */
+		g_signal_connect_object (model, "row-inserted",
+					 G_CALLBACK (rev_list_view_reset_search),
+					 list, G_CONNECT_SWAPPED);
+		g_signal_connect_object (model, "row-deleted",
+					 G_CALLBACK (rev_list_view_reset_search),
+					 list, G_CONNECT_SWAPPED);
+
+		/* a path limited history gets searched by git log */
+		if (!priv->files)
+			rev_list_view_start_index (list, model);
+	}
+
+	/* the graph layout is only needed once the graph gets shown */
+	priv->graph_valid = FALSE;
+
+	if (model && priv->show_graph) {
 		giggle_graph_renderer_validate_model
 			(GIGGLE_GRAPH_RENDERER (priv->graph_renderer),
 			 model, COL_OBJECT);
+		priv->graph_valid = TRUE;
 	}
 
-	gtk_tree_view_set_model (GTK_TREE_VIEW (list), model);
+	rev_list_view_update_filter (list);
+}
+
+/* the unfiltered model, as set with giggle_rev_list_view_set_model() */
+GtkTreeModel *
+giggle_rev_list_view_get_model (GiggleRevListView *list)
+{
+	g_return_val_if_fail (GIGGLE_IS_REV_LIST_VIEW (list), NULL);
+	return GET_PRIV (list)->model;
+}
+
+/* Tells the history of which files gets shown, so that searches
+ * look at the same commits. NULL means the whole history. */
+void
+giggle_rev_list_view_set_files (GiggleRevListView *list,
+				GList             *files)
+{
+	GiggleRevListViewPriv *priv;
+	guint                  i;
+
+	g_return_if_fail (GIGGLE_IS_REV_LIST_VIEW (list));
+
+	priv = GET_PRIV (list);
+
+	rev_list_view_reset_search (list);
+	g_strfreev (priv->files);
+	priv->files = NULL;
+
+	if (files) {
+		priv->files = g_new0 (gchar *, g_list_length (files) + 1);
+
+		for (i = 0; files; files = files->next)
+			priv->files[i++] = g_strdup (files->data);
+	}
 }
 
 gboolean
@@ -1864,13 +2881,24 @@ giggle_rev_list_view_set_graph_visible (GiggleRevListView *list,
 					gboolean            show_graph)
 {
 	GiggleRevListViewPriv *priv;
+	GtkTreeModel          *model;
 
 	g_return_if_fail (GIGGLE_IS_REV_LIST_VIEW (list));
 
 	priv = GET_PRIV (list);
+	model = priv->model;
 
 	priv->show_graph = (show_graph == TRUE);
-	gtk_tree_view_column_set_visible (priv->graph_column, priv->show_graph);
+
+	if (model && priv->show_graph && !priv->graph_valid) {
+		giggle_graph_renderer_validate_model
+			(GIGGLE_GRAPH_RENDERER (priv->graph_renderer),
+			 model, COL_OBJECT);
+		priv->graph_valid = TRUE;
+	}
+
+	gtk_tree_view_column_set_visible (priv->graph_column,
+					  priv->show_graph && !priv->filter);
 	g_object_notify (G_OBJECT (list), "graph-visible");
 }
 
@@ -56,6 +56,9 @@ GtkWidget *        giggle_rev_list_view_new               (void);
 
 void               giggle_rev_list_view_set_model         (GiggleRevListView *list,
 							   GtkTreeModel       *model);
+GtkTreeModel *     giggle_rev_list_view_get_model         (GiggleRevListView *list);
+void               giggle_rev_list_view_set_files         (GiggleRevListView *list,
+							   GList             *files);
 
 gboolean           giggle_rev_list_view_get_graph_visible (GiggleRevListView *list);
 void               giggle_rev_list_view_set_graph_visible (GiggleRevListView *list,
@@ -0,0 +1,349 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+#include "giggle-revision-model.h"
+
+#include <string.h>
+
+#define GET_PRIV(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIGGLE_TYPE_REVISION_MODEL, GiggleRevisionModelPriv))
+
+#define ITER_INDEX(iter) GPOINTER_TO_INT ((iter)->user_data)
+
+typedef struct {
+	/* rows are stored packed, the model owns a reference on each
+	 * revision. NULL rows stand for uncommitted changes. */
+	GPtrArray *rows;
+	int        stamp;
+} GiggleRevisionModelPriv;
+
+static void giggle_revision_model_tree_model_init (GtkTreeModelIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (GiggleRevisionModel, giggle_revision_model, G_TYPE_OBJECT,
+			 G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_MODEL,
+						giggle_revision_model_tree_model_init))
+
+static void
+revision_model_finalize (GObject *object)
+{
+	GiggleRevisionModelPriv *priv;
+	guint                    i;
+
+	priv = GET_PRIV (object);
+
+	for (i = 0; i < priv->rows->len; ++i) {
+		if (priv->rows->pdata[i])
+			g_object_unref (priv->rows->pdata[i]);
+	}
+
+	g_ptr_array_free (priv->rows, TRUE);
+
+	G_OBJECT_CLASS (giggle_revision_model_parent_class)->finalize (object);
+}
+
+static void
+giggle_revision_model_class_init (GiggleRevisionModelClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+	object_class->finalize = revision_model_finalize;
+
+	g_type_class_add_private (object_class, sizeof (GiggleRevisionModelPriv));
+}
+
+static void
+giggle_revision_model_init (GiggleRevisionModel *model)
+{
+	GiggleRevisionModelPriv *priv;
+
+	priv = GET_PRIV (model);
+
+	priv->rows = g_ptr_array_new ();
+	priv->stamp = g_random_int ();
+}
+
+static inline void
+revision_model_set_iter (GiggleRevisionModelPriv *priv,
+			 GtkTreeIter             *iter,
+			 int                      index)
+{
+	iter->stamp = priv->stamp;
+	iter->user_data = GINT_TO_POINTER (index);
+}
+
+static GtkTreeModelFlags
+revision_model_get_flags (GtkTreeModel *model)
+{
+	return GTK_TREE_MODEL_LIST_ONLY;
+}
+
+static int
+revision_model_get_n_columns (GtkTreeModel *model)
+{
+	return GIGGLE_REVISION_MODEL_N_COLUMNS;
+}
+
+static GType
+revision_model_get_column_type (GtkTreeModel *model,
+				int           column)
+{
+	g_return_val_if_fail (GIGGLE_REVISION_MODEL_COL_OBJECT == column, G_TYPE_INVALID);
+
+	return GIGGLE_TYPE_REVISION;
+}
+
+static gboolean
+revision_model_get_iter (GtkTreeModel *model,
+			 GtkTreeIter  *iter,
+			 GtkTreePath  *path)
+{
+	GiggleRevisionModelPriv *priv;
+	int                      index;
+
+	priv = GET_PRIV (model);
+
+	g_return_val_if_fail (gtk_tree_path_get_depth (path) > 0, FALSE);
+
+	index = gtk_tree_path_get_indices (path)[0];
+
+	if (index < 0 || index >= priv->rows->len)
+		return FALSE;
+
+	revision_model_set_iter (priv, iter, index);
+
+	return TRUE;
+}
+
+static GtkTreePath *
+revision_model_get_path (GtkTreeModel *model,
+			 GtkTreeIter  *iter)
+{
+	g_return_val_if_fail (GET_PRIV (model)->stamp == iter->stamp, NULL);
+
+	return gtk_tree_path_new_from_indices (ITER_INDEX (iter), -1);
+}
+
+static void
+revision_model_get_value (GtkTreeModel *model,
+			  GtkTreeIter  *iter,
+			  int           column,
+			  GValue       *value)
+{
+	GiggleRevisionModelPriv *priv;
+
+	priv = GET_PRIV (model);
+
+	g_return_if_fail (priv->stamp == iter->stamp);
+	g_return_if_fail (GIGGLE_REVISION_MODEL_COL_OBJECT == column);
+
+	g_value_init (value, GIGGLE_TYPE_REVISION);
+	g_value_set_object (value, priv->rows->pdata[ITER_INDEX (iter)]);
+}
+
+static gboolean
+revision_model_iter_next (GtkTreeModel *model,
+			  GtkTreeIter  *iter)
+{
+	GiggleRevisionModelPriv *priv;
+	int                      index;
+
+	priv = GET_PRIV (model);
+
+	g_return_val_if_fail (priv->stamp == iter->stamp, FALSE);
+
+	index = ITER_INDEX (iter) + 1;
+
+	if (index >= priv->rows->len) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+
+	revision_model_set_iter (priv, iter, index);
+
+	return TRUE;
+}
+
+static gboolean
+revision_model_iter_nth_child (GtkTreeModel *model,
+			       GtkTreeIter  *iter,
+			       GtkTreeIter  *parent,
+			       int           n)
+{
+	GiggleRevisionModelPriv *priv;
+
+	priv = GET_PRIV (model);
+
+	if (parent || n < 0 || n >= priv->rows->len)
+		return FALSE;
+
+	revision_model_set_iter (priv, iter, n);
+
+	return TRUE;
+}
+
+static gboolean
+revision_model_iter_children (GtkTreeModel *model,
+			      GtkTreeIter  *iter,
+			      GtkTreeIter  *parent)
+{
+	return revision_model_iter_nth_child (model, iter, parent, 0);
+}
+
+static gboolean
+revision_model_iter_has_child (GtkTreeModel *model,
+			       GtkTreeIter  *iter)
+{
+	return FALSE;
+}
+
+static int
+revision_model_iter_n_children (GtkTreeModel *model,
+				GtkTreeIter  *iter)
+{
+	if (iter)
+		return 0;
+
+	return GET_PRIV (model)->rows->len;
+}
+
+static gboolean
+revision_model_iter_parent (GtkTreeModel *model,
+			    GtkTreeIter  *iter,
+			    GtkTreeIter  *child)
+{
+	return FALSE;
+}
+
+static void
+giggle_revision_model_tree_model_init (GtkTreeModelIface *iface)
+{
+	iface->get_flags       = revision_model_get_flags;
+	iface->get_n_columns   = revision_model_get_n_columns;
+	iface->get_column_type = revision_model_get_column_type;
+	iface->get_iter        = revision_model_get_iter;
+	iface->get_path        = revision_model_get_path;
+	iface->get_value       = revision_model_get_value;
+	iface->iter_next       = revision_model_iter_next;
+	iface->iter_children   = revision_model_iter_children;
+	iface->iter_has_child  = revision_model_iter_has_child;
+	iface->iter_n_children = revision_model_iter_n_children;
+	iface->iter_nth_child  = revision_model_iter_nth_child;
+	iface->iter_parent     = revision_model_iter_parent;
+}
+
+GtkTreeModel *
+giggle_revision_model_new (GList *revisions)
+{
+	GiggleRevisionModel     *model;
+	GiggleRevisionModelPriv *priv;
+
+	model = g_object_new (GIGGLE_TYPE_REVISION_MODEL, NULL);
+	priv = GET_PRIV (model);
+
+	g_ptr_array_free (priv->rows, TRUE);
+	priv->rows = g_ptr_array_sized_new (g_list_length (revisions));
+
+	while (revisions) {
+		g_ptr_array_add (priv->rows, g_object_ref (revisions->data));
+		revisions = revisions->next;
+	}
+
+	return GTK_TREE_MODEL (model);
+}
+
+void
+giggle_revision_model_prepend (GiggleRevisionModel *model,
+			       GiggleRevision      *revision)
+{
+	GiggleRevisionModelPriv *priv;
+	GtkTreePath             *path;
+	GtkTreeIter              iter;
+
+	g_return_if_fail (GIGGLE_IS_REVISION_MODEL (model));
+	g_return_if_fail (GIGGLE_IS_REVISION (revision) || !revision);
+
+	priv = GET_PRIV (model);
+
+	g_ptr_array_add (priv->rows, NULL);
+	g_memmove (priv->rows->pdata + 1, priv->rows->pdata,
+		   (priv->rows->len - 1) * sizeof (gpointer));
+
+	priv->rows->pdata[0] = revision ? g_object_ref (revision) : NULL;
+
+	/* indices shifted, old iters are invalid now */
+	priv->stamp++;
+
+	revision_model_set_iter (priv, &iter, 0);
+	path = gtk_tree_path_new_first ();
+	gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
+	gtk_tree_path_free (path);
+}
+
+int
+giggle_revision_model_get_length (GiggleRevisionModel *model)
+{
+	g_return_val_if_fail (GIGGLE_IS_REVISION_MODEL (model), 0);
+	return GET_PRIV (model)->rows->len;
+}
+
+GiggleRevision *
+giggle_revision_model_peek_nth (GiggleRevisionModel *model,
+				int                  index)
+{
+	GiggleRevisionModelPriv *priv;
+
+	g_return_val_if_fail (GIGGLE_IS_REVISION_MODEL (model), NULL);
+
+	priv = GET_PRIV (model);
+
+	g_return_val_if_fail (index >= 0 && index < priv->rows->len, NULL);
+
+	return priv->rows->pdata[index];
+}
+
+GiggleRevision *
+giggle_revision_model_peek (GiggleRevisionModel *model,
+			    GtkTreeIter         *iter)
+{
+	g_return_val_if_fail (GIGGLE_IS_REVISION_MODEL (model), NULL);
+	g_return_val_if_fail (GET_PRIV (model)->stamp == iter->stamp, NULL);
+
+	return GET_PRIV (model)->rows->pdata[ITER_INDEX (iter)];
+}
+
+int
+giggle_revision_model_get_index (GiggleRevisionModel *model,
+				 GtkTreeIter         *iter)
+{
+	g_return_val_if_fail (GIGGLE_IS_REVISION_MODEL (model), -1);
+	g_return_val_if_fail (GET_PRIV (model)->stamp == iter->stamp, -1);
+
+	return ITER_INDEX (iter);
+}
+
+gboolean
+giggle_revision_model_get_iter_nth (GiggleRevisionModel *model,
+				    GtkTreeIter         *iter,
+				    int                  index)
+{
+	g_return_val_if_fail (GIGGLE_IS_REVISION_MODEL (model), FALSE);
+
+	return revision_model_iter_nth_child (GTK_TREE_MODEL (model), iter, NULL, index);
+}
@@ -0,0 +1,71 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GIGGLE_REVISION_MODEL_H__
+#define __GIGGLE_REVISION_MODEL_H__
+
+#include <gtk/gtk.h>
+#include "libgiggle/giggle-revision.h"
+
+G_BEGIN_DECLS
+
+#define GIGGLE_TYPE_REVISION_MODEL            (giggle_revision_model_get_type ())
+#define GIGGLE_REVISION_MODEL(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIGGLE_TYPE_REVISION_MODEL, GiggleRevisionModel))
+#define GIGGLE_REVISION_MODEL_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), GIGGLE_TYPE_REVISION_MODEL, GiggleRevisionModelClass))
+#define GIGGLE_IS_REVISION_MODEL(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GIGGLE_TYPE_REVISION_MODEL))
+#define GIGGLE_IS_REVISION_MODEL_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GIGGLE_TYPE_REVISION_MODEL))
+#define GIGGLE_REVISION_MODEL_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GIGGLE_TYPE_REVISION_MODEL, GiggleRevisionModelClass))
+
+typedef struct GiggleRevisionModel      GiggleRevisionModel;
+typedef struct GiggleRevisionModelClass GiggleRevisionModelClass;
+
+struct GiggleRevisionModel {
+	GObject parent_instance;
+};
+
+struct GiggleRevisionModelClass {
+	GObjectClass parent_class;
+};
+
+enum {
+	GIGGLE_REVISION_MODEL_COL_OBJECT,
+	GIGGLE_REVISION_MODEL_N_COLUMNS
+};
+
+GType                giggle_revision_model_get_type    (void);
+GtkTreeModel *       giggle_revision_model_new         (GList               *revisions);
+
+void                 giggle_revision_model_prepend     (GiggleRevisionModel *model,
+							GiggleRevision      *revision);
+
+int                  giggle_revision_model_get_length  (GiggleRevisionModel *model);
+GiggleRevision *     giggle_revision_model_peek_nth    (GiggleRevisionModel *model,
+							int                  index);
+GiggleRevision *     giggle_revision_model_peek        (GiggleRevisionModel *model,
+							GtkTreeIter         *iter);
+int                  giggle_revision_model_get_index   (GiggleRevisionModel *model,
+							GtkTreeIter         *iter);
+gboolean             giggle_revision_model_get_iter_nth (GiggleRevisionModel *model,
+							 GtkTreeIter         *iter,
+							 int                  index);
+
+G_END_DECLS
+
+#endif /* __GIGGLE_REVISION_MODEL_H__ */
@@ -0,0 +1,400 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+#include "giggle-text-search.h"
+
+#include <gtksourceview/gtksourceiter.h>
+#include <string.h>
+
+#define TEXT_SEARCH_CACHE_KEY "giggle-text-search-cache"
+
+#define FOLD(c) ((c) >= 'A' && (c) <= 'Z' ? (c) + ('a' - 'A') : (c))
+
+/* copy of the buffer's text, taken on the first search after the
+ * buffer changed. line_starts holds the byte offset of each buffer
+ * line, so that matches map to iters without walking the btree. */
+typedef struct {
+	gchar  *text;
+	gsize   length;
+	GArray *line_starts;
+} TextSearchCache;
+
+static void
+text_search_cache_free (TextSearchCache *cache)
+{
+	g_array_free (cache->line_starts, TRUE);
+	g_free (cache->text);
+	g_slice_free (TextSearchCache, cache);
+}
+
+static void
+text_search_buffer_changed_cb (GtkTextBuffer *buffer,
+			       gpointer       user_data)
+{
+	g_signal_handlers_disconnect_by_func (buffer, text_search_buffer_changed_cb, NULL);
+	g_object_set_data (G_OBJECT (buffer), TEXT_SEARCH_CACHE_KEY, NULL);
+}
+
+static TextSearchCache *
+text_search_get_cache (GtkTextBuffer *buffer)
+{
+	TextSearchCache *cache;
+	GtkTextIter      start, end;
+	gint             delimiter, next;
+	gsize            offset;
+
+	cache = g_object_get_data (G_OBJECT (buffer), TEXT_SEARCH_CACHE_KEY);
+
+	if (cache)
+		return cache;
+
+	cache = g_slice_new0 (TextSearchCache);
+
+	/* include hidden chars and pixbuf placeholders,
+	 * so that byte offsets match the line indices */
+	gtk_text_buffer_get_bounds (buffer, &start, &end);
+	cache->text = gtk_text_buffer_get_slice (buffer, &start, &end, TRUE);
+	cache->length = strlen (cache->text);
+
+	cache->line_starts = g_array_sized_new (FALSE, FALSE, sizeof (gsize),
+						gtk_text_buffer_get_line_count (buffer));
+
+	/* GtkTextBuffer breaks lines just like pango breaks paragraphs */
+	offset = 0;
+
+	do {
+		g_array_append_val (cache->line_starts, offset);
+
+		pango_find_paragraph_boundary (cache->text + offset,
+					       cache->length - offset,
+					       &delimiter, &next);
+
+		offset += next;
+	} while (next > delimiter);
+
+	g_object_set_data_full (G_OBJECT (buffer), TEXT_SEARCH_CACHE_KEY, cache,
+				(GDestroyNotify) text_search_cache_free);
+	g_signal_connect (buffer, "changed",
+			  G_CALLBACK (text_search_buffer_changed_cb), NULL);
+
+	return cache;
+}
+
+static gsize
+text_search_get_offset (TextSearchCache   *cache,
+			const GtkTextIter *iter)
+{
+	int line;
+
+	line = gtk_text_iter_get_line (iter);
+	line = CLAMP (line, 0, (int) cache->line_starts->len - 1);
+
+	return g_array_index (cache->line_starts, gsize, line) +
+		gtk_text_iter_get_line_index (iter);
+}
+
+static void
+text_search_get_iter (TextSearchCache *cache,
+		      GtkTextBuffer   *buffer,
+		      GtkTextIter     *iter,
+		      gsize            offset)
+{
+	guint low, high, mid;
+
+	low = 0;
+	high = cache->line_starts->len;
+
+	/* last line starting at or before offset */
+	while (high - low > 1) {
+		mid = (low + high) / 2;
+
+		if (g_array_index (cache->line_starts, gsize, mid) <= offset)
+			low = mid;
+		else
+			high = mid;
+	}
+
+	gtk_text_buffer_get_iter_at_line_index
+		(buffer, iter, low, offset - g_array_index (cache->line_starts, gsize, low));
+}
+
+static gboolean
+text_search_equal (const guchar *text,
+		   const guchar *pattern,
+		   gsize         length)
+{
+	while (length-- > 0) {
+		if (FOLD (text[length]) != pattern[length])
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* first match starting at or after from. patterns without letters
+ * go to memmem(), which is vectorized in any decent libc, others
+ * use Boyer-Moore-Horspool on ASCII folded bytes. */
+static gssize
+text_search_forward (const guchar *text,
+		     gsize         length,
+		     const guchar *pattern,
+		     gsize         pattern_length,
+		     gboolean      fold,
+		     gsize         from)
+{
+	gsize  shift[256];
+	gsize  i, pos;
+	guchar c, last;
+
+	if (pattern_length > length || from > length - pattern_length)
+		return -1;
+
+	if (!fold) {
+		const guchar *p;
+
+		p = memmem (text + from, length - from, pattern, pattern_length);
+		return p ? p - text : -1;
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (shift); ++i)
+		shift[i] = pattern_length;
+	for (i = 0; i + 1 < pattern_length; ++i)
+		shift[pattern[i]] = pattern_length - 1 - i;
+
+	last = pattern[pattern_length - 1];
+	pos = from;
+
+	while (pos <= length - pattern_length) {
+		c = FOLD (text[pos + pattern_length - 1]);
+
+		if (c == last && text_search_equal (text + pos, pattern, pattern_length - 1))
+			return pos;
+
+		pos += shift[c];
+	}
+
+	return -1;
+}
+
+/* last match starting before the given offset,
+ * Horspool's algorithm mirrored to run right to left */
+static gssize
+text_search_backward (const guchar *text,
+		      gsize         length,
+		      const guchar *pattern,
+		      gsize         pattern_length,
+		      gboolean      fold,
+		      gsize         before)
+{
+	gsize  shift[256];
+	gsize  i, pos;
+	guchar c, first;
+
+	if (pattern_length > length || before == 0)
+		return -1;
+
+	for (i = 0; i < G_N_ELEMENTS (shift); ++i)
+		shift[i] = pattern_length;
+	for (i = pattern_length - 1; i > 0; --i)
+		shift[pattern[i]] = i;
+
+	first = pattern[0];
+	pos = MIN (before - 1, length - pattern_length);
+
+	while (TRUE) {
+		c = text[pos];
+
+		if (fold)
+			c = FOLD (c);
+
+		if (c == first && (fold ?
+		    text_search_equal (text + pos + 1, pattern + 1, pattern_length - 1) :
+		    !memcmp (text + pos + 1, pattern + 1, pattern_length - 1)))
+			return pos;
+
+		if (pos < shift[c])
+			break;
+
+		pos -= shift[c];
+	}
+
+	return -1;
+}
+
+/* the former GtkSourceIter based search, used for terms which cannot
+ * be folded bytewise */
+static gboolean
+text_search_source_iter (GtkTextBuffer         *buffer,
+			 const gchar           *search_term,
+			 const GtkTextIter     *origin,
+			 GiggleSearchDirection  direction,
+			 GtkTextIter           *match_start,
+			 GtkTextIter           *match_end)
+{
+	GtkSourceSearchFlags flags;
+	GtkTextIter          start, end, cursor;
+	gboolean             result = FALSE;
+
+	flags = GTK_SOURCE_SEARCH_TEXT_ONLY |
+		GTK_SOURCE_SEARCH_CASE_INSENSITIVE;
+
+	gtk_text_buffer_get_bounds (buffer, &start, &end);
+
+	switch (direction) {
+	case GIGGLE_SEARCH_DIRECTION_NEXT:
+		if (origin) {
+			cursor = *origin;
+
+			result = gtk_source_iter_forward_search (&cursor, search_term, flags,
+								 match_start, match_end, NULL);
+
+			if (result && gtk_text_iter_equal (&cursor, match_start)) {
+				gtk_text_iter_forward_char (&cursor);
+
+				result = gtk_source_iter_forward_search (&cursor, search_term, flags,
+									 match_start, match_end, NULL);
+			}
+		}
+
+		if (!result) {
+			result = gtk_source_iter_forward_search (&start, search_term, flags,
+								 match_start, match_end, NULL);
+		}
+
+		break;
+
+	case GIGGLE_SEARCH_DIRECTION_PREV:
+		if (origin) {
+			cursor = *origin;
+
+			result = gtk_source_iter_backward_search (&cursor, search_term, flags,
+								  match_start, match_end, NULL);
+
+			if (result && gtk_text_iter_equal (&cursor, match_start)) {
+				gtk_text_iter_backward_char (&cursor);
+
+				result = gtk_source_iter_backward_search (&cursor, search_term, flags,
+									  match_start, match_end, NULL);
+			}
+		}
+
+		if (!result) {
+			result = gtk_source_iter_backward_search (&end, search_term, flags,
+								  match_start, match_end, NULL);
+		}
+
+		break;
+	}
+
+	return result;
+}
+
+/* Searches the casefolded search_term in buffer. Without origin the
+ * first (or last) match of the buffer is returned, otherwise the next
+ * match after (or before) origin, wrapping around at the buffer bounds.
+ *
+ * The buffer's text is copied on the first search after each change,
+ * so incremental searching doesn't need to walk the text btree. */
+gboolean
+giggle_text_buffer_search (GtkTextBuffer         *buffer,
+			   const gchar           *search_term,
+			   const GtkTextIter     *origin,
+			   GiggleSearchDirection  direction,
+			   GtkTextIter           *match_start,
+			   GtkTextIter           *match_end)
+{
+	TextSearchCache *cache;
+	const guchar    *text;
+	guchar          *pattern;
+	gsize            length, i;
+	gssize           match = -1;
+	gsize            offset;
+	gboolean         fold = FALSE;
+
+	g_return_val_if_fail (GTK_IS_TEXT_BUFFER (buffer), FALSE);
+	g_return_val_if_fail (NULL != search_term, FALSE);
+	g_return_val_if_fail (NULL != match_start, FALSE);
+	g_return_val_if_fail (NULL != match_end, FALSE);
+
+	length = strlen (search_term);
+
+	if (!length)
+		return FALSE;
+
+	pattern = (guchar *) g_strdup (search_term);
+
+	for (i = 0; i < length; ++i) {
+		if (pattern[i] & 0x80) {
+			g_free (pattern);
+
+			return text_search_source_iter (buffer, search_term, origin,
+							direction, match_start, match_end);
+		}
+
+		if (g_ascii_isalpha (pattern[i])) {
+			pattern[i] = FOLD (pattern[i]);
+			fold = TRUE;
+		}
+	}
+
+	cache = text_search_get_cache (buffer);
+	text = (const guchar *) cache->text;
+
+	switch (direction) {
+	case GIGGLE_SEARCH_DIRECTION_NEXT:
+		if (origin) {
+			offset = text_search_get_offset (cache, origin);
+			match = text_search_forward (text, cache->length, pattern,
+						     length, fold, offset + 1);
+		}
+
+		if (match < 0) {
+			match = text_search_forward (text, cache->length, pattern,
+						     length, fold, 0);
+		}
+
+		break;
+
+	case GIGGLE_SEARCH_DIRECTION_PREV:
+		if (origin) {
+			offset = text_search_get_offset (cache, origin);
+			match = text_search_backward (text, cache->length, pattern,
+						      length, fold, offset);
+		}
+
+		if (match < 0) {
+			match = text_search_backward (text, cache->length, pattern,
+						      length, fold, cache->length);
+		}
+
+		break;
+	}
+
+	g_free (pattern);
+
+	if (match < 0)
+		return FALSE;
+
+	text_search_get_iter (cache, buffer, match_start, match);
+	text_search_get_iter (cache, buffer, match_end, match + length);
+
+	return TRUE;
+}
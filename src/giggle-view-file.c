@@ -23,24 +23,25 @@
 
 #include "giggle-file-list.h"
 #include "giggle-rev-list-view.h"
+#include "giggle-revision-model.h"
+#include "giggle-text-search.h"
 #include "giggle-view-history.h"
 
 #include <libgiggle/giggle-history.h>
 #include <libgiggle/giggle-searchable.h>
 #include <libgiggle/giggle-view-shell.h>
 
+#include <libgiggle-git/giggle-blame-cache.h>
 #include <libgiggle-git/giggle-git.h>
 #include <libgiggle-git/giggle-git-blame.h>
 #include <libgiggle-git/giggle-git-cat-file.h>
 #include <libgiggle-git/giggle-git-revisions.h>
-#include <libgiggle-git/giggle-git-list-tree.h>
 #include <libgiggle-git/giggle-git-config.h>
 
 #include <fnmatch.h>
 #include <gio/gio.h>
 #include <glib/gi18n.h>
 
-#include <gtksourceview/gtksourceiter.h>
 #include <gtksourceview/gtksourcelanguagemanager.h>
 #include <gtksourceview/gtksourceview.h>
 
@@ -53,10 +54,26 @@
 
 #define GET_PRIV(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIGGLE_TYPE_VIEW_FILE, GiggleViewFilePriv))
 
-#define CHUNK_NAME(state, suffix) \
-	(GTK_STATE_SELECTED == (state) \
-		? "giggle-chunk-selected-" suffix \
-		: "giggle-chunk-"          suffix)
+#define CHUNK_MARKER_WIDTH	16
+#define N_CHUNK_STATES		2 /* normal and selected */
+
+/* files bigger than this only get a page of their lines into the buffer */
+#define LARGE_FILE_DEFAULT_SIZE	(4 << 20)
+#define LARGE_FILE_PAGE_LINES	2000
+#define LARGE_FILE_PAGE_BYTES	(1 << 20)
+#define LARGE_FILE_PAGE_MARGIN	200
+#define LARGE_FILE_MAX_LINE	(16 << 10)
+
+/* how many revisions before and after the current one get prefetched */
+#define PREFETCH_DISTANCE	2
+
+typedef enum {
+	CHUNK_START,
+	CHUNK_START_END,
+	CHUNK_MIDDLE,
+	CHUNK_END,
+	N_CHUNK_CATEGORIES
+} ChunkCategory;
 
 typedef struct {
 	GtkWidget           *file_list;
@@ -74,10 +91,60 @@ typedef struct {
 	GiggleJob           *job;
 
 	char                *current_file;
+	char                *current_blob;
 	GiggleRevision      *current_revision;
 	GiggleGitConfig     *configuration;
+
+	/* blame of the shown file, sorted by line, chunks don't overlap */
+	GArray              *blame_chunks;
+	GPtrArray           *blame_revisions;
+	GHashTable          *blame_revision_ids;
+	GiggleBlameCache    *blame_cache;
+
+	/* the revision blamed once all chunks got added */
+	GiggleRevision      *blame_revision;
+
+	/* contents of a large file, which the buffer shows
+	 * lines page_start to page_end (exclusive) of,
+	 * kept alive by page_data until page_destroy */
+	gpointer             page_data;
+	GDestroyNotify       page_destroy;
+	const char          *page_text;
+	gsize                page_length;
+	GArray              *page_lines;
+	int                  page_start;
+	int                  page_end;
+	guint                page_idle_id;
+	guint                page_scrolling : 1;
+
+	cairo_surface_t     *chunk_atlas;
+	int                  chunk_atlas_height;
+
+	/* revisions around the current one, by sha */
+	GHashTable          *prefetched;
+	GiggleJob           *prefetch_job;
+	GiggleRevision      *prefetch_revision;
+	guint                prefetch_idle_id;
 } GiggleViewFilePriv;
 
+typedef struct {
+	int start; /* first line, counting from 0 */
+	int count;
+	int revision; /* index into blame_revisions */
+} ViewFileBlameChunk;
+
+typedef struct {
+	GiggleRevision   *revision;
+	GiggleGitCatFile *blob; /* NULL if it wasn't worth keeping */
+	gboolean          blamed;
+} ViewFilePrefetch;
+
+/* what pruning the prefetched revisions keeps around */
+typedef struct {
+	GiggleViewFile *view;
+	int             current; /* row of the current revision */
+} ViewFilePrefetchPrune;
+
 typedef struct {
 	GObject parent;
 
@@ -102,6 +169,11 @@ static void	giggle_view_file_history_init		(GiggleHistoryIface    *iface);
 
 static GType	giggle_view_file_snapshot_get_type	(void) G_GNUC_CONST;
 
+static void	view_file_cancel_prefetch		(GiggleViewFile        *view);
+static void	view_file_schedule_prefetch		(GiggleViewFile        *view);
+static void	view_file_vadjustment_value_changed_cb	(GtkAdjustment         *adjustment,
+							 GiggleViewFile        *view);
+
 
 G_DEFINE_TYPE_WITH_CODE (GiggleViewFile, giggle_view_file, GIGGLE_TYPE_VIEW,
 			 G_IMPLEMENT_INTERFACE (GIGGLE_TYPE_SEARCHABLE,
@@ -146,11 +218,71 @@ view_file_set_property (GObject      *object,
 	}
 }
 
+static void
+view_file_set_blame_revision (GiggleViewFilePriv *priv,
+			      GiggleRevision     *revision)
+{
+	if (revision)
+		g_object_ref (revision);
+	if (priv->blame_revision)
+		g_object_unref (priv->blame_revision);
+
+	priv->blame_revision = revision;
+}
+
+static void
+view_file_clear_blame (GiggleViewFilePriv *priv)
+{
+	view_file_set_blame_revision (priv, NULL);
+
+	g_array_set_size (priv->blame_chunks, 0);
+	g_hash_table_remove_all (priv->blame_revision_ids);
+
+	g_ptr_array_foreach (priv->blame_revisions, (GFunc) g_object_unref, NULL);
+	g_ptr_array_set_size (priv->blame_revisions, 0);
+}
+
+static void
+view_file_clear_page (GiggleViewFilePriv *priv)
+{
+	if (priv->page_idle_id) {
+		g_source_remove (priv->page_idle_id);
+		priv->page_idle_id = 0;
+	}
+
+	if (priv->page_destroy)
+		priv->page_destroy (priv->page_data);
+
+	if (priv->page_lines) {
+		g_array_free (priv->page_lines, TRUE);
+		priv->page_lines = NULL;
+	}
+
+	priv->page_data = NULL;
+	priv->page_destroy = NULL;
+	priv->page_scrolling = FALSE;
+	priv->page_text = NULL;
+	priv->page_length = 0;
+	priv->page_start = 0;
+	priv->page_end = 0;
+}
+
 static void
 view_file_finalize (GObject *object)
 {
 	GiggleViewFilePriv *priv = GET_PRIV (object);
 
+	view_file_clear_blame (priv);
+
+	g_array_free (priv->blame_chunks, TRUE);
+	g_ptr_array_free (priv->blame_revisions, TRUE);
+	g_hash_table_destroy (priv->blame_revision_ids);
+	g_hash_table_destroy (priv->prefetched);
+
+	if (priv->chunk_atlas)
+		cairo_surface_destroy (priv->chunk_atlas);
+
+	g_free (priv->current_blob);
 	g_free (priv->current_file);
 
 	G_OBJECT_CLASS (giggle_view_file_parent_class)->finalize (object);
@@ -173,11 +305,35 @@ view_file_set_focus_cb (GtkWindow      *window,
 	gtk_action_set_sensitive (action, GTK_WIDGET_HAS_FOCUS (priv->source_view));
 }
 
+static void
+view_file_cancel_job (GiggleViewFile *view)
+{
+	GiggleViewFilePriv *priv = GET_PRIV (view);
+
+	/* cancelled jobs don't run their callback */
+	if (priv->job) {
+		giggle_git_cancel_job (priv->git, priv->job);
+		g_object_unref (priv->job);
+		priv->job = NULL;
+	}
+}
+
 static void
 view_file_dispose (GObject *object)
 {
 	GiggleViewFilePriv *priv = GET_PRIV (object);
 
+	view_file_cancel_job (GIGGLE_VIEW_FILE (object));
+	view_file_cancel_prefetch (GIGGLE_VIEW_FILE (object));
+	view_file_clear_page (priv);
+
+	g_hash_table_remove_all (priv->prefetched);
+
+	if (priv->blame_cache) {
+		g_object_unref (priv->blame_cache);
+		priv->blame_cache = NULL;
+	}
+
 	if (priv->configuration) {
 		g_object_unref (priv->configuration);
 		priv->configuration = NULL;
@@ -237,34 +393,154 @@ view_file_revision_list_revision_activated_cb (GiggleRevListView *list,
 	}
 }
 
-static GiggleRevision *
-source_view_get_revision_at_iter (GtkTextIter *iter)
+/* index of the first chunk which ends after line */
+static int
+view_file_find_blame_chunk (GiggleViewFilePriv *priv,
+			    int                 line)
 {
-	GiggleRevision *revision = NULL;
-	GSList         *l;
+	ViewFileBlameChunk *chunk;
+	int                 lower, upper, i;
 
-	for (l = gtk_text_iter_get_marks (iter); l; l = l->next) {
-		revision = g_object_get_data (l->data, "giggle-revision");
+	lower = 0;
+	upper = priv->blame_chunks->len;
 
-		if (revision)
-			break;
+	while (lower < upper) {
+		i = (lower + upper) / 2;
+		chunk = &g_array_index (priv->blame_chunks, ViewFileBlameChunk, i);
+
+		if (chunk->start + chunk->count <= line)
+			lower = i + 1;
+		else
+			upper = i;
 	}
 
-	return revision;
+	return lower;
 }
 
 static GiggleRevision *
-source_view_get_revision_at_insert (GtkTextView *view)
+view_file_get_revision_at_line (GiggleViewFilePriv *priv,
+				int                 line)
+{
+	ViewFileBlameChunk *chunk;
+	int                 i;
+
+	i = view_file_find_blame_chunk (priv, line);
+
+	if (i >= priv->blame_chunks->len)
+		return NULL;
+
+	chunk = &g_array_index (priv->blame_chunks, ViewFileBlameChunk, i);
+
+	if (chunk->start > line)
+		return NULL;
+
+	return priv->blame_revisions->pdata[chunk->revision];
+}
+
+static GiggleRevision *
+view_file_get_revision_at_insert (GiggleViewFilePriv *priv)
 {
 	GtkTextBuffer *buffer;
 	GtkTextMark   *insert;
 	GtkTextIter    iter;
 
-	buffer = gtk_text_view_get_buffer (view);
+	buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->source_view));
 	insert = gtk_text_buffer_get_insert (buffer);
 	gtk_text_buffer_get_iter_at_mark (buffer, &iter, insert);
 
-	return source_view_get_revision_at_iter (&iter);
+	return view_file_get_revision_at_line (priv, priv->page_start +
+					       gtk_text_iter_get_line (&iter));
+}
+
+/* the file's history, newest revision first */
+static GiggleRevisionModel *
+view_file_get_history (GiggleViewFile *view)
+{
+	GiggleViewFilePriv *priv;
+	GtkTreeModel       *model;
+
+	priv = GET_PRIV (view);
+	model = giggle_rev_list_view_get_model (GIGGLE_REV_LIST_VIEW (priv->revision_list));
+
+	if (!GIGGLE_IS_REVISION_MODEL (model))
+		return NULL;
+
+	return GIGGLE_REVISION_MODEL (model);
+}
+
+/* row of the current revision in the file's history, or -1 */
+static int
+view_file_get_current_row (GiggleViewFile *view)
+{
+	GiggleViewFilePriv  *priv;
+	GiggleRevisionModel *model;
+	GiggleRevision      *row;
+	int                  i, n_rows;
+
+	priv = GET_PRIV (view);
+	model = view_file_get_history (view);
+
+	if (!priv->current_revision || !model)
+		return -1;
+
+	n_rows = giggle_revision_model_get_length (model);
+
+	for (i = 0; i < n_rows; ++i) {
+		row = giggle_revision_model_peek_nth (model, i);
+
+		if (row && !giggle_revision_compare (row, priv->current_revision))
+			return i;
+	}
+
+	return -1;
+}
+
+static GiggleRevision *
+view_file_get_history_row (GiggleViewFile *view,
+			   int             i)
+{
+	GiggleRevisionModel *model;
+
+	model = view_file_get_history (view);
+
+	if (!model || i < 0 || i >= giggle_revision_model_get_length (model))
+		return NULL;
+
+	return giggle_revision_model_peek_nth (model, i);
+}
+
+static void
+view_file_step_revision (GiggleViewFile *view,
+			 int             step)
+{
+	GiggleViewFilePriv *priv = GET_PRIV (view);
+	GiggleRevision     *revision;
+	GList              *selection;
+	int                 current;
+
+	current = view_file_get_current_row (view);
+	revision = view_file_get_history_row (view, current + step);
+
+	if (current >= 0 && revision) {
+		selection = g_list_prepend (NULL, revision);
+		giggle_rev_list_view_set_selection (GIGGLE_REV_LIST_VIEW (priv->revision_list),
+						    selection);
+		g_list_free (selection);
+	}
+}
+
+static void
+view_file_older_revision_cb (GtkAction      *action,
+			     GiggleViewFile *view)
+{
+	view_file_step_revision (view, 1);
+}
+
+static void
+view_file_newer_revision_cb (GtkAction      *action,
+			     GiggleViewFile *view)
+{
+	view_file_step_revision (view, -1);
 }
 
 static void
@@ -277,7 +553,7 @@ view_file_show_changeset_cb (GtkAction      *action,
 	if (GTK_WIDGET_HAS_FOCUS (priv->revision_list)) {
 		revision = priv->current_revision;
 	} else if (GTK_WIDGET_HAS_FOCUS (priv->source_view)) {
-		revision = source_view_get_revision_at_insert (GTK_TEXT_VIEW (priv->source_view));
+		revision = view_file_get_revision_at_insert (priv);
 	}
 
 	if (revision) {
@@ -296,7 +572,7 @@ view_file_select_revision_cb (GtkAction      *action,
 	GList              *selection;
 
 	if (GTK_WIDGET_HAS_FOCUS (priv->source_view))
-		revision = source_view_get_revision_at_insert (GTK_TEXT_VIEW (priv->source_view));
+		revision = view_file_get_revision_at_insert (priv);
 
 	if (revision) {
 		selection = g_list_prepend (NULL, revision);
@@ -319,6 +595,9 @@ view_file_add_ui (GiggleView   *view,
 		"      <separator />"
 		"      <menuitem action='ViewFileShowChangeSet' />"
 		"      <menuitem action='ViewFileSelectRevision' />"
+		"      <separator />"
+		"      <menuitem action='ViewFileOlderRevision' />"
+		"      <menuitem action='ViewFileNewerRevision' />"
 		"    </menu>"
 		"  </menubar>"
 		"</ui>";
@@ -339,6 +618,16 @@ view_file_add_ui (GiggleView   *view,
 		  N_("Select revision of selected line"),
 		  G_CALLBACK (view_file_select_revision_cb)
 		},
+		{ "ViewFileOlderRevision", GTK_STOCK_GO_DOWN,
+		  N_("_Older Revision"), "<alt>Page_Down",
+		  N_("Show the file as of its previous revision"),
+		  G_CALLBACK (view_file_older_revision_cb)
+		},
+		{ "ViewFileNewerRevision", GTK_STOCK_GO_UP,
+		  N_("_Newer Revision"), "<alt>Page_Up",
+		  N_("Show the file as of its next revision"),
+		  G_CALLBACK (view_file_newer_revision_cb)
+		},
 	};
 
 	GiggleViewFilePriv *priv = GET_PRIV (view);
@@ -380,47 +669,13 @@ view_file_remove_ui (GiggleView *view)
 	}
 }
 
-static inline guint8
-convert_color_channel (guint  src,
-                       guint8 alpha)
-{
-	return (alpha ? ((src << 8) - src) / alpha : 0);
-}
-
-static GdkPixbuf *
-create_pixbuf_from_image (cairo_surface_t *image)
-{
-	int           width, height, stride, x, y;
-	const guint8 *source, *s, *rs;
-	guchar       *target, *t, *rt;
-
-	width  = cairo_image_surface_get_width  (image);
-	height = cairo_image_surface_get_height (image);
-	stride = cairo_image_surface_get_stride (image);
-	source = cairo_image_surface_get_data   (image);
-
-	target = g_new (guchar, stride * height);
-
-	for (y = 0, s = source, t = target; y < height; ++y, s += stride, t += stride) {
-		for (x = 0, rs = s, rt = t; x < width; ++x, rs += 4, rt += 4) {
-			rt[0] = convert_color_channel (rs[2], rs[3]);
-			rt[1] = convert_color_channel (rs[1], rs[3]);
-			rt[2] = convert_color_channel (rs[0], rs[3]);
-			rt[3] =                               rs[3];
-		}
-	}
-
-	return gdk_pixbuf_new_from_data (target, GDK_COLORSPACE_RGB,
-			                 TRUE, 8, width, height, stride,
-					 (GdkPixbufDestroyNotify) g_free, NULL);
-}
-
 static void
-render_chunk_marker (cairo_t    *cr,
-		     const char *name,
-		     int         width,
-		     int         height,
-		     GdkColor   *color)
+render_chunk_marker (cairo_t      *cr,
+		     ChunkCategory category,
+		     GtkStateType  state,
+		     int           width,
+		     int           height,
+		     GdkColor     *color)
 {
 	double           r, g, b;
 	double           x0, y0, x1, y1;
@@ -429,14 +684,11 @@ render_chunk_marker (cairo_t    *cr,
 	gboolean         end = FALSE;
 	cairo_pattern_t *gradient;
 
-	if (!g_str_has_prefix (name, "giggle-chunk-"))
-		return;
-
-	if (strstr (name, "-selected"))
+	if (GTK_STATE_SELECTED == state)
 		alpha = 1.0;
-	if (strstr (name, "-start"))
+	if (CHUNK_START == category || CHUNK_START_END == category)
 		start = TRUE;
-	if (strstr (name, "-end"))
+	if (CHUNK_END == category || CHUNK_START_END == category)
 		end = TRUE;
 
 	x0 = 2;
@@ -524,47 +776,94 @@ render_chunk_marker (cairo_t    *cr,
 	cairo_stroke (cr);
 }
 
-static GdkPixbuf *
-create_category_icon (GiggleViewFilePriv *priv,
-		      const char         *name)
+/* height of a line which isn't wrapped, as the text view lays it out */
+static int
+view_file_get_line_height (GiggleViewFilePriv *priv)
 {
-	int              width, height;
-	GdkColor        *color;
-	GdkPixbuf       *pixbuf;
-	cairo_surface_t *image;
-	cairo_t         *canvas;
+	GtkTextView *text_view;
+	PangoLayout *layout;
+	int          height;
 
-	gtk_icon_size_lookup (GTK_ICON_SIZE_MENU, &width, &height);
-	image = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+	text_view = GTK_TEXT_VIEW (priv->source_view);
 
-	canvas = cairo_create (image);
-	color = &priv->source_view->style->base[GTK_STATE_SELECTED];
-	pixbuf = create_pixbuf_from_image (image);
-
-	cairo_surface_destroy (image);
-	cairo_destroy (canvas);
+	layout = gtk_widget_create_pango_layout (priv->source_view, "X");
+	pango_layout_get_pixel_size (layout, NULL, &height);
+	g_object_unref (layout);
 
-	return pixbuf;
+	return height +
+		gtk_text_view_get_pixels_above_lines (text_view) +
+		gtk_text_view_get_pixels_below_lines (text_view);
 }
 
-static void
-create_category (GiggleViewFilePriv *priv,
-		 const char         *name)
+/* all chunk markers for the current style and font,
+ * one column per category, one row per state */
+static cairo_surface_t *
+view_file_get_chunk_atlas (GiggleViewFilePriv *priv,
+			   cairo_t            *cr)
 {
+	static const char *const icon_names[N_CHUNK_STATES][N_CHUNK_CATEGORIES] = {
+		{ "giggle-chunk-start", "giggle-chunk-start-end",
+		  "giggle-chunk-middle", "giggle-chunk-end" },
+		{ "giggle-chunk-selected-start", "giggle-chunk-selected-start-end",
+		  "giggle-chunk-selected-middle", "giggle-chunk-selected-end" },
+	};
+
+	GdkColor  *color;
 	GdkPixbuf *pixbuf;
+	cairo_t   *canvas;
+	int        category, row, height;
+
+	if (priv->chunk_atlas)
+		return priv->chunk_atlas;
+
+	height = view_file_get_line_height (priv);
+
+	/* similar to the target, so drawing from it is a plain blit */
+	priv->chunk_atlas = cairo_surface_create_similar
+		(cairo_get_target (cr), CAIRO_CONTENT_COLOR_ALPHA,
+		 CHUNK_MARKER_WIDTH * N_CHUNK_CATEGORIES, height * N_CHUNK_STATES);
+	priv->chunk_atlas_height = height;
+
+	color = &priv->source_view->style->base[GTK_STATE_SELECTED];
+	canvas = cairo_create (priv->chunk_atlas);
+
+	for (row = 0; row < N_CHUNK_STATES; ++row) {
+		for (category = 0; category < N_CHUNK_CATEGORIES; ++category) {
+			cairo_save (canvas);
+			cairo_translate (canvas, category * CHUNK_MARKER_WIDTH, row * height);
+			cairo_rectangle (canvas, 0, 0, CHUNK_MARKER_WIDTH, height);
+			cairo_clip (canvas);
+
+			/* themes still can provide their own markers */
+			pixbuf = gtk_widget_render_icon (priv->source_view,
+							 icon_names[row][category],
+							 GTK_ICON_SIZE_MENU, NULL);
+
+			if (pixbuf) {
+				gdk_cairo_set_source_pixbuf (canvas, pixbuf, 0, 0);
+				cairo_paint (canvas);
+				g_object_unref (pixbuf);
+			} else {
+				render_chunk_marker (canvas, category,
+						     row ? GTK_STATE_SELECTED : GTK_STATE_NORMAL,
+						     CHUNK_MARKER_WIDTH, height, color);
+			}
 
-	pixbuf = gtk_widget_render_icon (priv->source_view, name,
-					 GTK_ICON_SIZE_MENU, NULL);
+			cairo_restore (canvas);
+		}
+	}
+
+	cairo_destroy (canvas);
 
-	if (!pixbuf)
-		pixbuf = create_category_icon (priv, name);
-	
-	if (pixbuf) {
-		gtk_source_view_set_mark_category_pixbuf
-			(GTK_SOURCE_VIEW (priv->source_view),
-			 name, pixbuf);
+	return priv->chunk_atlas;
+}
 
-		g_object_unref (pixbuf);
+static void
+view_file_clear_chunk_atlas (GiggleViewFilePriv *priv)
+{
+	if (priv->chunk_atlas) {
+		cairo_surface_destroy (priv->chunk_atlas);
+		priv->chunk_atlas = NULL;
 	}
 }
 
@@ -573,17 +872,38 @@ source_view_style_set_cb (GtkWidget      *widget,
 			  GtkStyle       *prev,
 			  GiggleViewFile *view)
 {
-	GiggleViewFilePriv *priv = GET_PRIV (view);
+	view_file_clear_chunk_atlas (GET_PRIV (view));
+}
+
+static ChunkCategory
+get_line_category (int line,
+		   int num_lines)
+{
+	if (!line) {
+		if (1 == num_lines)
+			return CHUNK_START_END;
+
+		return CHUNK_START;
+	}
+
+	if (line < num_lines - 1)
+		return CHUNK_MIDDLE;
+
+	return CHUNK_END;
+}
+
+static GtkStateType
+get_chunk_state (GiggleViewFilePriv       *priv,
+		 const ViewFileBlameChunk *chunk)
+{
+	GiggleRevision *revision;
 
-	create_category (priv, "giggle-chunk-start");
-	create_category (priv, "giggle-chunk-start-end");
-	create_category (priv, "giggle-chunk-middle");
-	create_category (priv, "giggle-chunk-end");
+	revision = priv->blame_revisions->pdata[chunk->revision];
+
+	if (!giggle_revision_compare (priv->current_revision, revision))
+		return GTK_STATE_SELECTED;
 
-	create_category (priv, "giggle-chunk-selected-start");
-	create_category (priv, "giggle-chunk-selected-start-end");
-	create_category (priv, "giggle-chunk-selected-middle");
-	create_category (priv, "giggle-chunk-selected-end");
+	return GTK_STATE_NORMAL;
 }
 
 static gboolean
@@ -592,307 +912,1068 @@ source_view_expose_event_cb (GtkTextView    *text_view,
 			     GiggleViewFile *view)
 {
 	GiggleViewFilePriv *priv = GET_PRIV (view);
-	GtkSourceBuffer    *buffer;
+	ViewFileBlameChunk *chunk;
 	GdkRectangle        visible_rect;
-	int                 y, height;
-	int                 margin_width;
+	int                 y, height, line, i;
+	int                 margin_width, state_chunk, x;
 	GdkWindow          *left_margin;
-	GSList             *markers;
-	const char         *name;
-	GdkColor           *color;
+	GtkStateType        state = GTK_STATE_NORMAL;
+	ChunkCategory       category;
+	cairo_surface_t    *atlas = NULL;
 	GtkTextIter         iter;
 	cairo_t            *cr;
 
 	left_margin = gtk_text_view_get_window (text_view, GTK_TEXT_WINDOW_LEFT);
 
-	if (left_margin != event->window)
+	if (left_margin != event->window || !priv->blame_chunks->len)
+		return FALSE;
+
+	cr = gdk_cairo_create (event->window);
+	gdk_cairo_region (cr, event->region);
+	cairo_clip (cr);
+
+	gtk_text_view_get_visible_rect (text_view, &visible_rect);
+	gtk_text_view_get_line_at_y (text_view, &iter, visible_rect.y, NULL);
+	visible_rect.y += visible_rect.height;
+
+	gdk_drawable_get_size (left_margin, &margin_width, NULL);
+	x = margin_width - CHUNK_MARKER_WIDTH; /* FIXME: see GB#572785 */
+
+	line = priv->page_start + gtk_text_iter_get_line (&iter);
+	i = view_file_find_blame_chunk (priv, line);
+	state_chunk = -1;
+
+	while (i < priv->blame_chunks->len) {
+		gtk_text_view_get_line_yrange (text_view, &iter, &y, &height);
+
+		if (y >= visible_rect.y)
+			break;
+
+		chunk = &g_array_index (priv->blame_chunks, ViewFileBlameChunk, i);
+
+		if (chunk->start <= line) {
+			if (state_chunk != i) {
+				state = get_chunk_state (priv, chunk);
+				state_chunk = i;
+			}
+
+			category = get_line_category (line - chunk->start, chunk->count);
+
+			gtk_text_view_buffer_to_window_coords (text_view, GTK_TEXT_WINDOW_LEFT,
+							       0, y, NULL, &y);
+
+			if (!atlas)
+				atlas = view_file_get_chunk_atlas (priv, cr);
+
+			if (height == priv->chunk_atlas_height) {
+				cairo_set_source_surface (cr, atlas,
+							  x - category * CHUNK_MARKER_WIDTH,
+							  y - (GTK_STATE_SELECTED == state) * height);
+				cairo_rectangle (cr, x, y, CHUNK_MARKER_WIDTH, height);
+				cairo_fill (cr);
+			} else {
+				/* the atlas only fits lines of the font's height */
+				cairo_save (cr);
+				cairo_translate (cr, x, y);
+				render_chunk_marker (cr, category, state, CHUNK_MARKER_WIDTH, height,
+						     &priv->source_view->style->base[GTK_STATE_SELECTED]);
+				cairo_restore (cr);
+			}
+		}
+
+		/* chunks never overlap, so the next one can't end before line */
+		if (chunk->start + chunk->count <= ++line)
+			++i;
+
+		if (!gtk_text_iter_forward_line (&iter))
+			break;
+	}
+
+	cairo_destroy (cr);
+
+	return FALSE;
+}
+
+static void
+giggle_view_file_class_init (GiggleViewFileClass *class)
+{
+	GObjectClass    *object_class = G_OBJECT_CLASS (class);
+	GiggleViewClass *view_class   = GIGGLE_VIEW_CLASS (class);
+
+	object_class->get_property = view_file_get_property;
+	object_class->set_property = view_file_set_property;
+	object_class->finalize     = view_file_finalize;
+	object_class->dispose      = view_file_dispose;
+
+	view_class->add_ui         = view_file_add_ui;
+	view_class->remove_ui      = view_file_remove_ui;
+
+	g_object_class_install_property (object_class,
+					 PROP_PATH,
+					 g_param_spec_string ("path",
+							      "Path",
+							      "The currently selected path",
+							      NULL, G_PARAM_READWRITE));
+
+	g_type_class_add_private (object_class, sizeof (GiggleViewFilePriv));
+}
+
+static void
+show_error (GiggleViewFile *view,
+	    const char     *message,
+	    const GError   *error)
+{
+	GtkWidget *dialog;
+
+	dialog = gtk_message_dialog_new (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (view))),
+					 GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+					 GTK_MESSAGE_ERROR,
+					 GTK_BUTTONS_OK,
+					 message, error->message);
+
+	gtk_dialog_run (GTK_DIALOG (dialog));
+	gtk_widget_destroy (dialog);
+}
+
+static GtkSourceLanguage *
+view_file_find_language (GiggleViewFile *view,
+			 const char     *text,
+			 gsize	         len)
+{
+	GtkSourceLanguageManager *manager;
+	GiggleViewFilePriv       *priv;
+	GtkSourceLanguage        *lang;
+	const char *const        *ids;
+	char                     *content_type, *filename;
+	char                    **meta, **s;
+
+	priv = GET_PRIV (view);
+
+	manager = gtk_source_language_manager_get_default ();
+	ids = gtk_source_language_manager_get_language_ids (manager);
+
+	content_type = g_content_type_guess (priv->current_file, text, len, NULL);
+	filename = g_path_get_basename (priv->current_file);
+
+	for (; *ids; ++ids) {
+		lang = gtk_source_language_manager_get_language (manager, *ids);
+		meta = gtk_source_language_get_mime_types (lang);
+
+		if (meta) {
+			for (s = meta; *s; ++s) {
+				if (!strcmp (*s, content_type))
+					goto end;
+			}
+
+			g_strfreev (meta);
+		}
+
+		meta = gtk_source_language_get_globs (lang);
+
+		if (meta) {
+			for (s = meta; *s; ++s) {
+				if (!fnmatch (*s, filename, 0)) {
+					goto end;
+				}
+			}
+
+			g_strfreev (meta);
+		}
+	}
+
+	lang = NULL;
+
+end:
+	g_free (content_type);
+	g_free (filename);
+
+	return lang;
+}
+
+static gsize
+view_file_get_large_file_size (GiggleViewFilePriv *priv)
+{
+	int size;
+
+	size = giggle_git_config_get_int_field (priv->configuration,
+						GIGGLE_GIT_CONFIG_FIELD_FILE_VIEW_LARGE_FILE_SIZE);
+
+	return size > 0 ? size : LARGE_FILE_DEFAULT_SIZE;
+}
+
+/* pages straight out of text, which data keeps alive
+ * until destroy gets called, or out of a copy of it */
+static void
+view_file_map_text (GiggleViewFilePriv *priv,
+		    const char         *text,
+		    gsize               len,
+		    gpointer            data,
+		    GDestroyNotify      destroy)
+{
+	const char *p, *end;
+	gsize       offset;
+
+	if (!destroy) {
+		data = g_memdup (text, len);
+		destroy = g_free;
+		text = data;
+	}
+
+	priv->page_data = data;
+	priv->page_destroy = destroy;
+	priv->page_text = text;
+	priv->page_length = len;
+	priv->page_lines = g_array_new (FALSE, FALSE, sizeof (gsize));
+
+	end = priv->page_text + len;
+
+	for (p = priv->page_text; p && p < end; ) {
+		offset = p - priv->page_text;
+		g_array_append_val (priv->page_lines, offset);
+
+		if (NULL != (p = memchr (p, '\n', end - p)))
+			++p;
+	}
+}
+
+static gsize
+view_file_get_page_line (GiggleViewFilePriv  *priv,
+			 int                  line,
+			 const char         **text)
+{
+	gsize start, end;
+
+	start = g_array_index (priv->page_lines, gsize, line);
+
+	if (line + 1 < priv->page_lines->len)
+		end = g_array_index (priv->page_lines, gsize, line + 1);
+	else
+		end = priv->page_length;
+
+	if (text)
+		*text = priv->page_text + start;
+
+	return end - start;
+}
+
+/* shows the lines around center, returns FALSE if they're shown already */
+static gboolean
+view_file_fill_page (GiggleViewFile *view,
+		     int             center)
+{
+	GiggleViewFilePriv *priv;
+	GtkTextBuffer      *buffer;
+	GtkAdjustment      *adjustment;
+	GString            *page;
+	const char         *text, *cut;
+	gsize               length, bytes;
+	int                 start, end, i;
+
+	priv = GET_PRIV (view);
+	center = CLAMP (center, 0, (int) priv->page_lines->len - 1);
+
+	for (start = center, bytes = 0; start > 0 &&
+	     center - start < LARGE_FILE_PAGE_LINES / 2 &&
+	     bytes < LARGE_FILE_PAGE_BYTES / 2; --start)
+		bytes += MIN (view_file_get_page_line (priv, start - 1, NULL), LARGE_FILE_MAX_LINE);
+
+	for (end = center, bytes = 0; end < priv->page_lines->len &&
+	     end - center < LARGE_FILE_PAGE_LINES / 2 &&
+	     bytes < LARGE_FILE_PAGE_BYTES / 2; ++end)
+		bytes += MIN (view_file_get_page_line (priv, end, NULL), LARGE_FILE_MAX_LINE);
+
+	if (start == priv->page_start && end == priv->page_end)
+		return FALSE;
+
+	page = g_string_new (NULL);
+
+	for (i = start; i < end; ++i) {
+		length = view_file_get_page_line (priv, i, &text);
+
+		if (length > LARGE_FILE_MAX_LINE) {
+			/* minified code can put megabytes into one line,
+			 * which the text view won't lay out in any sane time */
+			cut = g_utf8_find_prev_char (text, text + LARGE_FILE_MAX_LINE);
+			g_string_append_len (page, text, cut ? cut - text : 0);
+
+			if ('\n' == text[length - 1])
+				g_string_append_c (page, '\n');
+		} else {
+			g_string_append_len (page, text, length);
+		}
+	}
+
+	priv->page_start = start;
+	priv->page_end = end;
+
+	/* replacing the text moves the adjustment, which would page again */
+	adjustment = gtk_scrolled_window_get_vadjustment
+		(GTK_SCROLLED_WINDOW (gtk_widget_get_parent (priv->source_view)));
+	g_signal_handlers_block_by_func (adjustment,
+					 view_file_vadjustment_value_changed_cb, view);
+
+	buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->source_view));
+	gtk_text_buffer_set_text (buffer, page->str, page->len);
+
+	g_signal_handlers_unblock_by_func (adjustment,
+					   view_file_vadjustment_value_changed_cb, view);
+
+	g_string_free (page, TRUE);
+
+	return TRUE;
+}
+
+/* data keeps text alive until destroy gets called,
+ * saving large files from getting copied for paging */
+static void
+view_file_set_source_code_full (GiggleViewFile *view,
+				const char     *text,
+				gsize           len,
+				gpointer        data,
+				GDestroyNotify  destroy)
+{
+	GiggleViewFilePriv *priv;
+	GtkTextBuffer      *buffer;
+	GtkSourceLanguage  *language = NULL;
+	gboolean            large;
+
+	priv = GET_PRIV (view);
+
+	view_file_clear_page (priv);
+
+	if (text && (gsize) -1 == len)
+		len = strlen (text);
+
+	large = (text && len > view_file_get_large_file_size (priv));
+
+	/* highlighting needs the entire file, line numbers would count from the
+	 * start of the page, and matching brackets doesn't scale to such files */
+	buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->source_view));
+	gtk_source_buffer_set_highlight_syntax (GTK_SOURCE_BUFFER (buffer), !large);
+	gtk_source_buffer_set_highlight_matching_brackets (GTK_SOURCE_BUFFER (buffer), !large);
+	gtk_source_view_set_show_line_numbers (GTK_SOURCE_VIEW (priv->source_view), !large);
+
+	gtk_widget_set_sensitive (priv->revision_list, NULL != text);
+	gtk_widget_set_sensitive (priv->source_view, NULL != text);
+
+	if (large) {
+		view_file_map_text (priv, text, len, data, destroy);
+		view_file_fill_page (view, 0);
+		destroy = NULL;
+	} else {
+		gtk_text_buffer_set_text (buffer, text ? text : "", len);
+	}
+
+	if (priv->action_group)
+		gtk_action_group_set_sensitive (priv->action_group, NULL != text);
+
+	if (text && !large)
+		language = view_file_find_language (view, text, len);
+
+	view_file_clear_blame (priv);
+	gtk_source_buffer_set_language (GTK_SOURCE_BUFFER (buffer), language);
+
+	if (destroy)
+		destroy (data);
+}
+
+static void
+view_file_set_source_code (GiggleViewFile *view,
+			   const char     *text,
+			   gsize	   len)
+{
+	view_file_set_source_code_full (view, text, len, NULL, NULL);
+}
+
+static int
+view_file_get_blame_revision_id (GiggleViewFilePriv *priv,
+				 GiggleRevision     *revision)
+{
+	int id;
+
+	/* blame resolves commits through the repository's registry,
+	 * so each of them comes with a single revision object */
+	id = GPOINTER_TO_INT (g_hash_table_lookup (priv->blame_revision_ids, revision));
+
+	if (!id) {
+		g_ptr_array_add (priv->blame_revisions, g_object_ref (revision));
+		id = priv->blame_revisions->len;
+
+		g_hash_table_insert (priv->blame_revision_ids,
+				     revision, GINT_TO_POINTER (id));
+	}
+
+	return id - 1;
+}
+
+static void
+view_file_blame_chunk_added_cb (GiggleGitBlame            *blame,
+				const GiggleGitBlameChunk *blame_chunk,
+				GiggleViewFile            *view)
+{
+	GiggleViewFilePriv *priv;
+	ViewFileBlameChunk  chunk, *chunks;
+	GdkWindow          *left_margin;
+	int                 end, i, j;
+
+	priv = GET_PRIV (view);
+
+	chunk.start = blame_chunk->result_line - 1;
+	chunk.count = blame_chunk->num_lines;
+	chunk.revision = view_file_get_blame_revision_id (priv, blame_chunk->revision);
+
+	end = chunk.start + chunk.count;
+	i = view_file_find_blame_chunk (priv, chunk.start);
+	chunks = (ViewFileBlameChunk *) priv->blame_chunks->data;
+
+	/* the full pass revisits lines annotated by the range pass,
+	 * whose chunks got clipped at the borders of that range */
+	if (i < priv->blame_chunks->len && chunks[i].start < chunk.start) {
+		ViewFileBlameChunk head = chunks[i];
+
+		head.count = chunk.start - head.start;
+		chunks[i].start = chunk.start;
+		chunks[i].count -= head.count;
+
+		g_array_insert_val (priv->blame_chunks, i, head);
+		chunks = (ViewFileBlameChunk *) priv->blame_chunks->data;
+		++i;
+	}
+
+	for (j = i; j < priv->blame_chunks->len; ++j) {
+		if (chunks[j].start + chunks[j].count > end)
+			break;
+	}
+
+	if (j > i)
+		g_array_remove_range (priv->blame_chunks, i, j - i);
+
+	if (i < priv->blame_chunks->len && chunks[i].start < end) {
+		chunks[i].count -= end - chunks[i].start;
+		chunks[i].start = end;
+	}
+
+	g_array_insert_val (priv->blame_chunks, i, chunk);
+
+	left_margin = gtk_text_view_get_window (GTK_TEXT_VIEW (priv->source_view),
+						GTK_TEXT_WINDOW_LEFT);
+
+	if (left_margin)
+		gdk_window_invalidate_rect (left_margin, NULL, FALSE);
+}
+
+static void
+view_file_blame_cache_cb (const GiggleGitBlameChunk *chunk,
+			  gpointer                   data)
+{
+	view_file_blame_chunk_added_cb (NULL, chunk, data);
+}
+
+static void
+view_file_blame_job_callback (GiggleGit *git,
+			      GiggleJob *job,
+			      GError    *error,
+			      gpointer   data)
+{
+	GiggleViewFilePriv *priv;
+
+	priv = GET_PRIV (data);
+	priv->job = NULL;
+
+	if (error) {
+		g_warning ("%s: %s", G_STRFUNC, error->message);
+	} else {
+		giggle_blame_cache_store (priv->blame_cache, GIGGLE_GIT_BLAME (job),
+					  priv->current_blob);
+		view_file_set_blame_revision (priv, priv->current_revision);
+	}
+
+	view_file_schedule_prefetch (data);
+	g_object_unref (job);
+}
+
+static void
+view_file_run_blame (GiggleViewFile      *view,
+		     int                  first_line,
+		     int                  last_line,
+		     GiggleJobDoneCallback callback)
+{
+	GiggleViewFilePriv *priv;
+
+	priv = GET_PRIV (view);
+
+	if (first_line > 0) {
+		priv->job = giggle_git_blame_new_for_range (priv->current_revision,
+							    priv->current_file,
+							    first_line, last_line);
+	} else {
+		priv->job = giggle_git_blame_new (priv->current_revision,
+						  priv->current_file);
+	}
+
+	g_signal_connect (priv->job, "chunk-added",
+			  G_CALLBACK (view_file_blame_chunk_added_cb), view);
+
+	giggle_git_run_job (priv->git, priv->job, callback, view);
+}
+
+static void
+view_file_blame_range_job_callback (GiggleGit *git,
+				    GiggleJob *job,
+				    GError    *error,
+				    gpointer   data)
+{
+	GiggleViewFilePriv *priv;
+
+	priv = GET_PRIV (data);
+	priv->job = NULL;
+
+	if (error)
+		g_warning ("%s: %s", G_STRFUNC, error->message);
+
+	view_file_run_blame (data, 0, 0, view_file_blame_job_callback);
+
+	g_object_unref (job);
+}
+
+/* whether all lines from start to end (exclusive) got blamed */
+static gboolean
+view_file_has_blame (GiggleViewFilePriv *priv,
+		     int                 start,
+		     int                 end)
+{
+	ViewFileBlameChunk *chunk;
+	int                 i;
+
+	for (i = view_file_find_blame_chunk (priv, start); start < end; ++i) {
+		if (i >= priv->blame_chunks->len)
+			return FALSE;
+
+		chunk = &g_array_index (priv->blame_chunks, ViewFileBlameChunk, i);
+
+		if (chunk->start > start)
+			return FALSE;
+
+		start = chunk->start + chunk->count;
+	}
+
+	return TRUE;
+}
+
+static void
+view_file_blame_page_job_callback (GiggleGit *git,
+				   GiggleJob *job,
+				   GError    *error,
+				   gpointer   data)
+{
+	GiggleViewFilePriv *priv;
+
+	priv = GET_PRIV (data);
+	priv->job = NULL;
+
+	if (error)
+		g_warning ("%s: %s", G_STRFUNC, error->message);
+
+	g_object_unref (job);
+}
+
+/* large files only get blamed for the lines paged in */
+static void
+view_file_blame_page (GiggleViewFile *view)
+{
+	GiggleViewFilePriv *priv;
+
+	priv = GET_PRIV (view);
+
+	/* don't get into the way of loading another file or revision */
+	if (priv->job && !GIGGLE_IS_GIT_BLAME (priv->job))
+		return;
+
+	if (view_file_has_blame (priv, priv->page_start, priv->page_end))
+		return;
+
+	view_file_cancel_job (view);
+	view_file_run_blame (view, priv->page_start + 1, priv->page_end,
+			     view_file_blame_page_job_callback);
+}
+
+static gboolean
+view_file_page_idle_cb (gpointer data)
+{
+	GiggleViewFilePriv *priv;
+	GtkTextView        *text_view;
+	GtkTextBuffer      *buffer;
+	GtkTextMark        *mark;
+	GtkTextIter         iter;
+	GdkRectangle        rect;
+	int                 top, bottom;
+
+	priv = GET_PRIV (data);
+	priv->page_idle_id = 0;
+
+	text_view = GTK_TEXT_VIEW (priv->source_view);
+	gtk_text_view_get_visible_rect (text_view, &rect);
+
+	gtk_text_view_get_line_at_y (text_view, &iter, rect.y, NULL);
+	top = priv->page_start + gtk_text_iter_get_line (&iter);
+
+	gtk_text_view_get_line_at_y (text_view, &iter, rect.y + rect.height, NULL);
+	bottom = priv->page_start + gtk_text_iter_get_line (&iter);
+
+	if (!view_file_fill_page (data, (top + bottom) / 2))
+		return FALSE;
+
+	/* keep the same line at the top of the view */
+	buffer = gtk_text_view_get_buffer (text_view);
+	gtk_text_buffer_get_iter_at_line (buffer, &iter, MAX (0, top - priv->page_start));
+	mark = gtk_text_buffer_get_mark (buffer, "giggle-page-top");
+
+	if (mark)
+		gtk_text_buffer_move_mark (buffer, mark, &iter);
+	else
+		mark = gtk_text_buffer_create_mark (buffer, "giggle-page-top", &iter, TRUE);
+
+	/* the adjustment keeps its old offset into the new page
+	 * until the scroll applies, which mustn't page again */
+	gtk_text_view_scroll_to_mark (text_view, mark, 0, TRUE, 0, 0);
+	priv->page_scrolling = TRUE;
+
+	view_file_blame_page (data);
+
+	return FALSE;
+}
+
+static void
+view_file_vadjustment_value_changed_cb (GtkAdjustment  *adjustment,
+					GiggleViewFile *view)
+{
+	GiggleViewFilePriv *priv;
+	GtkTextView        *text_view;
+	GtkTextBuffer      *buffer;
+	GtkTextIter         iter;
+	GdkRectangle        rect, location;
+	int                 top, bottom, margin;
+
+	priv = GET_PRIV (view);
+
+	if (!priv->page_lines || priv->page_idle_id)
+		return;
+
+	text_view = GTK_TEXT_VIEW (priv->source_view);
+	gtk_text_view_get_visible_rect (text_view, &rect);
+
+	/* wait for the view to get to the repaged lines */
+	if (priv->page_scrolling) {
+		buffer = gtk_text_view_get_buffer (text_view);
+		gtk_text_buffer_get_iter_at_mark (buffer, &iter,
+			gtk_text_buffer_get_mark (buffer, "giggle-page-top"));
+		gtk_text_view_get_iter_location (text_view, &iter, &location);
+
+		if (location.y < rect.y || location.y >= rect.y + rect.height)
+			return;
+
+		priv->page_scrolling = FALSE;
+	}
+
+	gtk_text_view_get_line_at_y (text_view, &iter, rect.y, NULL);
+	top = gtk_text_iter_get_line (&iter);
+
+	gtk_text_view_get_line_at_y (text_view, &iter, rect.y + rect.height, NULL);
+	bottom = gtk_text_iter_get_line (&iter);
+
+	margin = MIN (LARGE_FILE_PAGE_MARGIN, (priv->page_end - priv->page_start) / 4);
+
+	/* move the page before scrolling hits its borders */
+	if ((priv->page_start > 0 && top < margin) ||
+	    (priv->page_end < priv->page_lines->len &&
+	     bottom >= priv->page_end - priv->page_start - margin))
+		priv->page_idle_id = gdk_threads_add_idle (view_file_page_idle_cb, view);
+}
+
+static void
+view_file_get_iter_at_line (GiggleViewFile *view,
+			    int             line,
+			    GtkTextIter    *iter)
+{
+	GiggleViewFilePriv *priv;
+	GtkTextBuffer      *buffer;
+
+	priv = GET_PRIV (view);
+
+	if (priv->page_lines && (line < priv->page_start || line >= priv->page_end)) {
+		view_file_fill_page (view, line);
+		view_file_blame_page (view);
+	}
+
+	buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->source_view));
+	gtk_text_buffer_get_iter_at_line (buffer, iter, line - priv->page_start);
+}
+
+/* Estimates which lines of the file are shown. The buffer's layout isn't
+ * validated yet right after loading it, so this goes by the font height. */
+static gboolean
+view_file_get_visible_lines (GiggleViewFile *view,
+			     int            *first_line,
+			     int            *last_line)
+{
+	GiggleViewFilePriv *priv;
+	GtkTextView        *text_view;
+	GtkTextIter         end;
+	GdkRectangle        rect;
+	PangoFontMetrics   *metrics;
+	int                 line_height, n_lines;
+
+	priv = GET_PRIV (view);
+	text_view = GTK_TEXT_VIEW (priv->source_view);
+
+	if (!GTK_WIDGET_REALIZED (text_view))
 		return FALSE;
 
-	buffer = GTK_SOURCE_BUFFER (gtk_text_view_get_buffer (text_view));
-	color = &priv->source_view->style->base[GTK_STATE_SELECTED];
+	metrics = pango_context_get_metrics (gtk_widget_get_pango_context (priv->source_view),
+					     priv->source_view->style->font_desc, NULL);
 
-	cr = gdk_cairo_create (event->window);
-	gdk_cairo_region (cr, event->region);
-	cairo_clip (cr);
+	line_height = PANGO_PIXELS (pango_font_metrics_get_ascent (metrics) +
+				    pango_font_metrics_get_descent (metrics));
+	line_height += gtk_text_view_get_pixels_above_lines (text_view);
+	line_height += gtk_text_view_get_pixels_below_lines (text_view);
 
-	gtk_text_view_get_visible_rect (text_view, &visible_rect);
-	gtk_text_view_get_iter_at_location (text_view, &iter, visible_rect.x, visible_rect.y);
-	visible_rect.y += visible_rect.height;
+	pango_font_metrics_unref (metrics);
 
-	gdk_drawable_get_size (left_margin, &margin_width, NULL);
-	cairo_translate (cr, margin_width - 16, 0); /* FIXME: see GB#572785 */
+	gtk_text_view_get_visible_rect (text_view, &rect);
 
-	do {
-		gtk_text_view_get_line_yrange (text_view, &iter, &y, &height);
+	if (line_height <= 0 || rect.height <= 0)
+		return FALSE;
 
-		if (y >= visible_rect.y)
-			break;
+	/* git doesn't count the empty line after a final newline */
+	gtk_text_buffer_get_end_iter (gtk_text_view_get_buffer (text_view), &end);
+	n_lines = gtk_text_iter_get_line (&end);
 
-		markers = gtk_source_buffer_get_source_marks_at_iter (buffer, &iter, NULL);
+	if (gtk_text_iter_get_line_offset (&end) > 0)
+		n_lines += 1;
 
-		for (name = NULL; markers; name = NULL) {
-			name = gtk_source_mark_get_category (markers->data);
+	*first_line = rect.y / line_height + 1;
+	*last_line = MIN (n_lines, (rect.y + rect.height) / line_height + 1);
 
-			if (name && g_str_has_prefix (name, "giggle-chunk-"))
-				break;
+	/* nothing to gain when the entire file is visible */
+	return *first_line <= *last_line && (*first_line > 1 || *last_line < n_lines);
+}
 
-			markers = g_slist_delete_link (markers, markers);
-		}
+/* whether revision is next to the current one in the file's history */
+static gboolean
+view_file_is_neighbour (GiggleViewFile *view,
+			GiggleRevision *revision)
+{
+	GiggleRevision *row;
+	int             i;
 
-		if (name) /* FIXME: see GB#572785 */
-			render_chunk_marker (cr, name, 16, height, color);
+	if (!revision || (i = view_file_get_current_row (view)) < 0)
+		return FALSE;
+
+	row = view_file_get_history_row (view, i - 1);
 
-		g_slist_free (markers);
+	if (row && !giggle_revision_compare (row, revision))
+		return TRUE;
 
-		cairo_translate (cr, 0, height);
-	} while (gtk_text_iter_forward_line (&iter));
+	row = view_file_get_history_row (view, i + 1);
 
-	cairo_destroy (cr);
+	if (row && !giggle_revision_compare (row, revision))
+		return TRUE;
 
 	return FALSE;
 }
 
 static void
-giggle_view_file_class_init (GiggleViewFileClass *class)
+view_file_prefetch_free (ViewFilePrefetch *prefetch)
 {
-	GObjectClass    *object_class = G_OBJECT_CLASS (class);
-	GiggleViewClass *view_class   = GIGGLE_VIEW_CLASS (class);
+	g_object_unref (prefetch->revision);
 
-	object_class->get_property = view_file_get_property;
-	object_class->set_property = view_file_set_property;
-	object_class->finalize     = view_file_finalize;
-	object_class->dispose      = view_file_dispose;
+	if (prefetch->blob)
+		g_object_unref (prefetch->blob);
 
-	view_class->add_ui         = view_file_add_ui;
-	view_class->remove_ui      = view_file_remove_ui;
+	g_slice_free (ViewFilePrefetch, prefetch);
+}
 
-	g_object_class_install_property (object_class,
-					 PROP_PATH,
-					 g_param_spec_string ("path",
-							      "Path",
-							      "The currently selected path",
-							      NULL, G_PARAM_READWRITE));
+static ViewFilePrefetch *
+view_file_lookup_prefetch (GiggleViewFilePriv *priv,
+			   GiggleRevision     *revision)
+{
+	if (!revision)
+		return NULL;
 
-	g_type_class_add_private (object_class, sizeof (GiggleViewFilePriv));
+	return g_hash_table_lookup (priv->prefetched, giggle_revision_get_sha (revision));
 }
 
 static void
-show_error (GiggleViewFile *view,
-	    const char     *message,
-	    const GError   *error)
+view_file_cancel_prefetch (GiggleViewFile *view)
 {
-	GtkWidget *dialog;
+	GiggleViewFilePriv *priv = GET_PRIV (view);
 
-	dialog = gtk_message_dialog_new (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (view))),
-					 GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
-					 GTK_MESSAGE_ERROR,
-					 GTK_BUTTONS_OK,
-					 message, error->message);
+	if (priv->prefetch_idle_id) {
+		g_source_remove (priv->prefetch_idle_id);
+		priv->prefetch_idle_id = 0;
+	}
 
-	gtk_dialog_run (GTK_DIALOG (dialog));
-	gtk_widget_destroy (dialog);
+	if (priv->prefetch_job) {
+		giggle_git_cancel_job (priv->git, priv->prefetch_job);
+		g_object_unref (priv->prefetch_job);
+		priv->prefetch_job = NULL;
+	}
+
+	if (priv->prefetch_revision) {
+		g_object_unref (priv->prefetch_revision);
+		priv->prefetch_revision = NULL;
+	}
 }
 
-static GtkSourceLanguage *
-view_file_find_language (GiggleViewFile *view,
-			 const char     *text,
-			 gsize	         len)
-{
-	GtkSourceLanguageManager *manager;
-	GiggleViewFilePriv       *priv;
-	GtkSourceLanguage        *lang;
-	const char *const        *ids;
-	char                     *content_type, *filename;
-	char                    **meta, **s;
+static gboolean view_file_prefetch_idle_cb (gpointer data);
 
-	priv = GET_PRIV (view);
+static void
+view_file_schedule_prefetch (GiggleViewFile *view)
+{
+	GiggleViewFilePriv *priv = GET_PRIV (view);
 
-	manager = gtk_source_language_manager_get_default ();
-	ids = gtk_source_language_manager_get_language_ids (manager);
+	if (!priv->prefetch_idle_id) {
+		priv->prefetch_idle_id = gdk_threads_add_idle_full
+			(G_PRIORITY_LOW, view_file_prefetch_idle_cb, view, NULL);
+	}
+}
 
-	content_type = g_content_type_guess (priv->current_file, text, len, NULL);
-	filename = g_path_get_basename (priv->current_file);
+static void
+view_file_add_prefetch (GiggleViewFilePriv *priv,
+			GiggleRevision     *revision,
+			GiggleGitCatFile   *job)
+{
+	ViewFilePrefetch *prefetch;
+	gsize             len;
 
-	for (; *ids; ++ids) {
-		lang = gtk_source_language_manager_get_language (manager, *ids);
-		meta = gtk_source_language_get_mime_types (lang);
+	prefetch = g_slice_new0 (ViewFilePrefetch);
+	prefetch->revision = g_object_ref (revision);
 
-		if (meta) {
-			for (s = meta; *s; ++s) {
-				if (!strcmp (*s, content_type))
-					goto end;
-			}
+	/* failures and large files just get loaded when shown */
+	if (job && !g_strcmp0 (giggle_git_cat_file_get_kind (job), "blob") &&
+	    giggle_git_cat_file_get_contents (job, &len) &&
+	    len <= view_file_get_large_file_size (priv))
+		prefetch->blob = g_object_ref (job);
 
-			g_strfreev (meta);
-		}
+	g_hash_table_insert (priv->prefetched,
+			     (gpointer) giggle_revision_get_sha (revision),
+			     prefetch);
+}
 
-		meta = gtk_source_language_get_globs (lang);
+static void
+view_file_prefetch_blob_callback (GiggleGit *git,
+				  GiggleJob *job,
+				  GError    *error,
+				  gpointer   data)
+{
+	GiggleViewFilePriv *priv;
 
-		if (meta) {
-			for (s = meta; *s; ++s) {
-				if (!fnmatch (*s, filename, 0)) {
-					goto end;
-				}
-			}
+	priv = GET_PRIV (data);
+	priv->prefetch_job = NULL;
 
-			g_strfreev (meta);
-		}
-	}
+	if (error)
+		g_warning ("%s: %s", G_STRFUNC, error->message);
 
-	lang = NULL;
+	view_file_add_prefetch (priv, priv->prefetch_revision,
+				error ? NULL : GIGGLE_GIT_CAT_FILE (job));
 
-end:
-	g_free (content_type);
-	g_free (filename);
+	g_object_unref (priv->prefetch_revision);
+	priv->prefetch_revision = NULL;
 
-	return lang;
+	view_file_schedule_prefetch (data);
+	g_object_unref (job);
 }
 
 static void
-view_file_set_source_code (GiggleViewFile *view,
-			   const char     *text,
-			   gsize	   len)
+view_file_prefetch_blame_callback (GiggleGit *git,
+				   GiggleJob *job,
+				   GError    *error,
+				   gpointer   data)
 {
 	GiggleViewFilePriv *priv;
-	GtkTextBuffer      *buffer;
-	GtkSourceLanguage  *language = NULL;
-	GtkTextIter	    start, end;
+	ViewFilePrefetch   *prefetch;
 
-	priv = GET_PRIV (view);
+	priv = GET_PRIV (data);
+	priv->prefetch_job = NULL;
 
-	buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->source_view));
-	gtk_widget_set_sensitive (priv->revision_list, NULL != text);
-	gtk_widget_set_sensitive (priv->source_view, NULL != text);
-	gtk_text_buffer_set_text (buffer, text ? text : "", len);
+	prefetch = view_file_lookup_prefetch (priv, priv->prefetch_revision);
 
-	if (priv->action_group)
-		gtk_action_group_set_sensitive (priv->action_group, NULL != text);
+	if (error) {
+		g_warning ("%s: %s", G_STRFUNC, error->message);
+	} else if (prefetch && prefetch->blob) {
+		giggle_blame_cache_store (priv->blame_cache, GIGGLE_GIT_BLAME (job),
+					  giggle_git_cat_file_get_sha (prefetch->blob));
+	}
 
-	if (text)
-		language = view_file_find_language (view, text, len);
+	g_object_unref (priv->prefetch_revision);
+	priv->prefetch_revision = NULL;
 
-	gtk_text_buffer_get_bounds (buffer, &start, &end);
-	gtk_source_buffer_remove_source_marks (GTK_SOURCE_BUFFER (buffer), &start, &end, NULL);
-	gtk_source_buffer_set_language (GTK_SOURCE_BUFFER (buffer), language);
+	view_file_schedule_prefetch (data);
+	g_object_unref (job);
 }
 
-static const char *
-get_line_category (int          line,
-		   GtkStateType state,
-		   int          num_lines)
+/* starts fetching what's missing for revision, returns FALSE if nothing is */
+static gboolean
+view_file_prefetch (GiggleViewFile *view,
+		    GiggleRevision *revision)
 {
-	if (!line) {
-		if (1 == num_lines)
-			return CHUNK_NAME (state, "start-end");
+	GiggleViewFilePriv *priv;
+	ViewFilePrefetch   *prefetch;
 
-		return CHUNK_NAME (state, "start");
+	priv = GET_PRIV (view);
+	prefetch = view_file_lookup_prefetch (priv, revision);
+
+	if (!prefetch) {
+		priv->prefetch_job = giggle_git_cat_file_new_for_path (revision, priv->current_file);
+		priv->prefetch_revision = g_object_ref (revision);
+
+		giggle_git_run_job (priv->git, priv->prefetch_job,
+				    view_file_prefetch_blob_callback, view);
+
+		return TRUE;
 	}
 
-	if (line < num_lines - 1)
-		return CHUNK_NAME (state, "middle");
+	if (prefetch->blob && !prefetch->blamed) {
+		prefetch->blamed = TRUE;
+
+		if (giggle_blame_cache_contains (priv->blame_cache, revision, priv->current_file,
+						 giggle_git_cat_file_get_sha (prefetch->blob)))
+			return FALSE;
+
+		priv->prefetch_job = giggle_git_blame_new (revision, priv->current_file);
+		priv->prefetch_revision = g_object_ref (revision);
 
-	return CHUNK_NAME (state, "end");
+		giggle_git_run_job (priv->git, priv->prefetch_job,
+				    view_file_prefetch_blame_callback, view);
+
+		return TRUE;
+	}
+
+	return FALSE;
 }
 
-static GtkStateType
-get_chunk_state (GiggleViewFilePriv        *priv,
-		 const GiggleGitBlameChunk *chunk)
+static gboolean
+view_file_prefetch_is_stale (gpointer key,
+			     gpointer value,
+			     gpointer data)
 {
-	if (!giggle_revision_compare (priv->current_revision, chunk->revision))
-		return GTK_STATE_SELECTED;
+	ViewFilePrefetchPrune *prune = data;
+	int                    i;
 
-	return GTK_STATE_NORMAL;
+	for (i = prune->current - PREFETCH_DISTANCE; i <= prune->current + PREFETCH_DISTANCE; ++i) {
+		GiggleRevision *row = view_file_get_history_row (prune->view, i);
+
+		if (row && !giggle_revision_compare (row, ((ViewFilePrefetch *) value)->revision))
+			return FALSE;
+	}
+
+	return TRUE;
 }
 
-static void
-view_file_blame_job_callback (GiggleGit *git,
-			      GiggleJob *job,
-			      GError    *error,
-			      gpointer   data)
+/* fetches contents and blame of the revisions around the current one,
+ * one job at a time and only while the view has nothing else to do */
+static gboolean
+view_file_prefetch_idle_cb (gpointer data)
 {
-	GiggleViewFile            *view;
-	GiggleViewFilePriv        *priv;
-	const GiggleGitBlameChunk *chunk;
-	int                        i, l;
-	GtkSourceBuffer           *buffer;
-	GtkSourceMark             *mark;
-	GtkTextIter                iter;
-	const char                *category;
-	GtkStateType               state;
+	GiggleViewFilePriv    *priv;
+	GiggleRevision        *revision;
+	ViewFilePrefetchPrune  prune;
+	int                    current, distance;
 
-	view = GIGGLE_VIEW_FILE (data);
-	priv = GET_PRIV (view);
-	priv->job = NULL;
+	priv = GET_PRIV (data);
+	priv->prefetch_idle_id = 0;
 
-	if (error) {
-		g_warning ("%s: %s", G_STRFUNC, error->message);
-	} else {
-		buffer = GTK_SOURCE_BUFFER (gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->source_view)));
+	if (priv->job || priv->prefetch_job || priv->page_lines || !priv->current_file)
+		return FALSE;
 
-		for (i = 0; (chunk = giggle_git_blame_get_chunk (GIGGLE_GIT_BLAME (job), i)); ++i) {
-			for (l = 0; l < chunk->num_lines; ++l) {
-				state = get_chunk_state (priv, chunk);
-				category = get_line_category (l, state, chunk->num_lines);
+	current = view_file_get_current_row (data);
 
-				gtk_text_buffer_get_iter_at_line (GTK_TEXT_BUFFER (buffer),
-								  &iter, chunk->result_line + l - 1);
+	if (current < 0)
+		return FALSE;
 
-				mark = gtk_source_buffer_create_source_mark (buffer, NULL,
-									     category, &iter);
+	/* finding the current row means walking the history */
+	prune.view = data;
+	prune.current = current;
+	g_hash_table_foreach_remove (priv->prefetched, view_file_prefetch_is_stale, &prune);
 
-				g_object_set_data_full (G_OBJECT (mark), "giggle-revision",
-							g_object_ref (chunk->revision),
-							g_object_unref);
-			}
-		}
+	for (distance = 1; distance <= PREFETCH_DISTANCE; ++distance) {
+		/* stepping back in history is the common case */
+		revision = view_file_get_history_row (data, current + distance);
+
+		if (revision && view_file_prefetch (data, revision))
+			break;
+
+		revision = view_file_get_history_row (data, current - distance);
+
+		if (revision && view_file_prefetch (data, revision))
+			break;
 	}
 
-	g_object_unref (job);
+	return FALSE;
 }
 
 static void
-view_file_cat_file_job_callback (GiggleGit *git,
-				 GiggleJob *job,
-				 GError    *error,
-				 gpointer   data)
+view_file_show_blob (GiggleViewFile   *view,
+		     GiggleGitCatFile *job)
 {
-	GiggleViewFile     *view;
 	GiggleViewFilePriv *priv;
-	const char         *text;
+	const char         *text, *sha;
 	gsize               len;
+	int                 first_line, last_line;
 
-	view = GIGGLE_VIEW_FILE (data);
 	priv = GET_PRIV (view);
-	priv->job = NULL;
+	sha = giggle_git_cat_file_get_sha (job);
+
+	if (priv->blame_revision &&
+	    !g_strcmp0 (sha, priv->current_blob) &&
+	    view_file_is_neighbour (view, priv->blame_revision)) {
+		/* stepped over a revision which didn't touch
+		 * the file, so contents and blame didn't change */
+		view_file_set_blame_revision (priv, priv->current_revision);
+		gtk_widget_queue_draw (priv->source_view);
+		view_file_schedule_prefetch (view);
+		return;
+	}
 
-	if (error) {
-		view_file_set_source_code (view, error->message, -1);
-	} else {
-		text = giggle_git_cat_file_get_contents (GIGGLE_GIT_CAT_FILE (job), &len);
-		view_file_set_source_code (view, text, len);
+	g_free (priv->current_blob);
+	priv->current_blob = g_strdup (sha);
 
-		priv->job = giggle_git_blame_new (priv->current_revision,
-						  priv->current_file);
+	text = giggle_git_cat_file_get_contents (job, &len);
+	view_file_set_source_code_full (view, text, len,
+					g_object_ref (job), g_object_unref);
 
-		giggle_git_run_job (priv->git,
-				    priv->job,
-				    view_file_blame_job_callback,
-				    view);
+	if (priv->page_lines) {
+		view_file_blame_page (view);
+		return;
 	}
 
-	g_object_unref (job);
+	/* git gets to work on the blame while the
+	 * buffer lays out and highlights the text */
+	if (giggle_blame_cache_lookup (priv->blame_cache,
+				       priv->current_revision,
+				       priv->current_file,
+				       priv->current_blob,
+				       view_file_blame_cache_cb, view)) {
+		view_file_set_blame_revision (priv, priv->current_revision);
+		view_file_schedule_prefetch (view);
+	} else if (view_file_get_visible_lines (view, &first_line, &last_line)) {
+		/* annotate what the user is looking at first */
+		view_file_run_blame (view, first_line, last_line,
+				     view_file_blame_range_job_callback);
+	} else {
+		view_file_run_blame (view, 0, 0,
+				     view_file_blame_job_callback);
+	}
 }
 
 static void
-view_file_list_tree_job_callback (GiggleGit *git,
-				  GiggleJob *job,
-				  GError    *error,
-				  gpointer   data)
+view_file_cat_file_job_callback (GiggleGit *git,
+				 GiggleJob *job,
+				 GError    *error,
+				 gpointer   data)
 {
 	GiggleViewFile     *view;
 	GiggleViewFilePriv *priv;
-	const char         *type;
-	const char         *sha = NULL;
 	char		   *text;
 	gsize		    len;
 
@@ -901,32 +1982,21 @@ view_file_list_tree_job_callback (GiggleGit *git,
 	priv->job = NULL;
 
 	if (error) {
-		show_error (view, _("An error occurred when getting file ref:\n%s"), error);
+		view_file_set_source_code (view, error->message, -1);
+	} else if (!g_strcmp0 (giggle_git_cat_file_get_kind (GIGGLE_GIT_CAT_FILE (job)), "blob")) {
+		/* keep it for stepping back to this revision */
+		if (priv->current_revision &&
+		    !view_file_lookup_prefetch (priv, priv->current_revision))
+			view_file_add_prefetch (priv, priv->current_revision,
+						GIGGLE_GIT_CAT_FILE (job));
+
+		view_file_show_blob (view, GIGGLE_GIT_CAT_FILE (job));
+	} else if (g_file_test (priv->current_file, G_FILE_TEST_IS_DIR)) {
+		view_file_set_source_code (view, NULL, 0);
+	} else if (g_file_get_contents (priv->current_file, &text, &len, NULL)) {
+		view_file_set_source_code_full (view, text, len, text, g_free);
 	} else {
-		type = giggle_git_list_tree_get_kind (GIGGLE_GIT_LIST_TREE (job),
-						      priv->current_file);
-
-		if (!g_strcmp0 (type, "blob")) {
-			sha = giggle_git_list_tree_get_sha (GIGGLE_GIT_LIST_TREE (job),
-						            priv->current_file);
-		}
-
-		if (sha) {
-			priv->job = giggle_git_cat_file_new ("blob", sha);
-
-			giggle_git_run_job (priv->git,
-					    priv->job,
-					    view_file_cat_file_job_callback,
-					    view);
-
-		} else if (g_file_test (priv->current_file, G_FILE_TEST_IS_DIR)) {
-			view_file_set_source_code (view, NULL, 0);
-		} else if (g_file_get_contents (priv->current_file, &text, &len, NULL)) {
-			view_file_set_source_code (view, text, len);
-			g_free (text);
-		} else {
-			view_file_set_source_code (view, NULL, 0);
-		}
+		view_file_set_source_code (view, NULL, 0);
 	}
 
 	g_object_unref (job);
@@ -936,20 +2006,27 @@ static void
 view_file_read_source_code (GiggleViewFile *view)
 {
 	GiggleViewFilePriv *priv;
-	char		   *directory;
+	ViewFilePrefetch   *prefetch;
 
 	priv = GET_PRIV (view);
 
-	if (priv->current_file) {
-		directory = g_path_get_dirname (priv->current_file);
-		priv->job = giggle_git_list_tree_new (priv->current_revision, directory);
+	view_file_cancel_job (view);
+
+	/* prefetching must not hold up what the user asked for */
+	view_file_cancel_prefetch (view);
+
+	prefetch = view_file_lookup_prefetch (priv, priv->current_revision);
+
+	if (prefetch && prefetch->blob) {
+		view_file_show_blob (view, prefetch->blob);
+	} else if (priv->current_file) {
+		priv->job = giggle_git_cat_file_new_for_path (priv->current_revision,
+							      priv->current_file);
 
 		giggle_git_run_job (priv->git,
 				    priv->job,
-				    view_file_list_tree_job_callback,
+				    view_file_cat_file_job_callback,
 				    view);
-
-		g_free (directory);
 	} else {
 		view_file_set_source_code (view, NULL, 0);
 	}
@@ -963,8 +2040,7 @@ view_file_select_file_job_callback (GiggleGit *git,
 {
 	GiggleViewFile     *view;
 	GiggleViewFilePriv *priv;
-	GtkListStore       *store;
-	GtkTreeIter         iter;
+	GtkTreeModel       *model;
 	GList              *revisions;
 
 	view = GIGGLE_VIEW_FILE (data);
@@ -974,20 +2050,11 @@ view_file_select_file_job_callback (GiggleGit *git,
 	if (error) {
 		show_error (view, _("An error occurred when getting the revisions list:\n%s"), error);
 	} else {
-		store = gtk_list_store_new (1, GIGGLE_TYPE_REVISION);
 		revisions = giggle_git_revisions_get_revisions (GIGGLE_GIT_REVISIONS (job));
+		model = giggle_revision_model_new (revisions);
 
-		while (revisions) {
-			gtk_list_store_append (store, &iter);
-			gtk_list_store_set (store, &iter,
-					    0, revisions->data,
-					    -1);
-			revisions = revisions->next;
-		}
-
-		giggle_rev_list_view_set_model (GIGGLE_REV_LIST_VIEW (priv->revision_list),
-						GTK_TREE_MODEL (store));
-		g_object_unref (store);
+		giggle_rev_list_view_set_model (GIGGLE_REV_LIST_VIEW (priv->revision_list), model);
+		g_object_unref (model);
 
 		view_file_read_source_code (view);
 	}
@@ -1004,7 +2071,17 @@ view_file_selection_changed_cb (GtkTreeSelection *selection,
 
 	priv = GET_PRIV (view);
 
+	view_file_cancel_job (view);
+	view_file_cancel_prefetch (view);
+
+	/* blobs of different files can't share their blame */
+	g_free (priv->current_blob);
+	priv->current_blob = NULL;
+
+	g_hash_table_remove_all (priv->prefetched);
+
 	files = giggle_file_list_get_selection (GIGGLE_FILE_LIST (priv->file_list));
+	giggle_rev_list_view_set_files (GIGGLE_REV_LIST_VIEW (priv->revision_list), files);
 	priv->job = giggle_git_revisions_new_for_files (files);
 
 	g_free (priv->current_file);
@@ -1103,7 +2180,7 @@ goto_entry_activate_cb (GtkEntry       *entry,
 
 	if (1 == sscanf (text, "%d", &line)) {
 		buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->source_view));
-		gtk_text_buffer_get_iter_at_line (buffer, &iter, line - 1);
+		view_file_get_iter_at_line (view, line - 1, &iter);
 
 		gtk_text_view_scroll_to_iter
 			(GTK_TEXT_VIEW (priv->source_view), &iter,
@@ -1175,23 +2252,26 @@ goto_toolbar_init (GiggleViewFile *view)
 }
 
 static gboolean
-source_view_query_tooltip_cb (GtkWidget  *widget,
-                              gint        x,
-                              gint        y,
-                              gboolean    keyboard_mode,
-                              GtkTooltip *tooltip)
+source_view_query_tooltip_cb (GtkWidget      *widget,
+                              gint            x,
+                              gint            y,
+                              gboolean        keyboard_mode,
+                              GtkTooltip     *tooltip,
+                              GiggleViewFile *view)
 {
-	char            *markup = NULL, date[256];
-	GiggleRevision  *revision;
-	GdkRectangle     bounds;
-	GtkTextIter      iter;
+	GiggleViewFilePriv *priv = GET_PRIV (view);
+	char               *markup = NULL, date[256];
+	GiggleRevision     *revision;
+	GdkRectangle        bounds;
+	GtkTextIter         iter;
 
 	gtk_text_view_window_to_buffer_coords (GTK_TEXT_VIEW (widget),
 					       GTK_TEXT_WINDOW_WIDGET, x, y, &x, &y);
 	gtk_text_view_get_iter_at_location (GTK_TEXT_VIEW (widget), &iter, x, y);
 	gtk_text_iter_backward_chars (&iter, gtk_text_iter_get_line_offset (&iter));
 
-	revision = source_view_get_revision_at_iter (&iter);
+	revision = view_file_get_revision_at_line (priv, priv->page_start +
+						   gtk_text_iter_get_line (&iter));
 
 	if (revision) {
 		const char   *committer_name = NULL;
@@ -1249,72 +2329,27 @@ view_file_search (GiggleSearchable      *searchable,
 		  gboolean               full_search)
 {
 	GiggleViewFilePriv   *priv;
-	GtkSourceSearchFlags  flags;
-	gboolean	      result = FALSE;
-	int		      cursor_position;
-	GtkTextIter	      start, end, cursor;
+	GtkTextIter	      cursor;
 	GtkTextIter	      match_start, match_end;
 	GtkTextBuffer        *buffer;
 
 	priv = GET_PRIV (searchable);
 
-	flags = GTK_SOURCE_SEARCH_TEXT_ONLY |
-		GTK_SOURCE_SEARCH_CASE_INSENSITIVE;
-
 	buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->source_view));
-	g_object_get (buffer, "cursor-position", &cursor_position, NULL);
-	gtk_text_buffer_get_bounds (buffer, &start, &end);
-
-	cursor = start;
-	gtk_text_iter_forward_chars (&cursor, cursor_position);
-
-	switch (direction) {
-	case GIGGLE_SEARCH_DIRECTION_NEXT:
-		result = gtk_source_iter_forward_search (&cursor, search_term,
-							 flags, &match_start, &match_end, NULL);
-
-		if (result && gtk_text_iter_get_offset (&cursor) == gtk_text_iter_get_offset (&match_start)) {
-			gtk_text_iter_forward_char (&cursor);
-
-			result = gtk_source_iter_forward_search (&cursor, search_term,
-								 flags, &match_start, &match_end, NULL);
-		}
-
-		if (!result) {
-			result = gtk_source_iter_forward_search (&start, search_term,
-								 flags, &match_start, &match_end, NULL);
-		}
+	gtk_text_buffer_get_iter_at_mark (buffer, &cursor,
+					  gtk_text_buffer_get_insert (buffer));
 
-		break;
-
-	case GIGGLE_SEARCH_DIRECTION_PREV:
-		result = gtk_source_iter_backward_search (&cursor, search_term,
-							  flags, &match_start, &match_end, NULL);
-
-		if (result && gtk_text_iter_get_offset (&cursor) == gtk_text_iter_get_offset (&match_start)) {
-			gtk_text_iter_backward_char (&cursor);
-
-			result = gtk_source_iter_backward_search (&cursor, search_term,
-								  flags, &match_start, &match_end, NULL);
-		}
-
-		if (!result) {
-			result = gtk_source_iter_backward_search (&end, search_term,
-								  flags, &match_start, &match_end, NULL);
-		}
-
-		break;
-	}
+	if (!giggle_text_buffer_search (buffer, search_term, &cursor, direction,
+					&match_start, &match_end))
+		return FALSE;
 
-	if (result) {
-		gtk_text_buffer_move_mark_by_name (buffer, "insert", &match_start);
-		gtk_text_buffer_move_mark_by_name (buffer, "selection_bound", &match_end);
+	gtk_text_buffer_move_mark_by_name (buffer, "insert", &match_start);
+	gtk_text_buffer_move_mark_by_name (buffer, "selection_bound", &match_end);
 
-		gtk_text_view_scroll_to_iter (GTK_TEXT_VIEW (priv->source_view),
-					      &match_start, 0, FALSE, 0, 0);
-	}
+	gtk_text_view_scroll_to_iter (GTK_TEXT_VIEW (priv->source_view),
+				      &match_start, 0, FALSE, 0, 0);
 
-	return result;
+	return TRUE;
 }
 
 static void
@@ -1465,6 +2500,14 @@ giggle_view_file_init (GiggleViewFile *view)
 	priv->git = giggle_git_get ();
 	priv->configuration = giggle_git_config_new ();
 
+	priv->blame_chunks = g_array_new (FALSE, FALSE, sizeof (ViewFileBlameChunk));
+	priv->blame_revisions = g_ptr_array_new ();
+	priv->blame_revision_ids = g_hash_table_new (g_direct_hash, g_direct_equal);
+	priv->blame_cache = giggle_blame_cache_get ();
+
+	priv->prefetched = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+						  (GDestroyNotify) view_file_prefetch_free);
+
 	gtk_widget_push_composite_child ();
 
 	goto_toolbar_init (view);
@@ -1527,6 +2570,9 @@ giggle_view_file_init (GiggleViewFile *view)
 	gtk_container_add (GTK_CONTAINER (scrolled_window), priv->source_view);
 	gtk_paned_pack1 (GTK_PANED (priv->vpaned), scrolled_window, TRUE, FALSE);
 
+	g_signal_connect (gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (scrolled_window)),
+			  "value-changed", G_CALLBACK (view_file_vadjustment_value_changed_cb), view);
+
 	/* revisions list */
 	priv->revision_list = giggle_rev_list_view_new ();
 
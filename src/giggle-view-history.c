@@ -22,6 +22,7 @@
 #include "giggle-view-history.h"
 
 #include "giggle-rev-list-view.h"
+#include "giggle-revision-model.h"
 #include "giggle-revision-view.h"
 #include "giggle-view-diff.h"
 
@@ -253,7 +254,7 @@ view_history_get_branches_cb (GiggleGit    *git,
 		gtk_dialog_run (GTK_DIALOG (dialog));
 		gtk_widget_destroy (dialog);
 	} else {
-		model = gtk_tree_view_get_model (GTK_TREE_VIEW (priv->revision_list));
+		model = giggle_rev_list_view_get_model (GIGGLE_REV_LIST_VIEW (priv->revision_list));
 		valid = gtk_tree_model_get_iter_first (model, &iter);
 		branches = giggle_git_refs_get_branches (GIGGLE_GIT_REFS (job));
 		tags = giggle_git_refs_get_tags (GIGGLE_GIT_REFS (job));
@@ -295,7 +296,6 @@ view_history_diff_current_cb (GiggleGit *git,
 	GiggleViewHistoryPriv *priv;
 	GtkTreeModel          *model;
 	GtkTreePath           *path;
-	GtkTreeIter            iter;
 	const gchar           *text;
 
 	priv = GET_PRIV (user_data);
@@ -308,15 +308,13 @@ view_history_diff_current_cb (GiggleGit *git,
 	text = giggle_git_diff_get_result (GIGGLE_GIT_DIFF (job));
 
 	if (text && *text) {
-		model = gtk_tree_view_get_model (GTK_TREE_VIEW (priv->revision_list));
-		gtk_list_store_insert (GTK_LIST_STORE (model), &iter, 0);
-		gtk_list_store_set (GTK_LIST_STORE (model), &iter,
-				    REVISION_COL_OBJECT, NULL,
-				    -1);
+		model = giggle_rev_list_view_get_model (GIGGLE_REV_LIST_VIEW (priv->revision_list));
+		giggle_revision_model_prepend (GIGGLE_REVISION_MODEL (model), NULL);
 
-		path = gtk_tree_model_get_path (model, &iter);
+		path = gtk_tree_path_new_first ();
 		gtk_tree_view_scroll_to_cell (GTK_TREE_VIEW (priv->revision_list),
 					      path, NULL, FALSE, 0.0, 0.0);
+		gtk_tree_path_free (path);
 	}
 }
 
@@ -328,8 +326,7 @@ view_history_get_revisions_cb (GiggleGit    *git,
 {
 	GiggleViewHistory     *view;
 	GiggleViewHistoryPriv *priv;
-	GtkListStore          *store;
-	GtkTreeIter            iter;
+	GtkTreeModel          *model;
 	GList                 *revisions;
 
 	view = GIGGLE_VIEW_HISTORY (user_data);
@@ -350,21 +347,12 @@ view_history_get_revisions_cb (GiggleGit    *git,
 		g_object_unref (priv->job);
 		priv->job = NULL;
 	} else {
-		store = gtk_list_store_new (REVISION_NUM_COLS, GIGGLE_TYPE_REVISION);
 		revisions = giggle_git_revisions_get_revisions (GIGGLE_GIT_REVISIONS (job));
-
-		while (revisions) {
-			gtk_list_store_append (store, &iter);
-			gtk_list_store_set (store, &iter,
-					    REVISION_COL_OBJECT, revisions->data,
-					    -1);
-			revisions = revisions->next;
-		}
+		model = giggle_revision_model_new (revisions);
 
 		view_history_set_busy (GTK_WIDGET (priv->revision_list), FALSE);
-		giggle_rev_list_view_set_model (GIGGLE_REV_LIST_VIEW (priv->revision_list),
-						GTK_TREE_MODEL (store));
-		g_object_unref (store);
+		giggle_rev_list_view_set_model (GIGGLE_REV_LIST_VIEW (priv->revision_list), model);
+		g_object_unref (model);
 		g_object_unref (priv->job);
 		priv->job = NULL;
 
@@ -537,6 +525,17 @@ view_history_revision_list_key_press_cb (GiggleRevListView *list,
 	return TRUE;
 }
 
+static void
+view_history_search_progress_cb (GiggleSearchable *revision_list,
+				 guint             n_searched,
+				 guint             n_matches,
+				 gboolean          finished,
+				 const GError     *error,
+				 GiggleSearchable *view)
+{
+	giggle_searchable_emit_progress (view, n_searched, n_matches, finished, error);
+}
+
 static void
 view_history_setup_revision_list (GObject *object)
 {
@@ -556,6 +555,8 @@ view_history_setup_revision_list (GObject *object)
 			  G_CALLBACK (view_history_revision_list_selection_changed_cb), object);
 	g_signal_connect (priv->revision_list, "key-press-event",
 			  G_CALLBACK (view_history_revision_list_key_press_cb), object);
+	g_signal_connect (priv->revision_list, "search-progress",
+			  G_CALLBACK (view_history_search_progress_cb), object);
 
 	gtk_container_add (GTK_CONTAINER (priv->revision_list_sw), priv->revision_list);
 	gtk_widget_show_all (priv->revision_list_sw);
@@ -617,6 +618,8 @@ view_history_constructed (GObject *object)
 				  G_CALLBACK (view_history_git_dir_notify), object);
 	g_signal_connect_swapped (priv->git, "changed",
 				  G_CALLBACK (view_history_git_changed), object);
+	g_signal_connect_swapped (priv->git, "refs-changed",
+				  G_CALLBACK (view_history_git_changed), object);
 
 	priv->configuration = giggle_git_config_new ();
 
@@ -701,11 +704,23 @@ view_history_cancel_search (GiggleSearchable *searchable)
 	giggle_searchable_cancel (GIGGLE_SEARCHABLE (priv->revision_list));
 }
 
+static void
+view_history_set_search_filter (GiggleSearchable *searchable,
+				gboolean          filter)
+{
+	GiggleViewHistoryPriv *priv;
+
+	priv = GET_PRIV (searchable);
+
+	giggle_searchable_set_filter (GIGGLE_SEARCHABLE (priv->revision_list), filter);
+}
+
 static void
 giggle_view_history_searchable_init (GiggleSearchableIface *iface)
 {
 	iface->search = view_history_search;
 	iface->cancel = view_history_cancel_search;
+	iface->set_filter = view_history_set_search_filter;
 }
 
 static void
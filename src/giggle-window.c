@@ -87,6 +87,7 @@ typedef struct {
 
 	GtkWidget           *find_bar;
 	GtkToolItem         *full_search;
+	GtkToolItem         *filter_search;
 
 	/* Views */
 	GtkWidget           *file_view;
@@ -776,6 +777,38 @@ window_action_delete_cb (GtkAction    *action,
 		giggle_clipboard_delete (clipboard);
 }
 
+static void
+window_search_progress_cb (GiggleSearchable *searchable,
+			   guint             n_searched,
+			   guint             n_matches,
+			   gboolean          finished,
+			   const GError     *error,
+			   GiggleWindow     *window)
+{
+	GiggleWindowPriv *priv;
+	gchar            *text;
+
+	priv = GET_PRIV (window);
+
+	if (finished && error) {
+		text = g_strdup_printf (ngettext ("%u match, search failed: %s",
+						  "%u matches, search failed: %s",
+						  n_matches),
+					n_matches, error->message);
+	} else if (finished) {
+		text = g_strdup_printf (ngettext ("%u match", "%u matches", n_matches),
+					n_matches);
+	} else {
+		text = g_strdup_printf (ngettext ("Searching... %u match in %u commits",
+						  "Searching... %u matches in %u commits",
+						  n_matches),
+					n_matches, n_searched);
+	}
+
+	egg_find_bar_set_status_text (EGG_FIND_BAR (priv->find_bar), text);
+	g_free (text);
+}
+
 static void
 window_find (EggFindBar            *find_bar,
 	     GiggleWindow          *window,
@@ -798,6 +831,14 @@ window_find (EggFindBar            *find_bar,
 		full_search = gtk_toggle_tool_button_get_active (
 			GTK_TOGGLE_TOOL_BUTTON (priv->full_search));
 
+		giggle_searchable_set_filter (GIGGLE_SEARCHABLE (view),
+					      gtk_toggle_tool_button_get_active (
+						      GTK_TOGGLE_TOOL_BUTTON (priv->filter_search)));
+
+		g_signal_handlers_disconnect_by_func (view, window_search_progress_cb, window);
+		g_signal_connect (view, "search-progress",
+				  G_CALLBACK (window_search_progress_cb), window);
+
 		giggle_searchable_search (GIGGLE_SEARCHABLE (view),
 					  search_string, direction, full_search);
 	}
@@ -1364,6 +1405,23 @@ window_create_recent_manager (GiggleWindow *window)
 	window_recent_repositories_update (window);
 }
 
+static void
+window_filter_search_toggled_cb (GtkToggleToolButton *button,
+				 GiggleWindow        *window)
+{
+	GiggleWindowPriv *priv;
+	GiggleView       *view;
+
+	priv = GET_PRIV (window);
+
+	view = giggle_view_shell_get_selected (GIGGLE_VIEW_SHELL (priv->view_shell));
+
+	if (GIGGLE_IS_SEARCHABLE (view)) {
+		giggle_searchable_set_filter (GIGGLE_SEARCHABLE (view),
+					      gtk_toggle_tool_button_get_active (button));
+	}
+}
+
 static void
 window_cancel_find (GtkWidget    *widget,
 		    GiggleWindow *window)
@@ -1377,6 +1435,10 @@ window_cancel_find (GtkWidget    *widget,
 	g_return_if_fail (GIGGLE_IS_SEARCHABLE (view));
 
 	giggle_searchable_cancel (GIGGLE_SEARCHABLE (view));
+	egg_find_bar_set_status_text (EGG_FIND_BAR (priv->find_bar), NULL);
+
+	/* show everything again */
+	gtk_toggle_tool_button_set_active (GTK_TOGGLE_TOOL_BUTTON (priv->filter_search), FALSE);
 
 	gtk_widget_hide (widget);
 }
@@ -1403,6 +1465,17 @@ window_create_find_bar (GiggleWindow *window)
 
 	gtk_toolbar_insert (GTK_TOOLBAR (priv->find_bar), priv->full_search, -1);
 
+	priv->filter_search = gtk_toggle_tool_button_new ();
+	gtk_tool_button_set_label (GTK_TOOL_BUTTON (priv->filter_search), _("Show _Only Matches"));
+	gtk_tool_button_set_use_underline (GTK_TOOL_BUTTON (priv->filter_search), TRUE);
+	gtk_tool_item_set_is_important (priv->filter_search, TRUE);
+	gtk_widget_show (GTK_WIDGET (priv->filter_search));
+
+	gtk_toolbar_insert (GTK_TOOLBAR (priv->find_bar), priv->filter_search, -1);
+
+	g_signal_connect (priv->filter_search, "toggled",
+			  G_CALLBACK (window_filter_search_toggled_cb), window);
+
 	gtk_box_pack_end (GTK_BOX (priv->content_vbox), priv->find_bar, FALSE, FALSE, 0);
 
 	g_signal_connect (priv->find_bar, "close",
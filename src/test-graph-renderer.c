@@ -1,119 +1,361 @@
-#include <gtk/gtk.h>
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2007 Imendio AB
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Headless benchmark for GiggleGraphRenderer: builds synthetic
+ * histories, validates them and renders rows into an image surface.
+ */
+
+#include "config.h"
 #include "giggle-graph-renderer.h"
-#include "giggle-revision.h"
 
-GiggleBranchInfo *branch1;
-GiggleBranchInfo *branch2;
+#include <gtk/gtk.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#define FONT_SIZE  10
+#define ROW_HEIGHT 16
+
+#define SURFACE_WIDTH 2048
+
+typedef void (* GenerateFunc) (GPtrArray *revisions,
+			       GRand     *rand,
+			       guint      n_commits);
+
+typedef struct {
+	const char   *name;
+	GenerateFunc  generate;
+} Shape;
+
+static char     *shape_names = NULL;
+static char     *size_names = NULL;
+static int       n_render_rows = 10000;
+static int       lane_budget = 0;
+static int       seed = 42;
+
+static GOptionEntry options[] = {
+	{ "shapes", 's', 0, G_OPTION_ARG_STRING, &shape_names,
+	  "Comma separated list of history shapes (linear, octopus, parallel, kernel)", "SHAPES" },
+	{ "sizes", 'n', 0, G_OPTION_ARG_STRING, &size_names,
+	  "Comma separated list of commit counts (default: 10000,100000,1000000)", "SIZES" },
+	{ "render-rows", 'r', 0, G_OPTION_ARG_INT, &n_render_rows,
+	  "Number of rows to render per history (default: 10000)", "N" },
+	{ "lane-budget", 'l', 0, G_OPTION_ARG_INT, &lane_budget,
+	  "Lane budget of the renderer, 0 for no limit", "K" },
+	{ "seed", 0, 0, G_OPTION_ARG_INT, &seed,
+	  "Seed for the random shapes", "SEED" },
+	{ NULL }
+};
+
+static GiggleRevision *
+add_commit (GPtrArray      *revisions,
+	    GiggleRevision *parent)
+{
+	GiggleRevision *revision;
+	char            sha[41];
+
+	g_snprintf (sha, sizeof (sha), "%040x", revisions->len);
+	revision = giggle_revision_new (sha);
+
+	if (parent)
+		giggle_revision_add_parent (revision, parent);
+
+	g_ptr_array_add (revisions, revision);
+
+	return revision;
+}
+
+static void
+generate_linear (GPtrArray *revisions,
+		 GRand     *rand,
+		 guint      n_commits)
+{
+	GiggleRevision *head = NULL;
+
+	while (revisions->len < n_commits)
+		head = add_commit (revisions, head);
+}
+
+/* octopus merges of eight short topic branches */
+static void
+generate_octopus (GPtrArray *revisions,
+		  GRand     *rand,
+		  guint      n_commits)
+{
+	GiggleRevision *heads[8];
+	GiggleRevision *main_head;
+	int             i, j;
+
+	main_head = add_commit (revisions, NULL);
+
+	while (revisions->len + G_N_ELEMENTS (heads) * 8 + 1 < n_commits) {
+		for (i = 0; i < G_N_ELEMENTS (heads); ++i)
+			heads[i] = main_head;
+
+		for (j = 0; j < 8; ++j) {
+			for (i = 0; i < G_N_ELEMENTS (heads); ++i)
+				heads[i] = add_commit (revisions, heads[i]);
+		}
+
+		main_head = add_commit (revisions, main_head);
 
-static GList*
-get_branches (void)
+		for (i = 0; i < G_N_ELEMENTS (heads); ++i)
+			giggle_revision_add_parent (main_head, heads[i]);
+	}
+
+	while (revisions->len < n_commits)
+		main_head = add_commit (revisions, main_head);
+}
+
+/* many long-lived branches growing side by side */
+static void
+generate_parallel (GPtrArray *revisions,
+		   GRand     *rand,
+		   guint      n_commits)
 {
-	GList *list = NULL;
+	GiggleRevision *heads[64];
+	GiggleRevision *root;
+	int             i;
 
-	branch1 = giggle_branch_info_new ("master");
-	branch2 = giggle_branch_info_new ("foo");
+	root = add_commit (revisions, NULL);
 
-	list = g_list_prepend (list, branch2);
-	list = g_list_prepend (list, branch1);
-	return list;
+	for (i = 0; i < G_N_ELEMENTS (heads); ++i)
+		heads[i] = root;
+
+	while (revisions->len < n_commits) {
+		i = g_rand_int_range (rand, 0, G_N_ELEMENTS (heads));
+		heads[i] = add_commit (revisions, heads[i]);
+	}
 }
 
-static GtkTreeModel*
-create_model (void)
+/* a mainline merging topic branches of random length, which fork
+ * from random points of the recent mainline history */
+static void
+generate_kernel (GPtrArray *revisions,
+		 GRand     *rand,
+		 guint      n_commits)
+{
+	GPtrArray      *topics, *mainline;
+	GiggleRevision *main_head;
+	GiggleRevision *fork_point;
+	guint           i, depth;
+	double          dice;
+
+	topics = g_ptr_array_new ();
+	mainline = g_ptr_array_new ();
+	main_head = add_commit (revisions, NULL);
+	g_ptr_array_add (mainline, main_head);
+
+	while (revisions->len < n_commits) {
+		dice = g_rand_double (rand);
+
+		if (dice < 0.05 || (dice < 0.10 && topics->len < 4)) {
+			/* fork a new topic branch */
+			depth = MIN (mainline->len, 200);
+			i = mainline->len - 1 - g_rand_int_range (rand, 0, depth);
+			fork_point = g_ptr_array_index (mainline, i);
+			g_ptr_array_add (topics, add_commit (revisions, fork_point));
+		} else if (dice < 0.15 && topics->len > 0) {
+			/* merge a topic branch into mainline */
+			i = g_rand_int_range (rand, 0, topics->len);
+			main_head = add_commit (revisions, main_head);
+			giggle_revision_add_parent (main_head, g_ptr_array_index (topics, i));
+			g_ptr_array_remove_index_fast (topics, i);
+			g_ptr_array_add (mainline, main_head);
+		} else if (dice < 0.80 && topics->len > 0) {
+			/* commit to a topic branch */
+			i = g_rand_int_range (rand, 0, topics->len);
+			topics->pdata[i] = add_commit (revisions, topics->pdata[i]);
+		} else {
+			main_head = add_commit (revisions, main_head);
+			g_ptr_array_add (mainline, main_head);
+		}
+	}
+
+	g_ptr_array_free (mainline, TRUE);
+	g_ptr_array_free (topics, TRUE);
+}
+
+static const Shape shapes[] = {
+	{ "linear",   generate_linear },
+	{ "octopus",  generate_octopus },
+	{ "parallel", generate_parallel },
+	{ "kernel",   generate_kernel },
+};
+
+static glong
+get_peak_memory (void)
+{
+	struct rusage usage;
+
+	if (getrusage (RUSAGE_SELF, &usage))
+		return -1;
+
+	/* kilobytes on Linux */
+	return usage.ru_maxrss;
+}
+
+static GtkTreeModel *
+create_model (const Shape *shape,
+	      guint        n_commits)
 {
 	GtkListStore *store;
-	GtkTreeIter iter;
-
-	store = gtk_list_store_new (2, G_TYPE_POINTER, G_TYPE_STRING);
-
-	gtk_list_store_append (store, &iter);
-	gtk_list_store_set (store, &iter,
-			    0, giggle_revision_new_commit ("1", branch1),
-			    1, "another change",
-			    -1);
-
-	gtk_list_store_append (store, &iter);
-	gtk_list_store_set (store, &iter,
-			    0, giggle_revision_new_merge ("2", branch1, branch2),
-			    1, "merge branch foo",
-			    -1);
-
-	gtk_list_store_append (store, &iter);
-	gtk_list_store_set (store, &iter,
-			    0, giggle_revision_new_commit ("3", branch1),
-			    1, "fix something in branch master",
-			    -1);
-
-	gtk_list_store_append (store, &iter);
-	gtk_list_store_set (store, &iter,
-			    0, giggle_revision_new_commit ("4", branch2),
-			    1, "fix something in branch foo",
-			    -1);
-
-	gtk_list_store_append (store, &iter);
-	gtk_list_store_set (store, &iter,
-			    0, giggle_revision_new_branch ("5", branch1, branch2),
-			    1, "branched",
-			    -1);
-
-	gtk_list_store_append (store, &iter);
-	gtk_list_store_set (store, &iter,
-			    0, giggle_revision_new_commit ("6", branch1),
-			    1, "Initial commit",
-			    -1);
-
-	giggle_revision_validate (GTK_TREE_MODEL (store), 0);
+	GtkTreeIter   iter;
+	GPtrArray    *revisions;
+	GRand        *rand;
+	int           i;
+
+	revisions = g_ptr_array_sized_new (n_commits);
+	rand = g_rand_new_with_seed (seed);
+
+	shape->generate (revisions, rand, n_commits);
+
+	/* newest revisions come first, just like in git log */
+	store = gtk_list_store_new (1, GIGGLE_TYPE_REVISION);
+
+	for (i = revisions->len - 1; i >= 0; --i) {
+		gtk_list_store_insert_with_values (store, &iter, -1,
+						   0, revisions->pdata[i], -1);
+		g_object_unref (revisions->pdata[i]);
+	}
+
+	g_ptr_array_free (revisions, TRUE);
+	g_rand_free (rand);
 
 	return GTK_TREE_MODEL (store);
 }
 
-static GtkWidget*
-create_main_window (void)
+static void
+run_benchmark (const Shape *shape,
+	       guint        n_commits)
 {
-	GtkWidget *window, *treeview;
 	GtkCellRenderer *renderer;
-	GtkTreeModel *model;
-	GList *branches;
+	GtkTreeModel    *model;
+	GiggleRevision  *revision;
+	GtkTreeIter      iter;
+	cairo_surface_t *surface;
+	cairo_t         *cr;
+	GTimer          *timer;
+	double           t_model, t_validate, t_render;
+	glong            mem_model, mem_validate;
+	int              n_rows, i;
+
+	timer = g_timer_new ();
+	model = create_model (shape, n_commits);
+	t_model = g_timer_elapsed (timer, NULL);
+	mem_model = get_peak_memory ();
+
+	renderer = giggle_graph_renderer_new ();
+	g_object_ref_sink (renderer);
+	g_object_set (renderer, "lane-budget", lane_budget, NULL);
+
+	g_timer_start (timer);
+	giggle_graph_renderer_validate_model (GIGGLE_GRAPH_RENDERER (renderer), model, 0);
+	t_validate = g_timer_elapsed (timer, NULL);
+	mem_validate = get_peak_memory ();
+
+	/* rows get drawn over each other, like when scrolling a tree view */
+	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, SURFACE_WIDTH, ROW_HEIGHT * 64);
+	cr = cairo_create (surface);
 
-	window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
-	treeview = gtk_tree_view_new ();
-	branches = get_branches ();
-	model = create_model ();
+	n_rows = MIN ((guint) n_render_rows, n_commits);
+	g_timer_start (timer);
 
-	gtk_tree_view_set_model (GTK_TREE_VIEW (treeview), model);
+	for (i = 0; i < n_rows && gtk_tree_model_iter_nth_child (model, &iter, NULL, i); ++i) {
+		gtk_tree_model_get (model, &iter, 0, &revision, -1);
+
+		giggle_graph_renderer_render_revision (GIGGLE_GRAPH_RENDERER (renderer), cr, revision,
+						       FONT_SIZE, 0, (i % 64) * ROW_HEIGHT, ROW_HEIGHT);
+
+		g_object_unref (revision);
+	}
+
+	cairo_surface_flush (surface);
+	t_render = g_timer_elapsed (timer, NULL);
+
+	g_print ("%-8s %8u commits: model %7.3f s, validate %7.3f s, "
+		 "render %7.2f us/row (%d rows), peak %ld kB (%+ld kB validating)\n",
+		 shape->name, n_commits, t_model, t_validate,
+		 n_rows ? t_render * 1e6 / n_rows : 0.0, n_rows,
+		 mem_validate, mem_validate - mem_model);
+
+	cairo_destroy (cr);
+	cairo_surface_destroy (surface);
+	g_object_unref (renderer);
 	g_object_unref (model);
+	g_timer_destroy (timer);
+}
 
-	renderer = giggle_graph_renderer_new ();
-	gtk_tree_view_insert_column_with_attributes (GTK_TREE_VIEW (treeview), -1,
-						     "Graph",
-						     renderer,
-						     "revision", 0,
-						     NULL);
-
-	renderer = gtk_cell_renderer_text_new ();
-	gtk_tree_view_insert_column_with_attributes (GTK_TREE_VIEW (treeview), -1,
-						     "Comment",
-						     renderer,
-						     "text", 1,
-						     NULL);
-
-	gtk_container_add (GTK_CONTAINER (window), treeview);
-
-	return window;
+static const Shape *
+find_shape (const char *name)
+{
+	int i;
+
+	for (i = 0; i < G_N_ELEMENTS (shapes); ++i) {
+		if (!strcmp (shapes[i].name, name))
+			return &shapes[i];
+	}
+
+	return NULL;
 }
 
 int
-main (int argc, char *argv[])
+main (int    argc,
+      char **argv)
 {
-	GtkWidget *window;
+	GOptionContext  *context;
+	GError          *error = NULL;
+	char           **names, **sizes;
+	const Shape     *shape;
+	int              i, j;
+
+	g_type_init ();
+
+	context = g_option_context_new ("- benchmark the revision graph renderer");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s: %s\n", argv[0], error->message);
+		g_error_free (error);
+		return EXIT_FAILURE;
+	}
+
+	g_option_context_free (context);
+
+	names = g_strsplit (shape_names ? shape_names : "linear,octopus,parallel,kernel", ",", -1);
+	sizes = g_strsplit (size_names ? size_names : "10000,100000,1000000", ",", -1);
+
+	for (i = 0; names[i]; ++i) {
+		shape = find_shape (names[i]);
+
+		if (!shape) {
+			g_printerr ("%s: unknown shape \"%s\"\n", argv[0], names[i]);
+			continue;
+		}
 
-	gtk_init (&argc, &argv);
+		for (j = 0; sizes[j]; ++j)
+			run_benchmark (shape, strtoul (sizes[j], NULL, 10));
+	}
 
-	window = create_main_window ();
-	gtk_widget_show_all (window);
+	g_strfreev (names);
+	g_strfreev (sizes);
 
-	g_signal_connect (window, "delete-event",
-			  G_CALLBACK (gtk_main_quit), NULL);
-	gtk_main ();
-	return 0;
+	return EXIT_SUCCESS;
 }